@@ -56,6 +56,11 @@ public:
     void                        SortDeref() { ShellSort( m_Begin, m_Begin + m_Size, AscendingCompareDeref() ); }
     template < class COMPARER >
     void                        Sort( const COMPARER & comp ) { ShellSort( m_Begin, m_Begin + m_Size, comp ); }
+    // O(n log n), unstable - for large arrays
+    void                        QuickSort() { ::QuickSort( m_Begin, m_Begin + m_Size, AscendingCompare() ); }
+    void                        QuickSortDeref() { ::QuickSort( m_Begin, m_Begin + m_Size, AscendingCompareDeref() ); }
+    template < class COMPARER >
+    void                        QuickSort( const COMPARER & comp ) { ::QuickSort( m_Begin, m_Begin + m_Size, comp ); }
 
     // find
     template < class U >
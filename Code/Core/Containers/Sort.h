@@ -4,6 +4,7 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Move.h"
 #include "Core/Env/Types.h"
 
 // AscendingCompare
@@ -65,4 +66,155 @@ void ShellSort( T * begin, T * end, const COMPARE & compare )
     }
 }
 
+// QuickSort
+//------------------------------------------------------------------------------
+// O(n log n) unstable sort for large arrays, where ShellSort degrades to
+// quadratic time. Partitions around a median of three, falls back to heap sort
+// if partitioning degenerates and finishes small ranges with an insertion sort.
+//------------------------------------------------------------------------------
+namespace SortInternal
+{
+    template < class T >
+    void SwapItems( T & a, T & b )
+    {
+        T temp( Move( a ) );
+        a = Move( b );
+        b = Move( temp );
+    }
+
+    template < class T, class COMPARE >
+    void InsertionSort( T * begin, T * end, const COMPARE & compare )
+    {
+        for ( T * i = begin + 1; i < end; ++i )
+        {
+            T temp( Move( *i ) );
+            T * j = i;
+            while ( ( j > begin ) && compare( temp, *( j - 1 ) ) )
+            {
+                *j = Move( *( j - 1 ) );
+                --j;
+            }
+            *j = Move( temp );
+        }
+    }
+
+    template < class T, class COMPARE >
+    void SiftDown( T * begin, size_t root, size_t numItems, const COMPARE & compare )
+    {
+        for ( ;; )
+        {
+            size_t child = ( root * 2 ) + 1;
+            if ( child >= numItems )
+            {
+                return;
+            }
+            if ( ( child + 1 < numItems ) && compare( begin[ child ], begin[ child + 1 ] ) )
+            {
+                ++child;
+            }
+            if ( compare( begin[ root ], begin[ child ] ) == false )
+            {
+                return;
+            }
+            SwapItems( begin[ root ], begin[ child ] );
+            root = child;
+        }
+    }
+
+    template < class T, class COMPARE >
+    void HeapSort( T * begin, T * end, const COMPARE & compare )
+    {
+        size_t numItems = (size_t)( end - begin );
+        for ( size_t i = ( numItems / 2 ); i > 0; --i )
+        {
+            SiftDown( begin, i - 1, numItems, compare );
+        }
+        while ( numItems > 1 )
+        {
+            --numItems;
+            SwapItems( begin[ 0 ], begin[ numItems ] );
+            SiftDown( begin, 0, numItems, compare );
+        }
+    }
+
+    template < class T, class COMPARE >
+    void IntroSort( T * begin, T * end, const COMPARE & compare, size_t depthLimit )
+    {
+        const ptrdiff_t kInsertionSortThreshold = 16;
+        while ( ( end - begin ) > kInsertionSortThreshold )
+        {
+            if ( depthLimit == 0 )
+            {
+                HeapSort( begin, end, compare );
+                return;
+            }
+            --depthLimit;
+
+            // Order first, middle and last items, so both scans below are bounded
+            T * mid = begin + ( ( end - begin ) / 2 );
+            T * last = end - 1;
+            if ( compare( *mid, *begin ) )
+            {
+                SwapItems( *mid, *begin );
+            }
+            if ( compare( *last, *mid ) )
+            {
+                SwapItems( *last, *mid );
+                if ( compare( *mid, *begin ) )
+                {
+                    SwapItems( *mid, *begin );
+                }
+            }
+
+            // Partition around the median
+            const T pivot( *mid );
+            T * i = begin;
+            T * j = last;
+            for ( ;; )
+            {
+                while ( compare( *i, pivot ) )
+                {
+                    ++i;
+                }
+                while ( compare( pivot, *j ) )
+                {
+                    --j;
+                }
+                if ( i >= j )
+                {
+                    break;
+                }
+                SwapItems( *i, *j );
+                ++i;
+                --j;
+            }
+
+            // Recurse into the smaller half, iterate on the larger one
+            T * split = j + 1;
+            if ( ( split - begin ) < ( end - split ) )
+            {
+                IntroSort( begin, split, compare, depthLimit );
+                begin = split;
+            }
+            else
+            {
+                IntroSort( split, end, compare, depthLimit );
+                end = split;
+            }
+        }
+        InsertionSort( begin, end, compare );
+    }
+}
+
+template < class T, class COMPARE >
+void QuickSort( T * begin, T * end, const COMPARE & compare )
+{
+    size_t depthLimit = 0;
+    for ( size_t numItems = (size_t)( end - begin ); numItems > 1; numItems >>= 1 )
+    {
+        depthLimit += 2;
+    }
+    SortInternal::IntroSort( begin, end, compare, depthLimit );
+}
+
 //------------------------------------------------------------------------------
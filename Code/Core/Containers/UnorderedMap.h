@@ -15,6 +15,11 @@ namespace UnorderedMapKeyHashingFunctions
     {
         return xxHash::Calc32( key );
     }
+    inline uint32_t Hash( const void * key )
+    {
+        const uintptr_t value = reinterpret_cast< uintptr_t >( key );
+        return xxHash::Calc32( &value, sizeof( value ) );
+    }
 }
 
 // UnorderedMap
@@ -56,10 +61,14 @@ public:
 
     // Check if an item exists in the map
     [[nodiscard]] KeyValue *    Find( const KEY & key );
+    [[nodiscard]] const KeyValue * Find( const KEY & key ) const { return const_cast< UnorderedMap< KEY, VALUE > * >( this )->Find( key ); }
 
     // Add items to the map
     KeyValue &                  Insert( const KEY & key, const VALUE & value );
 
+    // Remove an item from the map (returns false if not present)
+    bool                        Erase( const KEY & key );
+
 protected:
     enum : uint32_t { kTableSizePower = 16 };
     enum : uint32_t { kTableSize = ( 1 << kTableSizePower ) };
@@ -179,4 +188,40 @@ typename UnorderedMap< KEY, VALUE >::KeyValue & UnorderedMap< KEY, VALUE >::Inse
     return *newKeyValue;
 }
 
+// Erase
+//------------------------------------------------------------------------------
+template< class KEY, class VALUE >
+bool UnorderedMap< KEY, VALUE >::Erase( const KEY & key )
+{
+    // Handle empty
+    if ( m_Buckets == nullptr )
+    {
+        return false;
+    }
+
+    // Hash the key
+    const uint32_t hash = UnorderedMapKeyHashingFunctions::Hash( key );
+
+    // Find the bucket
+    const uint32_t bucketId = ( hash & kTableSizeMask );
+    KeyValue ** link = &m_Buckets[ bucketId ];
+
+    // Unlink the matching entry from the bucket
+    while ( *link )
+    {
+        KeyValue * keyValue = *link;
+        if ( keyValue->m_Key == key )
+        {
+            *link = keyValue->m_Next;
+            FDELETE keyValue;
+            m_Count--;
+            return true;
+        }
+        link = &keyValue->m_Next;
+    }
+
+    // Not found
+    return false;
+}
+
 //------------------------------------------------------------------------------
@@ -36,6 +36,7 @@ private:
 
     void Sort() const;
     void SortDeref() const;
+    void QuickSort() const;
 
     void Find() const;
     void FindDeref() const;
@@ -104,6 +105,7 @@ REGISTER_TESTS_BEGIN( TestArray )
 
     REGISTER_TEST( Sort )
     REGISTER_TEST( SortDeref )
+    REGISTER_TEST( QuickSort )
 
     REGISTER_TEST( Find )
     REGISTER_TEST( FindDeref )
@@ -704,6 +706,72 @@ void TestArray::SortDeref() const
     }
 }
 
+// QuickSort
+//------------------------------------------------------------------------------
+void TestArray::QuickSort() const
+{
+    // Large enough to exercise partitioning as well as the insertion sort
+    const uint32_t numItems = 10000;
+
+    // POD - random, sorted, reversed and many duplicates
+    for ( uint32_t pattern = 0; pattern < 4; ++pattern )
+    {
+        Array<uint32_t> array;
+        uint32_t seed = 12345;
+        for ( uint32_t i = 0; i < numItems; ++i )
+        {
+            seed = ( seed * 1103515245 ) + 12345;
+            switch ( pattern )
+            {
+                case 0: array.Append( seed >> 8 );          break;
+                case 1: array.Append( i );                  break;
+                case 2: array.Append( numItems - i );       break;
+                default: array.Append( ( seed >> 8 ) % 4 ); break;
+            }
+        }
+        array.QuickSort();
+        CheckConsistency( array );
+        TEST_ASSERT( array.GetSize() == numItems );
+        for ( size_t i = 1; i < array.GetSize(); ++i )
+        {
+            TEST_ASSERT( array[ i - 1 ] <= array[ i ] );
+        }
+    }
+
+    // Complex type, with custom comparer
+    {
+        Array<AString> array;
+        AString string;
+        for ( uint32_t i = 0; i < numItems; ++i )
+        {
+            string.Format( "string%u", ( i * 7919 ) % numItems );
+            array.Append( string );
+        }
+        array.QuickSort( []( const AString & a, const AString & b ) { return ( b < a ); } );
+        CheckConsistency( array );
+        for ( size_t i = 1; i < array.GetSize(); ++i )
+        {
+            TEST_ASSERT( array[ i ] < array[ i - 1 ] );
+        }
+    }
+
+    // Deref
+    {
+        const AString string1( "string10" );
+        const AString string2( "string1" );
+        const AString string3( "string100" );
+        Array<const AString *> array;
+        array.Append( &string1 );
+        array.Append( &string2 );
+        array.Append( &string3 );
+        array.QuickSortDeref();
+        CheckConsistency( array );
+        TEST_ASSERT( *array[ 0 ] == "string1" );
+        TEST_ASSERT( *array[ 1 ] == "string10" );
+        TEST_ASSERT( *array[ 2 ] == "string100" );
+    }
+}
+
 // Find
 //------------------------------------------------------------------------------
 void TestArray::Find() const
@@ -35,6 +35,7 @@ private:
     void FileMove() const;
     void ReadOnly() const;
     void FileTime() const;
+    void FileTimeBatch() const;
     void LongPaths() const;
     #if defined( __WINDOWS__ )
         void NormalizeWindowsPathCasing() const;
@@ -55,6 +56,7 @@ REGISTER_TESTS_BEGIN( TestFileIO )
     REGISTER_TEST( FileMove )
     REGISTER_TEST( ReadOnly )
     REGISTER_TEST( FileTime )
+    REGISTER_TEST( FileTimeBatch )
     REGISTER_TEST( LongPaths )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( NormalizeWindowsPathCasing )
@@ -313,6 +315,45 @@ void TestFileIO::FileTime() const
     TEST_ASSERT( timeNow == oldTime );
 }
 
+// FileTimeBatch
+//------------------------------------------------------------------------------
+void TestFileIO::FileTimeBatch() const
+{
+    // generate some process unique file paths
+    AStackString<> pathA;
+    AStackString<> pathB;
+    AStackString<> pathMissing;
+    GenerateTempFileName( pathA );
+    GenerateTempFileName( pathB );
+    GenerateTempFileName( pathMissing );
+
+    // create files
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( pathA.Get(), FileStream::WRITE_ONLY ) == true );
+        f.Close();
+        TEST_ASSERT( f.Open( pathB.Get(), FileStream::WRITE_ONLY ) == true );
+        f.Close();
+    }
+
+    // Times should match those obtained individually, with missing files
+    // in the middle of a batch reported as such
+    AStackString<> noDirectory( "FileWithNoDirectory" );
+    const AString * fileNames[] = { &pathA, &pathMissing, &pathB, &noDirectory, &pathA };
+    uint64_t times[ 5 ] = { 1, 1, 1, 1, 1 };
+    FileIO::GetFileLastWriteTimes( fileNames, 5, times );
+    TEST_ASSERT( times[ 0 ] != 0 );
+    TEST_ASSERT( times[ 0 ] == FileIO::GetFileLastWriteTime( pathA ) );
+    TEST_ASSERT( times[ 1 ] == 0 );
+    TEST_ASSERT( times[ 2 ] != 0 );
+    TEST_ASSERT( times[ 2 ] == FileIO::GetFileLastWriteTime( pathB ) );
+    TEST_ASSERT( times[ 3 ] == 0 );
+    TEST_ASSERT( times[ 4 ] == times[ 0 ] );
+
+    FileIO::FileDelete( pathA.Get() );
+    FileIO::FileDelete( pathB.Get() );
+}
+
 // LongPaths
 //------------------------------------------------------------------------------
 void TestFileIO::LongPaths() const
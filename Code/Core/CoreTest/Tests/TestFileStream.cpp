@@ -8,6 +8,7 @@
 // Core
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
 #include "Core/Process/Process.h"
 #include "Core/Strings/AStackString.h"
 
@@ -20,6 +21,7 @@ private:
 
     void WriteOnly() const;
     void ReadOnly() const;
+    void MemoryMapped() const;
 
     // Helpers
     mutable uint32_t m_TempFileId = 0;
@@ -31,6 +33,7 @@ private:
 REGISTER_TESTS_BEGIN( TestFileStream )
     REGISTER_TEST( WriteOnly )
     REGISTER_TEST( ReadOnly )
+    REGISTER_TEST( MemoryMapped )
 REGISTER_TESTS_END
 
 // WriteOnly
@@ -111,6 +114,58 @@ void TestFileStream::ReadOnly() const
     TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
 }
 
+// MemoryMapped
+//------------------------------------------------------------------------------
+void TestFileStream::MemoryMapped() const
+{
+    AStackString<> fileName;
+    GenerateTempFileName( fileName );
+
+    // Missing file
+    {
+        MemoryMappedFile f;
+        TEST_ASSERT( f.Open( fileName.Get() ) == false );
+        TEST_ASSERT( f.IsOpen() == false );
+    }
+
+    // Empty file
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == true );
+    }
+    {
+        MemoryMappedFile f;
+        TEST_ASSERT( f.Open( fileName.Get() ) == true );
+        TEST_ASSERT( f.GetSize() == 0 );
+    }
+
+    // Create a file and put some data in it
+    const AStackString<> data( "Some Data To Store In A File" );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) == true );
+        TEST_ASSERT( f.WriteBuffer( data.Get(), data.GetLength() ) == data.GetLength() );
+    }
+
+    // Map and check contents
+    {
+        MemoryMappedFile f;
+        TEST_ASSERT( f.Open( fileName.Get() ) == true );
+        TEST_ASSERT( f.IsOpen() == true );
+        TEST_ASSERT( f.GetSize() == data.GetLength() );
+        const char * mappedData = static_cast< const char * >( f.GetData() );
+        const AStackString<> mapped( mappedData, mappedData + f.GetSize() );
+        TEST_ASSERT( mapped == data );
+
+        f.Close();
+        TEST_ASSERT( f.IsOpen() == false );
+        TEST_ASSERT( f.GetData() == nullptr );
+    }
+
+    // Clean up
+    TEST_ASSERT( FileIO::FileDelete( fileName.Get() ) );
+}
+
 // GenerateTempFileName
 //------------------------------------------------------------------------------
 void TestFileStream::GenerateTempFileName( AString & outTempFileName ) const
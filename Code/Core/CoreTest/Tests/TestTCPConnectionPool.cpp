@@ -47,6 +47,10 @@ private:
     void TestMultipleServersOneClient() const;
     void TestConnectionCount() const;
     void TestDataTransfer() const;
+    void TestManyConnections() const;
+    void TestSendGatheredPayload() const;
+    void TestPauseReceive() const;
+    void TestThreadPerConnection() const;
 
     void TestConnectionStuckDuringSend() const;
     static uint32_t TestConnectionStuckDuringSend_ThreadFunc( void * userData );
@@ -74,6 +78,10 @@ REGISTER_TESTS_BEGIN( TestTestTCPConnectionPool )
     REGISTER_TEST( TestMultipleServersOneClient )
     REGISTER_TEST( TestConnectionCount )
     REGISTER_TEST( TestDataTransfer )
+    REGISTER_TEST( TestManyConnections )
+    REGISTER_TEST( TestSendGatheredPayload )
+    REGISTER_TEST( TestPauseReceive )
+    REGISTER_TEST( TestThreadPerConnection )
     REGISTER_TEST( TestConnectionStuckDuringSend )
     REGISTER_TEST( TestConnectionFailure )
 REGISTER_TESTS_END
@@ -264,6 +272,218 @@ void TestTestTCPConnectionPool::TestDataTransfer() const
     client.ShutdownAllConnections();
 }
 
+// TestManyConnections
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestManyConnections() const
+{
+    // a server which counts connection events and received messages
+    class CountingServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~CountingServer() override { ShutdownAllConnections(); }
+        virtual void OnConnected( const ConnectionInfo * ) override { AtomicInc( &m_NumConnected ); }
+        virtual void OnDisconnected( const ConnectionInfo * ) override { AtomicInc( &m_NumDisconnected ); }
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t size, bool & ) override
+        {
+            AtomicInc( &m_NumMessages );
+            AtomicAdd( &m_ReceivedBytes, size );
+        }
+        volatile uint32_t m_NumConnected = 0;
+        volatile uint32_t m_NumDisconnected = 0;
+        volatile uint32_t m_NumMessages = 0;
+        volatile uint32_t m_ReceivedBytes = 0;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    CountingServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    // many connections from one pool, more than the number of threads servicing them
+    const uint32_t numConnections = 16;
+    TCPConnectionPool client;
+    const ConnectionInfo * connections[ numConnections ];
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        // Allow each connection to be retried in case of local resource exhaustion
+        const Timer t;
+        while ( ( connections[ i ] = client.Connect( AStackString<>( "127.0.0.1" ), testPort ) ) == nullptr )
+        {
+            TEST_ASSERTM( t.GetElapsed() < 5.0f, "Failed to connect. (Connection %u)", i );
+            Thread::Sleep( 50 );
+        }
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumConnected ) == numConnections );
+
+    // send messages of various sizes (including empty ones) on every connection
+    const char data[ 256 ] = { 0 };
+    uint32_t expectedBytes = 0;
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        TEST_ASSERT( client.Send( connections[ i ], data, 0 ) );
+        TEST_ASSERT( client.Send( connections[ i ], data, i ) );
+        TEST_ASSERT( client.Send( connections[ i ], data, sizeof( data ) ) );
+        expectedBytes += ( i + (uint32_t)sizeof( data ) );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumMessages ) == ( numConnections * 3 ) );
+    TEST_ASSERT( AtomicLoadRelaxed( &server.m_ReceivedBytes ) == expectedBytes );
+
+    // dropping the connections is seen by the server
+    client.ShutdownAllConnections();
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumDisconnected ) == numConnections );
+    WAIT_UNTIL_WITH_TIMEOUT( server.GetNumConnections() == 0 );
+}
+
+// TestSendGatheredPayload
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestSendGatheredPayload() const
+{
+    // a server which records the message and payload it receives
+    class TestServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~TestServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void * data, uint32_t size, bool & ) override
+        {
+            AString & dest = ( m_NumReceived == 0 ) ? m_Message : m_Payload;
+            dest.Assign( (const char *)data, (const char *)data + size );
+            AtomicInc( &m_NumReceived );
+        }
+        AString m_Message;
+        AString m_Payload;
+        volatile uint32_t m_NumReceived = 0;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    TestServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    TCPConnectionPool client;
+    const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    // payload header and data are gathered from separate buffers into one payload
+    const AStackString<> msg( "Message" );
+    const AStackString<> payloadHeader( "Header" );
+    const AStackString<> payloadData( "PayloadData" );
+    TEST_ASSERT( client.Send( ci,
+                              msg.Get(), msg.GetLength(),
+                              payloadHeader.Get(), payloadHeader.GetLength(),
+                              payloadData.Get(), payloadData.GetLength() ) );
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumReceived ) == 2 );
+    TEST_ASSERT( server.m_Message == "Message" );
+    TEST_ASSERT( server.m_Payload == "HeaderPayloadData" );
+
+    client.ShutdownAllConnections();
+}
+
+// TestPauseReceive
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestPauseReceive() const
+{
+    // a server which stops receiving after every second message
+    class PausingServer : public TCPConnectionPool
+    {
+    public:
+        virtual ~PausingServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo * connection, void *, uint32_t, bool & ) override
+        {
+            m_Connection = connection;
+            if ( ( AtomicInc( &m_NumReceived ) % 2 ) == 0 )
+            {
+                PauseReceive( connection );
+            }
+        }
+        const ConnectionInfo * volatile m_Connection = nullptr;
+        volatile uint32_t m_NumReceived = 0;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    PausingServer server;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    TCPConnectionPool client;
+    const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+    TEST_ASSERT( ci );
+
+    const AStackString<> msg( "Message" );
+    for ( uint32_t i = 0; i < 5; ++i )
+    {
+        TEST_ASSERT( client.Send( ci, msg.Get(), msg.GetLength() ) );
+    }
+
+    // nothing more is received while paused
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumReceived ) == 2 );
+    Thread::Sleep( 200 );
+    TEST_ASSERT( AtomicLoadRelaxed( &server.m_NumReceived ) == 2 );
+
+    // until resumed
+    server.ResumeReceive( server.m_Connection );
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumReceived ) == 4 );
+    Thread::Sleep( 200 );
+    TEST_ASSERT( AtomicLoadRelaxed( &server.m_NumReceived ) == 4 );
+
+    // a paused connection can still be disconnected
+    server.ShutdownAllConnections();
+    TEST_ASSERT( AtomicLoadRelaxed( &server.m_NumReceived ) == 4 );
+    WAIT_UNTIL_WITH_TIMEOUT( client.GetNumConnections() == 0 );
+
+    client.ShutdownAllConnections();
+}
+
+// TestThreadPerConnection
+//------------------------------------------------------------------------------
+void TestTestTCPConnectionPool::TestThreadPerConnection() const
+{
+    // a server whose callbacks block until every connection has received a
+    // message, which needs a thread for each connection
+    class BlockingServer : public TCPConnectionPool
+    {
+    public:
+        BlockingServer() : TCPConnectionPool( true ) {}
+        virtual ~BlockingServer() override { ShutdownAllConnections(); }
+        virtual void OnReceive( const ConnectionInfo *, void *, uint32_t, bool & ) override
+        {
+            AtomicInc( &m_NumReceived );
+            const Timer t;
+            while ( AtomicLoadRelaxed( &m_NumReceived ) < m_NumExpected )
+            {
+                if ( t.GetElapsed() > 30.0f )
+                {
+                    return; // Blocked by another connection
+                }
+                Thread::Sleep( 1 );
+            }
+            AtomicInc( &m_NumUnblocked );
+        }
+        uint32_t m_NumExpected = 0;
+        volatile uint32_t m_NumReceived = 0;
+        volatile uint32_t m_NumUnblocked = 0;
+    };
+
+    const uint16_t testPort( TEST_PORT );
+
+    // more connections than the number of threads shared by connections otherwise
+    const uint32_t numConnections = 16;
+    BlockingServer server;
+    server.m_NumExpected = numConnections;
+    TEST_ASSERT( server.Listen( testPort ) );
+
+    TCPConnectionPool client;
+    for ( uint32_t i = 0; i < numConnections; ++i )
+    {
+        const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), testPort );
+        TEST_ASSERT( ci );
+        const AStackString<> msg( "Message" );
+        TEST_ASSERT( client.Send( ci, msg.Get(), msg.GetLength() ) );
+    }
+    WAIT_UNTIL_WITH_TIMEOUT( AtomicLoadRelaxed( &server.m_NumUnblocked ) == numConnections );
+
+    client.ShutdownAllConnections();
+}
+
 // TestConnectionStuckDuringSend
 //------------------------------------------------------------------------------
 void TestTestTCPConnectionPool::TestConnectionStuckDuringSend() const
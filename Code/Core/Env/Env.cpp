@@ -27,7 +27,12 @@
     #include <linux/limits.h>
 #endif
 
+#if defined( __LINUX__ )
+    extern char ** environ;
+#endif
+
 #if defined( __APPLE__ )
+    #include <crt_externs.h>
     #include <mach-o/dyld.h>
     extern "C"
     {
@@ -168,6 +173,36 @@
     #endif
 }
 
+// GetEnvironment
+//------------------------------------------------------------------------------
+/*static*/ void Env::GetEnvironment( Array< AString > & outEnvironment )
+{
+    #if defined( __WINDOWS__ )
+        char * envStrings = ::GetEnvironmentStrings();
+        for ( const char * envVar = envStrings; *envVar; envVar += ( AString::StrLen( envVar ) + 1 ) )
+        {
+            // Skip hidden per-drive current dirs ("=C:=C:\Dir")
+            if ( envVar[ 0 ] != '=' )
+            {
+                outEnvironment.EmplaceBack( envVar );
+            }
+        }
+        ::FreeEnvironmentStrings( envStrings );
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        #if defined( __APPLE__ )
+            const char * const * envVars = *_NSGetEnviron();
+        #else
+            const char * const * envVars = environ;
+        #endif
+        for ( const char * const * envVar = envVars; *envVar; ++envVar )
+        {
+            outEnvironment.EmplaceBack( *envVar );
+        }
+    #else
+        #error Unknown platform
+    #endif
+}
+
 // GetCmdLine
 //------------------------------------------------------------------------------
 /*static*/ void Env::GetCmdLine( AString & cmdLine )
@@ -32,6 +32,7 @@ public:
 
     static bool GetEnvVariable( const char * envVarName, AString & envVarValue );
     static bool SetEnvVariable( const char * envVarName, const AString & envVarValue );
+    static void GetEnvironment( Array< AString > & outEnvironment ); // "NAME=value" for each variable
     static void GetCmdLine( AString & cmdLine );
     static void GetExePath( AString & path );
     static bool IsStdOutRedirected( const bool recheck = false );
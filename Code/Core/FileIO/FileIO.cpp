@@ -33,8 +33,10 @@
     #include <sys/stat.h>
     #include <unistd.h>
 #endif
-#if defined( __LINUX__ )
+#if defined( __LINUX__ ) || defined( __APPLE__ )
     #include <fcntl.h>
+#endif
+#if defined( __LINUX__ )
     #include <sys/sendfile.h>
 #endif
 #if defined( __APPLE__ )
@@ -766,6 +768,76 @@
     return 0;
 }
 
+// GetFileLastWriteTimes
+//------------------------------------------------------------------------------
+/*static*/ void FileIO::GetFileLastWriteTimes( const AString * const * fileNames, size_t numFiles, uint64_t * outLastWriteTimes )
+{
+    #if defined( __WINDOWS__ )
+        for ( size_t i = 0; i < numFiles; ++i )
+        {
+            outLastWriteTimes[ i ] = GetFileLastWriteTime( *fileNames[ i ] );
+        }
+    #elif defined( __LINUX__ ) || defined( __APPLE__ )
+        // Files are stat'd relative to their directory, so the directory path
+        // is resolved only once for each run of files in the same directory
+        AStackString<> dirName;
+        int dirFd = -1;
+        bool haveDir = false;
+        for ( size_t i = 0; i < numFiles; ++i )
+        {
+            const AString & fileName = *fileNames[ i ];
+            const char * lastSlash = fileName.FindLast( NATIVE_SLASH );
+            if ( lastSlash == nullptr )
+            {
+                outLastWriteTimes[ i ] = GetFileLastWriteTime( fileName );
+                continue;
+            }
+
+            // Moved to a different directory?
+            const size_t dirLen = (size_t)( lastSlash - fileName.Get() );
+            if ( ( haveDir == false ) ||
+                 ( dirName.GetLength() != dirLen ) ||
+                 ( AString::StrNCmp( dirName.Get(), fileName.Get(), dirLen ) != 0 ) )
+            {
+                if ( dirFd != -1 )
+                {
+                    close( dirFd );
+                }
+                dirName.Assign( fileName.Get(), lastSlash );
+                dirFd = open( dirLen ? dirName.Get() : "/", O_RDONLY | O_DIRECTORY );
+                haveDir = true;
+            }
+
+            // Fall back to stat'ing the full path if the directory couldn't be opened
+            if ( dirFd == -1 )
+            {
+                outLastWriteTimes[ i ] = GetFileLastWriteTime( fileName );
+                continue;
+            }
+
+            struct stat st;
+            if ( fstatat( dirFd, lastSlash + 1, &st, AT_SYMLINK_NOFOLLOW ) == 0 )
+            {
+                #if defined( __APPLE__ )
+                    outLastWriteTimes[ i ] = ( ( (uint64_t)st.st_mtimespec.tv_sec * 1000000000ULL ) + (uint64_t)st.st_mtimespec.tv_nsec );
+                #else
+                    outLastWriteTimes[ i ] = ( ( (uint64_t)st.st_mtim.tv_sec * 1000000000ULL ) + (uint64_t)st.st_mtim.tv_nsec );
+                #endif
+            }
+            else
+            {
+                outLastWriteTimes[ i ] = 0;
+            }
+        }
+        if ( dirFd != -1 )
+        {
+            close( dirFd );
+        }
+    #else
+        #error Unknown platform
+    #endif
+}
+
 // SetFileLastWriteTime
 //------------------------------------------------------------------------------
 /*static*/ bool FileIO::SetFileLastWriteTime( const AString & fileName, uint64_t fileTime )
@@ -806,7 +878,7 @@
             t[ 0 ].tv_sec = fileTime / 1000000000ULL;
             t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
             t[ 1 ] = t[ 0 ];
-            return ( (gOSXHelper_utimensat.m_FuncPtr)( 0, fileName.Get(), t, 0 ) == 0 );
+            return ( (gOSXHelper_utimensat.m_FuncPtr)( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
         }
     
         // Fallback to regular low-resolution filetime setting
@@ -820,7 +892,7 @@
         t[ 0 ].tv_sec = fileTime / 1000000000ULL;
         t[ 0 ].tv_nsec = ( fileTime % 1000000000ULL );
         t[ 1 ] = t[ 0 ];
-        return ( utimensat( 0, fileName.Get(), t, 0 ) == 0 );
+        return ( utimensat( AT_FDCWD, fileName.Get(), t, 0 ) == 0 );
     #else
         #error Unknown platform
     #endif
@@ -837,13 +909,13 @@
         // Use higher precision function if available
         if ( gOSXHelper_utimensat.m_FuncPtr )
         {
-            return ( (gOSXHelper_utimensat.m_FuncPtr)( 0, fileName.Get(), nullptr, 0 ) == 0 );
+            return ( (gOSXHelper_utimensat.m_FuncPtr)( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
         }
     
         // Fallback to regular low-resolution filetime setting
         return ( utimes( fileName.Get(), nullptr ) == 0 );
     #elif defined( __LINUX__ )
-        return ( utimensat( 0, fileName.Get(), nullptr, 0 ) == 0 );
+        return ( utimensat( AT_FDCWD, fileName.Get(), nullptr, 0 ) == 0 );
     #else
         #error Unknown platform
     #endif
@@ -60,6 +60,7 @@ public:
     #endif
 
     static uint64_t GetFileLastWriteTime( const AString & fileName );
+    static void     GetFileLastWriteTimes( const AString * const * fileNames, size_t numFiles, uint64_t * outLastWriteTimes );
     static bool     SetFileLastWriteTime( const AString & fileName, uint64_t fileTime );
     static bool     SetFileLastWriteTimeToNow( const AString & fileName );
 
@@ -0,0 +1,160 @@
+// MemoryMappedFile.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "MemoryMappedFile.h"
+
+// Core
+#include "Core/Env/Assert.h"
+
+// system
+#if defined( __WINDOWS__ )
+    #include "Core/Env/WindowsHeader.h"
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::MemoryMappedFile()
+    : m_Data( nullptr )
+    , m_Size( 0 )
+    , m_IsOpen( false )
+    #if defined( __WINDOWS__ )
+        , m_MapFile( nullptr )
+    #endif
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+// Open
+//------------------------------------------------------------------------------
+bool MemoryMappedFile::Open( const char * fileName )
+{
+    ASSERT( m_IsOpen == false );
+
+    #if defined( __WINDOWS__ )
+        HANDLE h = CreateFile( fileName,                  // _In_     LPCTSTR lpFileName,
+                               GENERIC_READ,              // _In_     DWORD dwDesiredAccess,
+                               FILE_SHARE_READ,           // _In_     DWORD dwShareMode,
+                               nullptr,                   // _In_opt_ LPSECURITY_ATTRIBUTES lpSecurityAttributes,
+                               OPEN_EXISTING,             // _In_     DWORD dwCreationDisposition,
+                               FILE_FLAG_SEQUENTIAL_SCAN, // _In_     DWORD dwFlagsAndAttributes,
+                               nullptr );                 // _In_opt_ HANDLE hTemplateFile
+        if ( h == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if ( GetFileSizeEx( h, &fileSize ) == FALSE )
+        {
+            CloseHandle( h );
+            return false;
+        }
+        m_Size = (size_t)fileSize.QuadPart;
+
+        // Empty files can't be mapped, but are valid
+        if ( m_Size > 0 )
+        {
+            m_MapFile = CreateFileMapping( h, nullptr, PAGE_READONLY, 0, 0, nullptr );
+            if ( m_MapFile )
+            {
+                m_Data = MapViewOfFile( m_MapFile, FILE_MAP_READ, 0, 0, 0 );
+            }
+        }
+
+        // The mapping keeps the file open
+        CloseHandle( h );
+
+        if ( ( m_Size > 0 ) && ( m_Data == nullptr ) )
+        {
+            if ( m_MapFile )
+            {
+                CloseHandle( m_MapFile );
+                m_MapFile = nullptr;
+            }
+            m_Size = 0;
+            return false;
+        }
+    #else
+        const int fd = open( fileName, O_RDONLY );
+        if ( fd == -1 )
+        {
+            return false;
+        }
+
+        struct stat st;
+        if ( fstat( fd, &st ) != 0 )
+        {
+            close( fd );
+            return false;
+        }
+        m_Size = (size_t)st.st_size;
+
+        // Empty files can't be mapped, but are valid
+        if ( m_Size > 0 )
+        {
+            void * data = mmap( nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( data == MAP_FAILED )
+            {
+                close( fd );
+                m_Size = 0;
+                return false;
+            }
+            m_Data = data;
+
+            // Data is generally consumed from start to finish
+            (void)madvise( data, m_Size, MADV_SEQUENTIAL );
+        }
+
+        // The mapping keeps the file open
+        close( fd );
+    #endif
+
+    m_IsOpen = true;
+    return true;
+}
+
+// Close
+//------------------------------------------------------------------------------
+void MemoryMappedFile::Close()
+{
+    if ( m_IsOpen == false )
+    {
+        return;
+    }
+
+    #if defined( __WINDOWS__ )
+        if ( m_Data )
+        {
+            UnmapViewOfFile( m_Data );
+        }
+        if ( m_MapFile )
+        {
+            CloseHandle( m_MapFile );
+            m_MapFile = nullptr;
+        }
+    #else
+        if ( m_Data )
+        {
+            munmap( const_cast< void * >( m_Data ), m_Size );
+        }
+    #endif
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_IsOpen = false;
+}
+
+//------------------------------------------------------------------------------
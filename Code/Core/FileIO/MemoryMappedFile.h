@@ -0,0 +1,36 @@
+// MemoryMappedFile - read only access to a file mapped into memory
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// MemoryMappedFile
+//
+// NOTE: Accessing the mapping after the file is truncated by another process
+// faults, so only map files which cannot be modified while in use.
+//------------------------------------------------------------------------------
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    bool Open( const char * fileName );
+    void Close();
+
+    inline bool         IsOpen() const  { return m_IsOpen; }
+    inline const void * GetData() const { return m_Data; }
+    inline size_t       GetSize() const { return m_Size; }
+
+private:
+    const void *    m_Data;
+    size_t          m_Size;
+    bool            m_IsOpen;
+    #if defined( __WINDOWS__ )
+        void *      m_MapFile;
+    #endif
+};
+
+//------------------------------------------------------------------------------
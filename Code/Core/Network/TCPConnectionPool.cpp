@@ -7,7 +7,9 @@
 #include "TCPConnectionPool.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/Env/ErrorFormat.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Network/Network.h"
 #include "Core/Process/Atomic.h"
@@ -26,11 +28,16 @@
     #include <netdb.h>
     #include <netinet/in.h>
     #include <netinet/tcp.h>
+    #include <poll.h>
     #include <string.h>
     #include <sys/ioctl.h>
     #include <sys/socket.h>
     #include <sys/uio.h>
     #include <unistd.h>
+    #if defined( __LINUX__ )
+        #include <sys/epoll.h>
+        #include <sys/eventfd.h>
+    #endif
     #define INVALID_SOCKET ( -1 )
     #define SOCKET_ERROR -1
 #else
@@ -49,6 +56,17 @@
     #define TCPDEBUG( ... ) (void)0
 #endif
 
+// Constants
+//------------------------------------------------------------------------------
+#if defined( __LINUX__ )
+    namespace
+    {
+        // Messages received per wakeup, so a busy connection can't starve others
+        // sharing the same I/O thread
+        constexpr uint32_t kMaxMessagesPerWakeup = 16;
+    }
+#endif
+
 // TCPConnectionPoolProfileHelper
 //------------------------------------------------------------------------------
 #if defined( PROFILING_ENABLED )
@@ -134,22 +152,40 @@ ConnectionInfo::ConnectionInfo( TCPConnectionPool * ownerPool )
     , m_RemoteAddress( 0 )
     , m_RemotePort( 0 )
     , m_ThreadQuitNotification( false )
+    , m_ReceivePaused( false )
     , m_TCPConnectionPool( ownerPool )
     , m_UserData( nullptr )
     #ifdef DEBUG
         , m_SendSocketInUseThreadId( INVALID_THREAD_ID )
     #endif
+    #if defined( __LINUX__ )
+        , m_Connected( false )
+        , m_Parked( false )
+        , m_ReadHeaderBytes( 0 )
+        , m_ReadSize( 0 )
+        , m_ReadBytes( 0 )
+        , m_ReadBuffer( nullptr )
+    #endif
 {
     ASSERT( ownerPool );
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-TCPConnectionPool::TCPConnectionPool()
+TCPConnectionPool::TCPConnectionPool( bool threadPerConnection )
     : m_ListenConnection( nullptr )
     , m_Connections( 8, true )
     , m_ShuttingDown( false )
+    #if defined( __LINUX__ )
+        , m_ThreadPerConnection( threadPerConnection )
+        , m_EpollFD( -1 )
+        , m_StopIOThreadsFD( -1 )
+        , m_NumIOThreads( 0 )
+    #endif
 {
+    #if !defined( __LINUX__ )
+        (void)threadPerConnection; // Always the case
+    #endif
 }
 
 // DESTRUCTOR
@@ -197,6 +233,11 @@ void TCPConnectionPool::ShutdownAllConnections()
         m_ConnectionsMutex.Lock();
     }
     m_ConnectionsMutex.Unlock();
+
+    #if defined( __LINUX__ )
+        // all connections are gone, so the I/O threads are idle
+        StopIOThreads();
+    #endif
 }
 
 // GetAddressAsString
@@ -438,7 +479,7 @@ const ConnectionInfo * TCPConnectionPool::Connect( uint32_t hostIP, uint16_t por
         ASSERT( false ); // should never get here
     }
 
-    return CreateConnectionThread( sockfd, hostIP, port, userData );
+    return CreateConnection( sockfd, hostIP, port, userData );
 }
 
 // Disconnect
@@ -466,6 +507,19 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     if ( iter != nullptr )
     {
         ci->m_ThreadQuitNotification.Store( true );
+        #if defined( __LINUX__ )
+            // Wake the I/O thread (the socket becomes readable) and
+            // abort any Send in progress. The socket remains valid
+            // until the connection is destroyed, which requires the lock.
+            shutdown( ci->m_Socket, SHUT_RDWR );
+
+            // A paused connection must be serviced to be destroyed
+            if ( ci->m_Parked )
+            {
+                ci->m_Parked = false;
+                ArmForRead( ci );
+            }
+        #endif
         return;
     }
 
@@ -474,6 +528,39 @@ void TCPConnectionPool::Disconnect( const ConnectionInfo * ci )
     // on another thread
 }
 
+// PauseReceive
+//------------------------------------------------------------------------------
+void TCPConnectionPool::PauseReceive( const ConnectionInfo * ci )
+{
+    ASSERT( ci );
+
+    // Takes effect once OnReceive returns
+    ci->m_ReceivePaused.Store( true );
+}
+
+// ResumeReceive
+//------------------------------------------------------------------------------
+void TCPConnectionPool::ResumeReceive( const ConnectionInfo * ci )
+{
+    ASSERT( ci );
+
+    // As for Disconnect, the connection may have been lost already
+    MutexHolder mh( m_ConnectionsMutex );
+    if ( m_Connections.Find( ci ) == nullptr )
+    {
+        return;
+    }
+
+    ci->m_ReceivePaused.Store( false );
+    #if defined( __LINUX__ )
+        if ( ci->m_Parked )
+        {
+            ci->m_Parked = false;
+            ArmForRead( ci );
+        }
+    #endif
+}
+
 // SetShuttingDown
 //------------------------------------------------------------------------------
 void TCPConnectionPool::SetShuttingDown()
@@ -533,6 +620,45 @@ bool TCPConnectionPool::Send( const ConnectionInfo * connection, const void * da
     return SendInternal( connection, buffers, 4, timeoutMS );
 }
 
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::Send( const ConnectionInfo * connection,
+                              const void * data,
+                              size_t size,
+                              const void * payloadHeader,
+                              size_t payloadHeaderSize,
+                              const void * payloadData,
+                              size_t payloadDataSize,
+                              uint32_t timeoutMS )
+{
+    // The payload is sent from two separate buffers (gathered by the socket
+    // send) so large payload data doesn't need to be copied after its header
+    SendBuffer buffers[ 5 ]; // size + data + payloadSize + payloadHeader + payloadData
+
+    // size
+    const uint32_t sizeData = (uint32_t)size;
+    buffers[ 0 ].size = sizeof( sizeData );
+    buffers[ 0 ].data = &sizeData;
+
+    // data
+    buffers[ 1 ].size = (uint32_t)size;
+    buffers[ 1 ].data = data;
+
+    // payloadSize
+    const uint32_t payloadSizeData = (uint32_t)( payloadHeaderSize + payloadDataSize );
+    buffers[ 2 ].size = sizeof( payloadSizeData );
+    buffers[ 2 ].data = &payloadSizeData;
+
+    // payloadHeader
+    buffers[ 3 ].size = (uint32_t)payloadHeaderSize;
+    buffers[ 3 ].data = payloadHeader;
+
+    // payloadData
+    buffers[ 4 ].size = (uint32_t)payloadDataSize;
+    buffers[ 4 ].data = payloadData;
+
+    return SendInternal( connection, buffers, 5, timeoutMS );
+}
+
 // SendInternal
 //------------------------------------------------------------------------------
 bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const TCPConnectionPool::SendBuffer * buffers, uint32_t numBuffers, uint32_t timeoutMS )
@@ -547,11 +673,11 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
         return false;
     }
 
-    ASSERT( numBuffers <= 4 ); // Worst case = size + data + payloadSize + payload
+    ASSERT( numBuffers <= 5 ); // Worst case = size + data + payloadSize + payloadHeader + payloadData
     #if defined( __WINDOWS__ )
-        WSABUF sendBuffers[ 4 ];
+        WSABUF sendBuffers[ 5 ];
     #else
-        struct iovec sendBuffers[ 4 ];
+        struct iovec sendBuffers[ 5 ];
     #endif
 
     // Calculate total to send
@@ -627,7 +753,16 @@ bool TCPConnectionPool::SendInternal( const ConnectionInfo * connection, const T
                     break;
                 }
 
-                Thread::Sleep( 1 );
+                // Wait for space in the send buffer (waking periodically to check for cancellation)
+                #if defined( __WINDOWS__ )
+                    Thread::Sleep( 1 );
+                #else
+                    struct pollfd pollInfo;
+                    pollInfo.fd = connection->m_Socket;
+                    pollInfo.events = POLLOUT;
+                    pollInfo.revents = 0;
+                    poll( &pollInfo, 1, 10 ); // 10 ms
+                #endif
                 continue;
             }
             // error
@@ -997,9 +1132,9 @@ void TCPConnectionPool::ListenThreadFunction( ConnectionInfo * ci )
         SetNonBlocking( newSocket );        // Set non-blocking
 
         // keep the new connected socket
-        CreateConnectionThread( newSocket,
-                                remoteAddrInfo.sin_addr.s_addr,
-                                ntohs( remoteAddrInfo.sin_port ) );
+        CreateConnection( newSocket,
+                          remoteAddrInfo.sin_addr.s_addr,
+                          ntohs( remoteAddrInfo.sin_port ) );
 
         continue; // keep listening for more connections
     }
@@ -1023,12 +1158,20 @@ void TCPConnectionPool::ListenThreadFunction( ConnectionInfo * ci )
     TCPDEBUG( "Listen thread exited\n" );
 }
 
-// CreateConnectionThread
+// CreateConnection
 //------------------------------------------------------------------------------
-ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData )
+ConnectionInfo * TCPConnectionPool::CreateConnection( TCPSocket socket, uint32_t host, uint16_t port, void * userData )
 {
     MutexHolder mh( m_ConnectionsMutex );
 
+    #if defined( __LINUX__ )
+        if ( ( m_ThreadPerConnection == false ) && ( StartIOThreads() == false ) )
+        {
+            CloseSocket( socket );
+            return nullptr;
+        }
+    #endif
+
     ConnectionInfo * ci = FNEW( ConnectionInfo( this ) );
     ci->m_Socket = socket;
     ci->m_RemoteAddress = host;
@@ -1042,20 +1185,352 @@ ConnectionInfo * TCPConnectionPool::CreateConnectionThread( TCPSocket socket, ui
         TCPDEBUG( "Connected to %s : %i (%x)\n", addr.Get(), port, (uint32_t)socket );
     #endif
 
-    // Spawn thread to handle socket
-    Thread::ThreadHandle h = Thread::CreateThread( &ConnectionThreadWrapperFunction,
-                                                   "TCPConnection",
-                                                   ( 64 * KILOBYTE ),
-                                                   ci ); // user data argument
-    ASSERT( h != INVALID_THREAD_HANDLE );
-    Thread::DetachThread( h );
-    Thread::CloseHandle( h ); // we don't need this anymore
+    #if defined( __LINUX__ )
+        if ( m_ThreadPerConnection == false )
+        {
+            // Hand socket to the I/O threads. A connected socket is immediately
+            // writable, so the first event (which does the OnConnected callback)
+            // fires straight away. EPOLLONESHOT ensures only one thread services
+            // a connection at a time.
+            struct epoll_event event;
+            memset( &event, 0, sizeof( event ) );
+            event.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
+            event.data.ptr = ci;
+            if ( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, socket, &event ) != 0 )
+            {
+                TCPDEBUG( "epoll_ctl() failed. Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)socket );
+                CloseSocket( socket );
+                FDELETE ci;
+                return nullptr;
+            }
+        }
+        else
+    #endif
+    {
+        // Spawn thread to handle socket
+        Thread::ThreadHandle h = Thread::CreateThread( &ConnectionThreadWrapperFunction,
+                                                       "TCPConnection",
+                                                       ( 64 * KILOBYTE ),
+                                                       ci ); // user data argument
+        ASSERT( h != INVALID_THREAD_HANDLE );
+        Thread::DetachThread( h );
+        Thread::CloseHandle( h ); // we don't need this anymore
+    }
 
     m_Connections.Append( ci );
 
     return ci;
 }
 
+// DestroyConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::DestroyConnection( ConnectionInfo * ci )
+{
+    // abandon sends in progress on other threads, so
+    // the callback doesn't have to wait long for them
+    ci->m_ThreadQuitNotification.Store( true );
+
+    OnDisconnected( ci ); // Do callback
+
+    // try to remove from connection list
+    // could validly be removed by another
+    // thread already due to simultaneously
+    // closing a connection while it is dropped
+    MutexHolder mh( m_ConnectionsMutex );
+
+    #if defined( __LINUX__ )
+        if ( m_ThreadPerConnection == false )
+        {
+            // free any partially received message
+            if ( ci->m_ReadBuffer )
+            {
+                FreeBuffer( ci->m_ReadBuffer );
+                ci->m_ReadBuffer = nullptr;
+            }
+            epoll_ctl( m_EpollFD, EPOLL_CTL_DEL, ci->m_Socket, nullptr );
+        }
+    #endif
+
+    // close the socket
+    CloseSocket( ci->m_Socket );
+    ci->m_Socket = INVALID_SOCKET;
+
+    ConnectionInfo ** iter = m_Connections.Find( ci );
+    ASSERT( iter );
+    m_Connections.Erase( iter );
+    FDELETE ci;
+    if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
+    {
+        m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
+    }
+}
+
+#if defined( __LINUX__ )
+// StartIOThreads
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::StartIOThreads()
+{
+    // NOTE: m_ConnectionsMutex is held by caller
+
+    // Create event queue on first use
+    if ( m_EpollFD == -1 )
+    {
+        m_EpollFD = epoll_create1( EPOLL_CLOEXEC );
+        if ( m_EpollFD == -1 )
+        {
+            TCPDEBUG( "epoll_create1() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+            return false;
+        }
+
+        // Signalling this wakes all I/O threads (level triggered) so they can exit
+        m_StopIOThreadsFD = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+        struct epoll_event event;
+        memset( &event, 0, sizeof( event ) );
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if ( ( m_StopIOThreadsFD == -1 ) ||
+             ( epoll_ctl( m_EpollFD, EPOLL_CTL_ADD, m_StopIOThreadsFD, &event ) != 0 ) )
+        {
+            TCPDEBUG( "eventfd() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+            if ( m_StopIOThreadsFD != -1 )
+            {
+                close( m_StopIOThreadsFD );
+                m_StopIOThreadsFD = -1;
+            }
+            close( m_EpollFD );
+            m_EpollFD = -1;
+            return false;
+        }
+    }
+
+    // Grow the thread pool with the number of connections, up to the limit
+    const uint32_t maxThreads = Math::Min( Env::GetNumProcessors(), (uint32_t)kMaxIOThreads );
+    if ( ( m_NumIOThreads < maxThreads ) && ( m_NumIOThreads <= m_Connections.GetSize() ) )
+    {
+        m_IOThreads[ m_NumIOThreads ].Start( IOThreadWrapperFunction, "TCPConnectionIO", this );
+        ++m_NumIOThreads;
+    }
+
+    return true;
+}
+
+// StopIOThreads
+//------------------------------------------------------------------------------
+void TCPConnectionPool::StopIOThreads()
+{
+    if ( m_EpollFD == -1 )
+    {
+        return; // never started
+    }
+
+    // Wake and wait for all threads
+    const uint64_t stop = 1;
+    VERIFY( write( m_StopIOThreadsFD, &stop, sizeof( stop ) ) == sizeof( stop ) );
+    for ( uint32_t i = 0; i < m_NumIOThreads; ++i )
+    {
+        m_IOThreads[ i ].Join();
+    }
+    m_NumIOThreads = 0;
+
+    close( m_StopIOThreadsFD );
+    m_StopIOThreadsFD = -1;
+    close( m_EpollFD );
+    m_EpollFD = -1;
+}
+
+// IOThreadWrapperFunction
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TCPConnectionPool::IOThreadWrapperFunction( void * data )
+{
+    TCP_CONNECTION_POOL_PROFILE_SET_THREAD_NAME( TCPConnectionPoolProfileHelper::THREAD_CONNECTION );
+    PROFILE_FUNCTION;
+
+    TCPConnectionPool * pool = (TCPConnectionPool *)data;
+    pool->IOThreadFunction();
+    return 0;
+}
+
+// IOThreadFunction
+//------------------------------------------------------------------------------
+void TCPConnectionPool::IOThreadFunction()
+{
+    for ( ;; )
+    {
+        // Take one event at a time so busy connections are spread over all threads
+        struct epoll_event event;
+        const int num = epoll_wait( m_EpollFD, &event, 1, -1 );
+        if ( num <= 0 )
+        {
+            if ( ( num < 0 ) && ( errno != EINTR ) )
+            {
+                TCPDEBUG( "epoll_wait() failed. Error: %s\n", LAST_NETWORK_ERROR_STR );
+                ASSERT( false && "Unexpected" );
+                break;
+            }
+            continue;
+        }
+
+        // stop requested?
+        if ( event.data.ptr == nullptr )
+        {
+            break;
+        }
+
+        ServiceConnection( static_cast< ConnectionInfo * >( event.data.ptr ) );
+    }
+
+    // thread exit
+    TCPDEBUG( "I/O thread exited\n" );
+}
+
+// ServiceConnection
+//------------------------------------------------------------------------------
+void TCPConnectionPool::ServiceConnection( ConnectionInfo * ci )
+{
+    ASSERT( ci->m_Socket != INVALID_SOCKET );
+
+    // The connection is disarmed (EPOLLONESHOT) until re-armed below, so
+    // no other thread can be servicing it
+    if ( ci->m_Connected == false )
+    {
+        ci->m_Connected = true;
+        OnConnected( ci ); // Do callback
+    }
+
+    if ( ( ci->m_ThreadQuitNotification.Load() == false ) &&
+         ReadAvailable( ci ) &&
+         ( ci->m_ThreadQuitNotification.Load() == false ) )
+    {
+        // While paused, leave the connection disarmed. ResumeReceive() or
+        // Disconnect() re-arm it.
+        {
+            MutexHolder mh( m_ConnectionsMutex );
+            if ( ci->m_ReceivePaused.Load() && ( ci->m_ThreadQuitNotification.Load() == false ) )
+            {
+                ci->m_Parked = true;
+                return;
+            }
+        }
+
+        // Wait for more data. If Disconnect() happens after the check above,
+        // the shut down socket is readable so this triggers immediately
+        if ( ArmForRead( ci ) )
+        {
+            return;
+        }
+    }
+
+    DestroyConnection( ci );
+}
+
+// ArmForRead
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::ArmForRead( const ConnectionInfo * ci )
+{
+    struct epoll_event event;
+    memset( &event, 0, sizeof( event ) );
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = const_cast< ConnectionInfo * >( ci );
+    if ( epoll_ctl( m_EpollFD, EPOLL_CTL_MOD, ci->m_Socket, &event ) != 0 )
+    {
+        TCPDEBUG( "epoll_ctl() failed. Error: %s (Socket: %x)\n", LAST_NETWORK_ERROR_STR, (uint32_t)( ci->m_Socket ) );
+        return false;
+    }
+    return true;
+}
+
+// ReadAvailable
+//------------------------------------------------------------------------------
+bool TCPConnectionPool::ReadAvailable( ConnectionInfo * ci )
+{
+    PROFILE_FUNCTION;
+
+    // Receive whatever is available without blocking, resuming any partially
+    // received message and delivering each complete one
+    uint32_t numMessages = 0;
+    while ( numMessages < kMaxMessagesPerWakeup )
+    {
+        // size header
+        if ( ci->m_ReadHeaderBytes < sizeof( ci->m_ReadSize ) )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket,
+                                           ( (char *)&ci->m_ReadSize ) + ci->m_ReadHeaderBytes,
+                                           sizeof( ci->m_ReadSize ) - ci->m_ReadHeaderBytes,
+                                           0 );
+            if ( numBytes <= 0 )
+            {
+                if ( ( numBytes < 0 ) && WouldBlock() )
+                {
+                    return true; // wait for more data
+                }
+                TCPDEBUG( "recv() failed (A). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+            ci->m_ReadHeaderBytes += (uint32_t)numBytes;
+            if ( ci->m_ReadHeaderBytes < sizeof( ci->m_ReadSize ) )
+            {
+                continue;
+            }
+
+            TCPDEBUG( "Handle read: %i (%x)\n", ci->m_ReadSize, (uint32_t)( ci->m_Socket ) );
+
+            // get output location
+            ci->m_ReadBuffer = AllocBuffer( ci->m_ReadSize );
+            ASSERT( ci->m_ReadBuffer );
+            ci->m_ReadBytes = 0;
+        }
+
+        // read data into the user supplied buffer
+        if ( ci->m_ReadBytes < ci->m_ReadSize )
+        {
+            const ssize_t numBytes = recv( ci->m_Socket,
+                                           (char *)ci->m_ReadBuffer + ci->m_ReadBytes,
+                                           ci->m_ReadSize - ci->m_ReadBytes,
+                                           0 );
+            if ( numBytes <= 0 )
+            {
+                if ( ( numBytes < 0 ) && WouldBlock() )
+                {
+                    return true; // wait for more data
+                }
+                TCPDEBUG( "recv() failed (B). Error: %s (Read: %i, Socket: %x)\n", LAST_NETWORK_ERROR_STR, (int)numBytes, (uint32_t)( ci->m_Socket ) );
+                return false;
+            }
+            ci->m_ReadBytes += (uint32_t)numBytes;
+            if ( ci->m_ReadBytes < ci->m_ReadSize )
+            {
+                continue;
+            }
+        }
+
+        // message is complete - reset for the next one
+        void * buffer = ci->m_ReadBuffer;
+        const uint32_t size = ci->m_ReadSize;
+        ci->m_ReadBuffer = nullptr;
+        ci->m_ReadHeaderBytes = 0;
+        ci->m_ReadSize = 0;
+        ci->m_ReadBytes = 0;
+
+        // tell user the data is in their buffer
+        bool keepMemory = false;
+        OnReceive( ci, buffer, size, keepMemory );
+        if ( !keepMemory )
+        {
+            FreeBuffer( buffer );
+        }
+        ++numMessages;
+
+        if ( ci->m_ThreadQuitNotification.Load() || ci->m_ReceivePaused.Load() )
+        {
+            break; // stop if disconnecting, or paused by OnReceive
+        }
+    }
+
+    // Remaining data (if any) will re-trigger when the connection is re-armed
+    return true;
+}
+#endif
+
 // ConnectionThreadWrapperFunction
 //------------------------------------------------------------------------------
 /*static*/ uint32_t TCPConnectionPool::ConnectionThreadWrapperFunction( void * data )
@@ -1080,6 +1555,12 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
     // process socket events
     while ( ci->m_ThreadQuitNotification.Load() == false )
     {
+        if ( ci->m_ReceivePaused.Load() )
+        {
+            Thread::Sleep( 10 ); // Until resumed (checking quit notification)
+            continue;
+        }
+
         // timout for select() operations
         // (modified by select, so we must recreate it)
         struct timeval timeout;
@@ -1120,27 +1601,7 @@ void TCPConnectionPool::ConnectionThreadFunction( ConnectionInfo * ci )
         }
     }
 
-    OnDisconnected( ci ); // Do callback
-
-    // close the socket
-    CloseSocket( ci->m_Socket );
-    ci->m_Socket = INVALID_SOCKET;
-
-    {
-        // try to remove from connection list
-        // could validly be removed by another
-        // thread already due to simultaneously
-        // closing a connection while it is dropped
-        MutexHolder mh( m_ConnectionsMutex );
-        ConnectionInfo ** iter = m_Connections.Find( ci );
-        ASSERT( iter );
-        m_Connections.Erase( iter );
-        FDELETE ci;
-        if ( AtomicLoadRelaxed( &m_ShuttingDown ) )
-        {
-            m_ShutdownSemaphore.Signal(); // Wake main thread which will be waiting on shutdown
-        }
-    }
+    DestroyConnection( ci );
 
     // thread exit
     TCPDEBUG( "connection thread exited\n" );
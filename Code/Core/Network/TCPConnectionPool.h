@@ -54,12 +54,23 @@ private:
     uint32_t                m_RemoteAddress;
     uint16_t                m_RemotePort;
     mutable Atomic<bool>    m_ThreadQuitNotification;
+    mutable Atomic<bool>    m_ReceivePaused;
     TCPConnectionPool *     m_TCPConnectionPool; // back pointer to parent pool
     mutable void *          m_UserData;
 
 #ifdef DEBUG
     mutable Thread::ThreadId m_SendSocketInUseThreadId; // sanity check we aren't sending from multiple threads unsafely
 #endif
+
+#if defined( __LINUX__ )
+    // Partially received message (only accessed by the I/O thread servicing the connection)
+    bool                    m_Connected;        // OnConnected has been called
+    mutable bool            m_Parked;           // left disarmed while paused (protected by m_ConnectionsMutex)
+    uint32_t                m_ReadHeaderBytes;  // bytes of the size header received
+    uint32_t                m_ReadSize;         // size of the message being received
+    uint32_t                m_ReadBytes;        // bytes of the message received
+    void *                  m_ReadBuffer;       // message being received (from AllocBuffer)
+#endif
 };
 
 // TCPConnectionPool
@@ -67,7 +78,10 @@ private:
 class TCPConnectionPool
 {
 public:
-    TCPConnectionPool();
+    // Connections share a small pool of I/O threads on Linux, unless callbacks
+    // can block (e.g. on file I/O, or on locks held while sending), in which
+    // case each connection is serviced by its own thread (as on other platforms)
+    explicit TCPConnectionPool( bool threadPerConnection = false );
     virtual ~TCPConnectionPool();
 
     // Must be called explicitly before destruction
@@ -87,6 +101,12 @@ public:
     void Disconnect( const ConnectionInfo * ci );
     void SetShuttingDown();
 
+    // flow control - stop receiving from a connection (the remote end stalls once
+    // the socket buffers fill) until resumed. Pause from within OnReceive only;
+    // resume from any thread.
+    void PauseReceive( const ConnectionInfo * ci );
+    void ResumeReceive( const ConnectionInfo * ci );
+
     // query connection state
     size_t GetNumConnections() const;
 
@@ -101,12 +121,22 @@ public:
                const void * payloadData,
                size_t payloadSize,
                uint32_t timeoutMS = kDefaultSendTimeoutMS );
+    bool Send( const ConnectionInfo * connection,
+               const void * data,
+               size_t size,
+               const void * payloadHeader,
+               size_t payloadHeaderSize,
+               const void * payloadData,
+               size_t payloadDataSize,
+               uint32_t timeoutMS = kDefaultSendTimeoutMS );
     bool Broadcast( const void * data, size_t size );
 
     static void GetAddressAsString( uint32_t addr, AString & address );
 
 protected:
-    // network events - NOTE: these happen in another thread! (but never at the same time)
+    // network events - NOTE: these happen in another thread! (but never at the same time for a given connection)
+    // On Linux, a small pool of threads services all connections (unless threadPerConnection is set), so these must
+    // not block (e.g. waiting for other threads to finish with a connection) - hand work off to other threads instead
     virtual void OnReceive( const ConnectionInfo *, void * /*data*/, uint32_t /*size*/, bool & /*keepMemory*/ ) {}
     virtual void OnConnected( const ConnectionInfo * ) {}
     virtual void OnDisconnected( const ConnectionInfo * ) {}
@@ -145,7 +175,18 @@ private:
     void                CreateListenThread( TCPSocket socket, uint32_t host, uint16_t port );
     static uint32_t     ListenThreadWrapperFunction( void * data );
     void                ListenThreadFunction( ConnectionInfo * ci );
-    ConnectionInfo *    CreateConnectionThread( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
+    ConnectionInfo *    CreateConnection( TCPSocket socket, uint32_t host, uint16_t port, void * userData = nullptr );
+    void                DestroyConnection( ConnectionInfo * ci );
+    #if defined( __LINUX__ )
+        // connections are serviced by a small pool of I/O threads driven by epoll
+        bool                StartIOThreads();
+        void                StopIOThreads();
+        static uint32_t     IOThreadWrapperFunction( void * data );
+        void                IOThreadFunction();
+        void                ServiceConnection( ConnectionInfo * ci );
+        bool                ArmForRead( const ConnectionInfo * ci );
+        bool                ReadAvailable( ConnectionInfo * ci );
+    #endif
     static uint32_t     ConnectionThreadWrapperFunction( void * data );
     void                ConnectionThreadFunction( ConnectionInfo * ci );
 
@@ -166,6 +207,16 @@ private:
     bool                        m_ShuttingDown;
     Semaphore                   m_ShutdownSemaphore;
 
+    #if defined( __LINUX__ )
+        // I/O threads (created on demand, up to kMaxIOThreads)
+        enum : uint32_t { kMaxIOThreads = 8 };
+        bool                        m_ThreadPerConnection;  // don't use the I/O threads
+        int                         m_EpollFD;
+        int                         m_StopIOThreadsFD;  // eventfd signalled to stop the I/O threads
+        uint32_t                    m_NumIOThreads;
+        Thread                      m_IOThreads[ kMaxIOThreads ];
+    #endif
+
     // object to manage network subsystem lifetime
 protected:
     NetworkStartupHelper m_EnsureNetworkStarted;
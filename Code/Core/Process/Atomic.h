@@ -198,6 +198,28 @@ inline void AtomicStoreRelease( volatile T * x, T value )
     #endif
 }
 
+// AtomicExchange (returns previous value)
+//------------------------------------------------------------------------------
+inline uint32_t AtomicExchange( volatile uint32_t * x, uint32_t value )
+{
+    #if defined( __GNUC__ ) || defined( __clang__ )
+        return __atomic_exchange_n( x, value, __ATOMIC_SEQ_CST );
+    #elif defined( _MSC_VER )
+        return static_cast<uint32_t>( _InterlockedExchange( reinterpret_cast<volatile long *>( x ), static_cast<long>( value ) ) );
+    #endif
+}
+
+// AtomicOr (returns previous value)
+//------------------------------------------------------------------------------
+inline uint64_t AtomicOr( volatile uint64_t * x, uint64_t value )
+{
+    #if defined( __GNUC__ ) || defined( __clang__ )
+        return __atomic_fetch_or( x, value, __ATOMIC_SEQ_CST );
+    #elif defined( _MSC_VER )
+        return static_cast<uint64_t>( _InterlockedOr64( reinterpret_cast<volatile __int64 *>( x ), static_cast<__int64>( value ) ) );
+    #endif
+}
+
 //------------------------------------------------------------------------------
 template <class T>
 class Atomic
@@ -166,7 +166,7 @@ Tracing::Callbacks::Callbacks()
     : m_CallbacksMutex()
     , m_InCallbackDispatch( false )
     , m_CallbacksDebugSpam( 2, true )
-    , m_CallbacksOutput( 2, true )
+    , m_CallbacksOutput( 4, true ) // FLog, -daemon forwarding + tests
 {
     // Callbacks can now be modified or dispatched
     s_Valid = true;
@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/BuildDaemon.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 #include "Tools/FBuild/FBuildCore/Helpers/CtrlCHandler.h"
 
@@ -36,6 +37,7 @@ enum ReturnCodes
     FBUILD_WRAPPER_CRASHED                  = -7,
     FBUILD_FAILED_TO_WSL_WRAPPER            = -8,
     FBUILD_FAILED_TO_WRITE_PROFILE_JSON     = -9,
+    FBUILD_FAILED_TO_START_DAEMON           = -10,
 };
 
 // Headers
@@ -43,6 +45,8 @@ enum ReturnCodes
 int WrapperMainProcess( const AString & args, const FBuildOptions & options, SystemMutex & finalProcess );
 int WrapperIntermediateProcess( const FBuildOptions & options );
 int32_t WrapperModeForWSL( const FBuildOptions & options );
+int DaemonResultToReturnCode( BuildDaemon::Result result );
+void DisplayTotalTime( const Timer & t );
 int Main( int argc, char * argv[] );
 
 // Misc
@@ -123,6 +127,18 @@ int Main( int argc, char * argv[] )
     {
         if ( mainProcess.TryLock() == false )
         {
+            // a resident daemon (-daemon) can perform the build for us
+            BuildDaemon::Result daemonResult;
+            if ( BuildDaemon::CanForward( options ) &&
+                 BuildDaemon::ForwardBuild( options, argc, argv, daemonResult ) )
+            {
+                if ( options.m_ShowTotalTimeTaken )
+                {
+                    DisplayTotalTime( t );
+                }
+                return DaemonResultToReturnCode( daemonResult );
+            }
+
             if ( options.m_WaitMode == false )
             {
                 OUTPUT( "FBuild: Error: Another instance of FASTBuild is already running in '%s'.\n", options.GetWorkingDir().Get() );
@@ -175,6 +191,19 @@ int Main( int argc, char * argv[] )
         sharedData->Started = true;
     }
 
+    // stay resident, performing builds forwarded by other invocations
+    if ( options.m_Daemon )
+    {
+        BuildDaemon daemon;
+        const bool result = daemon.Run( options );
+        ctrlCHandler.DeregisterHandler(); // Ensure this happens before FBuild is destroyed
+        if ( sharedData )
+        {
+            sharedData->ReturnCode = result ? FBUILD_OK : FBUILD_FAILED_TO_START_DAEMON;
+        }
+        return result ? FBUILD_OK : FBUILD_FAILED_TO_START_DAEMON;
+    }
+
     FBuild fBuild( options );
 
     // load the dependency graph if available
@@ -217,6 +246,16 @@ int Main( int argc, char * argv[] )
     else
     {
         result = fBuild.Build( options.m_Targets );
+
+        // keep recording changes to speed up subsequent builds
+        if ( options.m_Watch )
+        {
+            mainProcess.Unlock(); // allow subsequent builds while watching
+            if ( fBuild.WatchForChanges() == false )
+            {
+                result = false;
+            }
+        }
     }
 
 
@@ -238,17 +277,7 @@ int Main( int argc, char * argv[] )
     // final line of output - status of build
     if ( options.m_ShowTotalTimeTaken )
     {
-        const float totalBuildTime = t.GetElapsed();
-        const uint32_t minutes = uint32_t( totalBuildTime / 60.0f );
-        const float seconds = ( totalBuildTime - (float)( minutes * 60 ) );
-        if ( minutes > 0 )
-        {
-            FLOG_OUTPUT( "Time: %um %05.3fs\n", minutes, (double)seconds );
-        }
-        else
-        {
-            FLOG_OUTPUT( "Time: %05.3fs\n", (double)seconds );
-        }
+        DisplayTotalTime( t );
     }
 
     ctrlCHandler.DeregisterHandler(); // Ensure this happens before FBuild is destroyed
@@ -260,6 +289,37 @@ int Main( int argc, char * argv[] )
     return ( result == true ) ? FBUILD_OK : FBUILD_BUILD_FAILED;
 }
 
+// DisplayTotalTime
+//------------------------------------------------------------------------------
+void DisplayTotalTime( const Timer & t )
+{
+    const float totalBuildTime = t.GetElapsed();
+    const uint32_t minutes = uint32_t( totalBuildTime / 60.0f );
+    const float seconds = ( totalBuildTime - (float)( minutes * 60 ) );
+    if ( minutes > 0 )
+    {
+        FLOG_OUTPUT( "Time: %um %05.3fs\n", minutes, (double)seconds );
+    }
+    else
+    {
+        FLOG_OUTPUT( "Time: %05.3fs\n", (double)seconds );
+    }
+}
+
+// DaemonResultToReturnCode
+//------------------------------------------------------------------------------
+int DaemonResultToReturnCode( BuildDaemon::Result result )
+{
+    switch ( result )
+    {
+        case BuildDaemon::RESULT_OK:                return FBUILD_OK;
+        case BuildDaemon::RESULT_BUILD_FAILED:      return FBUILD_BUILD_FAILED;
+        case BuildDaemon::RESULT_ERROR_LOADING_BFF: return FBUILD_ERROR_LOADING_BFF;
+        case BuildDaemon::RESULT_BAD_ARGS:          return FBUILD_BAD_ARGS;
+    }
+    return FBUILD_BUILD_FAILED;
+}
+
 // WrapperMainProcess
 //------------------------------------------------------------------------------
 int WrapperMainProcess( const AString & args, const FBuildOptions & options, SystemMutex & finalProcess )
@@ -0,0 +1,124 @@
+// FBuildCacheServerOptions
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildCacheServerOptions.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Cache/CacheProtocol.h"
+#include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Env.h"
+#include "Core/Math/Conversions.h"
+
+// system
+#include <stdio.h>
+
+// FBuildCacheServerOptions (CONSTRUCTOR)
+//------------------------------------------------------------------------------
+FBuildCacheServerOptions::FBuildCacheServerOptions()
+    : m_CacheMaxSizeMiB( 0 )
+    , m_CachePacked( false )
+    , m_Port( CacheProtocol::CACHE_SERVER_PORT )
+    , m_NumThreads( Env::GetNumProcessors() )
+{
+}
+
+// ProcessCommandLine
+//------------------------------------------------------------------------------
+bool FBuildCacheServerOptions::ProcessCommandLine( const AString & commandLine )
+{
+    // Tokenize
+    Array< AString > tokens;
+    commandLine.Tokenize( tokens );
+
+    // Check each token
+    const AString * const end = tokens.End();
+    for ( const AString * it = tokens.Begin(); it != end; ++it )
+    {
+        const AString & token = *it;
+        if ( token.BeginsWith( "-cachepath=" ) )
+        {
+            m_CachePath = ( token.Get() + 11 );
+            if ( m_CachePath.IsEmpty() == false )
+            {
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-cachemaxsize=" ) )
+        {
+            if ( AString::ScanS( token.Get() + 14, "%u", &m_CacheMaxSizeMiB ) == 1 )
+            {
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token == "-cachepacked" )
+        {
+            m_CachePacked = true;
+            continue;
+        }
+        else if ( token.BeginsWith( "-port=" ) )
+        {
+            uint32_t port( 0 );
+            if ( ( AString::ScanS( token.Get() + 6, "%u", &port ) == 1 ) && ( port > 0 ) && ( port <= 0xFFFF ) )
+            {
+                m_Port = (uint16_t)port;
+                continue;
+            }
+            // problem... fall through
+        }
+        else if ( token.BeginsWith( "-threads=" ) )
+        {
+            uint32_t num( 0 );
+            if ( ( AString::ScanS( token.Get() + 9, "%u", &num ) == 1 ) && ( num > 0 ) )
+            {
+                m_NumThreads = Math::Min< uint32_t >( num, 256 );
+                continue;
+            }
+            // problem... fall through
+        }
+
+        ShowUsageError();
+        return false;
+    }
+
+    // A path is required
+    if ( m_CachePath.IsEmpty() )
+    {
+        ShowUsageError();
+        return false;
+    }
+
+    return true;
+}
+
+// ShowUsageError
+//------------------------------------------------------------------------------
+void FBuildCacheServerOptions::ShowUsageError()
+{
+    const char * msg = "FBuildCacheServer - " FBUILD_VERSION_STRING "\n"
+                       "Copyright 2012-2022 Franta Fulin - https://www.fastbuild.org\n"
+                       "\n"
+                       "Command Line Options:\n"
+                       "---------------------------------------------------------------------------\n"
+                       " -cachepath=<path>\n"
+                       "        Location of the cache to serve (required).\n"
+                       " -cachemaxsize=<MiB>\n"
+                       "        Keep the cache under this size, trimming in the background.\n"
+                       " -cachepacked\n"
+                       "        Store entries in pack files (see .CachePacked).\n"
+                       " -port=<n>\n"
+                       "        Port to listen on (default 31328).\n"
+                       " -threads=<n>\n"
+                       "        Threads serving requests (default: num CPU cores).\n"
+                       "---------------------------------------------------------------------------\n"
+                       ;
+    printf( "%s", msg );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,30 @@
+// FBuildCacheServerOptions
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// Core
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// FBuildCacheServerOptions
+//------------------------------------------------------------------------------
+class FBuildCacheServerOptions
+{
+public:
+    FBuildCacheServerOptions();
+
+    bool ProcessCommandLine( const AString & commandLine );
+
+    AString     m_CachePath;
+    uint32_t    m_CacheMaxSizeMiB;
+    bool        m_CachePacked;
+    uint16_t    m_Port;
+    uint32_t    m_NumThreads;
+
+private:
+    void ShowUsageError();
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,117 @@
+// Main
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildCacheServerOptions.h"
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheServer.h"
+#include "Tools/FBuild/FBuildCore/Cache/PackedCache.h"
+#include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
+
+#include <stdio.h>
+
+// Return Codes
+//------------------------------------------------------------------------------
+enum ReturnCodes
+{
+    FBUILD_OK                               = 0,
+    FBUILD_BAD_ARGS                         = -1,
+    FBUILD_CACHE_INACCESSIBLE               = -2,
+    FBUILD_FAILED_TO_LISTEN                 = -3
+};
+
+// Headers
+//------------------------------------------------------------------------------
+int Main( const AString & args );
+
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char * argv[])
+{
+    AStackString<> args;
+    for ( int i=1; i<argc; ++i ) // NOTE: Skip argv[0] exe name
+    {
+        if ( i > 1 )
+        {
+            args += ' ';
+        }
+        args += argv[ i ];
+    }
+
+    // This wrapper is purely for profiling scope
+    const int result = Main( args );
+    PROFILE_SYNCHRONIZE // make sure no tags are active and do one final sync
+    return result;
+}
+
+// Main
+//------------------------------------------------------------------------------
+int Main( const AString & args )
+{
+    // handle cmd line args
+    FBuildCacheServerOptions options;
+    if ( options.ProcessCommandLine( args ) == false )
+    {
+        return FBUILD_BAD_ARGS;
+    }
+
+    OUTPUT( "FBuildCacheServer - " FBUILD_VERSION_STRING "\n" );
+
+    // The built-in cache backend
+    Cache * cache = options.m_CachePacked ? FNEW( PackedCache( options.m_CacheMaxSizeMiB ) )
+                                          : FNEW( Cache( options.m_CacheMaxSizeMiB ) );
+    if ( cache->Init( options.m_CachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) == false )
+    {
+        OUTPUT( "Cache path '%s' is inaccessible.\n", options.m_CachePath.Get() );
+        FDELETE cache;
+        return FBUILD_CACHE_INACCESSIBLE;
+    }
+
+    int result = FBUILD_OK;
+    {
+        CacheServer server( *cache, options.m_NumThreads );
+
+        OUTPUT( "Serving '%s' on port %u\n", options.m_CachePath.Get(), (uint32_t)options.m_Port );
+        if ( server.Listen( options.m_Port ) == false )
+        {
+            OUTPUT( "Failed to listen on port %u.  Check port is not in use.\n", (uint32_t)options.m_Port );
+            result = FBUILD_FAILED_TO_LISTEN;
+        }
+        else
+        {
+            CacheServer::Stats previous;
+            for ( ;; )
+            {
+                PROFILE_SYNCHRONIZE
+
+                Thread::Sleep( 10 * 1000 );
+
+                CacheServer::Stats stats;
+                server.GetStats( stats );
+                if ( ( stats.m_Retrieves != previous.m_Retrieves ) || ( stats.m_Publishes != previous.m_Publishes ) )
+                {
+                    OUTPUT( "Connections: %u | Retrieves: %u (%u hits, %" PRIu64 " MiB) | Publishes: %u (%" PRIu64 " MiB)\n",
+                            (uint32_t)server.GetNumConnections(),
+                            stats.m_Retrieves,
+                            stats.m_Hits,
+                            ( stats.m_BytesSent / MEGABYTE ),
+                            stats.m_Publishes,
+                            ( stats.m_BytesReceived / MEGABYTE ) );
+                    previous = stats;
+                }
+            }
+        }
+    }
+
+    cache->Shutdown();
+    FDELETE cache;
+    return result;
+}
+
+//------------------------------------------------------------------------------
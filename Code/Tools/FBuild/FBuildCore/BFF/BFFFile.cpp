@@ -34,7 +34,7 @@ BFFFile::~BFFFile() = default;
 
 // Load
 //------------------------------------------------------------------------------
-bool BFFFile::Load( const AString & fileName, const BFFToken * token )
+bool BFFFile::Load( const AString & fileName, const BFFToken * token, bool reportErrors )
 {
     FLOG_VERBOSE( "Loading BFF '%s'", fileName.Get() );
 
@@ -43,7 +43,11 @@ bool BFFFile::Load( const AString & fileName, const BFFToken * token )
     if ( bffStream.Open( fileName.Get() ) == false )
     {
         // missing bff is a fatal problem
-        if ( token )
+        if ( reportErrors == false )
+        {
+            // Caller will handle it
+        }
+        else if ( token )
         {
             Error::Error_1032_UnableToOpenInclude( token, fileName );
         }
@@ -60,7 +64,10 @@ bool BFFFile::Load( const AString & fileName, const BFFToken * token )
     fileContents.SetLength( size );
     if ( bffStream.Read( fileContents.Get(), size ) != size )
     {
-        FLOG_ERROR( "Error reading BFF '%s'", fileName.Get() );
+        if ( reportErrors )
+        {
+            FLOG_ERROR( "Error reading BFF '%s'", fileName.Get() );
+        }
         return false;
     }
 
@@ -19,7 +19,7 @@ public:
     BFFFile( const char * fileName, const AString & fileContents );
     ~BFFFile();
 
-    bool Load( const AString & fileName, const BFFToken * token );
+    bool Load( const AString & fileName, const BFFToken * token, bool reportErrors = true );
 
     const AString & GetFileName() const             { return m_FileName; }
     const AString & GetSourceFileContents() const   { return m_FileContents; }
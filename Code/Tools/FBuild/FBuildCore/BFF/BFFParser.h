@@ -37,6 +37,7 @@ public:
     bool Parse( BFFTokenRange & tokenRange );
 
     const Array<BFFFile *> & GetUsedFiles() const { return m_Tokenizer.GetUsedFiles(); }
+    void SetTokenCache( BFFTokenCache * tokenCache ) { m_Tokenizer.SetTokenCache( tokenCache ); }
 
     enum { BFF_COMMENT_SEMICOLON = ';' };
     enum { BFF_COMMENT_SLASH = '/' };
@@ -0,0 +1,259 @@
+// BFFTokenCache.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "BFFTokenCache.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/BFF/BFFFile.h"
+#include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Containers/UniquePtr.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Profile/Profile.h"
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BFFTokenCache::BFFTokenCache() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BFFTokenCache::~BFFTokenCache()
+{
+    for ( Entry * entry : m_Entries )
+    {
+        FDELETE( entry );
+    }
+}
+
+// Load
+//------------------------------------------------------------------------------
+void BFFTokenCache::Load( const char * cacheFileName )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_Entries.IsEmpty() );
+
+    FileStream file;
+    if ( file.Open( cacheFileName, FileStream::READ_ONLY ) == false )
+    {
+        return; // No previous cache
+    }
+
+    // Read it into memory to avoid lots of tiny disk accesses
+    const size_t fileSize = (size_t)file.GetFileSize();
+    UniquePtr< char > memory( (char *)ALLOC( fileSize ) );
+    if ( file.ReadBuffer( memory.Get(), fileSize ) != fileSize )
+    {
+        return; // Unreadable cache, ignore it
+    }
+    ConstMemoryStream stream( memory.Get(), fileSize );
+
+    // Header
+    // (Functions are recognized during tokenization, so a different
+    // version of FASTBuild may tokenize differently)
+    char identifier[ 3 ];
+    uint8_t version = 0;
+    uint32_t fbuildVersion = 0;
+    if ( ( stream.Read( identifier, sizeof( identifier ) ) != sizeof( identifier ) ) ||
+         ( identifier[ 0 ] != 'B' ) || ( identifier[ 1 ] != 'T' ) || ( identifier[ 2 ] != 'C' ) ||
+         ( stream.Read( version ) == false ) ||
+         ( version != TOKEN_CACHE_VERSION ) ||
+         ( stream.Read( fbuildVersion ) == false ) ||
+         ( fbuildVersion != FBUILD_VERSION ) )
+    {
+        return; // Incompatible cache, ignore it
+    }
+
+    uint32_t numEntries = 0;
+    if ( stream.Read( numEntries ) == false )
+    {
+        return;
+    }
+    Array< Entry * > entries;
+    entries.SetCapacity( numEntries );
+    bool ok = true;
+    for ( uint32_t i = 0; ok && ( i < numEntries ); ++i )
+    {
+        Entry * entry = FNEW( Entry );
+        entry->m_Used = false;
+        entries.Append( entry );
+        uint32_t numTokens = 0;
+        ok = ( stream.Read( entry->m_FileName ) &&
+               stream.Read( entry->m_Hash ) &&
+               stream.Read( numTokens ) );
+        entry->m_Tokens.SetCapacity( ok ? numTokens : 0 );
+        for ( uint32_t j = 0; ok && ( j < numTokens ); ++j )
+        {
+            CachedToken & token = entry->m_Tokens.EmplaceBack();
+            uint8_t type = 0;
+            ok = ( stream.Read( type ) &&
+                   stream.Read( token.m_Offset ) &&
+                   stream.Read( token.m_Value ) &&
+                   ( type < (uint8_t)BFFTokenType::EndOfFile ) );
+            token.m_Type = (BFFTokenType)type;
+        }
+        ok = ok && ( m_EntryMap.Find( entry->m_FileName ) == nullptr );
+        if ( ok )
+        {
+            m_EntryMap.Insert( entry->m_FileName, entry );
+        }
+    }
+    if ( ok == false )
+    {
+        // Truncated or corrupt cache, ignore it
+        for ( Entry * entry : entries )
+        {
+            FDELETE( entry );
+        }
+        m_EntryMap.Destruct();
+        return;
+    }
+    m_Entries = Move( entries );
+}
+
+// Save
+//------------------------------------------------------------------------------
+bool BFFTokenCache::Save( const char * cacheFileName ) const
+{
+    PROFILE_FUNCTION;
+
+    // serialize into memory first
+    MemoryStream stream( 1024 * 1024, 1024 * 1024 );
+    const char identifier[ 3 ] = { 'B', 'T', 'C' };
+    stream.Write( identifier, sizeof( identifier ) );
+    stream.Write( (uint8_t)TOKEN_CACHE_VERSION );
+    stream.Write( FBUILD_VERSION );
+
+    // Only entries for files used during this parse are kept
+    uint32_t numEntries = 0;
+    for ( const Entry * entry : m_Entries )
+    {
+        numEntries += entry->m_Used ? 1 : 0;
+    }
+    stream.Write( numEntries );
+    for ( const Entry * entry : m_Entries )
+    {
+        if ( entry->m_Used == false )
+        {
+            continue;
+        }
+        stream.Write( entry->m_FileName );
+        stream.Write( entry->m_Hash );
+        stream.Write( (uint32_t)entry->m_Tokens.GetSize() );
+        for ( const CachedToken & token : entry->m_Tokens )
+        {
+            stream.Write( (uint8_t)token.m_Type );
+            stream.Write( token.m_Offset );
+            stream.Write( token.m_Value );
+        }
+    }
+
+    FileStream fileStream;
+    if ( ( fileStream.Open( cacheFileName, FileStream::WRITE_ONLY ) == false ) ||
+         ( fileStream.Write( stream.GetData(), stream.GetSize() ) != stream.GetSize() ) )
+    {
+        FLOG_WARN( "Failed to save BFF token cache '%s'", cacheFileName );
+        return false;
+    }
+    return true;
+}
+
+// GetTokens
+//------------------------------------------------------------------------------
+bool BFFTokenCache::GetTokens( const BFFFile & file, Array< BFFToken > & outTokens )
+{
+    Entry * entry = FindEntry( file );
+    if ( entry == nullptr )
+    {
+        ++m_NumMisses;
+        return false;
+    }
+    ++m_NumHits;
+
+    // Keep the entry for the next parse
+    entry->m_Used = true;
+
+    // Re-create the tokens, pointing into the supplied file
+    const char * contents = file.GetSourceFileContents().Get();
+    for ( const CachedToken & token : entry->m_Tokens )
+    {
+        const char * sourcePos = ( contents + token.m_Offset );
+        switch ( token.m_Type )
+        {
+            case BFFTokenType::Number:
+            {
+                // Number is parsed from the string value
+                outTokens.EmplaceBack( file, sourcePos, token.m_Type, token.m_Value.Get(), token.m_Value.GetEnd() );
+                break;
+            }
+            case BFFTokenType::Boolean:
+            {
+                outTokens.EmplaceBack( file, sourcePos, token.m_Type, ( token.m_Value == "true" ) );
+                break;
+            }
+            default:
+            {
+                outTokens.EmplaceBack( file, sourcePos, token.m_Type, token.m_Value );
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+// StoreTokens
+//------------------------------------------------------------------------------
+void BFFTokenCache::StoreTokens( const BFFFile & file, const BFFToken * begin, const BFFToken * end )
+{
+    // Replace any entry from a previous parse
+    UnorderedMap< AString, Entry * >::KeyValue * keyValue = m_EntryMap.Find( file.GetFileName() );
+    Entry * entry = keyValue ? keyValue->m_Value : nullptr;
+    if ( entry == nullptr )
+    {
+        entry = FNEW( Entry );
+        entry->m_FileName = file.GetFileName();
+        m_Entries.Append( entry );
+        m_EntryMap.Insert( entry->m_FileName, entry );
+    }
+    entry->m_Hash = file.GetHash();
+    entry->m_Used = true;
+    entry->m_Tokens.Clear();
+    entry->m_Tokens.SetCapacity( (size_t)( end - begin ) );
+    const char * contents = file.GetSourceFileContents().Get();
+    for ( const BFFToken * it = begin; it != end; ++it )
+    {
+        ASSERT( &it->GetSourceFile() == &file );
+        CachedToken & token = entry->m_Tokens.EmplaceBack();
+        token.m_Type = it->GetType();
+        token.m_Offset = (uint32_t)( it->GetSourcePos() - contents );
+        token.m_Value = it->GetValueString();
+    }
+}
+
+// GetCacheFileName
+//------------------------------------------------------------------------------
+/*static*/ void BFFTokenCache::GetCacheFileName( const char * nodeGraphDBFile, AString & outCacheFileName )
+{
+    outCacheFileName = nodeGraphDBFile;
+    outCacheFileName += ".tokens";
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+BFFTokenCache::Entry * BFFTokenCache::FindEntry( const BFFFile & file )
+{
+    UnorderedMap< AString, Entry * >::KeyValue * keyValue = m_EntryMap.Find( file.GetFileName() );
+    if ( ( keyValue == nullptr ) || ( keyValue->m_Value->m_Hash != file.GetHash() ) )
+    {
+        return nullptr; // Not seen before, or contents changed
+    }
+    return keyValue->m_Value;
+}
+
+//------------------------------------------------------------------------------
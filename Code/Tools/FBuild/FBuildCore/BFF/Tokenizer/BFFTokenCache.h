@@ -0,0 +1,71 @@
+// BFFTokenCache - persistent cache of tokenized bff files
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFToken.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class BFFFile;
+
+// BFFTokenCache
+//------------------------------------------------------------------------------
+// Stores the tokens for files which contain no directives. Such files tokenize
+// the same way regardless of the defines or environment in effect, so the
+// tokens can be re-used for as long as the file contents are unchanged.
+class BFFTokenCache
+{
+public:
+    explicit BFFTokenCache();
+    ~BFFTokenCache();
+
+    // Persistence (a missing or invalid cache is not an error)
+    void Load( const char * cacheFileName );
+    bool Save( const char * cacheFileName ) const;
+
+    // Retrieve tokens previously stored for a file with the same contents
+    bool GetTokens( const BFFFile & file, Array< BFFToken > & outTokens );
+
+    // Record the tokens for a file
+    void StoreTokens( const BFFFile & file, const BFFToken * begin, const BFFToken * end );
+
+    static void GetCacheFileName( const char * nodeGraphDBFile, AString & outCacheFileName );
+
+    // Stats
+    uint32_t GetNumHits() const     { return m_NumHits; }
+    uint32_t GetNumMisses() const   { return m_NumMisses; }
+
+private:
+    struct CachedToken
+    {
+        BFFTokenType    m_Type;
+        uint32_t        m_Offset;   // Offset of the token in the file contents
+        AString         m_Value;
+    };
+    struct Entry
+    {
+        AString                 m_FileName;
+        uint64_t                m_Hash;
+        bool                    m_Used;     // Retrieved or stored during this parse
+        Array< CachedToken >    m_Tokens;
+    };
+
+    Entry * FindEntry( const BFFFile & file );
+
+    enum : uint8_t { TOKEN_CACHE_VERSION = 1 };
+
+    Array< Entry * >                m_Entries;      // Loaded and stored entries (owned)
+    UnorderedMap< AString, Entry * > m_EntryMap;    // Entries by file name
+    uint32_t                        m_NumHits = 0;
+    uint32_t                        m_NumMisses = 0;
+};
+
+//------------------------------------------------------------------------------
@@ -9,13 +9,18 @@
 #include "Tools/FBuild/FBuildCore/BFF/BFFKeywords.h"
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/Function.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenCache.h"
 #include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenRange.h"
 #include "Tools/FBuild/FBuildCore/Error.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 
 // Core
+#include "Core/Env/Env.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Profile/Profile.h"
 
@@ -81,6 +86,23 @@ namespace
         }
 
     }
+
+    // Key for finding files by path, consistent with PathUtils::ArePathsEqual
+    void GetPathKey( const AString & cleanFileName, AString & outKey )
+    {
+        outKey = cleanFileName;
+        #if defined( __WINDOWS__ ) || defined( __OSX__ )
+            outKey.ToLower(); // Case insensitive
+        #endif
+    }
+
+    // Work shared by threads loading files in parallel
+    struct PrefetchContext
+    {
+        const Array<AString> *  m_FileNames;
+        Array<BFFFile *> *      m_LoadedFiles;
+        volatile uint32_t       m_NextIndex;
+    };
 }
 
 // CONSTRUCTOR
@@ -96,15 +118,36 @@ BFFTokenizer::~BFFTokenizer()
     {
         FDELETE( file );
     }
+    for ( BFFFile * file : m_PrefetchedFiles )
+    {
+        FDELETE( file );
+    }
 }
 
 // TokenizeFromFile
 //------------------------------------------------------------------------------
 bool BFFTokenizer::TokenizeFromFile( const AString & fileName )
 {
+    // Load the file hierarchy up front using multiple threads
+    PrefetchIncludes( fileName );
+
     const BFFToken * token = nullptr; // No token for the root
     const bool result = Tokenize( fileName, token );
 
+    // Free any files which were prefetched but excluded by directives
+    AStackString<> pathKey;
+    for ( BFFFile * file : m_PrefetchedFiles )
+    {
+        GetPathKey( file->GetFileName(), pathKey );
+        KnownFile & knownFile = m_KnownFiles.Find( pathKey )->m_Value;
+        if ( knownFile.m_Used == false )
+        {
+            knownFile.m_File = nullptr;
+            FDELETE( file );
+        }
+    }
+    m_PrefetchedFiles.Clear();
+
     // Close the token stream
     if ( result )
     {
@@ -131,35 +174,51 @@ bool BFFTokenizer::Tokenize( const AString & fileName, const BFFToken * token )
     NodeGraph::CleanPath( fileName, cleanFileName );
 
     // Have we seen this file before?
+    AStackString<> pathKey;
+    GetPathKey( cleanFileName, pathKey );
+    UnorderedMap<AString, KnownFile>::KeyValue * knownFile = m_KnownFiles.Find( pathKey );
     const BFFFile * fileToParse = nullptr;
-    for ( const BFFFile * previousInclude : m_Files )
+    if ( knownFile && knownFile->m_Value.m_Used )
     {
-        if ( PathUtils::ArePathsEqual( previousInclude->GetFileName(), cleanFileName ) )
+        // Already seen and should only be parsed once?
+        if ( knownFile->m_Value.m_File->IsParseOnce() )
         {
-            // Already seen and should only be parsed once?
-            if ( previousInclude->IsParseOnce() )
-            {
-                return true;
-            }
-
-            // Already included, but can be included again
-            fileToParse = previousInclude;
-            break;
+            return true;
         }
-    }
 
-    // A file seen for the first time?
-    if ( fileToParse == nullptr )
+        // Already included, but can be included again
+        fileToParse = knownFile->m_Value.m_File;
+    }
+    else
     {
-        // Load the new file
-        BFFFile * newFile = FNEW( BFFFile() );
-        if ( newFile->Load( cleanFileName, token ) == false )
+        // A file seen for the first time. Use the file if it was prefetched,
+        // or load it now (reporting any errors).
+        BFFFile * newFile = knownFile ? knownFile->m_Value.m_File : nullptr;
+        if ( newFile )
+        {
+            ++m_NumPrefetchedFilesUsed;
+        }
+        else
         {
-            FDELETE( newFile );
-            return false; // Load will have emitted an error
+            newFile = FNEW( BFFFile() );
+            if ( newFile->Load( cleanFileName, token ) == false )
+            {
+                FDELETE( newFile );
+                return false; // Load will have emitted an error
+            }
         }
         m_Files.Append( newFile );
 
+        const KnownFile usedFile = { newFile, true };
+        if ( knownFile )
+        {
+            knownFile->m_Value = usedFile;
+        }
+        else
+        {
+            m_KnownFiles.Insert( pathKey, usedFile );
+        }
+
         // use the new file
         fileToParse = newFile;
     }
@@ -181,6 +240,10 @@ bool BFFTokenizer::TokenizeFromString( const AString & fileName, const AString &
     // A file seen for the first time
     BFFFile * newFile = FNEW( BFFFile( cleanFileName.Get(), fileContents ) );
     m_Files.Append( newFile );
+    AStackString<> pathKey;
+    GetPathKey( cleanFileName, pathKey );
+    const KnownFile usedFile = { newFile, true };
+    m_KnownFiles.Insert( pathKey, usedFile );
 
     // Recursively tokenize
     const bool result = Tokenize( newFile );
@@ -203,10 +266,29 @@ bool BFFTokenizer::Tokenize( const BFFFile * file )
 {
     ASSERT( m_Files.Find( file ) );
 
+    // Re-use tokens from a previous parse if possible
+    if ( m_TokenCache && m_TokenCache->GetTokens( *file, m_Tokens ) )
+    {
+        return true;
+    }
+
     // Tokenize the stream
+    const size_t firstToken = m_Tokens.GetSize();
+    const bool parentFileHasDirectives = m_FileHasDirectives;
+    m_FileHasDirectives = false;
     const char * pos = file->GetSourceFileContents().Get();
     const char * end = file->GetSourceFileContents().GetEnd();
-    return Tokenize( *file, pos, end );
+    const bool result = Tokenize( *file, pos, end );
+
+    // Files without directives tokenize the same way regardless of defines,
+    // environment or other files, so can be re-used while unchanged
+    if ( result && m_TokenCache && ( m_FileHasDirectives == false ) )
+    {
+        m_TokenCache->StoreTokens( *file, m_Tokens.Begin() + firstToken, m_Tokens.End() );
+    }
+    m_FileHasDirectives = parentFileHasDirectives;
+
+    return result;
 }
 
 // Tokenize
@@ -353,6 +435,7 @@ bool BFFTokenizer::Tokenize( const BFFFile & file, const char * pos, const char
         // # directive (non-recursive)
         if ( IsDirective( c ) && ( m_ParsingDirective == false ) )
         {
+            m_FileHasDirectives = true;
             if ( HandleDirective( pos, end, file ) == false )
             {
                 return false; // HandleDirective will have emitted an error
@@ -1167,4 +1250,146 @@ void BFFTokenizer::ExpandIncludePath( const BFFFile & file, AString & includePat
     }
 }
 
+// PrefetchIncludes
+//------------------------------------------------------------------------------
+void BFFTokenizer::PrefetchIncludes( const AString & rootFileName )
+{
+    PROFILE_FUNCTION;
+
+    // Which files are tokenized depends on directives (#if etc) so can only be
+    // determined serially. However, loading and hashing the files is
+    // independent of that, so we load every file which could be included
+    // in parallel, one level of the hierarchy at a time. Files which are not
+    // ultimately used are discarded, and errors are only reported if a file
+    // is actually included.
+    const KnownFile unloadedFile = { nullptr, false };
+    Array<AString> filesToLoad( 64, true );
+    AStackString<> cleanFileName;
+    AStackString<> pathKey;
+    NodeGraph::CleanPath( rootFileName, cleanFileName );
+    GetPathKey( cleanFileName, pathKey );
+    m_KnownFiles.Insert( pathKey, unloadedFile );
+    filesToLoad.Append( cleanFileName );
+
+    const uint32_t maxThreads = Env::GetNumProcessors();
+    while ( filesToLoad.IsEmpty() == false )
+    {
+        Array<BFFFile *> loadedFiles;
+        loadedFiles.SetSize( filesToLoad.GetSize() );
+
+        PrefetchContext context;
+        context.m_FileNames = &filesToLoad;
+        context.m_LoadedFiles = &loadedFiles;
+        context.m_NextIndex = 0;
+
+        // Load files, using the main thread as one of the loading threads
+        const uint32_t numThreads = Math::Min( maxThreads, (uint32_t)filesToLoad.GetSize() );
+        Thread * threads = ( numThreads > 1 ) ? FNEW_ARRAY( Thread[ numThreads - 1 ] ) : nullptr;
+        for ( uint32_t i = 0; i < ( numThreads - 1 ); ++i )
+        {
+            threads[ i ].Start( PrefetchThreadFunc, "BFFPrefetch", &context );
+        }
+        PrefetchThreadFunc( &context );
+        for ( uint32_t i = 0; i < ( numThreads - 1 ); ++i )
+        {
+            threads[ i ].Join();
+        }
+        FDELETE_ARRAY threads;
+
+        // Find the next level of includes
+        filesToLoad.Clear();
+        for ( BFFFile * file : loadedFiles )
+        {
+            if ( file == nullptr )
+            {
+                continue; // Error will be reported if file is actually used
+            }
+            m_PrefetchedFiles.Append( file );
+            GetPathKey( file->GetFileName(), pathKey );
+            m_KnownFiles.Find( pathKey )->m_Value.m_File = file;
+
+            Array<AString> includes;
+            FindIncludes( *file, includes );
+            for ( const AString & include : includes )
+            {
+                NodeGraph::CleanPath( include, cleanFileName );
+                GetPathKey( cleanFileName, pathKey );
+                if ( m_KnownFiles.Find( pathKey ) == nullptr )
+                {
+                    m_KnownFiles.Insert( pathKey, unloadedFile );
+                    filesToLoad.Append( cleanFileName );
+                }
+            }
+        }
+    }
+}
+
+// FindIncludes
+//------------------------------------------------------------------------------
+void BFFTokenizer::FindIncludes( const BFFFile & file, Array<AString> & outIncludes ) const
+{
+    // Find all #include directives, regardless of any conditions they may be
+    // subject to. Only simple string arguments are considered.
+    const AString & contents = file.GetSourceFileContents();
+    const char * pos = contents.Get();
+    const char * const end = contents.GetEnd();
+    while ( pos < end )
+    {
+        SkipWhitespace( pos );
+        if ( IsDirective( *pos ) )
+        {
+            ++pos;
+            SkipWhitespaceOnCurrentLine( pos );
+            if ( AString::StrNCmp( pos, "include", 7 ) == 0 )
+            {
+                pos += 7;
+                SkipWhitespaceOnCurrentLine( pos );
+                if ( IsStringStart( *pos ) )
+                {
+                    const char quote = *pos;
+                    const char * const pathStart = ++pos;
+                    while ( ( pos < end ) && ( *pos != quote ) && !IsAtEndOfLine( *pos ) )
+                    {
+                        ++pos;
+                    }
+                    if ( ( *pos == quote ) && ( pos > pathStart ) )
+                    {
+                        AStackString<> include( pathStart, pos );
+                        ExpandIncludePath( file, include );
+                        outIncludes.Append( include );
+                    }
+                }
+            }
+        }
+        SkipToStartOfNextLine( pos, end );
+    }
+}
+
+// PrefetchThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t BFFTokenizer::PrefetchThreadFunc( void * userData )
+{
+    PrefetchContext & context = *static_cast< PrefetchContext * >( userData );
+    const Array<AString> & fileNames = *context.m_FileNames;
+    for ( ;; )
+    {
+        const uint32_t index = ( AtomicInc( &context.m_NextIndex ) - 1 );
+        if ( index >= fileNames.GetSize() )
+        {
+            break;
+        }
+
+        // Failing to load is not an error, since the include may never be
+        // used. If it is, the error is reported during tokenization.
+        BFFFile * file = FNEW( BFFFile() );
+        if ( file->Load( fileNames[ index ], nullptr, false ) == false )
+        {
+            FDELETE( file );
+            file = nullptr;
+        }
+        ( *context.m_LoadedFiles )[ index ] = file;
+    }
+    return 0;
+}
+
 //------------------------------------------------------------------------------
@@ -10,10 +10,12 @@
 
 // Core
 #include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class BFFTokenCache;
 class BFFTokenRange;
 
 // BFFTokenizer
@@ -28,12 +30,16 @@ public:
     // Process bff file hierarchy from a root file
     bool TokenizeFromFile( const AString & fileName );
 
+    // Re-use tokens for unchanged files (optional)
+    void SetTokenCache( BFFTokenCache * tokenCache ) { m_TokenCache = tokenCache; }
+
     // Preocess from an buffer in memory (for tests)
     bool TokenizeFromString( const AString & fileName, const AString & fileContents );
 
     // Access results
     const Array<BFFToken> &     GetTokens() const { return m_Tokens; }
     const Array<BFFFile *> &    GetUsedFiles() const { return m_Files; }
+    uint32_t                    GetNumPrefetchedFilesUsed() const { return m_NumPrefetchedFilesUsed; }
 
 protected:
     bool Tokenize( const AString & fileName, const BFFToken * token );
@@ -61,17 +67,34 @@ protected:
 
     void ExpandIncludePath( const BFFFile & file, AString & includePath ) const;
 
+    // Load files in the #include hierarchy in parallel, ahead of tokenization
+    void PrefetchIncludes( const AString & rootFileName );
+    void FindIncludes( const BFFFile & file, Array<AString> & outIncludes ) const;
+    static uint32_t PrefetchThreadFunc( void * userData );
+
     struct IncludedFile
     {
         AString     m_FileName;
         bool        m_Once;
     };
 
+    // Files which have been included or prefetched, by path
+    struct KnownFile
+    {
+        BFFFile *   m_File;     // nullptr if prefetching failed
+        bool        m_Used;     // Included, and owned by m_Files
+    };
+
     Array<BFFToken>     m_Tokens;
     Array<BFFFile *>    m_Files;
+    Array<BFFFile *>    m_PrefetchedFiles;  // Loaded speculatively, not yet used
+    UnorderedMap<AString, KnownFile> m_KnownFiles;
+    uint32_t            m_NumPrefetchedFilesUsed = 0;
     BFFMacros           m_Macros;
+    BFFTokenCache *     m_TokenCache = nullptr;
     uint32_t            m_Depth = 0;
     bool                m_ParsingDirective = false;
+    bool                m_FileHasDirectives = false; // Tokens depend on state outside the current file
 };
 
 //------------------------------------------------------------------------------
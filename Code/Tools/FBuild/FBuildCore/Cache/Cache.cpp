@@ -6,14 +6,23 @@
 #include "Cache.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheFilter.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheTrimmer.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ContentChunker.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Network/Network.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Process.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Time.h"
@@ -40,25 +49,68 @@ public:
     }
 };
 
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Stored instead of the data of large entries, followed by the chunks
+    struct ChunkManifestHeader
+    {
+        uint32_t    m_Magic;
+        uint32_t    m_NumChunks;
+        uint64_t    m_DataSize;
+    };
+    struct ChunkManifestEntry
+    {
+        uint64_t    m_Hash;
+        uint32_t    m_Size;
+        uint32_t    m_Padding;
+    };
+    constexpr uint32_t kChunkManifestMagic = 0x4D434246; // FBCM
+
+    // Written to the root of the cache by Trim
+    const char * const kFilterFileName = "CacheFilter.fbf";
+
+    // How often clients check for a newer filter
+    constexpr float kFilterRefreshIntervalSecs = 60.0f;
+
+    // How long each process writes to one file of filter updates
+    constexpr float kFilterUpdatesFileSecs = ( 10.0f * 60.0f );
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
-/*explicit*/ Cache::Cache() = default;
+/*explicit*/ Cache::Cache( uint32_t maxSizeMiB, uint32_t dedupMinSizeMiB )
+    : m_MaxSizeMiB( maxSizeMiB )
+    , m_DedupMinSizeMiB( dedupMinSizeMiB )
+{
+}
 
 // DESTRUCTOR
 //------------------------------------------------------------------------------
-/*virtual*/ Cache::~Cache() = default;
+/*virtual*/ Cache::~Cache()
+{
+    FDELETE m_Trimmer;
+    FDELETE m_FilterUpdatesFile;
+    FDELETE m_Filter;
+    for ( CacheFilter * filter : m_RetiredFilters )
+    {
+        FDELETE filter;
+    }
+}
 
 // Init
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Init( const AString & cachePath,
                               const AString & cachePathMountPoint,
-                              bool /*cacheRead*/,
-                              bool /*cacheWrite*/,
-                              bool /*cacheVerbose*/,
+                              bool cacheRead,
+                              bool cacheWrite,
+                              bool cacheVerbose,
                               const AString & /*pluginDLLConfig*/ )
 {
     PROFILE_FUNCTION;
 
+    m_Verbose = cacheVerbose;
     m_CachePath = cachePath;
     PathUtils::EnsureTrailingSlash( m_CachePath );
 
@@ -78,6 +130,11 @@ public:
 
     if ( FileIO::EnsurePathExists( m_CachePath ) )
     {
+        // Keep under the size limit while building
+        if ( ( m_MaxSizeMiB > 0 ) && ( cacheRead || cacheWrite ) )
+        {
+            m_Trimmer = FNEW( CacheTrimmer( *this, m_MaxSizeMiB ) );
+        }
         return true;
     }
 
@@ -89,7 +146,13 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::Shutdown()
 {
-    // Nothing to do
+    // Stop trimming
+    FDELETE m_Trimmer;
+    m_Trimmer = nullptr;
+
+    MutexHolder mh( m_FilterUpdatesMutex );
+    FDELETE m_FilterUpdatesFile;
+    m_FilterUpdatesFile = nullptr;
 }
 
 // Publish
@@ -99,6 +162,36 @@ public:
     AStackString<> fullPath;
     GetFullPathForCacheEntry( cacheId, fullPath );
 
+    // Large entries are stored in chunks, shared with similar entries
+    if ( ( m_DedupMinSizeMiB > 0 ) && ( dataSize >= ( (uint64_t)m_DedupMinSizeMiB * MEGABYTE ) ) )
+    {
+        if ( PublishChunked( cacheId, fullPath, data, dataSize ) == false )
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if ( WriteCacheFile( fullPath, data, dataSize ) == false )
+        {
+            return false;
+        }
+
+        uint32_t bucket;
+        if ( m_Trimmer && GetBucketForCacheEntry( cacheId, bucket ) )
+        {
+            m_Trimmer->OnPublish( bucket, dataSize );
+        }
+    }
+
+    RecordFilterUpdate( cacheId );
+    return true;
+}
+
+// WriteCacheFile
+//------------------------------------------------------------------------------
+bool Cache::WriteCacheFile( const AString & fullPath, const void * data, size_t dataSize ) const
+{
     // make sure the cache output path exists
     if ( !FileIO::EnsurePathExistsForFile( fullPath ) )
     {
@@ -160,6 +253,17 @@ public:
         UniquePtr< char > mem( (char *)ALLOC( cacheFileSize ) );
         if ( cacheFile.Read( mem.Get(), cacheFileSize ) == cacheFileSize )
         {
+            if ( m_Trimmer )
+            {
+                m_Trimmer->OnRetrieve( fullPath );
+            }
+
+            // Large entries are stored in chunks
+            if ( IsChunkManifest( mem.Get(), cacheFileSize ) )
+            {
+                return RetrieveChunked( mem.Get(), cacheFileSize, data, dataSize );
+            }
+
             dataSize = cacheFileSize;
             data = mem.Release();
             return true;
@@ -169,6 +273,45 @@ public:
     return false;
 }
 
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void Cache::ExistsBatch( CacheBatchItem * items, size_t numItems )
+{
+    // NOTE: Chunked entries are assumed to have all their chunks
+    AStackString<> fullPath;
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        GetFullPathForCacheEntry( *items[ i ].m_CacheId, fullPath );
+        items[ i ].m_Result = FileIO::FileExists( fullPath.Get() );
+    }
+}
+
+// MayContain
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::MayContain( const AString & cacheId )
+{
+    if ( IsFilterSupported() == false )
+    {
+        return true;
+    }
+
+    // Refreshed by whichever thread notices first, while others continue
+    // to use the current filter
+    if ( Timer::GetNow() >= AtomicLoadRelaxed( &m_NextFilterRefresh ) )
+    {
+        if ( AtomicExchange( &m_FilterRefreshing, 1 ) == 0 )
+        {
+            RefreshFilter();
+            const int64_t interval = (int64_t)( kFilterRefreshIntervalSecs * (float)Timer::GetFrequency() );
+            AtomicStoreRelaxed( &m_NextFilterRefresh, Timer::GetNow() + interval );
+            AtomicStoreRelease( &m_FilterRefreshing, (uint32_t)0 );
+        }
+    }
+
+    const CacheFilter * filter = AtomicLoadAcquire( &m_Filter );
+    return ( filter == nullptr ) || filter->MayContain( cacheId );
+}
+
 // FreeMemory
 //------------------------------------------------------------------------------
 /*virtual*/ void Cache::FreeMemory( void * data, size_t /*dataSize*/ )
@@ -244,99 +387,373 @@ public:
 //------------------------------------------------------------------------------
 /*virtual*/ bool Cache::Trim( bool showProgress, uint32_t sizeMiB )
 {
+    // Entries published while enumerating may be missed by the filter
+    const uint64_t filterCreationTime = Time::GetCurrentFileTime();
+
     // Get all the files
     Array< FileIO::FileInfo > allFiles( 1000000 );
     uint64_t totalSize = 0;
     GetCacheFiles( showProgress, allFiles, totalSize );
     OUTPUT( " - Before: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize(), (uint32_t)( totalSize / MEGABYTE ) );
 
-    // Sort by age
-    OldestFileTimeSorter sorter;
-    allFiles.Sort( sorter );
-
     // Do we need to delete anything?
     OUTPUT( "Trimming to %u MiB:\n", sizeMiB );
-    const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
-    uint32_t numDeleted = 0;
-    if ( limit < totalSize )
+    const uint32_t numDeleted = DeleteOldestFiles( showProgress, sizeMiB, allFiles, totalSize );
+
+    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
+
+    if ( IsFilterSupported() )
     {
-        const Timer timer;
-        float lastProgressTime = 0.0f;
-        if ( showProgress )
+        WriteFilter( allFiles, filterCreationTime );
+        DeleteOldFilterUpdates( filterCreationTime );
+    }
+    return true;
+}
+
+// WriteFilter
+//------------------------------------------------------------------------------
+void Cache::WriteFilter( const Array< FileIO::FileInfo > & allFiles, uint64_t creationTime ) const
+{
+    PROFILE_FUNCTION;
+
+    // NOTE: Deleted entries are included, which only increases false positives
+    CacheFilter filter;
+    filter.Init( allFiles.GetSize(), creationTime );
+    AStackString<> cacheId;
+    for ( const FileIO::FileInfo & info : allFiles )
+    {
+        // Chunks (and partially written files) are not entries
+        if ( info.m_Name.EndsWith( ".chunk" ) || info.m_Name.EndsWith( ".tmp" ) )
         {
-            FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+            continue;
         }
-        const uint64_t originalTotalSize = totalSize;
+        const char * lastSlash = info.m_Name.FindLast( NATIVE_SLASH );
+        cacheId = lastSlash ? ( lastSlash + 1 ) : info.m_Name.Get();
+        filter.Add( cacheId );
+    }
+
+    MemoryStream stream;
+    filter.Save( stream );
+    AStackString<> fileName;
+    GetFilterFileName( fileName );
+    if ( WriteCacheFile( fileName, stream.GetData(), stream.GetSize() ) )
+    {
+        OUTPUT( " - Filter: %" PRIu64 " Entries\n", filter.GetNumEntries() );
+    }
+    else
+    {
+        FLOG_WARN( "Failed to write cache filter '%s'", fileName.Get() );
+    }
+}
+
+// RefreshFilter
+//------------------------------------------------------------------------------
+void Cache::RefreshFilter()
+{
+    PROFILE_FUNCTION;
 
-        // Iterate over files, deleting oldest first
-        for ( const FileIO::FileInfo & info : allFiles )
+    // Replaced by a trim?
+    CacheFilter * filter = m_Filter;
+    AStackString<> fileName;
+    GetFilterFileName( fileName );
+    const uint64_t fileTime = FileIO::GetFileLastWriteTime( fileName );
+    if ( fileTime != m_FilterFileTime )
+    {
+        m_FilterFileTime = fileTime;
+
+        filter = nullptr;
+        FileStream file;
+        if ( file.Open( fileName.Get(), FileStream::READ_ONLY ) )
         {
-            // Try to delete (ok to fail if file is in use)
-            if ( FileIO::FileDelete( info.m_Name.Get() ) )
+            const size_t fileSize = (size_t)file.GetFileSize();
+            UniquePtr< char > mem( (char *)ALLOC( fileSize ) );
+            if ( file.Read( mem.Get(), fileSize ) == fileSize )
             {
-                totalSize -= info.m_Size;
-                ++numDeleted;
-
-                // Are we under the limit now?
-                if ( totalSize <= limit )
+                filter = FNEW( CacheFilter );
+                if ( filter->Load( mem.Get(), fileSize ) == false )
                 {
-                    break;
+                    FLOG_WARN( "Ignoring invalid cache filter '%s'", fileName.Get() );
+                    FDELETE filter;
+                    filter = nullptr;
                 }
+            }
+        }
 
-                // Progress
-                if ( showProgress )
-                {
-                    // Throttled to avoid perf impact
-                    if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
-                    {
-                        const uint64_t toDeleteBytes = originalTotalSize - limit;
-                        const uint64_t deletedBytes = originalTotalSize - totalSize;
-                        const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
-                        FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
-                        lastProgressTime = timer.GetElapsed();
-                    }
-                }
+        // Other threads may still be using the previous filter
+        CacheFilter * previousFilter = m_Filter;
+        if ( previousFilter )
+        {
+            m_RetiredFilters.Append( previousFilter );
+        }
+        AtomicStoreRelease( &m_Filter, filter );
+
+        // All updates are applied to the new filter
+        m_FilterUpdates.Clear();
+
+        if ( m_Verbose && filter )
+        {
+            #if defined( __WINDOWS__ )
+                const uint64_t oneMinute = ( 60 * (uint64_t)10000000 );
+            #else
+                const uint64_t oneMinute = ( 60 * (uint64_t)1000000000 );
+            #endif
+            const uint64_t currentTime = Time::GetCurrentFileTime();
+            const uint64_t creationTime = filter->GetCreationTime();
+            const uint64_t ageMins = ( currentTime > creationTime ) ? ( ( currentTime - creationTime ) / oneMinute ) : 0;
+            FLOG_OUTPUT( "Cache Filter: %" PRIu64 " entries, created %" PRIu64 " mins ago '%s'\n", filter->GetNumEntries(), ageMins, fileName.Get() );
+        }
+    }
+
+    // Add entries published since
+    if ( filter )
+    {
+        ApplyFilterUpdates( *filter );
+    }
+}
+
+// ApplyFilterUpdates
+//------------------------------------------------------------------------------
+void Cache::ApplyFilterUpdates( CacheFilter & filter )
+{
+    PROFILE_FUNCTION;
+
+    AStackString<> path;
+    GetFilterUpdatesPath( path );
+    Array< AString > patterns;
+    patterns.EmplaceBack( "*.ids" );
+    Array< FileIO::FileInfo > files( 256, true );
+    FileIO::GetFilesEx( path, &patterns, false, &files );
+
+    // Forget files which have been deleted
+    for ( size_t i = m_FilterUpdates.GetSize(); i > 0; --i )
+    {
+        const AString & fileName = m_FilterUpdates[ i - 1 ].m_FileName;
+        bool found = false;
+        for ( const FileIO::FileInfo & info : files )
+        {
+            if ( info.m_Name == fileName )
+            {
+                found = true;
+                break;
             }
         }
+        if ( found == false )
+        {
+            m_FilterUpdates.EraseIndex( i - 1 );
+        }
+    }
 
-        if ( showProgress )
+    AStackString<> cacheId;
+    for ( const FileIO::FileInfo & info : files )
+    {
+        FilterUpdates * updates = nullptr;
+        for ( FilterUpdates & existing : m_FilterUpdates )
+        {
+            if ( existing.m_FileName == info.m_Name )
+            {
+                updates = &existing;
+                break;
+            }
+        }
+        if ( updates == nullptr )
         {
-            FLog::ClearProgress();
+            updates = &m_FilterUpdates.EmplaceBack();
+            updates->m_FileName = info.m_Name;
+            updates->m_AppliedSize = 0;
+        }
+        if ( info.m_Size <= updates->m_AppliedSize )
+        {
+            continue; // Nothing new
+        }
+
+        // Read what has been appended since last time
+        FileStream file;
+        if ( file.Open( info.m_Name.Get(), FileStream::READ_ONLY ) == false )
+        {
+            continue; // Try again next time
+        }
+        const uint64_t newSize = file.GetFileSize();
+        if ( ( newSize <= updates->m_AppliedSize ) || ( file.Seek( updates->m_AppliedSize ) == false ) )
+        {
+            continue;
+        }
+        const size_t readSize = (size_t)( newSize - updates->m_AppliedSize );
+        UniquePtr< char > mem( (char *)ALLOC( readSize ) );
+        if ( file.ReadBuffer( mem.Get(), readSize ) != readSize )
+        {
+            continue;
+        }
+
+        // One id per line (the last may be incomplete, if still being written)
+        const char * pos = mem.Get();
+        const char * end = ( pos + readSize );
+        for ( ;; )
+        {
+            const char * lineEnd = pos;
+            while ( ( lineEnd < end ) && ( *lineEnd != '\n' ) )
+            {
+                ++lineEnd;
+            }
+            if ( lineEnd == end )
+            {
+                break;
+            }
+            cacheId.Assign( pos, lineEnd );
+            filter.Add( cacheId );
+            pos = ( lineEnd + 1 );
         }
+        updates->m_AppliedSize += (uint64_t)( pos - mem.Get() );
     }
+}
 
-    OUTPUT( " - After: %u Files @ %u MiB\n", (uint32_t)allFiles.GetSize() - numDeleted, (uint32_t)( totalSize / MEGABYTE ) );
-    return true;
+// RecordFilterUpdate
+//------------------------------------------------------------------------------
+void Cache::RecordFilterUpdate( const AString & cacheId )
+{
+    if ( IsFilterSupported() == false )
+    {
+        return;
+    }
+
+    // Visible to this process immediately...
+    CacheFilter * filter = AtomicLoadAcquire( &m_Filter );
+    if ( filter )
+    {
+        filter->Add( cacheId );
+    }
+
+    // ...and to others when they next refresh
+    MutexHolder mh( m_FilterUpdatesMutex );
+
+    // Start a new file periodically, so those no longer written can be deleted
+    // once a new filter includes them. Updates are only recorded if there is a
+    // filter, which is checked at the same time.
+    if ( ( m_FilterUpdatesChecked == false ) || ( m_FilterUpdatesTimer.GetElapsed() > kFilterUpdatesFileSecs ) )
+    {
+        m_FilterUpdatesChecked = true;
+        m_FilterUpdatesTimer.Start();
+        FDELETE m_FilterUpdatesFile;
+        m_FilterUpdatesFile = nullptr;
+
+        AStackString<> filterFileName;
+        GetFilterFileName( filterFileName );
+        AStackString<> path;
+        GetFilterUpdatesPath( path );
+        if ( FileIO::FileExists( filterFileName.Get() ) && FileIO::EnsurePathExists( path ) )
+        {
+            // Named uniquely, so no other process will write to it
+            AStackString<> hostName;
+            Network::GetHostName( hostName );
+            AStackString<> fileName;
+            fileName.Format( "%s%s-%u-%" PRIX64 ".ids", path.Get(), hostName.Get(), Process::GetCurrentId(), Time::GetCurrentFileTime() );
+            FileStream * file = FNEW( FileStream );
+            if ( file->Open( fileName.Get(), FileStream::WRITE_ONLY ) )
+            {
+                m_FilterUpdatesFile = file;
+            }
+            else
+            {
+                FDELETE file;
+            }
+        }
+    }
+
+    if ( m_FilterUpdatesFile )
+    {
+        AStackString<> line( cacheId );
+        line += '\n';
+        m_FilterUpdatesFile->WriteBuffer( line.Get(), line.GetLength() );
+    }
 }
 
-// GetCacheFiles
+// DeleteOldFilterUpdates
 //------------------------------------------------------------------------------
-void Cache::GetCacheFiles( bool showProgress,
-                           Array< FileIO::FileInfo > & outInfo,
-                           uint64_t & outTotalSize ) const
+void Cache::DeleteOldFilterUpdates( uint64_t filterCreationTime ) const
 {
-    // Throttle progress messages to avoid impacting performance significantly
-    // (network cache is usually the bottleneck, but a local caches is not)
+    // Files no longer written to (allowing for clock differences between
+    // machines) were complete when the filter was created, so are included
+    #if defined( __WINDOWS__ )
+        const uint64_t oneSecond = (uint64_t)10000000;
+    #else
+        const uint64_t oneSecond = (uint64_t)1000000000;
+    #endif
+    const uint64_t margin = ( (uint64_t)( kFilterUpdatesFileSecs * 2.0f ) * oneSecond );
+    if ( filterCreationTime <= margin )
+    {
+        return;
+    }
+    const uint64_t cutoffTime = ( filterCreationTime - margin );
+
+    AStackString<> path;
+    GetFilterUpdatesPath( path );
+    Array< AString > patterns;
+    patterns.EmplaceBack( "*.ids" );
+    Array< FileIO::FileInfo > files( 256, true );
+    FileIO::GetFilesEx( path, &patterns, false, &files );
+    for ( const FileIO::FileInfo & info : files )
+    {
+        if ( info.m_LastWriteTime < cutoffTime )
+        {
+            FileIO::FileDelete( info.m_Name.Get() );
+        }
+    }
+}
+
+// GetFilterFileName
+//------------------------------------------------------------------------------
+void Cache::GetFilterFileName( AString & outFileName ) const
+{
+    outFileName = m_CachePath;
+    outFileName += kFilterFileName;
+}
+
+// GetFilterUpdatesPath
+//------------------------------------------------------------------------------
+void Cache::GetFilterUpdatesPath( AString & outPath ) const
+{
+    outPath.Format( "%sFilterUpdates%c", m_CachePath.Get(), NATIVE_SLASH );
+}
+
+// DeleteOldestFiles
+//------------------------------------------------------------------------------
+uint32_t Cache::DeleteOldestFiles( bool showProgress,
+                                   uint32_t sizeMiB,
+                                   Array< FileIO::FileInfo > & allFiles,
+                                   uint64_t & inOutTotalSize ) const
+{
+    const uint64_t limit = ( (uint64_t)sizeMiB * MEGABYTE );
+    if ( limit >= inOutTotalSize )
+    {
+        return 0;
+    }
+
+    // Sort by age
+    OldestFileTimeSorter sorter;
+    allFiles.Sort( sorter );
+
     const Timer timer;
     float lastProgressTime = 0.0f;
     if ( showProgress )
     {
         FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
     }
+    const uint64_t originalTotalSize = inOutTotalSize;
 
-    // Scan the matrix of directories
-    for ( size_t i=0; i<256; ++i )
+    // Iterate over files, deleting oldest first
+    uint32_t numDeleted = 0;
+    for ( const FileIO::FileInfo & info : allFiles )
     {
-        for ( size_t j=0; j<256; ++j )
+        // Try to delete (ok to fail if file is in use)
+        if ( DeleteCacheFile( info.m_Name ) )
         {
-            // Get Files
-            AStackString<> path;
-            path.Format( "%s%02X%c%02X%c", m_CachePath.Get(),
-                                               (uint32_t)i,
-                                               NATIVE_SLASH,
-                                               (uint32_t)j,
-                                               NATIVE_SLASH);
-            FileIO::GetFilesEx( path, nullptr, false, &outInfo );
+            inOutTotalSize -= info.m_Size;
+            ++numDeleted;
+
+            // Are we under the limit now?
+            if ( inOutTotalSize <= limit )
+            {
+                break;
+            }
 
             // Progress
             if ( showProgress )
@@ -344,7 +761,9 @@ void Cache::GetCacheFiles( bool showProgress,
                 // Throttled to avoid perf impact
                 if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
                 {
-                    const float perc = ( (float)( ( i*256 ) + j ) / (float)( 256 * 256 ) ) * 100.0f;
+                    const uint64_t toDeleteBytes = originalTotalSize - limit;
+                    const uint64_t deletedBytes = originalTotalSize - inOutTotalSize;
+                    const float perc = ( (float)deletedBytes / (float)toDeleteBytes ) * 100.0f;
                     FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
                     lastProgressTime = timer.GetElapsed();
                 }
@@ -352,6 +771,46 @@ void Cache::GetCacheFiles( bool showProgress,
         }
     }
 
+    if ( showProgress )
+    {
+        FLog::ClearProgress();
+    }
+
+    return numDeleted;
+}
+
+// GetCacheFiles
+//------------------------------------------------------------------------------
+void Cache::GetCacheFiles( bool showProgress,
+                           Array< FileIO::FileInfo > & outInfo,
+                           uint64_t & outTotalSize ) const
+{
+    // Throttle progress messages to avoid impacting performance significantly
+    // (network cache is usually the bottleneck, but a local caches is not)
+    const Timer timer;
+    float lastProgressTime = 0.0f;
+    if ( showProgress )
+    {
+        FLog::OutputProgress( 0.0f, 0.0f, 0, 0, 0, 0 );
+    }
+
+    for ( uint32_t i = 0; i < 256; ++i )
+    {
+        GetBucketFiles( i, outInfo, nullptr );
+
+        // Progress
+        if ( showProgress )
+        {
+            // Throttled to avoid perf impact
+            if ( ( timer.GetElapsed() - lastProgressTime ) > 0.5f )
+            {
+                const float perc = ( (float)i / 256.0f ) * 100.0f;
+                FLog::OutputProgress( timer.GetElapsed(), perc, 0, 0, 0, 0 );
+                lastProgressTime = timer.GetElapsed();
+            }
+        }
+    }
+
     // Calculate totals
     outTotalSize = 0;
     for ( const FileIO::FileInfo & info : outInfo )
@@ -365,6 +824,215 @@ void Cache::GetCacheFiles( bool showProgress,
     }
 }
 
+// GetBucketFiles
+//------------------------------------------------------------------------------
+/*virtual*/ void Cache::GetBucketFiles( uint32_t bucket, Array< FileIO::FileInfo > & outInfo, const volatile bool * abort ) const
+{
+    // Scan the directories for this bucket
+    for ( uint32_t j = 0; j < 256; ++j )
+    {
+        if ( abort && *abort )
+        {
+            return;
+        }
+
+        // Get Files
+        AStackString<> path;
+        path.Format( "%s%02X%c%02X%c", m_CachePath.Get(),
+                                       bucket,
+                                       NATIVE_SLASH,
+                                       j,
+                                       NATIVE_SLASH );
+        FileIO::GetFilesEx( path, nullptr, false, &outInfo );
+    }
+}
+
+// GetTrimLeaseFileName
+//------------------------------------------------------------------------------
+void Cache::GetTrimLeaseFileName( uint32_t bucket, AString & outFileName ) const
+{
+    // format example: N:\\fbuild.cache\\TrimLeases\\AB.lease
+    outFileName.Format( "%sTrimLeases%c%02X.lease", m_CachePath.Get(), NATIVE_SLASH, bucket );
+}
+
+// PublishChunked
+//------------------------------------------------------------------------------
+bool Cache::PublishChunked( const AString & cacheId, const AString & fullPath, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    // Compressed blocks already end at content-defined boundaries, so are used
+    // as the chunks. Chunking the compressed stream itself finds few shared
+    // chunks, since an edit changes all of the compressed data after it.
+    Array< uint32_t > chunkSizes( 256, true );
+    if ( Compressor::GetBlockSizes( data, dataSize, chunkSizes ) == false )
+    {
+        ContentChunker::Split( data, dataSize, chunkSizes );
+    }
+
+    const size_t manifestSize = sizeof( ChunkManifestHeader ) + ( sizeof( ChunkManifestEntry ) * chunkSizes.GetSize() );
+    UniquePtr< char > manifest( (char *)ALLOC( manifestSize ) );
+    ChunkManifestHeader * header = (ChunkManifestHeader *)manifest.Get();
+    header->m_Magic = kChunkManifestMagic;
+    header->m_NumChunks = (uint32_t)chunkSizes.GetSize();
+    header->m_DataSize = dataSize;
+    ChunkManifestEntry * entries = (ChunkManifestEntry *)( header + 1 );
+
+    // Store chunks not already in the cache
+    const char * chunk = (const char *)data;
+    for ( size_t i = 0; i < chunkSizes.GetSize(); ++i )
+    {
+        const uint32_t chunkSize = chunkSizes[ i ];
+        const uint64_t chunkHash = xxHash::Calc64( chunk, chunkSize );
+        entries[ i ].m_Hash = chunkHash;
+        entries[ i ].m_Size = chunkSize;
+        entries[ i ].m_Padding = 0;
+
+        AStackString<> chunkPath;
+        GetFullPathForChunk( chunkHash, chunkSize, chunkPath );
+        if ( FileIO::FileExists( chunkPath.Get() ) )
+        {
+            // Now in use by this entry too, so keep it when trimming
+            FileIO::SetFileLastWriteTimeToNow( chunkPath );
+        }
+        else
+        {
+            if ( WriteCacheFile( chunkPath, chunk, chunkSize ) == false )
+            {
+                return false;
+            }
+            if ( m_Trimmer )
+            {
+                m_Trimmer->OnPublish( (uint32_t)( chunkHash >> 56 ), chunkSize );
+            }
+        }
+        chunk += chunkSize;
+    }
+
+    // Store the manifest as the entry
+    if ( WriteCacheFile( fullPath, manifest.Get(), manifestSize ) == false )
+    {
+        return false;
+    }
+    uint32_t bucket;
+    if ( m_Trimmer && GetBucketForCacheEntry( cacheId, bucket ) )
+    {
+        m_Trimmer->OnPublish( bucket, manifestSize );
+    }
+    return true;
+}
+
+// RetrieveChunked
+//------------------------------------------------------------------------------
+bool Cache::RetrieveChunked( const void * manifest, size_t manifestSize, void * & outData, size_t & outDataSize )
+{
+    PROFILE_FUNCTION;
+
+    (void)manifestSize;
+    const ChunkManifestHeader * header = (const ChunkManifestHeader *)manifest;
+    const ChunkManifestEntry * entries = (const ChunkManifestEntry *)( header + 1 );
+
+    const size_t dataSize = (size_t)header->m_DataSize;
+    UniquePtr< char > data( (char *)ALLOC( dataSize ) );
+    size_t offset = 0;
+    for ( uint32_t i = 0; i < header->m_NumChunks; ++i )
+    {
+        const ChunkManifestEntry & entry = entries[ i ];
+        if ( entry.m_Size > ( dataSize - offset ) )
+        {
+            return false; // Corrupt manifest
+        }
+
+        // Chunks can have been trimmed independently of the entry
+        AStackString<> chunkPath;
+        GetFullPathForChunk( entry.m_Hash, entry.m_Size, chunkPath );
+        FileStream chunkFile;
+        if ( ( chunkFile.Open( chunkPath.Get(), FileStream::READ_ONLY ) == false ) ||
+             ( chunkFile.GetFileSize() != entry.m_Size ) ||
+             ( chunkFile.Read( data.Get() + offset, entry.m_Size ) != entry.m_Size ) ||
+             ( xxHash::Calc64( data.Get() + offset, entry.m_Size ) != entry.m_Hash ) )
+        {
+            return false;
+        }
+        if ( m_Trimmer )
+        {
+            m_Trimmer->OnRetrieve( chunkPath );
+        }
+        offset += entry.m_Size;
+    }
+    if ( offset != dataSize )
+    {
+        return false; // Corrupt manifest
+    }
+
+    outData = data.Release();
+    outDataSize = dataSize;
+    return true;
+}
+
+// IsChunkManifest
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::IsChunkManifest( const void * data, size_t dataSize )
+{
+    // Regular entries never start with the magic number (see Compressor)
+    if ( dataSize < sizeof( ChunkManifestHeader ) )
+    {
+        return false;
+    }
+    const ChunkManifestHeader * header = (const ChunkManifestHeader *)data;
+    return ( ( header->m_Magic == kChunkManifestMagic ) &&
+             ( dataSize == ( sizeof( ChunkManifestHeader ) + ( sizeof( ChunkManifestEntry ) * header->m_NumChunks ) ) ) );
+}
+
+// GetFullPathForChunk
+//------------------------------------------------------------------------------
+void Cache::GetFullPathForChunk( uint64_t chunkHash, uint32_t chunkSize, AString & outFullPath ) const
+{
+    // Bucket from the hash, like entries
+    // format example: N:\\fbuild.cache\\AA\\BB\\AABBCCDDEEFF0011-00100000.chunk
+    outFullPath.Format( "%s%02X%c%02X%c%016" PRIX64 "-%08X.chunk", m_CachePath.Get(),
+                                                                  (uint32_t)( chunkHash >> 56 ),
+                                                                  NATIVE_SLASH,
+                                                                  (uint32_t)( ( chunkHash >> 48 ) & 0xFF ),
+                                                                  NATIVE_SLASH,
+                                                                  chunkHash,
+                                                                  chunkSize );
+}
+
+// DeleteCacheFile
+//------------------------------------------------------------------------------
+/*virtual*/ bool Cache::DeleteCacheFile( const AString & fileName ) const
+{
+    return FileIO::FileDelete( fileName.Get() );
+}
+
+// GetBucketForCacheEntry
+//------------------------------------------------------------------------------
+/*static*/ bool Cache::GetBucketForCacheEntry( const AString & cacheId, uint32_t & outBucket )
+{
+    // Bucket is the first directory level (see GetFullPathForCacheEntry)
+    outBucket = 0;
+    for ( uint32_t i = 0; i < 2; ++i )
+    {
+        const char c = cacheId[ i ];
+        uint32_t value;
+        if ( ( c >= '0' ) && ( c <= '9' ) )
+        {
+            value = (uint32_t)( c - '0' );
+        }
+        else if ( ( c >= 'A' ) && ( c <= 'F' ) )
+        {
+            value = (uint32_t)( c - 'A' + 10 );
+        }
+        else
+        {
+            return false; // Not enumerated when trimming
+        }
+        outBucket = ( outBucket * 16 ) + value;
+    }
+    return true;
+}
+
 // GetFullPathForCacheEntry
 //------------------------------------------------------------------------------
 void Cache::GetFullPathForCacheEntry( const AString & cacheId,
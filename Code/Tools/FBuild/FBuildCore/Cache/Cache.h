@@ -6,14 +6,23 @@
 //------------------------------------------------------------------------------
 #include "ICache.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Process/Mutex.h"
 #include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class CacheFilter;
+class CacheTrimmer;
+class FileStream;
 
 // Cache
 //------------------------------------------------------------------------------
 class Cache : public ICache
 {
 public:
-    explicit Cache();
+    explicit Cache( uint32_t maxSizeMiB = 0,        // 0 = No trimming in the background
+                    uint32_t dedupMinSizeMiB = 0 ); // 0 = No chunked storage
     virtual ~Cache() override;
 
     virtual bool Init( const AString & cachePath,
@@ -28,11 +37,77 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void ExistsBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual bool SupportsExists() const override { return true; }
+    virtual bool MayContain( const AString & cacheId ) override;
+
+protected:
+    friend class CacheTrimmer;
+
+    // Files which make up the cache are split into 256 buckets (by cache id)
+    // which can be enumerated independently (stopping early if abort is set).
+    // Files are deleted oldest first when trimming.
+    virtual void GetBucketFiles( uint32_t bucket, Array< FileIO::FileInfo > & outInfo, const volatile bool * abort ) const;
+    virtual bool DeleteCacheFile( const AString & fileName ) const;
+
+    // Taken by a client while trimming a bucket in the background
+    void GetTrimLeaseFileName( uint32_t bucket, AString & outFileName ) const;
+
+    // Entries are individual files, so can be enumerated to create a CacheFilter
+    virtual bool IsFilterSupported() const { return true; }
+
+    AString         m_CachePath;
+    uint32_t        m_MaxSizeMiB;
+    uint32_t        m_DedupMinSizeMiB;
+    CacheTrimmer *  m_Trimmer = nullptr;
 private:
+    bool            m_Verbose = false;
+
+    // Filter - read without locking. Replaced filters may still be in use, so
+    // are kept until destruction.
+    CacheFilter * volatile  m_Filter = nullptr;
+    Array< CacheFilter * >  m_RetiredFilters;
+    volatile uint32_t       m_FilterRefreshing = 0;
+    volatile int64_t        m_NextFilterRefresh = 0;    // Timer::GetNow()
+    uint64_t                m_FilterFileTime = 0;
+    struct FilterUpdates
+    {
+        AString     m_FileName;
+        uint64_t    m_AppliedSize;
+    };
+    Array< FilterUpdates >  m_FilterUpdates;            // Applied to m_Filter
+
+    // Ids published by this process, for other clients' filters
+    Mutex                   m_FilterUpdatesMutex;
+    FileStream *            m_FilterUpdatesFile = nullptr;
+    bool                    m_FilterUpdatesChecked = false;
+    Timer                   m_FilterUpdatesTimer;
+
+    // Large entries are stored as a manifest of content-defined chunks, each
+    // stored once (in the buckets, by hash), shared by similar entries
+    bool PublishChunked( const AString & cacheId, const AString & fullPath, const void * data, size_t dataSize );
+    bool RetrieveChunked( const void * manifest, size_t manifestSize, void * & outData, size_t & outDataSize );
+    static bool IsChunkManifest( const void * data, size_t dataSize );
+    void GetFullPathForChunk( uint64_t chunkHash, uint32_t chunkSize, AString & outFullPath ) const;
+
+    bool WriteCacheFile( const AString & fullPath, const void * data, size_t dataSize ) const;
+
+    // A CacheFilter of all entries is written when trimming, and used by clients
+    // (reloaded periodically) to skip lookups of entries which don't exist.
+    // Entries published since are recorded in per-process update files, which
+    // clients add to their filter when reloading it.
+    void WriteFilter( const Array< FileIO::FileInfo > & allFiles, uint64_t creationTime ) const;
+    void RefreshFilter();
+    void ApplyFilterUpdates( CacheFilter & filter );
+    void RecordFilterUpdate( const AString & cacheId );
+    void DeleteOldFilterUpdates( uint64_t filterCreationTime ) const;
+    void GetFilterFileName( AString & outFileName ) const;
+    void GetFilterUpdatesPath( AString & outPath ) const;
+
+    uint32_t DeleteOldestFiles( bool showProgress, uint32_t sizeMiB, Array< FileIO::FileInfo > & allFiles, uint64_t & inOutTotalSize ) const;
     void GetCacheFiles( bool showProgress, Array< FileIO::FileInfo > & outInfo, uint64_t & outTotalSize ) const;
     void GetFullPathForCacheEntry( const AString & cacheId, AString & outFullPath ) const;
-
-    AString m_CachePath;
+    static bool GetBucketForCacheEntry( const AString & cacheId, uint32_t & outBucket );
 };
 
 //------------------------------------------------------------------------------
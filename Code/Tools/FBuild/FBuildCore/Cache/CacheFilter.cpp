@@ -0,0 +1,152 @@
+// CacheFilter - Probabilistic membership of cache entries
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheFilter.h"
+
+// Core
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Strings/AString.h"
+
+// system
+#include <string.h> // for memcpy, memset
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    struct FilterHeader
+    {
+        uint32_t    m_Magic;
+        uint32_t    m_NumHashes;
+        uint64_t    m_CreationTime;
+        uint64_t    m_NumEntries;
+        uint64_t    m_NumWords;
+    };
+    constexpr uint32_t kFilterMagic = 0x31464346; // FCF1
+
+    // ~1% false positives
+    constexpr uint64_t kBitsPerEntry = 10;
+    constexpr uint32_t kNumHashes = 7;
+
+    // Small caches still get a useful filter
+    constexpr uint64_t kMinNumWords = 1024;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheFilter::CacheFilter() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheFilter::~CacheFilter()
+{
+    FREE( m_Words );
+}
+
+// Init
+//------------------------------------------------------------------------------
+void CacheFilter::Init( uint64_t numEntries, uint64_t creationTime )
+{
+    FREE( m_Words );
+
+    m_CreationTime = creationTime;
+    m_NumEntries = 0;
+    m_NumWords = ( ( numEntries * kBitsPerEntry ) + 63 ) / 64;
+    m_NumWords = ( m_NumWords < kMinNumWords ) ? kMinNumWords : m_NumWords;
+    m_NumHashes = kNumHashes;
+    m_Words = (uint64_t *)ALLOC( (size_t)m_NumWords * sizeof( uint64_t ) );
+    memset( m_Words, 0, (size_t)m_NumWords * sizeof( uint64_t ) );
+}
+
+// Add
+//------------------------------------------------------------------------------
+void CacheFilter::Add( const AString & cacheId )
+{
+    ASSERT( IsValid() );
+
+    // Bits are derived from two halves of one hash (double hashing)
+    const uint64_t hash = xxHash::Calc64( cacheId );
+    const uint64_t numBits = ( m_NumWords * 64 );
+    uint64_t bit = hash;
+    const uint64_t step = ( ( hash >> 32 ) | ( hash << 32 ) ) | 1;
+    for ( uint32_t i = 0; i < m_NumHashes; ++i )
+    {
+        const uint64_t index = ( bit % numBits );
+        AtomicOr( &m_Words[ index / 64 ], ( (uint64_t)1 << ( index % 64 ) ) );
+        bit += step;
+    }
+    AtomicInc( &m_NumEntries );
+}
+
+// MayContain
+//------------------------------------------------------------------------------
+bool CacheFilter::MayContain( const AString & cacheId ) const
+{
+    ASSERT( IsValid() );
+
+    const uint64_t hash = xxHash::Calc64( cacheId );
+    const uint64_t numBits = ( m_NumWords * 64 );
+    uint64_t bit = hash;
+    const uint64_t step = ( ( hash >> 32 ) | ( hash << 32 ) ) | 1;
+    for ( uint32_t i = 0; i < m_NumHashes; ++i )
+    {
+        const uint64_t index = ( bit % numBits );
+        if ( ( AtomicLoadRelaxed( &m_Words[ index / 64 ] ) & ( (uint64_t)1 << ( index % 64 ) ) ) == 0 )
+        {
+            return false;
+        }
+        bit += step;
+    }
+    return true;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void CacheFilter::Save( MemoryStream & stream ) const
+{
+    ASSERT( IsValid() );
+
+    FilterHeader header;
+    header.m_Magic = kFilterMagic;
+    header.m_NumHashes = m_NumHashes;
+    header.m_CreationTime = m_CreationTime;
+    header.m_NumEntries = m_NumEntries;
+    header.m_NumWords = m_NumWords;
+    stream.WriteBuffer( &header, sizeof( header ) );
+    stream.WriteBuffer( m_Words, m_NumWords * sizeof( uint64_t ) );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool CacheFilter::Load( const void * data, size_t dataSize )
+{
+    FilterHeader header;
+    if ( dataSize < sizeof( header ) )
+    {
+        return false;
+    }
+    memcpy( &header, data, sizeof( header ) );
+    if ( ( header.m_Magic != kFilterMagic ) ||
+         ( header.m_NumHashes == 0 ) ||
+         ( header.m_NumHashes > 32 ) ||
+         ( header.m_NumWords == 0 ) ||
+         ( ( dataSize - sizeof( header ) ) != ( header.m_NumWords * sizeof( uint64_t ) ) ) )
+    {
+        return false; // Corrupt, or written by an incompatible version
+    }
+
+    FREE( m_Words );
+    m_CreationTime = header.m_CreationTime;
+    m_NumEntries = header.m_NumEntries;
+    m_NumWords = header.m_NumWords;
+    m_NumHashes = header.m_NumHashes;
+    m_Words = (uint64_t *)ALLOC( (size_t)m_NumWords * sizeof( uint64_t ) );
+    memcpy( m_Words, (const char *)data + sizeof( header ), (size_t)m_NumWords * sizeof( uint64_t ) );
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,51 @@
+// CacheFilter - Probabilistic membership of cache entries
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+#include "Core/Process/Atomic.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+class MemoryStream;
+
+// CacheFilter
+//------------------------------------------------------------------------------
+// A bloom filter of the cache ids in a cache when it was created. Ids not in the
+// filter were not in the cache at that time, so lookups for them can be skipped
+// (entries published since then are missed, unless added to the filter). Ids in
+// the filter are in the cache, with a false positive rate of around 1%.
+//
+// Ids can be added while other threads query the filter.
+class CacheFilter
+{
+public:
+    explicit CacheFilter();
+    ~CacheFilter();
+
+    void Init( uint64_t numEntries, uint64_t creationTime );
+    void Add( const AString & cacheId );
+    bool MayContain( const AString & cacheId ) const;
+
+    void Save( MemoryStream & stream ) const;
+    bool Load( const void * data, size_t dataSize );
+
+    inline bool     IsValid() const         { return ( m_NumWords > 0 ); }
+    inline uint64_t GetCreationTime() const { return m_CreationTime; }
+    inline uint64_t GetNumEntries() const   { return AtomicLoadRelaxed( &m_NumEntries ); }
+
+private:
+    CacheFilter( const CacheFilter & ) = delete;
+    CacheFilter & operator = ( const CacheFilter & ) = delete;
+
+    uint64_t    m_CreationTime  = 0;
+    volatile uint64_t   m_NumEntries    = 0;
+    uint64_t            m_NumWords      = 0;
+    uint32_t            m_NumHashes     = 0;
+    uint64_t *          m_Words         = nullptr;
+};
+
+//------------------------------------------------------------------------------
@@ -9,6 +9,7 @@
 #include "Tools/FBuild/FBuildCore/FLog.h"
 
 // Core
+#include "Core/Containers/Array.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/Mem/Mem.h"
 #include "Core/Tracing/Tracing.h"
@@ -30,6 +31,9 @@
     , m_PublishFunc( nullptr )
     , m_RetrieveFunc( nullptr )
     , m_FreeMemoryFunc( nullptr )
+    , m_RetrieveBatchFunc( nullptr )
+    , m_PublishBatchFunc( nullptr )
+    , m_ExistsBatchFunc( nullptr )
 {
     #if defined( __WINDOWS__ )
         m_DLL = ::LoadLibrary( dllName.Get() );
@@ -58,6 +62,9 @@
     m_FreeMemoryFunc= (CacheFreeMemoryFunc) GetFunction( "CacheFreeMemory", "?CacheFreeMemory@@YAXPEAX_K@Z" );
     m_OutputInfoFunc= (CacheOutputInfoFunc) GetFunction( "CacheOutputInfo", "?CacheOutputInfo@@YA_N_N@Z", true ); // Optional
     m_TrimFunc      = (CacheTrimFunc)       GetFunction( "CacheTrim",       "?CacheTrim@@YA_N_NI@Z", true ); // Optional
+    m_RetrieveBatchFunc = (CacheRetrieveBatchFunc)  GetFunction( "CacheRetrieveBatch",  nullptr, true ); // Optional
+    m_PublishBatchFunc  = (CachePublishBatchFunc)   GetFunction( "CachePublishBatch",   nullptr, true ); // Optional
+    m_ExistsBatchFunc   = (CacheExistsBatchFunc)    GetFunction( "CacheExistsBatch",    nullptr, true ); // Optional
 }
 
 // DESTRUCTOR
@@ -251,4 +258,100 @@ void * CachePlugin::GetFunction( const char * name, const char * mangledName, bo
     return false;
 }
 
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::RetrieveBatch( CacheBatchItem * items, size_t numItems )
+{
+    if ( ( m_Valid == false ) || ( m_RetrieveBatchFunc == nullptr ) )
+    {
+        ICache::RetrieveBatch( items, numItems ); // RetrieveBatch is optional
+        return;
+    }
+
+    Array< const char * > cacheIds( numItems, false );
+    Array< void * > data( numItems, false );
+    Array< unsigned long long > dataSizes( numItems, false );
+    Array< bool > results( numItems, false );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        cacheIds.Append( items[ i ].m_CacheId->Get() );
+        data.Append( nullptr );
+        dataSizes.Append( 0 );
+        results.Append( false );
+    }
+
+    (*m_RetrieveBatchFunc)( (unsigned int)numItems, cacheIds.Begin(), data.Begin(), dataSizes.Begin(), results.Begin() );
+
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        items[ i ].m_Result = results[ i ];
+        items[ i ].m_Data = results[ i ] ? data[ i ] : nullptr;
+        items[ i ].m_DataSize = results[ i ] ? (size_t)dataSizes[ i ] : 0;
+    }
+}
+
+// PublishBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::PublishBatch( CacheBatchItem * items, size_t numItems )
+{
+    if ( ( m_Valid == false ) || ( m_PublishBatchFunc == nullptr ) )
+    {
+        ICache::PublishBatch( items, numItems ); // PublishBatch is optional
+        return;
+    }
+
+    Array< const char * > cacheIds( numItems, false );
+    Array< const void * > data( numItems, false );
+    Array< unsigned long long > dataSizes( numItems, false );
+    Array< bool > results( numItems, false );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        cacheIds.Append( items[ i ].m_CacheId->Get() );
+        data.Append( items[ i ].m_PublishData );
+        dataSizes.Append( items[ i ].m_PublishDataSize );
+        results.Append( false );
+    }
+
+    (*m_PublishBatchFunc)( (unsigned int)numItems, cacheIds.Begin(), data.Begin(), dataSizes.Begin(), results.Begin() );
+
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        items[ i ].m_Result = results[ i ];
+    }
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void CachePlugin::ExistsBatch( CacheBatchItem * items, size_t numItems )
+{
+    if ( ( m_Valid == false ) || ( m_ExistsBatchFunc == nullptr ) )
+    {
+        ICache::ExistsBatch( items, numItems ); // ExistsBatch is optional
+        return;
+    }
+
+    Array< const char * > cacheIds( numItems, false );
+    Array< bool > results( numItems, false );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        cacheIds.Append( items[ i ].m_CacheId->Get() );
+        results.Append( false );
+    }
+
+    (*m_ExistsBatchFunc)( (unsigned int)numItems, cacheIds.Begin(), results.Begin() );
+
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        items[ i ].m_Result = results[ i ];
+    }
+}
+
+// SupportsExists
+//------------------------------------------------------------------------------
+/*virtual*/ bool CachePlugin::SupportsExists() const
+{
+    // Without CacheExistsBatch, entries are retrieved to check them
+    return ( m_Valid && ( m_ExistsBatchFunc != nullptr ) );
+}
+
 //------------------------------------------------------------------------------
@@ -31,6 +31,10 @@ public:
     virtual void FreeMemory( void * data, size_t dataSize ) override;
     virtual bool OutputInfo( bool showProgress ) override;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void RetrieveBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual void PublishBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual void ExistsBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual bool SupportsExists() const override;
 private:
     void * GetFunction( const char * friendlyName, const char * mangledName = nullptr, bool optional = false );
 
@@ -46,6 +50,9 @@ private:
     CacheFreeMemoryFunc m_FreeMemoryFunc;
     CacheOutputInfoFunc m_OutputInfoFunc;
     CacheTrimFunc       m_TrimFunc;
+    CacheRetrieveBatchFunc  m_RetrieveBatchFunc;
+    CachePublishBatchFunc   m_PublishBatchFunc;
+    CacheExistsBatchFunc    m_ExistsBatchFunc;
 };
 
 //------------------------------------------------------------------------------
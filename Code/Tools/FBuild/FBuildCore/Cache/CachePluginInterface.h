@@ -93,6 +93,50 @@ using CacheOutputInfoFunc = bool (STDCALL *)( bool showProgress );
 //     sizeMiB      - desired size in MiB
 using CacheTrimFunc = bool (STDCALL *)( bool showProgress, unsigned int sizeMiB );
 
+// CacheRetrieveBatch (Optional)
+//------------------------------------------------------------------------------
+// Retrieve several previously stored items at once (for example, with a single
+// request to a server). If not provided, CacheRetrieve is called for each item.
+//
+// In:  count     - number of items
+//      cacheIds  - string names of cache entries
+// Out: data      - for each item, on success, retrieved data (freed with CacheFreeMemory)
+//      dataSizes - for each item, on success, size in bytes of retrieved data
+//      results   - for each item, true if retrieved
+using CacheRetrieveBatchFunc = void (STDCALL *)( unsigned int count,
+                                                 const char * const * cacheIds,
+                                                 void ** data,
+                                                 unsigned long long * dataSizes,
+                                                 bool * results );
+
+// CachePublishBatch (Optional)
+//------------------------------------------------------------------------------
+// Store several items to the cache at once. If not provided, CachePublish is
+// called for each item.
+//
+// In:  count     - number of items
+//      cacheIds  - string names of cache entries
+//      data      - for each item, data to store to cache
+//      dataSizes - for each item, size in bytes of data to store
+// Out: results   - for each item, true if stored
+using CachePublishBatchFunc = void (STDCALL *)( unsigned int count,
+                                                const char * const * cacheIds,
+                                                const void * const * data,
+                                                const unsigned long long * dataSizes,
+                                                bool * results );
+
+// CacheExistsBatch (Optional)
+//------------------------------------------------------------------------------
+// Check if several items are in the cache, without retrieving them. If not
+// provided, items are retrieved (and freed) to check.
+//
+// In:  count     - number of items
+//      cacheIds  - string names of cache entries
+// Out: results   - for each item, true if in the cache
+using CacheExistsBatchFunc = void (STDCALL *)( unsigned int count,
+                                               const char * const * cacheIds,
+                                               bool * results );
+
 } //extern "C"
 
 //------------------------------------------------------------------------------
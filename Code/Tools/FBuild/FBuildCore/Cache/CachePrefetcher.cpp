@@ -0,0 +1,367 @@
+// CachePrefetcher - Retrieve likely cache hits before jobs are executed
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePrefetcher.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Prefetching stops if more than this is waiting to be used
+    constexpr uint64_t kMaxBytesHeld = ( 512 * MEGABYTE );
+
+    // Most requests retrieved by a thread in a single call to the cache
+    constexpr size_t kMaxBatchSize = 32;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePrefetcher::CachePrefetcher( ICache * cache, uint32_t numThreads )
+    : m_Cache( cache )
+    , m_Pending( 1024, true )
+    , m_Threads( numThreads, false )
+{
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        Thread * thread = FNEW( Thread );
+        thread->Start( ThreadFuncStatic, "CachePrefetcher", this, MEGABYTE );
+        m_Threads.Append( thread );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePrefetcher::~CachePrefetcher()
+{
+    m_Exit = true;
+    m_WorkAvailable.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread * thread : m_Threads )
+    {
+        thread->Join();
+        FDELETE thread;
+    }
+
+    Clear();
+}
+
+// Prefetch
+//------------------------------------------------------------------------------
+void CachePrefetcher::Prefetch( ObjectNode * node, const AString & cacheId )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        if ( FindRequest( node ) )
+        {
+            return; // Already requested
+        }
+
+        Request * request = FNEW( Request );
+        request->m_Node = node;
+        request->m_CacheId = cacheId;
+        request->m_State = PENDING;
+        request->m_Abandoned = false;
+        request->m_Hit = false;
+        request->m_Data = nullptr;
+        request->m_DataSize = 0;
+        request->m_WorkerWaiting = false;
+        request->m_Prev = nullptr;
+        request->m_Next = m_FirstRequest;
+        if ( m_FirstRequest )
+        {
+            m_FirstRequest->m_Prev = request;
+        }
+        m_FirstRequest = request;
+        m_Requests.Insert( node, request );
+        m_Pending.Append( request );
+        ++m_NumPending;
+    }
+    m_WorkAvailable.Signal();
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+bool CachePrefetcher::Retrieve( const ObjectNode * node, const AString & cacheId, void * & outData, size_t & outDataSize )
+{
+    Request * request = nullptr;
+    {
+        MutexHolder mh( m_Mutex );
+        request = FindRequest( node );
+        if ( request && ( ( request->m_CacheId != cacheId ) || ( request->m_State == PENDING ) ) )
+        {
+            // Mispredicted, or not started (so no benefit in waiting for it)
+            RemoveRequest( request );
+            request = nullptr;
+        }
+        else if ( request && ( request->m_State == IN_PROGRESS ) )
+        {
+            request->m_WorkerWaiting = true;
+        }
+    }
+
+    if ( request == nullptr )
+    {
+        return m_Cache->Retrieve( cacheId, outData, outDataSize );
+    }
+
+    // Wait for retrieval in progress to complete
+    if ( request->m_WorkerWaiting )
+    {
+        PROFILE_SECTION( "WaitForPrefetch" );
+        request->m_Done.Wait();
+    }
+
+    // Take the result
+    {
+        MutexHolder mh( m_Mutex );
+        ASSERT( request->m_State == DONE );
+        ASSERT( FindRequest( node ) == request );
+        UnlinkRequest( request );
+        m_BytesHeld -= request->m_DataSize;
+    }
+    const bool hit = request->m_Hit;
+    outData = request->m_Data;
+    outDataSize = request->m_DataSize;
+    FDELETE request;
+
+    AtomicInc( &m_NumPrefetchesUsed );
+    return hit;
+}
+
+// Discard
+//------------------------------------------------------------------------------
+void CachePrefetcher::Discard( const ObjectNode * node )
+{
+    MutexHolder mh( m_Mutex );
+    Request * request = FindRequest( node );
+    if ( request )
+    {
+        RemoveRequest( request );
+    }
+}
+
+// Clear
+//------------------------------------------------------------------------------
+void CachePrefetcher::Clear()
+{
+    MutexHolder mh( m_Mutex );
+
+    // Requests not yet started (including those already removed)
+    for ( size_t i = m_PendingHead; i < m_Pending.GetSize(); ++i )
+    {
+        FreeRequest( m_Pending[ i ] );
+    }
+    m_Pending.Clear();
+    m_PendingHead = 0;
+    m_NumPending = 0;
+
+    // Requests in progress or done
+    Request * request = m_FirstRequest;
+    while ( request )
+    {
+        Request * next = request->m_Next;
+        if ( request->m_State == IN_PROGRESS )
+        {
+            request->m_Abandoned = true;
+        }
+        else if ( request->m_State == DONE )
+        {
+            FreeRequest( request );
+        }
+        request = next;
+    }
+    m_FirstRequest = nullptr;
+    m_Requests.Destruct();
+    m_BytesHeld = 0;
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePrefetcher::ThreadFuncStatic( void * param )
+{
+    static_cast< CachePrefetcher * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePrefetcher::ThreadFunc()
+{
+    PROFILE_SET_THREAD_NAME( "CachePrefetcher" );
+
+    for ( ;; )
+    {
+        m_WorkAvailable.Wait();
+        if ( m_Exit )
+        {
+            break;
+        }
+
+        // Take the oldest pending requests, sharing them out between threads
+        // so a batch doesn't serialize retrievals other threads could make
+        StackArray< Request *, kMaxBatchSize > requests;
+        {
+            MutexHolder mh( m_Mutex );
+            const size_t numThreads = m_Threads.GetSize();
+            const size_t batchSize = Math::Min< size_t >( ( m_NumPending + numThreads - 1 ) / numThreads, kMaxBatchSize );
+            while ( requests.GetSize() < batchSize )
+            {
+                Request * request = PopPending();
+                if ( request == nullptr )
+                {
+                    break;
+                }
+                if ( m_BytesHeld > kMaxBytesHeld )
+                {
+                    // Too much unused data - retrieved by worker instead
+                    UnlinkRequest( request );
+                    FreeRequest( request );
+                    break;
+                }
+                request->m_State = IN_PROGRESS;
+                requests.Append( request );
+            }
+        }
+        if ( requests.IsEmpty() )
+        {
+            continue;
+        }
+
+        // Retrieve all together (a single round trip for remote caches)
+        // NOTE: Cache ids are safe to read without the lock while IN_PROGRESS
+        StackArray< CacheBatchItem, kMaxBatchSize > items;
+        for ( const Request * request : requests )
+        {
+            CacheBatchItem item;
+            item.m_CacheId = &request->m_CacheId;
+            items.Append( item );
+        }
+        m_Cache->RetrieveBatch( items.Begin(), items.GetSize() );
+
+        MutexHolder mh( m_Mutex );
+        for ( size_t i = 0; i < requests.GetSize(); ++i )
+        {
+            Request * request = requests[ i ];
+            const CacheBatchItem & item = items[ i ];
+            if ( request->m_Abandoned )
+            {
+                if ( item.m_Result )
+                {
+                    m_Cache->FreeMemory( item.m_Data, item.m_DataSize );
+                }
+                FDELETE request;
+                continue;
+            }
+            request->m_State = DONE;
+            request->m_Hit = item.m_Result;
+            request->m_Data = item.m_Result ? item.m_Data : nullptr;
+            request->m_DataSize = item.m_Result ? item.m_DataSize : 0;
+            m_BytesHeld += request->m_DataSize;
+            if ( request->m_WorkerWaiting )
+            {
+                request->m_Done.Signal();
+            }
+        }
+    }
+}
+
+// FindRequest
+//------------------------------------------------------------------------------
+CachePrefetcher::Request * CachePrefetcher::FindRequest( const ObjectNode * node ) const
+{
+    const UnorderedMap< const ObjectNode *, Request * >::KeyValue * keyValue = m_Requests.Find( node );
+    return keyValue ? keyValue->m_Value : nullptr;
+}
+
+// UnlinkRequest
+//------------------------------------------------------------------------------
+void CachePrefetcher::UnlinkRequest( Request * request )
+{
+    VERIFY( m_Requests.Erase( request->m_Node ) );
+    if ( request->m_Prev )
+    {
+        request->m_Prev->m_Next = request->m_Next;
+    }
+    else
+    {
+        ASSERT( m_FirstRequest == request );
+        m_FirstRequest = request->m_Next;
+    }
+    if ( request->m_Next )
+    {
+        request->m_Next->m_Prev = request->m_Prev;
+    }
+    request->m_Prev = nullptr;
+    request->m_Next = nullptr;
+}
+
+// RemoveRequest
+//------------------------------------------------------------------------------
+void CachePrefetcher::RemoveRequest( Request * request )
+{
+    UnlinkRequest( request );
+    if ( request->m_State == PENDING )
+    {
+        // Still in the pending queue, freed when dequeued
+        request->m_Abandoned = true;
+        --m_NumPending;
+    }
+    else if ( request->m_State == IN_PROGRESS )
+    {
+        // Freed by the I/O thread when complete
+        request->m_Abandoned = true;
+    }
+    else
+    {
+        m_BytesHeld -= request->m_DataSize;
+        FreeRequest( request );
+    }
+}
+
+// PopPending
+//------------------------------------------------------------------------------
+CachePrefetcher::Request * CachePrefetcher::PopPending()
+{
+    while ( m_PendingHead < m_Pending.GetSize() )
+    {
+        Request * request = m_Pending[ m_PendingHead++ ];
+        if ( m_PendingHead == m_Pending.GetSize() )
+        {
+            // Queue drained - reuse the storage
+            m_Pending.Clear();
+            m_PendingHead = 0;
+        }
+        if ( request->m_Abandoned )
+        {
+            FreeRequest( request );
+            continue;
+        }
+        --m_NumPending;
+        return request;
+    }
+    return nullptr;
+}
+
+// FreeRequest
+//------------------------------------------------------------------------------
+void CachePrefetcher::FreeRequest( Request * request ) const
+{
+    ASSERT( request->m_State != IN_PROGRESS );
+    if ( request->m_Data )
+    {
+        m_Cache->FreeMemory( request->m_Data, request->m_DataSize );
+    }
+    FDELETE request;
+}
+
+//------------------------------------------------------------------------------
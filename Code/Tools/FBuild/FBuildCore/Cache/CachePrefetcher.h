@@ -0,0 +1,93 @@
+// CachePrefetcher - Retrieve likely cache hits before jobs are executed
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ICache;
+class ObjectNode;
+
+// CachePrefetcher
+//------------------------------------------------------------------------------
+// The cache key of an object depends on its preprocessed source, so is only
+// known once a worker has preprocessed it. However, the key is usually the same
+// as the one used the last time the object was built (clean builds, builds of
+// other branches etc.), so as soon as jobs become available, that entry is
+// retrieved by a pool of I/O threads (sized independently of the workers).
+// When the worker determines the real key, it uses the prefetched data if the
+// keys match, or retrieves from the cache as normal otherwise.
+class CachePrefetcher
+{
+public:
+    explicit CachePrefetcher( ICache * cache, uint32_t numThreads );
+    ~CachePrefetcher();
+
+    // Main thread, as jobs become available
+    void Prefetch( ObjectNode * node, const AString & cacheId );
+
+    // Worker threads: retrieve via the prefetched data if possible
+    bool Retrieve( const ObjectNode * node, const AString & cacheId, void * & outData, size_t & outDataSize );
+
+    // Worker threads: the node will not be retrieved (the prefetch is discarded)
+    void Discard( const ObjectNode * node );
+
+    // Main thread, at the end of the build: discard anything not used
+    void Clear();
+
+    uint32_t GetNumPrefetchesUsed() const { return m_NumPrefetchesUsed; }
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    enum State : uint8_t
+    {
+        PENDING,
+        IN_PROGRESS,
+        DONE,
+    };
+    struct Request
+    {
+        const ObjectNode *  m_Node;
+        AString             m_CacheId;
+        State               m_State;
+        bool                m_Abandoned;        // Freed by the I/O thread when dequeued or complete
+        bool                m_Hit;
+        void *              m_Data;
+        size_t              m_DataSize;
+        Semaphore           m_Done;             // Signalled if a worker is waiting
+        bool                m_WorkerWaiting;
+        Request *           m_Prev;             // In m_FirstRequest list
+        Request *           m_Next;
+    };
+    Request * FindRequest( const ObjectNode * node ) const;
+    void UnlinkRequest( Request * request );
+    void RemoveRequest( Request * request );
+    Request * PopPending();
+    void FreeRequest( Request * request ) const;
+
+    ICache *                m_Cache;
+    Mutex                   m_Mutex;
+    Semaphore               m_WorkAvailable;
+    UnorderedMap< const ObjectNode *, Request * > m_Requests; // Pending, in progress or done (not yet used)
+    Request *               m_FirstRequest = nullptr; // All requests in m_Requests
+    Array< Request * >      m_Pending;          // FIFO, from m_PendingHead (removed requests are abandoned in place)
+    size_t                  m_PendingHead = 0;
+    size_t                  m_NumPending = 0;   // Not abandoned
+    uint64_t                m_BytesHeld = 0;    // Completed but not yet used
+    uint32_t                m_NumPrefetchesUsed = 0;
+    volatile bool           m_Exit = false;
+    Array< Thread * >       m_Threads;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,250 @@
+// CacheProtocol - Network protocol between NetworkCache and FBuildCacheServer
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheProtocol.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/TCPConnectionPool.h"
+
+// system
+#include <memory.h>
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheProtocol::Channel::Channel( TCPConnectionPool & pool, const ConnectionInfo * connection )
+    : m_Pool( pool )
+    , m_Connection( connection )
+{
+    memset( &m_FrameHeader, 0, sizeof( m_FrameHeader ) );
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheProtocol::Channel::~Channel()
+{
+    ASSERT( m_RefCount == 0 );
+    for ( IncomingMessage * incoming : m_Incoming )
+    {
+        FREE( incoming->m_Data );
+        FDELETE incoming;
+    }
+}
+
+// AddRef
+//------------------------------------------------------------------------------
+bool CacheProtocol::Channel::AddRef()
+{
+    MutexHolder mh( m_RefMutex );
+    if ( m_Closed )
+    {
+        return false;
+    }
+    ++m_RefCount;
+    return true;
+}
+
+// Release
+//------------------------------------------------------------------------------
+bool CacheProtocol::Channel::Release()
+{
+    MutexHolder mh( m_RefMutex );
+    ASSERT( m_RefCount > 0 );
+    --m_RefCount;
+    return ( ( m_RefCount == 0 ) && m_Closed );
+}
+
+// Send
+//------------------------------------------------------------------------------
+bool CacheProtocol::Channel::Send( MessageType msgType,
+                                   uint8_t flags,
+                                   uint32_t requestId,
+                                   const AString & cacheId,
+                                   const void * data,
+                                   size_t dataSize )
+{
+    ASSERT( m_Connection );
+    ASSERT( cacheId.GetLength() <= kMaxCacheIdLength );
+
+    struct
+    {
+        FrameHeader m_Header;
+        char        m_CacheId[ kMaxCacheIdLength ];
+    } frame;
+    frame.m_Header.m_MsgType = msgType;
+    frame.m_Header.m_Flags = flags;
+    frame.m_Header.m_RequestId = requestId;
+    frame.m_Header.m_BodySize = dataSize;
+    frame.m_Header.m_Padding = 0;
+    memcpy( frame.m_CacheId, cacheId.Get(), cacheId.GetLength() );
+
+    // Other messages can be sent between the frames of a large body
+    const char * pos = static_cast< const char * >( data );
+    size_t remaining = dataSize;
+    bool firstFrame = true;
+    do
+    {
+        const uint32_t frameSize = (uint32_t)Math::Min< size_t >( remaining, kMaxFrameSize );
+        frame.m_Header.m_IdLength = firstFrame ? (uint16_t)cacheId.GetLength() : 0;
+        frame.m_Header.m_FrameSize = frameSize;
+        const size_t headerSize = ( sizeof( FrameHeader ) + frame.m_Header.m_IdLength );
+
+        // The connection is only valid until closed
+        MutexHolder mh( m_SendMutex );
+        if ( IsClosed() )
+        {
+            return false;
+        }
+        const bool sent = ( frameSize > 0 ) ? m_Pool.Send( m_Connection, &frame, headerSize, pos, frameSize )
+                                            : m_Pool.Send( m_Connection, &frame, headerSize );
+        if ( sent == false )
+        {
+            return false;
+        }
+
+        pos += frameSize;
+        remaining -= frameSize;
+        firstFrame = false;
+    }
+    while ( remaining > 0 );
+
+    return true;
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+CacheProtocol::Channel::ReceiveResult CacheProtocol::Channel::OnReceive( void * data,
+                                                                          uint32_t size,
+                                                                          bool & keepMemory,
+                                                                          Message & outMessage )
+{
+    keepMemory = false;
+
+    // are we expecting a header, or the body for a frame?
+    void * frameBody = nullptr;
+    uint32_t frameSize = 0;
+    if ( m_ExpectingFrameBody == false )
+    {
+        if ( size < sizeof( FrameHeader ) )
+        {
+            return RECEIVE_INVALID;
+        }
+        memcpy( &m_FrameHeader, data, sizeof( FrameHeader ) );
+        if ( ( size != ( sizeof( FrameHeader ) + m_FrameHeader.m_IdLength ) ) ||
+             ( m_FrameHeader.m_FrameSize > kMaxFrameSize ) ||
+             ( m_FrameHeader.m_BodySize > kMaxBodySize ) ||
+             ( m_FrameHeader.m_FrameSize > m_FrameHeader.m_BodySize ) )
+        {
+            return RECEIVE_INVALID;
+        }
+        const char * cacheId = ( static_cast< const char * >( data ) + sizeof( FrameHeader ) );
+        m_FrameCacheId.Assign( cacheId, cacheId + m_FrameHeader.m_IdLength );
+        if ( m_FrameHeader.m_FrameSize > 0 )
+        {
+            m_ExpectingFrameBody = true;
+            return RECEIVE_INCOMPLETE;
+        }
+    }
+    else
+    {
+        if ( size != m_FrameHeader.m_FrameSize )
+        {
+            return RECEIVE_INVALID;
+        }
+        m_ExpectingFrameBody = false;
+        frameBody = data;
+        frameSize = size;
+    }
+    const FrameHeader & header = m_FrameHeader;
+
+    // Find the message this frame continues
+    IncomingMessage ** iter = m_Incoming.Begin();
+    for ( ; iter != m_Incoming.End(); ++iter )
+    {
+        if ( ( *iter )->m_Header.m_RequestId == header.m_RequestId )
+        {
+            break;
+        }
+    }
+    if ( iter == m_Incoming.End() )
+    {
+        // Entire message in one frame - take ownership of the received memory
+        if ( frameSize == header.m_BodySize )
+        {
+            outMessage.m_MsgType = (MessageType)header.m_MsgType;
+            outMessage.m_Flags = header.m_Flags;
+            outMessage.m_RequestId = header.m_RequestId;
+            outMessage.m_CacheId = m_FrameCacheId;
+            outMessage.m_Data = frameBody;
+            outMessage.m_DataSize = frameSize;
+            keepMemory = ( frameBody != nullptr );
+            return RECEIVE_COMPLETE;
+        }
+
+        // Bodies are allocated up front, so limit what a connection can reserve
+        if ( ( m_IncomingBytes + header.m_BodySize ) > kMaxIncomingBytes )
+        {
+            return RECEIVE_INVALID;
+        }
+        m_IncomingBytes += header.m_BodySize;
+
+        IncomingMessage * newIncoming = FNEW( IncomingMessage );
+        newIncoming->m_Header = header;
+        newIncoming->m_CacheId = m_FrameCacheId;
+        newIncoming->m_Data = static_cast< char * >( ALLOC( (size_t)header.m_BodySize ) );
+        newIncoming->m_Received = 0;
+        m_Incoming.Append( newIncoming );
+        iter = ( m_Incoming.End() - 1 );
+    }
+
+    IncomingMessage * incoming = *iter;
+    if ( frameSize > ( incoming->m_Header.m_BodySize - incoming->m_Received ) )
+    {
+        return RECEIVE_INVALID;
+    }
+    memcpy( incoming->m_Data + incoming->m_Received, frameBody, frameSize );
+    incoming->m_Received += frameSize;
+    if ( incoming->m_Received < incoming->m_Header.m_BodySize )
+    {
+        return RECEIVE_INCOMPLETE;
+    }
+
+    outMessage.m_MsgType = (MessageType)incoming->m_Header.m_MsgType;
+    outMessage.m_Flags = incoming->m_Header.m_Flags;
+    outMessage.m_RequestId = incoming->m_Header.m_RequestId;
+    outMessage.m_CacheId = incoming->m_CacheId;
+    outMessage.m_Data = incoming->m_Data;
+    outMessage.m_DataSize = (size_t)incoming->m_Received;
+    m_IncomingBytes -= incoming->m_Header.m_BodySize;
+    m_Incoming.Erase( iter );
+    FDELETE incoming;
+    return RECEIVE_COMPLETE;
+}
+
+// Close
+//------------------------------------------------------------------------------
+void CacheProtocol::Channel::Close()
+{
+    {
+        MutexHolder mh( m_RefMutex );
+        m_Closed = true;
+    }
+
+    // Wait for a send in progress, which is abandoned quickly as the connection
+    // is being destroyed
+    MutexHolder mh( m_SendMutex );
+}
+
+// IsClosed
+//------------------------------------------------------------------------------
+bool CacheProtocol::Channel::IsClosed() const
+{
+    MutexHolder mh( m_RefMutex );
+    return m_Closed;
+}
+
+//------------------------------------------------------------------------------
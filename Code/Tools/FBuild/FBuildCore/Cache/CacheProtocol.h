@@ -0,0 +1,135 @@
+// CacheProtocol - Network protocol between NetworkCache and FBuildCacheServer
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ConnectionInfo;
+class TCPConnectionPool;
+
+// CacheProtocol
+//------------------------------------------------------------------------------
+// Requests and responses are messages, made of one or more frames. Each frame is
+// a FrameHeader (followed by the cache id in the first frame of a request) and
+// then, as a separate message on the connection, part of the message body.
+//
+// Connections are kept alive for the whole build and carry many requests at once:
+// each message has a request id so responses can be returned in any order, and
+// bodies are split into frames so a large entry doesn't hold up small ones.
+namespace CacheProtocol
+{
+    enum : uint16_t { CACHE_SERVER_PORT = Protocol::PROTOCOL_PORT + 64 };
+    enum : uint16_t { CACHE_SERVER_TEST_PORT = CACHE_SERVER_PORT + 1 }; // Different port for use by tests
+
+    enum : uint32_t { CACHE_PROTOCOL_VERSION = 2 };
+
+    // Identifiers for all unique messages
+    //--------------------------------------------------------------------------
+    enum MessageType : uint8_t
+    {
+        MSG_HELLO               = 1, // Client <-> Server : Version handshake (body: protocol version)
+        MSG_RETRIEVE            = 2, // Client -> Server : Request an entry
+        MSG_RETRIEVE_RESULT     = 3, // Client <- Server : Entry data (if FLAG_SUCCESS)
+        MSG_PUBLISH             = 4, // Client -> Server : Store an entry (body: data)
+        MSG_PUBLISH_RESULT      = 5, // Client <- Server : Entry stored (if FLAG_SUCCESS)
+        MSG_EXISTS              = 6, // Client -> Server : Query an entry without transferring it
+        MSG_EXISTS_RESULT       = 7, // Client <- Server : Entry exists (if FLAG_SUCCESS)
+    };
+
+    enum : uint8_t { FLAG_SUCCESS = 0x01 };
+
+    enum : uint32_t { kMaxFrameSize = ( 4 * 1024 * 1024 ) };
+    enum : uint32_t { kMaxCacheIdLength = 1024 };
+    enum : uint32_t { kMaxBodySize = ( 1024 * 1024 * 1024 ) };             // Largest entry
+    enum : uint32_t { kMaxIncomingBytes = ( 2u * 1024 * 1024 * 1024 ) };   // Partially received, per connection
+
+    // FrameHeader
+    //--------------------------------------------------------------------------
+    struct FrameHeader
+    {
+        uint8_t     m_MsgType;
+        uint8_t     m_Flags;
+        uint16_t    m_IdLength;     // Cache id following this header (first frame only)
+        uint32_t    m_RequestId;    // Matches responses to requests
+        uint64_t    m_BodySize;     // Total over all frames
+        uint32_t    m_FrameSize;    // Part of body sent after this header
+        uint32_t    m_Padding;
+    };
+    static_assert( sizeof( FrameHeader ) == 24, "FrameHeader has incorrect size" );
+
+    // Message - a complete, received message
+    //--------------------------------------------------------------------------
+    struct Message
+    {
+        MessageType m_MsgType;
+        uint8_t     m_Flags;
+        uint32_t    m_RequestId;
+        AString     m_CacheId;
+        void *      m_Data;         // Owned by the receiver of the message (use FREE)
+        size_t      m_DataSize;
+    };
+
+    // Channel - the state of one connection, used by both ends
+    //--------------------------------------------------------------------------
+    class Channel
+    {
+    public:
+        explicit Channel( TCPConnectionPool & pool, const ConnectionInfo * connection = nullptr );
+        ~Channel();
+
+        void SetConnection( const ConnectionInfo * connection ) { m_Connection = connection; }
+
+        // Sent to from any thread while references are held. Starts with one
+        // reference (held by the creator), and is deleted by whoever releases
+        // the last reference once closed.
+        bool AddRef();                      // Fails once closed
+        bool Release();                     // True if the caller must now delete the channel
+        bool Send( MessageType msgType, uint8_t flags, uint32_t requestId,
+                   const AString & cacheId, const void * data, size_t dataSize );
+
+        // Connection thread only
+        enum ReceiveResult : uint8_t
+        {
+            RECEIVE_INCOMPLETE,
+            RECEIVE_COMPLETE,
+            RECEIVE_INVALID,
+        };
+        ReceiveResult OnReceive( void * data, uint32_t size, bool & keepMemory, Message & outMessage );
+        void Close();                       // When disconnected - stops any further sends
+        bool IsClosed() const;
+
+    private:
+        // A message for which not all frames have been received
+        struct IncomingMessage
+        {
+            FrameHeader     m_Header;
+            AString         m_CacheId;
+            char *          m_Data;
+            uint64_t        m_Received;
+        };
+
+        TCPConnectionPool &         m_Pool;
+        const ConnectionInfo *      m_Connection;
+        Mutex                       m_SendMutex;
+        mutable Mutex               m_RefMutex;
+        uint32_t                    m_RefCount = 1;
+        bool                        m_Closed = false;
+
+        bool                        m_ExpectingFrameBody = false;
+        FrameHeader                 m_FrameHeader;
+        AString                     m_FrameCacheId;
+        Array< IncomingMessage * >  m_Incoming;
+        uint64_t                    m_IncomingBytes = 0;
+    };
+};
+
+//------------------------------------------------------------------------------
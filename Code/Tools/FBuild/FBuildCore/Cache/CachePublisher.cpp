@@ -0,0 +1,279 @@
+// CachePublisher - Compress and publish cache entries in the background
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CachePublisher.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+#include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
+
+// Core
+#include "Core/Math/Conversions.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Time/Timer.h"
+
+// system
+#include <string.h> // for memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Most entries published in a single call to the cache
+    constexpr size_t kMaxBatchSize = 32;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CachePublisher::CachePublisher( uint64_t maxQueuedBytes )
+    : m_Queue( 1024, true )
+    , m_MaxQueuedBytes( maxQueuedBytes )
+    , m_Stores( 1024, true )
+{
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Start( ThreadFuncStatic, "CachePublisher", this, MEGABYTE );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CachePublisher::~CachePublisher()
+{
+    m_Exit = true;
+    m_WorkAvailable.Signal( kNumThreads );
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Join();
+    }
+
+    // Anything not flushed is abandoned
+    for ( Entry * entry : m_Queue )
+    {
+        FREE( entry->m_Data );
+        FDELETE entry;
+    }
+}
+
+// Queue
+//------------------------------------------------------------------------------
+bool CachePublisher::Queue( ObjectNode * node, const AString & cacheId, const void * data, uint64_t dataSize, bool isCompressed )
+{
+    {
+        MutexHolder mh( m_Mutex );
+        if ( ( m_QueuedBytes + dataSize ) > m_MaxQueuedBytes )
+        {
+            return false;
+        }
+        m_QueuedBytes += dataSize;
+    }
+
+    Entry * entry = FNEW( Entry );
+    entry->m_Node = node;
+    entry->m_CacheId = cacheId;
+    entry->m_Data = ALLOC( (size_t)dataSize );
+    memcpy( entry->m_Data, data, (size_t)dataSize );
+    entry->m_DataSize = dataSize;
+    entry->m_IsCompressed = isCompressed;
+
+    {
+        MutexHolder mh( m_Mutex );
+        entry->m_FlushIndex = m_FlushIndex;
+        m_Queue.Append( entry );
+    }
+    m_WorkAvailable.Signal();
+    return true;
+}
+
+// Flush
+//------------------------------------------------------------------------------
+bool CachePublisher::Flush( uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( Thread::IsMainThread() );
+
+    // Wait for the queue to drain
+    const Timer timer;
+    bool timedOut = false;
+    for ( ;; )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_Queue.IsEmpty() && ( m_NumInProgress == 0 ) )
+            {
+                break;
+            }
+            if ( ( timeoutMS > 0 ) && ( timer.GetElapsedMS() >= (float)timeoutMS ) )
+            {
+                // Abandon anything not yet started
+                if ( m_Queue.IsEmpty() == false )
+                {
+                    FLOG_WARN( "Cache publishing timed out - %u entries not published", (uint32_t)m_Queue.GetSize() );
+                }
+                for ( Entry * entry : m_Queue )
+                {
+                    m_QueuedBytes -= entry->m_DataSize;
+                    FREE( entry->m_Data );
+                    FDELETE entry;
+                }
+                m_Queue.Clear();
+                timedOut = true;
+                break;
+            }
+        }
+        Thread::Sleep( 1 );
+    }
+
+    // Record completed stores in the node stats
+    MutexHolder mh( m_Mutex );
+    for ( const Store & store : m_Stores )
+    {
+        store.m_Node->OnPublishedToCache( store.m_CachingTimeMS );
+    }
+    m_Stores.Clear();
+    ++m_FlushIndex; // Any still in progress are reported to no build
+    return ( timedOut == false );
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CachePublisher::ThreadFuncStatic( void * param )
+{
+    static_cast< CachePublisher * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CachePublisher::ThreadFunc()
+{
+    PROFILE_SET_THREAD_NAME( "CachePublisher" );
+
+    Array< Entry * > batch( 64, true );
+    for ( ;; )
+    {
+        m_WorkAvailable.Wait();
+        if ( m_Exit )
+        {
+            break;
+        }
+
+        // Take a share of everything that has been queued
+        {
+            MutexHolder mh( m_Mutex );
+            const size_t numToTake = ( ( m_Queue.GetSize() + kNumThreads - 1 ) / kNumThreads );
+            for ( size_t i = 0; i < numToTake; ++i )
+            {
+                batch.Append( m_Queue.Top() );
+                m_Queue.Pop();
+            }
+            m_NumInProgress += (uint32_t)batch.GetSize();
+        }
+
+        for ( size_t i = 0; i < batch.GetSize(); i += kMaxBatchSize )
+        {
+            const size_t numEntries = Math::Min< size_t >( batch.GetSize() - i, kMaxBatchSize );
+            Publish( &batch[ i ], numEntries );
+
+            MutexHolder mh( m_Mutex );
+            for ( size_t j = 0; j < numEntries; ++j )
+            {
+                Entry * entry = batch[ i + j ];
+                m_QueuedBytes -= entry->m_DataSize;
+                --m_NumInProgress;
+                FREE( entry->m_Data );
+                FDELETE entry;
+            }
+        }
+        batch.Clear();
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+void CachePublisher::Publish( Entry * const * entries, size_t numEntries )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( numEntries <= kMaxBatchSize );
+    ICache * cache = FBuild::Get().GetCache();
+
+    // Compress
+    Compressor * compressors[ kMaxBatchSize ] = {};
+    uint32_t compressionTimes[ kMaxBatchSize ] = {};
+    StackArray< CacheBatchItem, kMaxBatchSize > items;
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        const Entry & entry = *entries[ i ];
+        CacheBatchItem item;
+        item.m_CacheId = &entry.m_CacheId;
+        item.m_PublishData = entry.m_Data;
+        item.m_PublishDataSize = (size_t)entry.m_DataSize;
+        if ( entry.m_IsCompressed == false )
+        {
+            const Timer t;
+            compressors[ i ] = FNEW( Compressor );
+            compressors[ i ]->Compress( entry.m_Data, (size_t)entry.m_DataSize, FBuild::Get().GetOptions().m_CacheCompressionLevel, FBuild::Get().GetCacheDictionary(), true );
+            compressionTimes[ i ] = (uint32_t)t.GetElapsedMS();
+            item.m_PublishData = compressors[ i ]->GetResult();
+            item.m_PublishDataSize = compressors[ i ]->GetResultSize();
+        }
+        items.Append( item );
+    }
+
+    // When not reading from the cache (i.e. populating it), entries built by
+    // other machines already exist, so only upload those which don't. Without
+    // a cheap way to check, uploading is cheaper than downloading to check.
+    StackArray< CacheBatchItem, kMaxBatchSize > publishItems;
+    StackArray< size_t, kMaxBatchSize > publishIndices;
+    if ( ( FBuild::Get().GetOptions().m_UseCacheRead == false ) && cache->SupportsExists() )
+    {
+        cache->ExistsBatch( items.Begin(), items.GetSize() );
+    }
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        if ( items[ i ].m_Result == false )
+        {
+            publishItems.Append( items[ i ] );
+            publishIndices.Append( i );
+        }
+    }
+
+    // Publish
+    const Timer t;
+    if ( publishItems.IsEmpty() == false )
+    {
+        cache->PublishBatch( publishItems.Begin(), publishItems.GetSize() );
+        for ( size_t i = 0; i < publishItems.GetSize(); ++i )
+        {
+            items[ publishIndices[ i ] ].m_Result = publishItems[ i ].m_Result;
+        }
+    }
+    const uint32_t publishTime = (uint32_t)t.GetElapsedMS();
+
+    // Record results (entries which already existed are reported as stores)
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        const Entry & entry = *entries[ i ];
+        const CacheBatchItem & item = items[ i ];
+        uint32_t cachingTime = 0;
+        if ( entry.m_Node->OnPublishToCacheComplete( entry.m_CacheId, item.m_PublishData, item.m_PublishDataSize, compressionTimes[ i ], publishTime, item.m_Result, cachingTime ) )
+        {
+            MutexHolder mh( m_Mutex );
+            if ( entry.m_FlushIndex == m_FlushIndex )
+            {
+                m_Stores.Append( Store{ entry.m_Node, cachingTime } );
+            }
+        }
+        FDELETE compressors[ i ];
+    }
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+// CachePublisher - Compress and publish cache entries in the background
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ObjectNode;
+
+// CachePublisher
+//------------------------------------------------------------------------------
+// Publishing to a network cache can take much longer than compiling, so rather
+// than occupying a worker, results are queued and compressed/published by
+// dedicated threads. Each thread takes a share of all queued entries at once,
+// so bursts of small objects are handled without a wake-up per entry, and
+// passes them to the cache in batches.
+//
+// The queue is bounded; when full, callers publish synchronously as before.
+// At the end of a build the queue is flushed, and stores are recorded in the
+// stats of each node (from the main thread).
+class CachePublisher
+{
+public:
+    // Beyond this, workers publish synchronously rather than use more memory
+    static constexpr uint64_t kDefaultMaxQueuedBytes = ( 256 * MEGABYTE );
+
+    explicit CachePublisher( uint64_t maxQueuedBytes = kDefaultMaxQueuedBytes );
+    ~CachePublisher();
+
+    // Queue a copy of the data to be published. Returns false if the queue is
+    // full, in which case the caller should publish the data itself
+    bool Queue( ObjectNode * node, const AString & cacheId, const void * data, uint64_t dataSize, bool isCompressed );
+
+    // Wait for queued entries to be published (0 = no timeout)
+    // Returns false if entries were abandoned due to the timeout
+    bool Flush( uint32_t timeoutMS );
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    struct Entry
+    {
+        ObjectNode *    m_Node;
+        AString         m_CacheId;
+        void *          m_Data;
+        uint64_t        m_DataSize;
+        bool            m_IsCompressed;
+        uint32_t        m_FlushIndex;
+    };
+    void Publish( Entry * const * entries, size_t numEntries );
+
+    struct Store
+    {
+        ObjectNode *    m_Node;
+        uint32_t        m_CachingTimeMS;
+    };
+
+    enum : uint32_t { kNumThreads = 2 };
+
+    Mutex               m_Mutex;
+    Semaphore           m_WorkAvailable;
+    Array< Entry * >    m_Queue;
+    const uint64_t      m_MaxQueuedBytes;
+    uint64_t            m_QueuedBytes = 0;
+    uint32_t            m_NumInProgress = 0;
+    uint32_t            m_FlushIndex = 0;       // Stores from before a timed-out flush are discarded
+    Array< Store >      m_Stores;               // Recorded on the main thread when flushing
+    volatile bool       m_Exit = false;
+    Thread              m_Threads[ kNumThreads ];
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,289 @@
+// CacheServer - Serves a cache to NetworkCache clients
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheServer.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
+
+// Core
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AString.h"
+
+// system
+#include <memory.h>
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheServer::CacheServer( ICache & cache, uint32_t numThreads )
+    : TCPConnectionPool()
+    , m_Cache( cache )
+    , m_Jobs( 256, true )
+    , m_PausedConnections( 32, true )
+    , m_Threads( numThreads, false )
+{
+    ASSERT( numThreads > 0 );
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        Thread * thread = FNEW( Thread );
+        thread->Start( ThreadFuncStatic, "CacheServer", this, MEGABYTE );
+        m_Threads.Append( thread );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheServer::~CacheServer()
+{
+    // Outstanding requests are completed as connections are closed
+    ShutdownAllConnections();
+
+    m_Exit = true;
+    m_JobsAvailable.Signal( (uint32_t)m_Threads.GetSize() );
+    for ( Thread * thread : m_Threads )
+    {
+        thread->Join();
+        FDELETE thread;
+    }
+    ASSERT( m_Jobs.IsEmpty() );
+}
+
+// GetStats
+//------------------------------------------------------------------------------
+void CacheServer::GetStats( Stats & outStats ) const
+{
+    MutexHolder mh( m_StatsMutex );
+    outStats = m_Stats;
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void CacheServer::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    CacheProtocol::Channel * channel = static_cast< CacheProtocol::Channel * >( connection->GetUserData() );
+    ASSERT( channel );
+
+    CacheProtocol::Message message;
+    switch ( channel->OnReceive( data, size, keepMemory, message ) )
+    {
+        case CacheProtocol::Channel::RECEIVE_INCOMPLETE:
+        {
+            return;
+        }
+        case CacheProtocol::Channel::RECEIVE_INVALID:
+        {
+            Disconnect( connection );
+            return;
+        }
+        case CacheProtocol::Channel::RECEIVE_COMPLETE:
+        {
+            break;
+        }
+    }
+
+    // Keep the channel until the job is processed
+    VERIFY( channel->AddRef() ); // Only closed by this thread
+
+    Job * job = FNEW( Job );
+    job->m_Channel = channel;
+    job->m_Message = message;
+    {
+        MutexHolder mh( m_JobsMutex );
+        m_Jobs.Append( job );
+        m_QueuedBytes += message.m_DataSize;
+
+        // Stop reading more requests until the queue drains (paused while
+        // holding the lock, so a draining thread can't miss the connection)
+        if ( IsQueueFull() )
+        {
+            PauseReceive( connection );
+            m_PausedConnections.Append( connection );
+        }
+    }
+    m_JobsAvailable.Signal();
+}
+
+// OnConnected
+//------------------------------------------------------------------------------
+/*virtual*/ void CacheServer::OnConnected( const ConnectionInfo * connection )
+{
+    connection->SetUserData( FNEW( CacheProtocol::Channel( *this, connection ) ) );
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void CacheServer::OnDisconnected( const ConnectionInfo * connection )
+{
+    CacheProtocol::Channel * channel = static_cast< CacheProtocol::Channel * >( connection->GetUserData() );
+    ASSERT( channel );
+
+    {
+        MutexHolder mh( m_JobsMutex );
+        m_PausedConnections.FindAndErase( connection );
+    }
+
+    // Jobs still using the channel free it when they complete, rather than
+    // blocking this thread until they do
+    connection->SetUserData( nullptr );
+    channel->Close();
+    if ( channel->Release() )
+    {
+        FDELETE channel;
+    }
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CacheServer::ThreadFuncStatic( void * param )
+{
+    static_cast< CacheServer * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CacheServer::ThreadFunc()
+{
+    PROFILE_SET_THREAD_NAME( "CacheServer" );
+
+    for ( ;; )
+    {
+        m_JobsAvailable.Wait();
+
+        Job * job = nullptr;
+        Array< const ConnectionInfo * > resume;
+        {
+            MutexHolder mh( m_JobsMutex );
+            if ( m_Jobs.IsEmpty() )
+            {
+                if ( m_Exit )
+                {
+                    return;
+                }
+                continue;
+            }
+            job = m_Jobs[ 0 ];
+            m_Jobs.EraseIndex( 0 );
+            m_QueuedBytes -= job->m_Message.m_DataSize;
+
+            // Resume reading once there is plenty of room, rather than
+            // pausing and resuming around the limit
+            if ( ( m_PausedConnections.IsEmpty() == false ) &&
+                 ( m_Jobs.GetSize() <= ( kMaxQueuedJobs / 2 ) ) &&
+                 ( m_QueuedBytes <= ( kMaxQueuedBytes / 2 ) ) )
+            {
+                resume.Swap( m_PausedConnections );
+            }
+        }
+        for ( const ConnectionInfo * connection : resume )
+        {
+            ResumeReceive( connection );
+        }
+
+        // Skip requests from clients which have disconnected
+        if ( job->m_Channel->IsClosed() == false )
+        {
+            Process( *job );
+        }
+
+        if ( job->m_Channel->Release() )
+        {
+            FDELETE job->m_Channel;
+        }
+        FREE( job->m_Message.m_Data );
+        FDELETE job;
+    }
+}
+
+// IsQueueFull
+//------------------------------------------------------------------------------
+bool CacheServer::IsQueueFull() const
+{
+    // NOTE: m_JobsMutex must be held
+    return ( m_Jobs.GetSize() >= kMaxQueuedJobs ) || ( m_QueuedBytes >= kMaxQueuedBytes );
+}
+
+// Process
+//------------------------------------------------------------------------------
+void CacheServer::Process( const Job & job )
+{
+    PROFILE_FUNCTION;
+
+    CacheProtocol::Channel & channel = *job.m_Channel;
+    const CacheProtocol::Message & msg = job.m_Message;
+
+    // Ids are used to build paths, so reject anything not generated by a client
+    const bool validId = ICache::IsValidCacheId( msg.m_CacheId );
+
+    switch ( msg.m_MsgType )
+    {
+        case CacheProtocol::MSG_HELLO:
+        {
+            uint32_t clientVersion = 0;
+            if ( msg.m_DataSize == sizeof( clientVersion ) )
+            {
+                memcpy( &clientVersion, msg.m_Data, sizeof( clientVersion ) );
+            }
+            const uint32_t version = CacheProtocol::CACHE_PROTOCOL_VERSION;
+            const uint8_t flags = ( clientVersion == version ) ? CacheProtocol::FLAG_SUCCESS : 0;
+            channel.Send( CacheProtocol::MSG_HELLO, flags, msg.m_RequestId, AString::GetEmpty(), &version, sizeof( version ) );
+            return;
+        }
+        case CacheProtocol::MSG_RETRIEVE:
+        {
+            void * data = nullptr;
+            size_t dataSize = 0;
+            const bool hit = validId && m_Cache.Retrieve( msg.m_CacheId, data, dataSize );
+            {
+                MutexHolder mh( m_StatsMutex );
+                ++m_Stats.m_Retrieves;
+                m_Stats.m_Hits += hit ? 1 : 0;
+                m_Stats.m_BytesSent += dataSize;
+            }
+            if ( hit )
+            {
+                channel.Send( CacheProtocol::MSG_RETRIEVE_RESULT, CacheProtocol::FLAG_SUCCESS, msg.m_RequestId, AString::GetEmpty(), data, dataSize );
+                m_Cache.FreeMemory( data, dataSize );
+            }
+            else
+            {
+                channel.Send( CacheProtocol::MSG_RETRIEVE_RESULT, 0, msg.m_RequestId, AString::GetEmpty(), nullptr, 0 );
+            }
+            return;
+        }
+        case CacheProtocol::MSG_PUBLISH:
+        {
+            const bool stored = validId && m_Cache.Publish( msg.m_CacheId, msg.m_Data, msg.m_DataSize );
+            if ( stored )
+            {
+                MutexHolder mh( m_StatsMutex );
+                ++m_Stats.m_Publishes;
+                m_Stats.m_BytesReceived += msg.m_DataSize;
+            }
+            channel.Send( CacheProtocol::MSG_PUBLISH_RESULT, stored ? CacheProtocol::FLAG_SUCCESS : 0, msg.m_RequestId, AString::GetEmpty(), nullptr, 0 );
+            return;
+        }
+        case CacheProtocol::MSG_EXISTS:
+        {
+            CacheBatchItem item;
+            item.m_CacheId = &msg.m_CacheId;
+            if ( validId )
+            {
+                m_Cache.ExistsBatch( &item, 1 );
+            }
+            channel.Send( CacheProtocol::MSG_EXISTS_RESULT, item.m_Result ? CacheProtocol::FLAG_SUCCESS : 0, msg.m_RequestId, AString::GetEmpty(), nullptr, 0 );
+            return;
+        }
+        case CacheProtocol::MSG_RETRIEVE_RESULT:
+        case CacheProtocol::MSG_PUBLISH_RESULT:
+        case CacheProtocol::MSG_EXISTS_RESULT:
+        {
+            break; // Only sent to clients
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
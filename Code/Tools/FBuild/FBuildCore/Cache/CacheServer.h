@@ -0,0 +1,75 @@
+// CacheServer - Serves a cache to NetworkCache clients
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheProtocol.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ICache;
+class Thread;
+
+// CacheServer
+//------------------------------------------------------------------------------
+// Requests are received on each connection's thread and processed by a pool of
+// threads, so the requests pipelined on one connection are served in parallel,
+// and their responses returned as they complete. When too much work is queued,
+// connections are not read from until the queue drains.
+class CacheServer : public TCPConnectionPool
+{
+public:
+    explicit CacheServer( ICache & cache, uint32_t numThreads );
+    virtual ~CacheServer() override;
+
+    struct Stats
+    {
+        uint32_t    m_Retrieves = 0;
+        uint32_t    m_Hits = 0;
+        uint32_t    m_Publishes = 0;
+        uint64_t    m_BytesSent = 0;
+        uint64_t    m_BytesReceived = 0;
+    };
+    void GetStats( Stats & outStats ) const;
+
+protected:
+    // network events - NOTE: these happen in another thread!
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+    virtual void OnConnected( const ConnectionInfo * connection ) override;
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+
+private:
+    struct Job
+    {
+        CacheProtocol::Channel *    m_Channel;
+        CacheProtocol::Message      m_Message;
+    };
+
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+    void Process( const Job & job );
+    bool IsQueueFull() const;
+
+    enum : uint32_t { kMaxQueuedJobs = 1024 };
+    enum : uint32_t { kMaxQueuedBytes = ( 1024 * 1024 * 1024 ) };
+
+    ICache &            m_Cache;
+    Mutex               m_JobsMutex;
+    Array< Job * >      m_Jobs;
+    uint64_t            m_QueuedBytes = 0;
+    Array< const ConnectionInfo * > m_PausedConnections;
+    Semaphore           m_JobsAvailable;
+    volatile bool       m_Exit = false;
+    Array< Thread * >   m_Threads;
+
+    mutable Mutex       m_StatsMutex;
+    Stats               m_Stats;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,304 @@
+// CacheTrimmer - Keep a cache under a size limit in the background
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "CacheTrimmer.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Math/Random.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Time/Timer.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Leave the start of the build (which is I/O heavy) alone
+    constexpr uint32_t kStartDelayMS = 1000;
+
+    // How often to check for buckets which have grown, once the pass is complete
+    constexpr uint32_t kIdleIntervalMS = 5000;
+
+    // Oldest entries are deleted until buckets are this far under the limit, so
+    // buckets aren't revisited for every store
+    constexpr uint64_t kLowWaterMarkPercent = 90;
+
+    // A bucket leased by another client is left alone for this long (the lease
+    // is renewed while trimming)
+    constexpr uint64_t kLeaseDurationSecs = 60;
+
+    // OldestFileTimeSorter
+    //--------------------------------------------------------------------------
+    class OldestFileTimeSorter
+    {
+    public:
+        bool operator () ( const FileIO::FileInfo * a, const FileIO::FileInfo * b ) const
+        {
+            return ( a->m_LastWriteTime < b->m_LastWriteTime );
+        }
+    };
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+CacheTrimmer::CacheTrimmer( Cache & cache, uint32_t sizeMiB )
+    : m_Cache( cache )
+    , m_BucketLimit( ( (uint64_t)sizeMiB * MEGABYTE ) / kNumBuckets )
+    , m_Retrieved( 1024, true )
+{
+    for ( uint64_t & size : m_BucketSizes )
+    {
+        size = kUnknownSize;
+    }
+
+    Random random;
+    m_SweepStart = random.GetRandIndex( kNumBuckets );
+
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Start( ThreadFuncStatic, "CacheTrimmer", this, MEGABYTE );
+    }
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+CacheTrimmer::~CacheTrimmer()
+{
+    m_Exit = true;
+    m_Exited.Signal( kNumThreads );
+    for ( Thread & thread : m_Threads )
+    {
+        thread.Join();
+    }
+}
+
+// OnRetrieve
+//------------------------------------------------------------------------------
+void CacheTrimmer::OnRetrieve( const AString & fileName )
+{
+    MutexHolder mh( m_Mutex );
+    m_Retrieved.Append( fileName );
+}
+
+// OnPublish
+//------------------------------------------------------------------------------
+void CacheTrimmer::OnPublish( uint32_t bucket, uint64_t size )
+{
+    ASSERT( bucket < kNumBuckets );
+
+    MutexHolder mh( m_Mutex );
+    if ( m_BucketSizes[ bucket ] != kUnknownSize )
+    {
+        m_BucketSizes[ bucket ] += size;
+    }
+}
+
+// ThreadFuncStatic
+//------------------------------------------------------------------------------
+/*static*/ uint32_t CacheTrimmer::ThreadFuncStatic( void * param )
+{
+    static_cast< CacheTrimmer * >( param )->ThreadFunc();
+    return 0;
+}
+
+// ThreadFunc
+//------------------------------------------------------------------------------
+void CacheTrimmer::ThreadFunc()
+{
+    PROFILE_SET_THREAD_NAME( "CacheTrimmer" );
+
+    m_Exited.Wait( kStartDelayMS );
+    while ( m_Exit == false )
+    {
+        uint32_t bucket;
+        if ( GetNextBucket( bucket ) )
+        {
+            TrimBucket( bucket );
+            continue;
+        }
+
+        TouchRetrievedFiles();
+        m_Exited.Wait( kIdleIntervalMS );
+    }
+}
+
+// GetNextBucket
+//------------------------------------------------------------------------------
+bool CacheTrimmer::GetNextBucket( uint32_t & outBucket )
+{
+    MutexHolder mh( m_Mutex );
+
+    // Buckets which have grown beyond the limit
+    for ( uint32_t i = 0; i < kNumBuckets; ++i )
+    {
+        if ( ( m_BucketSizes[ i ] != kUnknownSize ) && ( m_BucketSizes[ i ] > m_BucketLimit ) )
+        {
+            m_BucketSizes[ i ] = kUnknownSize; // Not picked by other threads until trimmed
+            outBucket = i;
+            return true;
+        }
+    }
+
+    // One pass over all buckets
+    while ( m_SweepPos < kNumBuckets )
+    {
+        const uint32_t bucket = ( ( m_SweepStart + m_SweepPos++ ) % kNumBuckets );
+        if ( m_BucketSizes[ bucket ] == kUnknownSize )
+        {
+            outBucket = bucket;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// TouchRetrievedFiles
+//------------------------------------------------------------------------------
+void CacheTrimmer::TouchRetrievedFiles()
+{
+    // Held until touched, so trimming can wait for touches in progress
+    MutexHolder th( m_TouchMutex );
+
+    Array< AString > retrieved;
+    {
+        MutexHolder mh( m_Mutex );
+        retrieved.Swap( m_Retrieved );
+    }
+    if ( retrieved.IsEmpty() )
+    {
+        return;
+    }
+
+    PROFILE_FUNCTION;
+
+    // Files can be retrieved many times (such as pack files)
+    Array< const AString * > sorted( retrieved.GetSize(), false );
+    for ( const AString & fileName : retrieved )
+    {
+        sorted.Append( &fileName );
+    }
+    sorted.QuickSortDeref();
+    const AString * previous = nullptr;
+    for ( const AString * fileName : sorted )
+    {
+        if ( m_Exit )
+        {
+            break; // Shutting down - touches are only a hint
+        }
+        if ( previous && ( *previous == *fileName ) )
+        {
+            continue;
+        }
+        FileIO::SetFileLastWriteTimeToNow( *fileName ); // Ok to fail if deleted
+        previous = fileName;
+    }
+}
+
+// TrimBucket
+//------------------------------------------------------------------------------
+void CacheTrimmer::TrimBucket( uint32_t bucket )
+{
+    PROFILE_FUNCTION;
+
+    // Everything retrieved so far must be seen as recently used
+    TouchRetrievedFiles();
+
+    // Another client is trimming this bucket, or has just done so
+    const uint64_t lowWaterMark = ( ( m_BucketLimit * kLowWaterMarkPercent ) / 100 );
+    AStackString<> leaseFileName;
+    m_Cache.GetTrimLeaseFileName( bucket, leaseFileName );
+    if ( AcquireLease( leaseFileName ) == false )
+    {
+        MutexHolder mh( m_Mutex );
+        m_BucketSizes[ bucket ] = lowWaterMark; // Assume trimmed
+        return;
+    }
+    const Timer leaseTimer;
+
+    Array< FileIO::FileInfo > files( 1024, true );
+    m_Cache.GetBucketFiles( bucket, files, &m_Exit );
+    if ( m_Exit )
+    {
+        return; // Abandoned (bucket size remains unknown)
+    }
+    uint64_t totalSize = 0;
+    for ( const FileIO::FileInfo & info : files )
+    {
+        totalSize += info.m_Size;
+    }
+
+    if ( totalSize > m_BucketLimit )
+    {
+        // Delete least recently used first
+        Array< const FileIO::FileInfo * > oldestFirst( files.GetSize(), false );
+        for ( const FileIO::FileInfo & info : files )
+        {
+            oldestFirst.Append( &info );
+        }
+        oldestFirst.QuickSort( OldestFileTimeSorter() );
+        for ( const FileIO::FileInfo * info : oldestFirst )
+        {
+            if ( m_Exit || ( totalSize <= lowWaterMark ) )
+            {
+                break;
+            }
+
+            // Renew the lease if trimming is taking a long time
+            if ( leaseTimer.GetElapsed() > ( kLeaseDurationSecs / 2 ) )
+            {
+                FileIO::SetFileLastWriteTimeToNow( leaseFileName );
+            }
+
+            // Ok to fail if in use, or deleted by another process
+            if ( m_Cache.DeleteCacheFile( info->m_Name ) )
+            {
+                totalSize -= info->m_Size;
+            }
+        }
+    }
+
+    MutexHolder mh( m_Mutex );
+    m_BucketSizes[ bucket ] = totalSize;
+}
+
+// AcquireLease
+//------------------------------------------------------------------------------
+bool CacheTrimmer::AcquireLease( const AString & leaseFileName ) const
+{
+    // Held if renewed recently (the last write time is 0 if no client has taken it)
+    const uint64_t leaseTime = FileIO::GetFileLastWriteTime( leaseFileName );
+    if ( leaseTime )
+    {
+        const uint64_t now = Time::GetCurrentFileTime();
+        const uint64_t age = ( now > leaseTime ) ? ( now - leaseTime ) : ( leaseTime - now ); // Clocks can differ
+        if ( Time::FileTimeToSeconds( age ) < kLeaseDurationSecs )
+        {
+            return false;
+        }
+    }
+
+    // Take the lease (two clients can occasionally both take it, which is harmless,
+    // as is failing to write it)
+    if ( leaseTime == 0 )
+    {
+        FileIO::EnsurePathExistsForFile( leaseFileName );
+        FileStream f;
+        f.Open( leaseFileName.Get(), FileStream::WRITE_ONLY );
+    }
+    else
+    {
+        FileIO::SetFileLastWriteTimeToNow( leaseFileName );
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+// CacheTrimmer - Keep a cache under a size limit in the background
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Process/Semaphore.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class Cache;
+
+// CacheTrimmer
+//------------------------------------------------------------------------------
+// Rather than enumerating the entire cache, each of its 256 buckets (which are
+// evenly filled, as cache ids are hashes) is kept under 1/256th of the limit.
+// While a build runs, the trimmer makes one pass over all buckets (starting at a
+// random one, so short builds share the work), then revisits buckets estimated
+// to have grown over their limit from what has been published since. Several
+// buckets are processed (and their files deleted) in parallel.
+//
+// Entries are deleted least recently used first: files are touched when they
+// are retrieved (batched, from the trimmer threads rather than the workers).
+//
+// Clients sharing a cache take a lease (a file in the cache) on a bucket before
+// trimming it, so each bucket is trimmed by one client at a time, and not again
+// by others soon after.
+class CacheTrimmer
+{
+public:
+    explicit CacheTrimmer( Cache & cache, uint32_t sizeMiB );
+    ~CacheTrimmer();
+
+    // Any thread
+    void OnRetrieve( const AString & fileName );
+    void OnPublish( uint32_t bucket, uint64_t size );
+
+private:
+    static uint32_t ThreadFuncStatic( void * param );
+    void ThreadFunc();
+
+    bool GetNextBucket( uint32_t & outBucket );
+    void TouchRetrievedFiles();
+    void TrimBucket( uint32_t bucket );
+    bool AcquireLease( const AString & leaseFileName ) const;
+
+    enum : uint32_t { kNumThreads = 4 };
+    enum : uint32_t { kNumBuckets = 256 };
+    static constexpr uint64_t kUnknownSize = ~(uint64_t)0;
+
+    Cache &             m_Cache;
+    uint64_t            m_BucketLimit;
+    Mutex               m_Mutex;
+    Mutex               m_TouchMutex;
+    Array< AString >    m_Retrieved;                    // Files to touch
+    uint64_t            m_BucketSizes[ kNumBuckets ];   // Estimated, or unknown
+    uint32_t            m_SweepStart;
+    uint32_t            m_SweepPos = 0;
+    Semaphore           m_Exited;
+    volatile bool       m_Exit = false;
+    Thread              m_Threads[ kNumThreads ];
+};
+
+//------------------------------------------------------------------------------
@@ -7,16 +7,57 @@
 
 #include <Core/Strings/AString.h>
 
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::RetrieveBatch( CacheBatchItem * items, size_t numItems )
+{
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        CacheBatchItem & item = items[ i ];
+        item.m_Result = Retrieve( *item.m_CacheId, item.m_Data, item.m_DataSize );
+    }
+}
+
+// PublishBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::PublishBatch( CacheBatchItem * items, size_t numItems )
+{
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        CacheBatchItem & item = items[ i ];
+        item.m_Result = Publish( *item.m_CacheId, item.m_PublishData, item.m_PublishDataSize );
+    }
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void ICache::ExistsBatch( CacheBatchItem * items, size_t numItems )
+{
+    // Without a cheaper way to check, retrieve the data
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        CacheBatchItem & item = items[ i ];
+        void * data = nullptr;
+        size_t dataSize = 0;
+        item.m_Result = Retrieve( *item.m_CacheId, data, dataSize );
+        if ( item.m_Result )
+        {
+            FreeMemory( data, dataSize );
+        }
+    }
+}
+
 // GetCacheId
 //------------------------------------------------------------------------------
 /*static*/ void ICache::GetCacheId( const uint64_t preprocessedSourceKey,
                                     const uint32_t commandLineKey,
                                     const uint64_t toolChainKey,
                                     const uint64_t pchKey,
+                                    const uint64_t dictionaryId,
                                     AString & outCacheId )
 {
     // cache version - bump if cache format is changed
-    static const char cacheVersion( 'D' );
+    static const char cacheVersion( 'E' );
 
     // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7
     outCacheId.Format( "%016" PRIX64 "_%08X_%016" PRIX64 "-%016" PRIX64 ".%c",
@@ -25,6 +66,66 @@
                        toolChainKey,
                        pchKey,
                        cacheVersion );
+
+    // Entries compressed using a dictionary can only be decompressed with it, so
+    // are only shared by users of the same dictionary
+    // format example: 2377DE32AB045A2D_FED872A1_AB62FEAA23498AAC-32A2B04375A2D7DE.7-5A0C93E3A1B2C4D6
+    if ( dictionaryId != 0 )
+    {
+        outCacheId.AppendFormat( "-%016" PRIX64, dictionaryId );
+    }
+}
+
+// IsValidCacheId
+//------------------------------------------------------------------------------
+/*static*/ bool ICache::IsValidCacheId( const AString & cacheId )
+{
+    // Ids are used to build paths, so must not contain anything else
+    // ('X' = hex digit, 'V' = cache version, '-' is only present with a dictionary)
+    static const char format[] = "XXXXXXXXXXXXXXXX_XXXXXXXX_XXXXXXXXXXXXXXXX-XXXXXXXXXXXXXXXX.V-XXXXXXXXXXXXXXXX";
+    static const size_t shortLength = 61;
+    static const size_t longLength = 78;
+    static_assert( sizeof( format ) == ( longLength + 1 ), "Unexpected length" );
+
+    const size_t length = cacheId.GetLength();
+    if ( ( length != shortLength ) && ( length != longLength ) )
+    {
+        return false;
+    }
+
+    const char * id = cacheId.Get();
+    for ( size_t i = 0; i < length; ++i )
+    {
+        const char c = id[ i ];
+        switch ( format[ i ] )
+        {
+            case 'X':
+            {
+                if ( ( ( c >= '0' ) && ( c <= '9' ) ) || ( ( c >= 'A' ) && ( c <= 'F' ) ) )
+                {
+                    continue;
+                }
+                return false;
+            }
+            case 'V':
+            {
+                if ( ( ( c >= '0' ) && ( c <= '9' ) ) || ( ( c >= 'A' ) && ( c <= 'Z' ) ) )
+                {
+                    continue;
+                }
+                return false;
+            }
+            default:
+            {
+                if ( c == format[ i ] )
+                {
+                    continue;
+                }
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -10,6 +10,32 @@
 //------------------------------------------------------------------------------
 class AString;
 
+// CacheTierStats - hit/miss counts per tier of a LayeredCache
+//------------------------------------------------------------------------------
+struct CacheTierStats
+{
+    uint32_t    m_MemoryHits = 0;
+    uint32_t    m_MemoryMisses = 0;
+    uint32_t    m_LocalHits = 0;
+    uint32_t    m_LocalMisses = 0;
+    uint32_t    m_LocalStores = 0;  // Publishes and promotions of shared hits
+    uint32_t    m_SharedHits = 0;
+    uint32_t    m_SharedMisses = 0;
+    uint32_t    m_SharedStores = 0;
+};
+
+// CacheBatchItem - one entry of a batched request
+//------------------------------------------------------------------------------
+struct CacheBatchItem
+{
+    const AString * m_CacheId = nullptr;
+    const void *    m_PublishData = nullptr;    // PublishBatch: data to store
+    size_t          m_PublishDataSize = 0;
+    void *          m_Data = nullptr;           // RetrieveBatch: retrieved data (free with FreeMemory)
+    size_t          m_DataSize = 0;
+    bool            m_Result = false;           // Retrieved, stored or exists
+};
+
 // Cache
 //------------------------------------------------------------------------------
 class ICache
@@ -31,12 +57,29 @@ public:
     virtual bool OutputInfo( bool showProgress ) = 0;
     virtual bool Trim( bool showProgress, uint32_t sizeMiB ) = 0;
 
+    // Optional: several entries per call, for implementations where each call is a
+    // round trip. By default, each entry is processed individually.
+    virtual void RetrieveBatch( CacheBatchItem * items, size_t numItems );
+    virtual void PublishBatch( CacheBatchItem * items, size_t numItems );
+    virtual void ExistsBatch( CacheBatchItem * items, size_t numItems );
+
+    // Optional: true if ExistsBatch is cheaper than retrieving the entries
+    virtual bool SupportsExists() const { return false; }
+
+    // Optional: false if an entry is known not to exist, so retrieval can be skipped
+    virtual bool MayContain( const AString & /*cacheId*/ ) { return true; }
+
+    // Optional: stats since the previous call, for implementations with tiers
+    virtual bool GetTierStats( CacheTierStats & /*outStats*/ ) { return false; }
+
     // Helper functions
     static void GetCacheId( const uint64_t preprocessedSourceKey,
                             const uint32_t commandLineKey,
                             const uint64_t toolChainKey,
                             const uint64_t pchKey,
+                            const uint64_t dictionaryId,    // 0 = not compressed using a dictionary
                             AString & outCacheId );
+    static bool IsValidCacheId( const AString & cacheId ); // Has the form generated by GetCacheId
 };
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,449 @@
+// LayeredCache - Local tiers in front of a shared cache
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "LayeredCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+
+// system
+#include <string.h> // for memcpy
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+LayeredCache::LayeredCache( ICache * sharedCache,
+                            const AString & localCachePath,
+                            uint32_t localCacheSizeMiB,
+                            uint32_t memoryCacheSizeMiB )
+    : m_SharedCache( sharedCache )
+    , m_LocalCachePath( localCachePath )
+    , m_LocalCacheSizeMiB( localCacheSizeMiB )
+    , m_MemoryLimit( (uint64_t)memoryCacheSizeMiB * MEGABYTE )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+LayeredCache::~LayeredCache()
+{
+    while ( m_OldestEntry )
+    {
+        RemoveFromMemory( m_OldestEntry );
+    }
+    FDELETE m_LocalCache;
+    FDELETE m_SharedCache;
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::Init( const AString & cachePath,
+                                     const AString & cachePathMountPoint,
+                                     bool cacheRead,
+                                     bool cacheWrite,
+                                     bool cacheVerbose,
+                                     const AString & pluginDLLConfig )
+{
+    PROFILE_FUNCTION;
+
+    // The shared cache is required
+    if ( m_SharedCache->Init( cachePath, cachePathMountPoint, cacheRead, cacheWrite, cacheVerbose, pluginDLLConfig ) == false )
+    {
+        return false;
+    }
+
+    // The local tier is optional
+    if ( m_LocalCachePath.IsEmpty() == false )
+    {
+        PathUtils::EnsureTrailingSlash( m_LocalCachePath );
+        if ( FileIO::EnsurePathExists( m_LocalCachePath ) )
+        {
+            m_LocalCache = FNEW( Cache( m_LocalCacheSizeMiB ) ); // Trimmed in the background
+            VERIFY( m_LocalCache->Init( m_LocalCachePath, AString::GetEmpty(), cacheRead, cacheWrite, cacheVerbose, AString::GetEmpty() ) );
+        }
+        else
+        {
+            FLOG_WARN( "Local cache inaccessible - Local caching disabled (Path '%s')", m_LocalCachePath.Get() );
+        }
+    }
+
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void LayeredCache::Shutdown()
+{
+    if ( m_LocalCache )
+    {
+        m_LocalCache->Shutdown();
+    }
+    m_SharedCache->Shutdown();
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    StoreInMemory( cacheId, data, dataSize );
+    StoreInLocal( cacheId, data, dataSize );
+
+    if ( m_SharedCache->Publish( cacheId, data, dataSize ) )
+    {
+        AtomicInc( &m_Stats.m_SharedStores );
+        return true;
+    }
+    return false;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    data = nullptr;
+    dataSize = 0;
+
+    if ( RetrieveFromLocalTiers( cacheId, data, dataSize ) )
+    {
+        return true;
+    }
+
+    // Shared
+    void * sharedData = nullptr;
+    size_t sharedDataSize = 0;
+    if ( m_SharedCache->Retrieve( cacheId, sharedData, sharedDataSize ) == false )
+    {
+        AtomicInc( &m_Stats.m_SharedMisses );
+        return false;
+    }
+    AtomicInc( &m_Stats.m_SharedHits );
+    OnSharedHit( cacheId, sharedData, sharedDataSize, data, dataSize );
+    return true;
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void LayeredCache::RetrieveBatch( CacheBatchItem * items, size_t numItems )
+{
+    // Entries not in the local tiers are retrieved from the shared cache together
+    Array< CacheBatchItem > sharedItems( numItems, false );
+    Array< size_t > sharedItemIndices( numItems, false );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        CacheBatchItem & item = items[ i ];
+        item.m_Data = nullptr;
+        item.m_DataSize = 0;
+        item.m_Result = RetrieveFromLocalTiers( *item.m_CacheId, item.m_Data, item.m_DataSize );
+        if ( item.m_Result == false )
+        {
+            CacheBatchItem sharedItem;
+            sharedItem.m_CacheId = item.m_CacheId;
+            sharedItems.Append( sharedItem );
+            sharedItemIndices.Append( i );
+        }
+    }
+    if ( sharedItems.IsEmpty() )
+    {
+        return;
+    }
+
+    m_SharedCache->RetrieveBatch( sharedItems.Begin(), sharedItems.GetSize() );
+
+    for ( size_t i = 0; i < sharedItems.GetSize(); ++i )
+    {
+        const CacheBatchItem & sharedItem = sharedItems[ i ];
+        CacheBatchItem & item = items[ sharedItemIndices[ i ] ];
+        if ( sharedItem.m_Result == false )
+        {
+            AtomicInc( &m_Stats.m_SharedMisses );
+            continue;
+        }
+        AtomicInc( &m_Stats.m_SharedHits );
+        OnSharedHit( *item.m_CacheId, sharedItem.m_Data, sharedItem.m_DataSize, item.m_Data, item.m_DataSize );
+        item.m_Result = true;
+    }
+}
+
+// PublishBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void LayeredCache::PublishBatch( CacheBatchItem * items, size_t numItems )
+{
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        const CacheBatchItem & item = items[ i ];
+        StoreInMemory( *item.m_CacheId, item.m_PublishData, item.m_PublishDataSize );
+        StoreInLocal( *item.m_CacheId, item.m_PublishData, item.m_PublishDataSize );
+    }
+
+    m_SharedCache->PublishBatch( items, numItems );
+
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        if ( items[ i ].m_Result )
+        {
+            AtomicInc( &m_Stats.m_SharedStores );
+        }
+    }
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void LayeredCache::ExistsBatch( CacheBatchItem * items, size_t numItems )
+{
+    // Only the shared cache is authoritative (local tiers may have been trimmed or be stale)
+    m_SharedCache->ExistsBatch( items, numItems );
+}
+
+// SupportsExists
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::SupportsExists() const
+{
+    return m_SharedCache->SupportsExists();
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void LayeredCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    FREE( data );
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::OutputInfo( bool showProgress )
+{
+    return m_SharedCache->OutputInfo( showProgress );
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    return m_SharedCache->Trim( showProgress, sizeMiB );
+}
+
+// GetTierStats
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::GetTierStats( CacheTierStats & outStats )
+{
+    // Reset each counter as it is read, so concurrent updates aren't lost
+    outStats.m_MemoryHits   = AtomicExchange( &m_Stats.m_MemoryHits, 0 );
+    outStats.m_MemoryMisses = AtomicExchange( &m_Stats.m_MemoryMisses, 0 );
+    outStats.m_LocalHits    = AtomicExchange( &m_Stats.m_LocalHits, 0 );
+    outStats.m_LocalMisses  = AtomicExchange( &m_Stats.m_LocalMisses, 0 );
+    outStats.m_LocalStores  = AtomicExchange( &m_Stats.m_LocalStores, 0 );
+    outStats.m_SharedHits   = AtomicExchange( &m_Stats.m_SharedHits, 0 );
+    outStats.m_SharedMisses = AtomicExchange( &m_Stats.m_SharedMisses, 0 );
+    outStats.m_SharedStores = AtomicExchange( &m_Stats.m_SharedStores, 0 );
+    return true;
+}
+
+// MayContain
+//------------------------------------------------------------------------------
+/*virtual*/ bool LayeredCache::MayContain( const AString & cacheId )
+{
+    // Local tiers are cheap to check, so are checked first
+    if ( IsInMemory( cacheId ) )
+    {
+        return true;
+    }
+    if ( m_LocalCache )
+    {
+        CacheBatchItem item;
+        item.m_CacheId = &cacheId;
+        m_LocalCache->ExistsBatch( &item, 1 );
+        if ( item.m_Result )
+        {
+            return true;
+        }
+    }
+    return m_SharedCache->MayContain( cacheId );
+}
+
+// RetrieveFromLocalTiers
+//------------------------------------------------------------------------------
+bool LayeredCache::RetrieveFromLocalTiers( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    // Memory
+    if ( m_MemoryLimit > 0 )
+    {
+        if ( RetrieveFromMemory( cacheId, data, dataSize ) )
+        {
+            AtomicInc( &m_Stats.m_MemoryHits );
+            return true;
+        }
+        AtomicInc( &m_Stats.m_MemoryMisses );
+    }
+
+    // Local disk
+    if ( m_LocalCache )
+    {
+        if ( m_LocalCache->Retrieve( cacheId, data, dataSize ) )
+        {
+            AtomicInc( &m_Stats.m_LocalHits );
+            StoreInMemory( cacheId, data, dataSize );
+            return true;
+        }
+        AtomicInc( &m_Stats.m_LocalMisses );
+    }
+
+    return false;
+}
+
+// OnSharedHit
+//------------------------------------------------------------------------------
+void LayeredCache::OnSharedHit( const AString & cacheId, void * sharedData, size_t sharedDataSize, void * & outData, size_t & outDataSize )
+{
+    // Take a copy so data from all tiers can be freed the same way
+    // (the shared cache may be a plugin with its own allocator)
+    outData = ALLOC( sharedDataSize );
+    memcpy( outData, sharedData, sharedDataSize );
+    outDataSize = sharedDataSize;
+    m_SharedCache->FreeMemory( sharedData, sharedDataSize );
+
+    // Promote to local tiers
+    StoreInLocal( cacheId, outData, outDataSize );
+    StoreInMemory( cacheId, outData, outDataSize );
+}
+
+// RetrieveFromMemory
+//------------------------------------------------------------------------------
+bool LayeredCache::RetrieveFromMemory( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    MutexHolder mh( m_MemoryMutex );
+    const UnorderedMap< AString, MemoryEntry * >::KeyValue * keyValue = m_MemoryEntries.Find( cacheId );
+    if ( keyValue == nullptr )
+    {
+        return false;
+    }
+
+    // Most recently used
+    MemoryEntry * entry = keyValue->m_Value;
+    Unlink( entry );
+    LinkAsNewest( entry );
+
+    // Caller owns the returned memory
+    data = ALLOC( entry->m_DataSize );
+    memcpy( data, entry->m_Data, entry->m_DataSize );
+    dataSize = entry->m_DataSize;
+    return true;
+}
+
+// IsInMemory
+//------------------------------------------------------------------------------
+bool LayeredCache::IsInMemory( const AString & cacheId )
+{
+    if ( m_MemoryLimit == 0 )
+    {
+        return false;
+    }
+
+    MutexHolder mh( m_MemoryMutex );
+    return ( m_MemoryEntries.Find( cacheId ) != nullptr );
+}
+
+// StoreInMemory
+//------------------------------------------------------------------------------
+void LayeredCache::StoreInMemory( const AString & cacheId, const void * data, size_t dataSize )
+{
+    if ( ( m_MemoryLimit == 0 ) || ( dataSize > m_MemoryLimit ) )
+    {
+        return; // Disabled, or too big to be worth evicting everything else
+    }
+
+    MemoryEntry * newEntry = FNEW( MemoryEntry );
+    newEntry->m_CacheId = cacheId;
+    newEntry->m_Data = ALLOC( dataSize );
+    memcpy( newEntry->m_Data, data, dataSize );
+    newEntry->m_DataSize = dataSize;
+
+    MutexHolder mh( m_MemoryMutex );
+
+    // Replace existing entry if present
+    UnorderedMap< AString, MemoryEntry * >::KeyValue * keyValue = m_MemoryEntries.Find( cacheId );
+    if ( keyValue )
+    {
+        RemoveFromMemory( keyValue->m_Value );
+    }
+
+    // Evict least recently used entries until there is space
+    while ( ( m_MemorySize + dataSize ) > m_MemoryLimit )
+    {
+        ASSERT( m_OldestEntry );
+        RemoveFromMemory( m_OldestEntry );
+    }
+
+    m_MemoryEntries.Insert( cacheId, newEntry );
+    LinkAsNewest( newEntry );
+    m_MemorySize += dataSize;
+}
+
+// LinkAsNewest
+//------------------------------------------------------------------------------
+void LayeredCache::LinkAsNewest( MemoryEntry * entry )
+{
+    entry->m_Newer = nullptr;
+    entry->m_Older = m_NewestEntry;
+    if ( m_NewestEntry )
+    {
+        m_NewestEntry->m_Newer = entry;
+    }
+    else
+    {
+        m_OldestEntry = entry;
+    }
+    m_NewestEntry = entry;
+}
+
+// Unlink
+//------------------------------------------------------------------------------
+void LayeredCache::Unlink( MemoryEntry * entry )
+{
+    if ( entry->m_Newer )
+    {
+        entry->m_Newer->m_Older = entry->m_Older;
+    }
+    else
+    {
+        m_NewestEntry = entry->m_Older;
+    }
+    if ( entry->m_Older )
+    {
+        entry->m_Older->m_Newer = entry->m_Newer;
+    }
+    else
+    {
+        m_OldestEntry = entry->m_Newer;
+    }
+}
+
+// RemoveFromMemory
+//------------------------------------------------------------------------------
+void LayeredCache::RemoveFromMemory( MemoryEntry * entry )
+{
+    Unlink( entry );
+    VERIFY( m_MemoryEntries.Erase( entry->m_CacheId ) );
+    m_MemorySize -= entry->m_DataSize;
+    FREE( entry->m_Data );
+    FDELETE entry;
+}
+
+// StoreInLocal
+//------------------------------------------------------------------------------
+void LayeredCache::StoreInLocal( const AString & cacheId, const void * data, size_t dataSize )
+{
+    if ( m_LocalCache && m_LocalCache->Publish( cacheId, data, dataSize ) )
+    {
+        AtomicInc( &m_Stats.m_LocalStores );
+    }
+}
+
+//------------------------------------------------------------------------------
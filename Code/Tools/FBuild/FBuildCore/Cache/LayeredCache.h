@@ -0,0 +1,87 @@
+// LayeredCache - Local tiers in front of a shared cache
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Cache.h"
+
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// LayeredCache
+//------------------------------------------------------------------------------
+// Retrieval from the shared (usually network) cache is slow compared to local
+// storage, so hits are looked up in up to two local tiers first:
+//  - an in-memory LRU (useful when a process performs several builds, such as
+//    with -daemon, or when identical objects are compiled for several targets)
+//  - a size-bounded cache on a local disk (least recently used entries are trimmed in the background)
+// Shared hits are promoted to the local tiers and publishing writes through to
+// all tiers.
+class LayeredCache : public ICache
+{
+public:
+    // Takes ownership of the shared cache
+    explicit LayeredCache( ICache * sharedCache,
+                           const AString & localCachePath,
+                           uint32_t localCacheSizeMiB,
+                           uint32_t memoryCacheSizeMiB );
+    virtual ~LayeredCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual bool GetTierStats( CacheTierStats & outStats ) override;
+    virtual void RetrieveBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual void PublishBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual void ExistsBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual bool SupportsExists() const override;
+    virtual bool MayContain( const AString & cacheId ) override;
+
+private:
+    bool RetrieveFromLocalTiers( const AString & cacheId, void * & data, size_t & dataSize );
+    void OnSharedHit( const AString & cacheId, void * sharedData, size_t sharedDataSize, void * & outData, size_t & outDataSize );
+    bool RetrieveFromMemory( const AString & cacheId, void * & data, size_t & dataSize );
+    bool IsInMemory( const AString & cacheId );
+    void StoreInMemory( const AString & cacheId, const void * data, size_t dataSize );
+    void StoreInLocal( const AString & cacheId, const void * data, size_t dataSize );
+
+    struct MemoryEntry
+    {
+        AString         m_CacheId;
+        void *          m_Data;
+        size_t          m_DataSize;
+        MemoryEntry *   m_Newer;    // LRU list
+        MemoryEntry *   m_Older;
+    };
+    void LinkAsNewest( MemoryEntry * entry );
+    void Unlink( MemoryEntry * entry );
+    void RemoveFromMemory( MemoryEntry * entry );
+
+    ICache *                m_SharedCache;
+    Cache *                 m_LocalCache = nullptr;     // Null if not accessible
+    AString                 m_LocalCachePath;
+    uint32_t                m_LocalCacheSizeMiB;
+
+    // In-memory LRU tier
+    Mutex                   m_MemoryMutex;
+    UnorderedMap< AString, MemoryEntry * > m_MemoryEntries;
+    MemoryEntry *           m_NewestEntry = nullptr;
+    MemoryEntry *           m_OldestEntry = nullptr;    // Evicted first
+    uint64_t                m_MemoryLimit;
+    uint64_t                m_MemorySize = 0;
+
+    CacheTierStats          m_Stats;                    // Updated atomically
+};
+
+//------------------------------------------------------------------------------
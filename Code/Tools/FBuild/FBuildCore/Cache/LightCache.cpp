@@ -55,6 +55,7 @@ public:
     uint64_t                        m_FileNameHash;
     AString                         m_FileName;
     bool                            m_Exists;
+    uint64_t                        m_LastWriteTime;
     uint64_t                        m_ContentHash;
     Array< Include >                m_Includes;
     Array< const IncludeDefine * >  m_IncludeDefines;
@@ -132,6 +133,40 @@ public:
         m_Buckets.Destruct();
         m_Elts = 0;
     }
+    void RemoveChangedFiles()
+    {
+        Array< IncludedFile * > files( m_Elts, false );
+        Array< const AString * > fileNames( m_Elts, false );
+        for ( IncludedFile * file : m_Buckets )
+        {
+            if ( file )
+            {
+                files.Append( file );
+                fileNames.Append( &file->m_FileName );
+            }
+        }
+        Array< uint64_t > lastWriteTimes;
+        lastWriteTimes.SetSize( files.GetSize() );
+        FileIO::GetFileLastWriteTimes( fileNames.Begin(), fileNames.GetSize(), lastWriteTimes.Begin() );
+
+        // Re-insert unchanged files (removing in place would break probing)
+        for ( IncludedFile * & elt : m_Buckets )
+        {
+            elt = nullptr;
+        }
+        m_Elts = 0;
+        for ( size_t i = 0; i < files.GetSize(); ++i )
+        {
+            if ( lastWriteTimes[ i ] == files[ i ]->m_LastWriteTime )
+            {
+                Insert( files[ i ] );
+            }
+            else
+            {
+                FDELETE files[ i ];
+            }
+        }
+    }
 
 private:
     IncludedFile ** InternalFind( const AString & fileName, uint64_t fileNameHash )
@@ -346,6 +381,20 @@ bool LightCache::Hash( ObjectNode * node,
     }
 }
 
+// ClearChangedFiles
+//------------------------------------------------------------------------------
+/*static*/ void LightCache::ClearChangedFiles()
+{
+    PROFILE_FUNCTION;
+
+    // Files created, modified or deleted since they were cached must be parsed again
+    for ( IncludedFileBucket & bucket : g_AllIncludedFiles )
+    {
+        MutexHolder mh( bucket.m_Mutex );
+        bucket.m_HashSet.RemoveChangedFiles();
+    }
+}
+
 // Parse
 //------------------------------------------------------------------------------
 void LightCache::Parse( IncludedFile * file, FileStream & f )
@@ -879,6 +928,7 @@ const IncludedFile * LightCache::FileExists( const AString & fileName )
     newFile->m_FileNameHash = fileNameHash;
     newFile->m_FileName = fileName;
     newFile->m_Exists = false;
+    newFile->m_LastWriteTime = FileIO::GetFileLastWriteTime( fileName ); // Before reading, so later changes are detected
     newFile->m_ContentHash = 0;
 
     // Try to open the new file
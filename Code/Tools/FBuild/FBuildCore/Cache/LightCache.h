@@ -37,6 +37,7 @@ public:
     const AString & GetErrors() const { return m_Errors; }
 
     static void ClearCachedFiles();
+    static void ClearChangedFiles(); // Keep unmodified files between builds (-daemon)
 
 protected:
     void                    Parse( IncludedFile * file, FileStream & f );
@@ -0,0 +1,490 @@
+// NetworkCache - Cache served by an FBuildCacheServer
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "NetworkCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/FLog.h"
+
+// Core
+#include "Core/Process/Atomic.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Tracing/Tracing.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    const char * const kCachePathPrefix = "fbcache://";
+
+    // Don't stall every request while the server is unavailable
+    constexpr float kReconnectIntervalSecs = 10.0f;
+
+    // Requests are abandoned (as misses) if the server doesn't respond
+    constexpr uint32_t kRequestTimeoutMS = ( 60 * 1000 );
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+NetworkCache::NetworkCache()
+    : ICache()
+    , TCPConnectionPool()
+    , m_Port( CacheProtocol::CACHE_SERVER_PORT )
+    , m_PendingRequests( 64, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ NetworkCache::~NetworkCache()
+{
+    ShutdownAllConnections();
+}
+
+// IsNetworkCachePath
+//------------------------------------------------------------------------------
+/*static*/ bool NetworkCache::IsNetworkCachePath( const AString & cachePath )
+{
+    return cachePath.BeginsWithI( kCachePathPrefix );
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool NetworkCache::Init( const AString & cachePath,
+                                     const AString & /*cachePathMountPoint*/,
+                                     bool /*cacheRead*/,
+                                     bool /*cacheWrite*/,
+                                     bool /*cacheVerbose*/,
+                                     const AString & /*pluginDLLConfig*/ )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( IsNetworkCachePath( cachePath ) );
+
+    // fbcache://host[:port][/]
+    m_Host = ( cachePath.Get() + AString::StrLen( kCachePathPrefix ) );
+    m_Host.TrimEnd( '/' );
+    const char * colon = m_Host.Find( ':' );
+    if ( colon )
+    {
+        uint32_t port = 0;
+        if ( ( AString::ScanS( colon + 1, "%u", &port ) != 1 ) || ( port == 0 ) || ( port > 0xFFFF ) )
+        {
+            FLOG_WARN( "Invalid cache server port - Caching disabled (Path '%s')", cachePath.Get() );
+            return false;
+        }
+        m_Port = (uint16_t)port;
+        m_Host.SetLength( (uint32_t)( colon - m_Host.Get() ) );
+    }
+
+    MutexHolder mh( m_ConnectMutex );
+    if ( ConnectToServer() == false )
+    {
+        FLOG_WARN( "Cache server inaccessible - Caching disabled (Path '%s')", cachePath.Get() );
+        return false;
+    }
+    return true;
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::Shutdown()
+{
+    ShutdownAllConnections();
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool NetworkCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    PROFILE_FUNCTION;
+
+    CacheProtocol::Channel * channel = AcquireChannel();
+    if ( channel == nullptr )
+    {
+        return false;
+    }
+
+    void * response = nullptr;
+    size_t responseSize = 0;
+    const bool stored = SendRequest( channel, CacheProtocol::MSG_PUBLISH, cacheId, data, dataSize, response, responseSize );
+    FREE( response );
+    ReleaseChannel( channel );
+    return stored;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool NetworkCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    PROFILE_FUNCTION;
+
+    data = nullptr;
+    dataSize = 0;
+
+    CacheProtocol::Channel * channel = AcquireChannel();
+    if ( channel == nullptr )
+    {
+        return false;
+    }
+
+    const bool hit = SendRequest( channel, CacheProtocol::MSG_RETRIEVE, cacheId, nullptr, 0, data, dataSize );
+    ReleaseChannel( channel );
+    return hit;
+}
+
+// RetrieveBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::RetrieveBatch( CacheBatchItem * items, size_t numItems )
+{
+    PROFILE_FUNCTION;
+    SendBatch( CacheProtocol::MSG_RETRIEVE, items, numItems );
+}
+
+// PublishBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::PublishBatch( CacheBatchItem * items, size_t numItems )
+{
+    PROFILE_FUNCTION;
+    SendBatch( CacheProtocol::MSG_PUBLISH, items, numItems );
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::ExistsBatch( CacheBatchItem * items, size_t numItems )
+{
+    PROFILE_FUNCTION;
+    SendBatch( CacheProtocol::MSG_EXISTS, items, numItems );
+}
+
+// FreeMemory
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::FreeMemory( void * data, size_t /*dataSize*/ )
+{
+    FREE( data );
+}
+
+// OutputInfo
+//------------------------------------------------------------------------------
+/*virtual*/ bool NetworkCache::OutputInfo( bool /*showProgress*/ )
+{
+    OUTPUT( "Cache is served by %s:%u (FBuildCacheServer)\n", m_Host.Get(), (uint32_t)m_Port );
+    return true;
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool NetworkCache::Trim( bool /*showProgress*/, uint32_t /*sizeMiB*/ )
+{
+    OUTPUT( "Cache is trimmed by the server (FBuildCacheServer -cachemaxsize)\n" );
+    return false;
+}
+
+// OnReceive
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
+{
+    CacheProtocol::Channel * channel = static_cast< CacheProtocol::Channel * >( connection->GetUserData() );
+    ASSERT( channel );
+
+    CacheProtocol::Message message;
+    switch ( channel->OnReceive( data, size, keepMemory, message ) )
+    {
+        case CacheProtocol::Channel::RECEIVE_INCOMPLETE:
+        {
+            return;
+        }
+        case CacheProtocol::Channel::RECEIVE_INVALID:
+        {
+            Disconnect( connection );
+            return;
+        }
+        case CacheProtocol::Channel::RECEIVE_COMPLETE:
+        {
+            break;
+        }
+    }
+
+    PendingRequest * request = nullptr;
+    {
+        MutexHolder mh( m_Mutex );
+        for ( PendingRequest ** iter = m_PendingRequests.Begin(); iter != m_PendingRequests.End(); ++iter )
+        {
+            if ( ( *iter )->m_RequestId == message.m_RequestId )
+            {
+                request = *iter;
+                m_PendingRequests.Erase( iter );
+                break;
+            }
+        }
+    }
+    if ( request == nullptr )
+    {
+        FREE( message.m_Data ); // Request timed out
+        return;
+    }
+
+    request->m_Success = ( ( message.m_Flags & CacheProtocol::FLAG_SUCCESS ) != 0 );
+    if ( request->m_Success )
+    {
+        request->m_Data = message.m_Data;
+        request->m_DataSize = message.m_DataSize;
+    }
+    else
+    {
+        FREE( message.m_Data );
+    }
+    request->m_Completed.Signal();
+}
+
+// OnDisconnected
+//------------------------------------------------------------------------------
+/*virtual*/ void NetworkCache::OnDisconnected( const ConnectionInfo * connection )
+{
+    CacheProtocol::Channel * channel = static_cast< CacheProtocol::Channel * >( connection->GetUserData() );
+    ASSERT( channel );
+
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Channel == channel )
+        {
+            m_Channel = nullptr;
+        }
+        channel->Close();
+
+        // Fail requests which will never get a response
+        for ( size_t i = 0; i < m_PendingRequests.GetSize(); )
+        {
+            PendingRequest * request = m_PendingRequests[ i ];
+            if ( request->m_Channel == channel )
+            {
+                m_PendingRequests.EraseIndex( i );
+                request->m_Completed.Signal();
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    // Threads still using the channel free it when they're done with it,
+    // rather than blocking this thread until they are
+    connection->SetUserData( nullptr );
+    ReleaseChannel( channel );
+}
+
+// AcquireChannel
+//------------------------------------------------------------------------------
+CacheProtocol::Channel * NetworkCache::AcquireChannel()
+{
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Channel && m_Channel->AddRef() )
+        {
+            return m_Channel;
+        }
+    }
+
+    // Reconnect (one thread at a time, and not too often)
+    MutexHolder connectHolder( m_ConnectMutex );
+    {
+        MutexHolder mh( m_Mutex );
+        if ( m_Channel && m_Channel->AddRef() )
+        {
+            return m_Channel; // Reconnected by another thread
+        }
+    }
+    if ( m_ConnectTimer.GetElapsed() < kReconnectIntervalSecs )
+    {
+        return nullptr;
+    }
+    if ( ConnectToServer() == false )
+    {
+        return nullptr;
+    }
+
+    MutexHolder mh( m_Mutex );
+    if ( m_Channel && m_Channel->AddRef() )
+    {
+        return m_Channel;
+    }
+    return nullptr;
+}
+
+// ConnectToServer
+//------------------------------------------------------------------------------
+bool NetworkCache::ConnectToServer()
+{
+    PROFILE_FUNCTION;
+
+    m_ConnectTimer.Start();
+
+    // The channel's first reference belongs to the connection, released when disconnected
+    CacheProtocol::Channel * channel = FNEW( CacheProtocol::Channel( *this ) );
+    VERIFY( channel->AddRef() );
+    const ConnectionInfo * connection = Connect( m_Host, m_Port, kDefaultConnectionTimeoutMS, channel );
+    if ( connection == nullptr )
+    {
+        channel->Close();
+        channel->Release();
+        ReleaseChannel( channel );
+        return false;
+    }
+    channel->SetConnection( connection );
+
+    // Check the server is compatible before making the connection available
+    void * response = nullptr;
+    size_t responseSize = 0;
+    const uint32_t version = CacheProtocol::CACHE_PROTOCOL_VERSION;
+    bool connected = SendRequest( channel, CacheProtocol::MSG_HELLO, AString::GetEmpty(), &version, sizeof( version ), response, responseSize );
+    FREE( response );
+    {
+        MutexHolder mh( m_Mutex );
+        if ( connected && ( channel->IsClosed() == false ) )
+        {
+            m_Channel = channel;
+        }
+        else
+        {
+            connected = false;
+        }
+    }
+    if ( connected == false )
+    {
+        Disconnect( connection ); // Ok if already disconnected
+    }
+
+    ReleaseChannel( channel );
+    return connected;
+}
+
+// ReleaseChannel
+//------------------------------------------------------------------------------
+/*static*/ void NetworkCache::ReleaseChannel( CacheProtocol::Channel * channel )
+{
+    if ( channel->Release() )
+    {
+        FDELETE channel; // Disconnected, and no longer used
+    }
+}
+
+// SendRequest
+//------------------------------------------------------------------------------
+bool NetworkCache::SendRequest( CacheProtocol::Channel * channel,
+                                CacheProtocol::MessageType msgType,
+                                const AString & cacheId,
+                                const void * data,
+                                size_t dataSize,
+                                void * & outData,
+                                size_t & outDataSize )
+{
+    PendingRequest request;
+    const bool sent = BeginRequest( request, channel, msgType, cacheId, data, dataSize );
+    const bool success = WaitForRequest( request, sent );
+    outData = request.m_Data;
+    outDataSize = request.m_DataSize;
+    return success;
+}
+
+// BeginRequest
+//------------------------------------------------------------------------------
+bool NetworkCache::BeginRequest( PendingRequest & request,
+                                 CacheProtocol::Channel * channel,
+                                 CacheProtocol::MessageType msgType,
+                                 const AString & cacheId,
+                                 const void * data,
+                                 size_t dataSize )
+{
+    request.m_RequestId = AtomicInc( &m_NextRequestId );
+    request.m_Channel = channel;
+    request.m_Success = false;
+    request.m_Data = nullptr;
+    request.m_DataSize = 0;
+    {
+        MutexHolder mh( m_Mutex );
+        m_PendingRequests.Append( &request );
+    }
+
+    // The server drops connections sending larger entries
+    if ( dataSize > CacheProtocol::kMaxBodySize )
+    {
+        return false;
+    }
+
+    // Other threads continue to send while we wait for the response
+    return channel->Send( msgType, 0, request.m_RequestId, cacheId, data, dataSize );
+}
+
+// WaitForRequest
+//------------------------------------------------------------------------------
+bool NetworkCache::WaitForRequest( PendingRequest & request, bool sent )
+{
+    if ( ( sent == false ) || ( request.m_Completed.Wait( kRequestTimeoutMS ) == false ) )
+    {
+        {
+            MutexHolder mh( m_Mutex );
+            if ( m_PendingRequests.FindAndErase( &request ) )
+            {
+                return false; // No response
+            }
+        }
+        request.m_Completed.Wait(); // Response is being handled
+    }
+    return request.m_Success;
+}
+
+// SendBatch
+//------------------------------------------------------------------------------
+void NetworkCache::SendBatch( CacheProtocol::MessageType msgType, CacheBatchItem * items, size_t numItems )
+{
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        items[ i ].m_Result = false;
+        items[ i ].m_Data = nullptr;
+        items[ i ].m_DataSize = 0;
+    }
+
+    CacheProtocol::Channel * channel = AcquireChannel();
+    if ( channel == nullptr )
+    {
+        return;
+    }
+
+    // Send all requests before waiting for any, so the whole batch costs a
+    // single round trip
+    PendingRequest * requests = FNEW_ARRAY( PendingRequest[ numItems ] );
+    bool * sent = FNEW_ARRAY( bool[ numItems ] );
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        const CacheBatchItem & item = items[ i ];
+        const bool publish = ( msgType == CacheProtocol::MSG_PUBLISH );
+        sent[ i ] = BeginRequest( requests[ i ],
+                                  channel,
+                                  msgType,
+                                  *item.m_CacheId,
+                                  publish ? item.m_PublishData : nullptr,
+                                  publish ? item.m_PublishDataSize : 0 );
+    }
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        CacheBatchItem & item = items[ i ];
+        PendingRequest & request = requests[ i ];
+        item.m_Result = WaitForRequest( request, sent[ i ] );
+        if ( msgType == CacheProtocol::MSG_RETRIEVE )
+        {
+            item.m_Data = request.m_Data;
+            item.m_DataSize = request.m_DataSize;
+        }
+        else
+        {
+            FREE( request.m_Data );
+        }
+    }
+    FDELETE_ARRAY sent;
+    FDELETE_ARRAY requests;
+
+    ReleaseChannel( channel );
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,92 @@
+// NetworkCache - Cache served by an FBuildCacheServer
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ICache.h"
+#include "CacheProtocol.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Network/TCPConnectionPool.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// NetworkCache
+//------------------------------------------------------------------------------
+// Used when the cache path is of the form "fbcache://host[:port]". A single
+// connection to the server is kept for the whole build, and shared by all
+// threads: requests are sent without waiting for earlier ones to complete.
+class NetworkCache : public ICache, public TCPConnectionPool
+{
+public:
+    NetworkCache();
+    virtual ~NetworkCache() override;
+
+    static bool IsNetworkCachePath( const AString & cachePath );
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual void FreeMemory( void * data, size_t dataSize ) override;
+    virtual bool OutputInfo( bool showProgress ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void RetrieveBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual void PublishBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual void ExistsBatch( CacheBatchItem * items, size_t numItems ) override;
+    virtual bool SupportsExists() const override { return true; } // Checked by the server
+
+protected:
+    // network events - NOTE: these happen in another thread!
+    virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
+    virtual void OnDisconnected( const ConnectionInfo * connection ) override;
+
+private:
+    struct PendingRequest
+    {
+        uint32_t                    m_RequestId;
+        CacheProtocol::Channel *    m_Channel;
+        Semaphore                   m_Completed;
+        bool                        m_Success;
+        void *                      m_Data;
+        size_t                      m_DataSize;
+    };
+
+    CacheProtocol::Channel * AcquireChannel();
+    static void ReleaseChannel( CacheProtocol::Channel * channel );
+    bool ConnectToServer();
+    bool SendRequest( CacheProtocol::Channel * channel,
+                      CacheProtocol::MessageType msgType,
+                      const AString & cacheId,
+                      const void * data,
+                      size_t dataSize,
+                      void * & outData,
+                      size_t & outDataSize );
+    bool BeginRequest( PendingRequest & request,
+                       CacheProtocol::Channel * channel,
+                       CacheProtocol::MessageType msgType,
+                       const AString & cacheId,
+                       const void * data,
+                       size_t dataSize );
+    bool WaitForRequest( PendingRequest & request, bool sent );
+    void SendBatch( CacheProtocol::MessageType msgType, CacheBatchItem * items, size_t numItems );
+
+    AString                     m_Host;
+    uint16_t                    m_Port;
+    Mutex                       m_ConnectMutex;
+    Timer                       m_ConnectTimer;
+
+    Mutex                       m_Mutex;
+    CacheProtocol::Channel *    m_Channel = nullptr;  // Connected and ready for requests
+    Array< PendingRequest * >   m_PendingRequests;
+    volatile uint32_t           m_NextRequestId = 0;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,861 @@
+// PackedCache - Cache storing entries in pack files
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "PackedCache.h"
+
+// FBuild
+#include "Tools/FBuild/FBuildCore/Cache/CacheTrimmer.h"
+
+// Core
+#include "Core/Containers/Sort.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Network/Network.h"
+#include "Core/Process/Process.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Tracing/Tracing.h"
+
+// system
+#include <string.h> // for memcmp, memcpy
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    constexpr uint32_t kRecordMagic = 0x31524246; // 'FBR1'
+    constexpr uint32_t kIndexMagic = 0x31494246; // 'FBI1'
+    constexpr uint32_t kMaxIdLength = 256;
+
+    // Written at the start of the index of a sealed segment
+    struct IndexHeader
+    {
+        uint32_t    m_Magic;
+        uint32_t    m_NumEntries;
+        uint64_t    m_SegmentSize;
+    };
+
+    // Segments are sealed and a new one started beyond this size
+    constexpr uint64_t kMaxSegmentSize = ( 64 * MEGABYTE );
+
+    // Sealed segments smaller than this are merged when trimming
+    constexpr uint64_t kCompactSegmentSize = ( 16 * MEGABYTE );
+
+    // On a miss, look for entries added by other processes at most this often
+    constexpr float kRefreshIntervalSecs = 5.0f;
+
+    // Entries added to a shard are searched linearly until there are this many,
+    // then sorted and merged into the rest of the index
+    constexpr size_t kMaxUnsortedEntries = 256;
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+/*explicit*/ PackedCache::PackedCache( uint32_t maxSizeMiB )
+    : Cache( maxSizeMiB )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+/*virtual*/ PackedCache::~PackedCache()
+{
+    for ( Shard & shard : m_Shards )
+    {
+        if ( shard.m_WriteStream )
+        {
+            CloseWriteSegment( shard, true );
+        }
+        for ( Segment * segment : shard.m_Segments )
+        {
+            FDELETE segment->m_Stream;
+            FDELETE segment;
+        }
+    }
+}
+
+// Init
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Init( const AString & cachePath,
+                                    const AString & cachePathMountPoint,
+                                    bool cacheRead,
+                                    bool cacheWrite,
+                                    bool cacheVerbose,
+                                    const AString & pluginDLLConfig )
+{
+    PROFILE_FUNCTION;
+
+    // format example: N:\\fbuild.cache\\Packed\\<shard>
+    // (before Cache::Init, which can start trimming)
+    AStackString<> path( cachePath );
+    PathUtils::EnsureTrailingSlash( path );
+    m_PackPath.Format( "%sPacked%c", path.Get(), NATIVE_SLASH );
+
+    // Segments created by this process are named uniquely, so no other process
+    // will ever write to them
+    AStackString<> hostName;
+    Network::GetHostName( hostName );
+    m_WriterId.Format( "%s-%u-%" PRIX64, hostName.Get(), Process::GetCurrentId(), Time::GetCurrentFileTime() );
+
+    return Cache::Init( cachePath, cachePathMountPoint, cacheRead, cacheWrite, cacheVerbose, pluginDLLConfig );
+}
+
+// Shutdown
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::Shutdown()
+{
+    PROFILE_FUNCTION;
+
+    Cache::Shutdown();
+
+    // Seal segments we've written to, so other processes don't need to scan them
+    for ( Shard & shard : m_Shards )
+    {
+        MutexHolder mh( shard.m_Mutex );
+        if ( shard.m_WriteStream )
+        {
+            CloseWriteSegment( shard, true );
+        }
+    }
+}
+
+// Publish
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Publish( const AString & cacheId, const void * data, size_t dataSize )
+{
+    const uint64_t idHash = xxHash::Calc64( cacheId );
+    const uint32_t shardIndex = (uint32_t)( idHash % kNumShards );
+    Shard & shard = m_Shards[ shardIndex ];
+
+    RecordHeader header;
+    header.m_Magic = kRecordMagic;
+    header.m_IdLength = cacheId.GetLength();
+    header.m_DataSize = dataSize;
+
+    {
+        MutexHolder mh( shard.m_Mutex );
+        if ( AppendRecord( shard, shardIndex, idHash, header, cacheId.Get(), data ) == false )
+        {
+            return false;
+        }
+    }
+
+    if ( m_Trimmer )
+    {
+        m_Trimmer->OnPublish( shardIndex, sizeof( RecordHeader ) + header.m_IdLength + dataSize );
+    }
+    return true;
+}
+
+// Retrieve
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Retrieve( const AString & cacheId, void * & data, size_t & dataSize )
+{
+    data = nullptr;
+    dataSize = 0;
+    return Lookup( cacheId, &data, dataSize );
+}
+
+// ExistsBatch
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::ExistsBatch( CacheBatchItem * items, size_t numItems )
+{
+    // Only the record headers are read
+    for ( size_t i = 0; i < numItems; ++i )
+    {
+        size_t dataSize = 0;
+        items[ i ].m_Result = Lookup( *items[ i ].m_CacheId, nullptr, dataSize );
+    }
+}
+
+// Lookup
+//------------------------------------------------------------------------------
+bool PackedCache::Lookup( const AString & cacheId, void ** outData, size_t & outDataSize )
+{
+    const uint64_t idHash = xxHash::Calc64( cacheId );
+    const uint32_t shardIndex = (uint32_t)( idHash % kNumShards );
+    Shard & shard = m_Shards[ shardIndex ];
+
+    MutexHolder mh( shard.m_Mutex );
+
+    bool refreshed = false;
+    if ( shard.m_Loaded == false )
+    {
+        RefreshShard( shard, shardIndex );
+        refreshed = true;
+    }
+
+    for ( ;; )
+    {
+        if ( FindEntry( shard, idHash, cacheId, outData, outDataSize ) )
+        {
+            return true;
+        }
+
+        // Look for entries from other processes, unless we've done so recently
+        if ( refreshed || ( ( m_Timer.GetElapsed() - shard.m_LastRefreshTime ) < kRefreshIntervalSecs ) )
+        {
+            return false;
+        }
+        RefreshShard( shard, shardIndex );
+        refreshed = true;
+    }
+}
+
+// Trim
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::Trim( bool showProgress, uint32_t sizeMiB )
+{
+    // Delete the oldest segments
+    Cache::Trim( showProgress, sizeMiB );
+
+    // Merge what remains
+    uint32_t numMerged = 0;
+    for ( uint32_t i = 0; i < kNumShards; ++i )
+    {
+        numMerged += CompactShard( i );
+    }
+    OUTPUT( " - Compacted: %u Files\n", numMerged );
+    return true;
+}
+
+// GetBucketFiles
+//------------------------------------------------------------------------------
+/*virtual*/ void PackedCache::GetBucketFiles( uint32_t bucket, Array< FileIO::FileInfo > & outInfo, const volatile bool * /*abort*/ ) const
+{
+    // Only a handful of files per shard
+    Array< AString > patterns( 1, false );
+    patterns.EmplaceBack( "*.fpk" );
+    AStackString<> path;
+    GetShardPath( bucket, path );
+    Array< FileIO::FileInfo > files;
+    FileIO::GetFilesEx( path, &patterns, false, &files );
+
+    // Segments this process is appending to are not candidates
+    for ( FileIO::FileInfo & info : files )
+    {
+        if ( info.m_Name.Find( m_WriterId.Get() ) == nullptr )
+        {
+            outInfo.Append( Move( info ) );
+        }
+    }
+}
+
+// DeleteCacheFile
+//------------------------------------------------------------------------------
+/*virtual*/ bool PackedCache::DeleteCacheFile( const AString & fileName ) const
+{
+    if ( FileIO::FileDelete( fileName.Get() ) == false )
+    {
+        return false; // In use
+    }
+
+    // Segments still being written have no index
+    AStackString<> indexFileName;
+    GetIndexFileName( fileName, indexFileName );
+    FileIO::FileDelete( indexFileName.Get() );
+    return true;
+}
+
+// GetShardPath
+//------------------------------------------------------------------------------
+void PackedCache::GetShardPath( uint32_t shardIndex, AString & outPath ) const
+{
+    // format example: N:\\fbuild.cache\\Packed\\AB\\<segment>
+    outPath.Format( "%s%02X%c", m_PackPath.Get(), shardIndex, NATIVE_SLASH );
+}
+
+// RefreshShard
+//------------------------------------------------------------------------------
+void PackedCache::RefreshShard( Shard & shard, uint32_t shardIndex )
+{
+    PROFILE_FUNCTION;
+
+    shard.m_Loaded = true;
+    shard.m_LastRefreshTime = m_Timer.GetElapsed();
+
+    // Find new segments, and forget those which have been deleted
+    AStackString<> path;
+    GetShardPath( shardIndex, path );
+    Array< AString > files;
+    FileIO::GetFiles( path, AStackString<>( "*.fpk" ), false, &files );
+    Array< bool > removed( shard.m_Segments.GetSize(), false );
+    for ( size_t i = 0; i < shard.m_Segments.GetSize(); ++i )
+    {
+        // Segment being written by this process is always kept
+        removed.Append( ( shard.m_WriteStream == nullptr ) || ( i != shard.m_WriteSegment ) );
+    }
+    Array< AString > newFiles( files.GetSize(), false );
+    for ( AString & file : files )
+    {
+        bool known = false;
+        for ( size_t i = 0; i < shard.m_Segments.GetSize(); ++i )
+        {
+            if ( shard.m_Segments[ i ]->m_FileName == file )
+            {
+                removed[ i ] = false;
+                known = true;
+                break;
+            }
+        }
+        if ( known == false )
+        {
+            newFiles.Append( Move( file ) );
+        }
+    }
+    PruneSegments( shard, removed );
+    for ( AString & file : newFiles )
+    {
+        Segment * segment = FNEW( Segment );
+        segment->m_FileName = Move( file );
+        segment->m_IndexedSize = 0;
+        segment->m_Sealed = false;
+        segment->m_Stream = nullptr;
+        shard.m_Segments.Append( segment );
+    }
+
+    // Index new records (our own are indexed as they are written)
+    for ( size_t i = 0; i < shard.m_Segments.GetSize(); ++i )
+    {
+        const bool isWriteSegment = ( shard.m_WriteStream && ( i == shard.m_WriteSegment ) );
+        if ( ( shard.m_Segments[ i ]->m_Sealed == false ) && ( isWriteSegment == false ) )
+        {
+            IndexSegment( shard, (uint32_t)i );
+        }
+    }
+}
+
+// IndexSegment
+//------------------------------------------------------------------------------
+void PackedCache::IndexSegment( Shard & shard, uint32_t segmentIndex )
+{
+    Segment & segment = *shard.m_Segments[ segmentIndex ];
+
+    // Use the index written when the segment was sealed, if available
+    AStackString<> indexFileName;
+    GetIndexFileName( segment.m_FileName, indexFileName );
+    Array< IndexEntry > entries;
+    uint64_t segmentSize = 0;
+    if ( LoadSegmentIndex( indexFileName, entries, segmentSize ) )
+    {
+        for ( IndexEntry & entry : entries )
+        {
+            if ( entry.m_Offset >= segment.m_IndexedSize )
+            {
+                entry.m_Segment = segmentIndex;
+                shard.m_Index.Append( entry );
+            }
+        }
+        segment.m_IndexedSize = segmentSize;
+        segment.m_Sealed = true;
+        return;
+    }
+
+    // Otherwise the segment is being written (or the writer never finished), so
+    // scan the records added since we last looked
+    FileStream f;
+    if ( f.Open( segment.m_FileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return;
+    }
+    const uint64_t fileSize = f.GetFileSize();
+    uint64_t pos = segment.m_IndexedSize;
+    while ( ( pos + sizeof( RecordHeader ) ) <= fileSize )
+    {
+        RecordHeader header;
+        char id[ kMaxIdLength ];
+        if ( ( f.Seek( pos ) == false ) ||
+             ( f.ReadBuffer( &header, sizeof( header ) ) != sizeof( header ) ) )
+        {
+            break;
+        }
+        const uint64_t recordSize = ( sizeof( RecordHeader ) + header.m_IdLength + header.m_DataSize );
+        if ( ( header.m_Magic != kRecordMagic ) || ( header.m_IdLength > kMaxIdLength ) || ( recordSize > 0xFFFFFFFF ) )
+        {
+            // Either corrupt, or a header not yet visible to us (e.g. over a network
+            // share), so look again next time. Only the index seals a segment.
+            break;
+        }
+        if ( ( pos + recordSize ) > fileSize )
+        {
+            break; // Still being written
+        }
+        if ( f.ReadBuffer( id, header.m_IdLength ) != header.m_IdLength )
+        {
+            break;
+        }
+
+        IndexEntry & entry = shard.m_Index.EmplaceBack();
+        entry.m_IdHash = xxHash::Calc64( id, header.m_IdLength );
+        entry.m_Offset = pos;
+        entry.m_Size = (uint32_t)recordSize;
+        entry.m_Segment = segmentIndex;
+
+        pos += recordSize;
+    }
+    segment.m_IndexedSize = pos;
+}
+
+// PruneSegments
+//------------------------------------------------------------------------------
+void PackedCache::PruneSegments( Shard & shard, const Array< bool > & removed )
+{
+    ASSERT( removed.GetSize() == shard.m_Segments.GetSize() );
+
+    // Renumber the remaining segments
+    const uint32_t kRemoved = 0xFFFFFFFF;
+    Array< uint32_t > remap( shard.m_Segments.GetSize(), false );
+    Array< Segment * > segments( shard.m_Segments.GetSize(), false );
+    for ( size_t i = 0; i < shard.m_Segments.GetSize(); ++i )
+    {
+        Segment * segment = shard.m_Segments[ i ];
+        if ( removed[ i ] )
+        {
+            FDELETE segment->m_Stream;
+            FDELETE segment;
+            remap.Append( kRemoved );
+            continue;
+        }
+        remap.Append( (uint32_t)segments.GetSize() );
+        segments.Append( segment );
+    }
+    if ( segments.GetSize() == shard.m_Segments.GetSize() )
+    {
+        return; // Nothing removed
+    }
+    shard.m_Segments.Swap( segments );
+
+    // Drop entries in removed segments (keeping the order, so sorted entries remain so)
+    size_t numEntries = 0;
+    size_t numSortedEntries = 0;
+    for ( size_t i = 0; i < shard.m_Index.GetSize(); ++i )
+    {
+        IndexEntry entry = shard.m_Index[ i ];
+        entry.m_Segment = remap[ entry.m_Segment ];
+        if ( entry.m_Segment == kRemoved )
+        {
+            continue;
+        }
+        shard.m_Index[ numEntries++ ] = entry;
+        numSortedEntries += ( i < shard.m_NumSortedEntries ) ? 1 : 0;
+    }
+    shard.m_Index.SetSize( numEntries );
+    shard.m_NumSortedEntries = numSortedEntries;
+
+    // Segment being written by this process is never removed
+    if ( shard.m_WriteStream )
+    {
+        shard.m_WriteSegment = remap[ shard.m_WriteSegment ];
+        ASSERT( shard.m_WriteSegment != kRemoved );
+        for ( IndexEntry & entry : shard.m_WriteIndex )
+        {
+            entry.m_Segment = shard.m_WriteSegment;
+        }
+    }
+}
+
+// MergeIndex
+//------------------------------------------------------------------------------
+/*static*/ void PackedCache::MergeIndex( Shard & shard )
+{
+    Array< IndexEntry > & index = shard.m_Index;
+    if ( shard.m_NumSortedEntries == index.GetSize() )
+    {
+        return;
+    }
+
+    // Sort the entries added since last time
+    IndexEntry * const added = ( index.Begin() + shard.m_NumSortedEntries );
+    QuickSort( added, index.End(), AscendingCompare() );
+
+    // Merge with the rest
+    if ( shard.m_NumSortedEntries > 0 )
+    {
+        Array< IndexEntry > merged( index.GetSize(), false );
+        const IndexEntry * a = index.Begin();
+        const IndexEntry * b = added;
+        while ( ( a < added ) && ( b < index.End() ) )
+        {
+            merged.Append( ( *b < *a ) ? *b++ : *a++ );
+        }
+        while ( a < added )
+        {
+            merged.Append( *a++ );
+        }
+        while ( b < index.End() )
+        {
+            merged.Append( *b++ );
+        }
+        index.Swap( merged );
+    }
+    shard.m_NumSortedEntries = index.GetSize();
+}
+
+// FindEntry
+//------------------------------------------------------------------------------
+bool PackedCache::FindEntry( Shard & shard, uint64_t idHash, const AString & cacheId, void ** outData, size_t & outDataSize )
+{
+    if ( ( shard.m_Index.GetSize() - shard.m_NumSortedEntries ) > kMaxUnsortedEntries )
+    {
+        MergeIndex( shard );
+    }
+
+    // Find the first sorted entry with this hash
+    size_t low = 0;
+    size_t high = shard.m_NumSortedEntries;
+    while ( low < high )
+    {
+        const size_t mid = ( low + high ) / 2;
+        if ( shard.m_Index[ mid ].m_IdHash < idHash )
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    // There can be several (duplicates from different writers or hash collisions),
+    // and more amongst the entries not yet sorted
+    for ( size_t i = low; i < shard.m_Index.GetSize(); ++i )
+    {
+        const IndexEntry & entry = shard.m_Index[ i ];
+        if ( entry.m_IdHash != idHash )
+        {
+            if ( i < shard.m_NumSortedEntries )
+            {
+                i = ( shard.m_NumSortedEntries - 1 ); // Continue with unsorted entries
+            }
+            continue;
+        }
+
+        RecordHeader header;
+        char id[ kMaxIdLength ];
+        if ( ReadRecord( shard, entry, &cacheId, header, id, outData ) )
+        {
+            // Caller owns the returned memory (if any)
+            outDataSize = (size_t)header.m_DataSize;
+            if ( m_Trimmer )
+            {
+                m_Trimmer->OnRetrieve( shard.m_Segments[ entry.m_Segment ]->m_FileName );
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// ReadRecord
+//------------------------------------------------------------------------------
+bool PackedCache::ReadRecord( Shard & shard, const IndexEntry & entry, const AString * expectedId, RecordHeader & outHeader, char * outId, void ** outData ) const
+{
+    Segment & segment = *shard.m_Segments[ entry.m_Segment ];
+
+    // Fails if deleted by a trim, or still open for write by another process (Windows)
+    if ( segment.m_Stream == nullptr )
+    {
+        FileStream * stream = FNEW( FileStream );
+        if ( stream->Open( segment.m_FileName.Get(), FileStream::READ_ONLY ) == false )
+        {
+            FDELETE stream;
+            return false;
+        }
+        segment.m_Stream = stream;
+    }
+    FileStream & f = *segment.m_Stream;
+
+    // Check the record is as indexed
+    if ( ( f.Seek( entry.m_Offset ) == false ) ||
+         ( f.ReadBuffer( &outHeader, sizeof( outHeader ) ) != sizeof( outHeader ) ) ||
+         ( outHeader.m_Magic != kRecordMagic ) ||
+         ( outHeader.m_IdLength > kMaxIdLength ) ||
+         ( ( sizeof( RecordHeader ) + outHeader.m_IdLength + outHeader.m_DataSize ) != entry.m_Size ) ||
+         ( f.ReadBuffer( outId, outHeader.m_IdLength ) != outHeader.m_IdLength ) )
+    {
+        return false; // Corrupt, or deleted by another machine
+    }
+
+    // Check it's the entry we're looking for (and not a hash collision)
+    if ( expectedId &&
+         ( ( outHeader.m_IdLength != expectedId->GetLength() ) ||
+           ( memcmp( outId, expectedId->Get(), outHeader.m_IdLength ) != 0 ) ) )
+    {
+        return false;
+    }
+
+    // Data is only read if wanted
+    if ( outData == nullptr )
+    {
+        return true;
+    }
+    const size_t dataSize = (size_t)outHeader.m_DataSize;
+    void * data = ALLOC( dataSize );
+    if ( f.ReadBuffer( data, dataSize ) != dataSize )
+    {
+        FREE( data );
+        return false;
+    }
+    *outData = data;
+    return true;
+}
+
+// AppendRecord
+//------------------------------------------------------------------------------
+bool PackedCache::AppendRecord( Shard & shard, uint32_t shardIndex, uint64_t idHash, const RecordHeader & header, const void * id, const void * data )
+{
+    const uint64_t recordSize = ( sizeof( RecordHeader ) + header.m_IdLength + header.m_DataSize );
+    if ( ( header.m_IdLength > kMaxIdLength ) || ( recordSize > 0xFFFFFFFF ) )
+    {
+        return false;
+    }
+
+    // Start a new segment if the current one is full
+    if ( shard.m_WriteStream && ( ( shard.m_WriteSize + recordSize ) > kMaxSegmentSize ) )
+    {
+        CloseWriteSegment( shard, true );
+    }
+    if ( shard.m_WriteStream == nullptr )
+    {
+        AStackString<> path;
+        GetShardPath( shardIndex, path );
+        if ( FileIO::EnsurePathExists( path ) == false )
+        {
+            return false;
+        }
+
+        // format example: N:\\fbuild.cache\\Packed\\AB\\<host>-<pid>-<time>-0.fpk
+        AStackString<> fileName;
+        fileName.Format( "%s%s-%u.fpk", path.Get(), m_WriterId.Get(), shard.m_WriteSequence++ );
+        FileStream * stream = FNEW( FileStream );
+        if ( stream->Open( fileName.Get(), FileStream::WRITE_ONLY ) == false )
+        {
+            FDELETE stream;
+            return false;
+        }
+
+        Segment * segment = FNEW( Segment );
+        segment->m_FileName = fileName;
+        segment->m_IndexedSize = 0;
+        segment->m_Sealed = false;
+        segment->m_Stream = nullptr;
+        shard.m_WriteSegment = (uint32_t)shard.m_Segments.GetSize();
+        shard.m_Segments.Append( segment );
+        shard.m_WriteStream = stream;
+        shard.m_WriteSize = 0;
+    }
+
+    // Readers in other processes ignore the record until it is complete
+    const bool ok = ( shard.m_WriteStream->WriteBuffer( &header, sizeof( header ) ) == sizeof( header ) ) &&
+                    ( shard.m_WriteStream->WriteBuffer( id, header.m_IdLength ) == header.m_IdLength ) &&
+                    ( shard.m_WriteStream->WriteBuffer( data, header.m_DataSize ) == header.m_DataSize );
+    if ( ok == false )
+    {
+        // Partially written record would prevent further use of the segment
+        CloseWriteSegment( shard, false );
+        return false;
+    }
+
+    IndexEntry entry;
+    entry.m_IdHash = idHash;
+    entry.m_Offset = shard.m_WriteSize;
+    entry.m_Size = (uint32_t)recordSize;
+    entry.m_Segment = shard.m_WriteSegment;
+    shard.m_WriteIndex.Append( entry );
+    shard.m_Index.Append( entry );
+
+    shard.m_WriteSize += recordSize;
+    shard.m_Segments[ shard.m_WriteSegment ]->m_IndexedSize = shard.m_WriteSize;
+    return true;
+}
+
+// CloseWriteSegment
+//------------------------------------------------------------------------------
+void PackedCache::CloseWriteSegment( Shard & shard, bool writeIndex )
+{
+    shard.m_WriteStream->Close();
+    FDELETE shard.m_WriteStream;
+    shard.m_WriteStream = nullptr;
+
+    Segment & segment = *shard.m_Segments[ shard.m_WriteSegment ];
+    segment.m_Sealed = true;
+
+    // Allow other processes to load the index rather than scanning the segment
+    // (ok to fail - they will scan it instead)
+    if ( writeIndex )
+    {
+        AStackString<> indexFileName;
+        GetIndexFileName( segment.m_FileName, indexFileName );
+        SaveSegmentIndex( indexFileName, shard.m_WriteIndex, shard.m_WriteSize );
+    }
+
+    shard.m_WriteIndex.Clear();
+    shard.m_WriteSize = 0;
+}
+
+// CompactShard
+//------------------------------------------------------------------------------
+uint32_t PackedCache::CompactShard( uint32_t shardIndex )
+{
+    Shard & shard = m_Shards[ shardIndex ];
+    MutexHolder mh( shard.m_Mutex );
+    RefreshShard( shard, shardIndex );
+
+    // Find small segments which are complete
+    Array< bool > merge( shard.m_Segments.GetSize(), false );
+    uint32_t numToMerge = 0;
+    for ( const Segment * segment : shard.m_Segments )
+    {
+        const bool small = ( segment->m_Sealed && ( segment->m_IndexedSize < kCompactSegmentSize ) );
+        merge.Append( small );
+        numToMerge += small ? 1 : 0;
+    }
+    if ( numToMerge < 2 )
+    {
+        return 0;
+    }
+
+    // Take the entries to copy (index is modified as they are appended)
+    MergeIndex( shard );
+    Array< IndexEntry > entries( shard.m_Index.GetSize(), true );
+    for ( const IndexEntry & entry : shard.m_Index )
+    {
+        if ( merge[ entry.m_Segment ] )
+        {
+            entries.Append( entry );
+        }
+    }
+
+    // Copy into new segment(s), dropping duplicates (adjacent, as sorted by hash)
+    const IndexEntry * previous = nullptr;
+    for ( const IndexEntry & entry : entries )
+    {
+        if ( previous && ( previous->m_IdHash == entry.m_IdHash ) )
+        {
+            continue;
+        }
+
+        RecordHeader header;
+        char id[ kMaxIdLength ];
+        void * data = nullptr;
+        if ( ReadRecord( shard, entry, nullptr, header, id, &data ) == false )
+        {
+            continue; // Deleted by another process - nothing to preserve
+        }
+        const bool appended = AppendRecord( shard, shardIndex, entry.m_IdHash, header, id, data );
+        FREE( data );
+        if ( appended == false )
+        {
+            // Leave the originals in place
+            if ( shard.m_WriteStream )
+            {
+                CloseWriteSegment( shard, true );
+            }
+            return 0;
+        }
+        previous = &entry;
+    }
+    if ( shard.m_WriteStream )
+    {
+        CloseWriteSegment( shard, true );
+    }
+
+    // Delete the originals (not the segments created above)
+    Array< bool > deleted( shard.m_Segments.GetSize(), false );
+    uint32_t numDeleted = 0;
+    for ( size_t i = 0; i < shard.m_Segments.GetSize(); ++i )
+    {
+        bool ok = false;
+        if ( ( i < merge.GetSize() ) && merge[ i ] )
+        {
+            Segment * segment = shard.m_Segments[ i ];
+            FDELETE segment->m_Stream; // Can't delete an open file on Windows
+            segment->m_Stream = nullptr;
+            ok = DeleteCacheFile( segment->m_FileName );
+        }
+        deleted.Append( ok );
+        numDeleted += ok ? 1 : 0;
+    }
+    PruneSegments( shard, deleted );
+    return numDeleted;
+}
+
+// LoadSegmentIndex
+//------------------------------------------------------------------------------
+/*static*/ bool PackedCache::LoadSegmentIndex( const AString & indexFileName, Array< IndexEntry > & outEntries, uint64_t & outSegmentSize )
+{
+    FileStream f;
+    if ( f.Open( indexFileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+
+    IndexHeader header;
+    if ( ( f.ReadBuffer( &header, sizeof( header ) ) != sizeof( header ) ) ||
+         ( header.m_Magic != kIndexMagic ) )
+    {
+        return false;
+    }
+    const uint64_t entriesSize = ( (uint64_t)header.m_NumEntries * sizeof( IndexEntry ) );
+    if ( f.GetFileSize() != ( sizeof( header ) + entriesSize ) )
+    {
+        return false;
+    }
+
+    outEntries.SetSize( header.m_NumEntries );
+    if ( f.ReadBuffer( outEntries.Begin(), entriesSize ) != entriesSize )
+    {
+        return false;
+    }
+    outSegmentSize = header.m_SegmentSize;
+    return true;
+}
+
+// SaveSegmentIndex
+//------------------------------------------------------------------------------
+/*static*/ bool PackedCache::SaveSegmentIndex( const AString & indexFileName, const Array< IndexEntry > & entries, uint64_t segmentSize )
+{
+    // Write to a tmp file so readers never see a partial index
+    AStackString<> indexFileNameTmp( indexFileName );
+    indexFileNameTmp += ".tmp";
+    FileStream f;
+    if ( f.Open( indexFileNameTmp.Get(), FileStream::WRITE_ONLY ) == false )
+    {
+        return false;
+    }
+
+    IndexHeader header;
+    header.m_Magic = kIndexMagic;
+    header.m_NumEntries = (uint32_t)entries.GetSize();
+    header.m_SegmentSize = segmentSize;
+    const uint64_t entriesSize = ( entries.GetSize() * sizeof( IndexEntry ) );
+    const bool ok = ( f.WriteBuffer( &header, sizeof( header ) ) == sizeof( header ) ) &&
+                    ( f.WriteBuffer( entries.Begin(), entriesSize ) == entriesSize );
+    f.Close();
+
+    if ( ok && FileIO::FileMove( indexFileNameTmp, indexFileName ) )
+    {
+        return true;
+    }
+    FileIO::FileDelete( indexFileNameTmp.Get() );
+    return false;
+}
+
+// GetIndexFileName
+//------------------------------------------------------------------------------
+/*static*/ void PackedCache::GetIndexFileName( const AString & segmentFileName, AString & outIndexFileName )
+{
+    // <segment>.fpk -> <segment>.fidx
+    ASSERT( segmentFileName.EndsWith( ".fpk" ) );
+    outIndexFileName = segmentFileName;
+    outIndexFileName.SetLength( segmentFileName.GetLength() - 4 );
+    outIndexFileName += ".fidx";
+}
+
+//------------------------------------------------------------------------------
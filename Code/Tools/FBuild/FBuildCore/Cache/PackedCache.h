@@ -0,0 +1,122 @@
+// PackedCache - Cache storing entries in pack files
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Cache.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+#include "Core/Time/Timer.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class FileStream;
+
+// PackedCache
+//------------------------------------------------------------------------------
+// Rather than one file per entry, entries are appended to segment files, split
+// into 256 shards by cache id. Each process appends only to segments it created,
+// so concurrent writers (on any machine) never need to coordinate. When a segment
+// is complete an index is written alongside it (sealing it); segments still being
+// written are indexed by scanning their records. Entries are read with explicit
+// reads rather than mapping, so a segment deleted by another machine (over a
+// network share) causes a failed read rather than a fault.
+//
+// Trimming deletes whole segments (least recently used first) and then compacts
+// small segments (typically created by short builds) into larger ones. Shards
+// are the buckets trimmed incrementally by a CacheTrimmer.
+class PackedCache : public Cache
+{
+public:
+    explicit PackedCache( uint32_t maxSizeMiB = 0 );
+    virtual ~PackedCache() override;
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override;
+    virtual void Shutdown() override;
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override;
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override;
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override;
+    virtual void ExistsBatch( CacheBatchItem * items, size_t numItems ) override;
+
+protected:
+    virtual void GetBucketFiles( uint32_t bucket, Array< FileIO::FileInfo > & outInfo, const volatile bool * abort ) const override;
+    virtual bool DeleteCacheFile( const AString & fileName ) const override;
+    virtual bool IsFilterSupported() const override { return false; } // Lookups only read indices
+
+private:
+    // Written before each entry in a segment
+    struct RecordHeader
+    {
+        uint32_t    m_Magic;
+        uint32_t    m_IdLength;
+        uint64_t    m_DataSize;
+    };
+    struct IndexEntry
+    {
+        uint64_t    m_IdHash;
+        uint64_t    m_Offset;       // Start of record within the segment
+        uint32_t    m_Size;         // Size of the whole record
+        uint32_t    m_Segment;      // Index into Shard::m_Segments (not meaningful on disk)
+
+        bool operator < ( const IndexEntry & other ) const { return ( m_IdHash < other.m_IdHash ); }
+    };
+    struct Segment
+    {
+        AString             m_FileName;
+        uint64_t            m_IndexedSize;  // Records up to here are in the index
+        bool                m_Sealed;       // Complete (index written) - will not grow further
+        FileStream *        m_Stream;       // Opened on first read
+    };
+    struct Shard
+    {
+        Mutex                   m_Mutex;
+        bool                    m_Loaded = false;
+        float                   m_LastRefreshTime = 0.0f;
+        Array< Segment * >      m_Segments;
+        Array< IndexEntry >     m_Index;            // Sorted by id hash up to m_NumSortedEntries, then as added
+        size_t                  m_NumSortedEntries = 0;
+
+        // Segment being appended to by this process
+        FileStream *            m_WriteStream = nullptr;
+        uint32_t                m_WriteSegment = 0;
+        uint64_t                m_WriteSize = 0;
+        uint32_t                m_WriteSequence = 0;
+        Array< IndexEntry >     m_WriteIndex;       // Written alongside the segment when sealed
+    };
+
+    void GetShardPath( uint32_t shardIndex, AString & outPath ) const;
+
+    // Shard must be locked
+    void RefreshShard( Shard & shard, uint32_t shardIndex );
+    void IndexSegment( Shard & shard, uint32_t segmentIndex );
+    void PruneSegments( Shard & shard, const Array< bool > & removed );
+    static void MergeIndex( Shard & shard );
+    bool Lookup( const AString & cacheId, void ** outData, size_t & outDataSize ); // outData: nullptr to check existence only
+    bool FindEntry( Shard & shard, uint64_t idHash, const AString & cacheId, void ** outData, size_t & outDataSize );
+    bool ReadRecord( Shard & shard, const IndexEntry & entry, const AString * expectedId, RecordHeader & outHeader, char * outId, void ** outData ) const;
+    bool AppendRecord( Shard & shard, uint32_t shardIndex, uint64_t idHash, const RecordHeader & header, const void * id, const void * data );
+    void CloseWriteSegment( Shard & shard, bool writeIndex );
+
+    uint32_t CompactShard( uint32_t shardIndex );
+
+    static bool LoadSegmentIndex( const AString & indexFileName, Array< IndexEntry > & outEntries, uint64_t & outSegmentSize );
+    static bool SaveSegmentIndex( const AString & indexFileName, const Array< IndexEntry > & entries, uint64_t segmentSize );
+    static void GetIndexFileName( const AString & segmentFileName, AString & outIndexFileName );
+
+    enum : uint32_t { kNumShards = 256 };
+
+    AString     m_PackPath;
+    AString     m_WriterId;     // Unique to this process - names segments we create
+    Timer       m_Timer;
+    Shard       m_Shards[ kNumShards ];
+};
+
+//------------------------------------------------------------------------------
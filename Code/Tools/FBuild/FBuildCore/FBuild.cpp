@@ -11,13 +11,21 @@
 #include "Cache/ICache.h"
 #include "Cache/Cache.h"
 #include "Cache/CachePlugin.h"
+#include "Cache/CachePrefetcher.h"
+#include "Cache/CachePublisher.h"
+#include "Cache/LayeredCache.h"
 #include "Cache/LightCache.h"
+#include "Cache/NetworkCache.h"
+#include "Cache/PackedCache.h"
+#include "Graph/CompilerNode.h"
 #include "Graph/Node.h"
 #include "Graph/NodeGraph.h"
 #include "Graph/NodeProxy.h"
 #include "Graph/SettingsNode.h"
 #include "Helpers/BuildProfiler.h"
 #include "Helpers/CompilationDatabase.h"
+#include "Helpers/Compressor.h"
+#include "Helpers/FileChangeJournal.h"
 #include "Helpers/Report.h"
 #include "Protocol/Client.h"
 #include "Protocol/Protocol.h"
@@ -60,12 +68,16 @@ FBuild::FBuild( const FBuildOptions & options )
     , m_JobQueue( nullptr )
     , m_Client( nullptr )
     , m_Cache( nullptr )
+    , m_CachePrefetcher( nullptr )
+    , m_CachePublisher( nullptr )
+    , m_CacheDictionary( nullptr )
     , m_LastProgressOutputTime( 0.0f )
     , m_LastProgressCalcTime( 0.0f )
     , m_SmoothedProgressCurrent( 0.0f )
     , m_SmoothedProgressTarget( 0.0f )
     , m_EnvironmentString( nullptr )
     , m_EnvironmentStringSize( 0 )
+    , m_ProcessEnvironmentHash( 0 )
     , m_ImportedEnvironmentVars( 0, true )
 {
     #ifdef DEBUG_CRT_MEMORY_USAGE
@@ -107,6 +119,9 @@ FBuild::~FBuild()
 
     Function::Destroy();
 
+    FDELETE m_CachePrefetcher;
+    FDELETE m_CachePublisher;
+    FDELETE m_CacheDictionary;
     FDELETE m_DependencyGraph;
     FDELETE m_Client;
     FREE( m_EnvironmentString );
@@ -139,6 +154,8 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
     PROFILE_FUNCTION;
     BuildProfilerScope buildProfileScope( "Initialize" );
 
+    m_ProcessEnvironmentHash = GetProcessEnvironmentHash();
+
     // handle working dir
     if ( !FileIO::SetCurrentDir( m_Options.GetWorkingDir() ) )
     {
@@ -189,9 +206,27 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         {
             m_Cache = FNEW( CachePlugin( settings->GetCachePluginDLL() ) );
         }
+        else if ( NetworkCache::IsNetworkCachePath( settings->GetCachePath() ) )
+        {
+            m_Cache = FNEW( NetworkCache() );
+        }
+        else if ( settings->GetCachePacked() )
+        {
+            m_Cache = FNEW( PackedCache( settings->GetCacheMaxSizeMiB() ) );
+        }
         else
         {
-            m_Cache = FNEW( Cache() );
+            m_Cache = FNEW( Cache( settings->GetCacheMaxSizeMiB(), settings->GetCacheDedupMinSizeMiB() ) );
+        }
+
+        // Local tiers in front of the shared cache?
+        if ( ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite ) &&
+             ( ( settings->GetCachePathLocal().IsEmpty() == false ) || ( settings->GetCacheMemorySizeMiB() > 0 ) ) )
+        {
+            m_Cache = FNEW( LayeredCache( m_Cache,
+                                          settings->GetCachePathLocal(),
+                                          settings->GetCacheLocalSizeMiB(),
+                                          settings->GetCacheMemorySizeMiB() ) );
         }
 
         if ( m_Cache->Init( settings->GetCachePath(),
@@ -208,6 +243,115 @@ bool FBuild::Initialize( const char * nodeGraphDBFile )
         }
     }
 
+    // compress cache entries referring to a dictionary?
+    if ( m_Cache && ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite ) && ( m_Options.m_CacheDictionaryFile.IsEmpty() == false ) )
+    {
+        m_CacheDictionary = FNEW( CompressionDictionary() );
+        if ( m_CacheDictionary->Load( m_Options.m_CacheDictionaryFile ) == false )
+        {
+            FLOG_WARN( "Cache dictionary inaccessible - Dictionary disabled (File '%s')", m_Options.m_CacheDictionaryFile.Get() );
+            FDELETE m_CacheDictionary;
+            m_CacheDictionary = nullptr;
+        }
+    }
+
+    // retrieve likely cache hits ahead of the workers
+    if ( m_Cache && m_Options.m_UseCacheRead && ( m_Options.m_CachePrefetchThreads > 0 ) )
+    {
+        m_CachePrefetcher = FNEW( CachePrefetcher( m_Cache, m_Options.m_CachePrefetchThreads ) );
+    }
+
+    // publish to the cache in the background
+    if ( m_Cache && m_Options.m_UseCacheWrite )
+    {
+        m_CachePublisher = FNEW( CachePublisher() );
+    }
+
+    return true;
+}
+
+// GetProcessEnvironmentHash
+//------------------------------------------------------------------------------
+/*static*/ uint64_t FBuild::GetProcessEnvironmentHash()
+{
+    // Order of variables is not significant
+    Array< AString > environment( 128, true );
+    Env::GetEnvironment( environment );
+    environment.Sort();
+    AString allVars( 32 * 1024 );
+    for ( const AString & envVar : environment )
+    {
+        allVars += envVar;
+        allVars += '\n';
+    }
+    return xxHash::Calc64( allVars );
+}
+
+// ReuseForBuild
+//------------------------------------------------------------------------------
+bool FBuild::ReuseForBuild( const FBuildOptions & options )
+{
+    PROFILE_FUNCTION;
+
+    ASSERT( m_DependencyGraph );
+
+    // Options used during initialization (including those consumed by
+    // Initialize() and the constructor) must match
+    if ( ( options.GetWorkingDir() != m_Options.GetWorkingDir() ) ||
+         ( options.m_ConfigFile != m_Options.m_ConfigFile ) ||
+         ( options.m_UseCacheRead != m_Options.m_UseCacheRead ) ||
+         ( options.m_UseCacheWrite != m_Options.m_UseCacheWrite ) ||
+         ( options.m_CacheInfo != m_Options.m_CacheInfo ) ||
+         ( options.m_CacheTrim != m_Options.m_CacheTrim ) ||
+         ( ( options.m_UseCacheRead || options.m_UseCacheWrite ) && ( options.m_CacheVerbose != m_Options.m_CacheVerbose ) ) ||
+         ( ( options.m_UseCacheRead || options.m_UseCacheWrite ) && ( options.m_CacheDictionaryFile != m_Options.m_CacheDictionaryFile ) ) ||
+         ( options.m_UseCacheRead && ( options.m_CachePrefetchThreads != m_Options.m_CachePrefetchThreads ) ) ||
+         ( options.m_ForceDBMigration_Debug != m_Options.m_ForceDBMigration_Debug ) ||
+         options.m_Profile || m_Options.m_Profile )
+    {
+        return false;
+    }
+
+    // The environment is used to parse the bff (#import etc.) and is inherited by
+    // processes spawned during the build
+    if ( GetProcessEnvironmentHash() != m_ProcessEnvironmentHash )
+    {
+        return false;
+    }
+
+    // The cache dictionary can be modified without its file name changing, and
+    // determines cache keys
+    if ( m_Cache && ( m_Options.m_UseCacheRead || m_Options.m_UseCacheWrite ) && ( m_Options.m_CacheDictionaryFile.IsEmpty() == false ) )
+    {
+        CompressionDictionary dictionary;
+        const uint64_t dictionaryId = dictionary.Load( m_Options.m_CacheDictionaryFile ) ? dictionary.GetId() : 0;
+        if ( dictionaryId != ( m_CacheDictionary ? m_CacheDictionary->GetId() : 0 ) )
+        {
+            return false;
+        }
+    }
+
+    // Modified bff files (or changes to files checked with file_exists) need
+    // the graph to be loaded/parsed again
+    bool added;
+    if ( m_DependencyGraph->HaveUsedFilesChanged() ||
+         m_FileExistsInfo.CheckForChanges( added ) )
+    {
+        return false;
+    }
+
+    m_Options = options;
+
+    // poke options where required
+    FLog::SetShowVerbose( m_Options.m_ShowVerbose );
+    FLog::SetShowBuildReason( m_Options.m_ShowBuildReason );
+    FLog::SetShowErrors( m_Options.m_ShowErrors );
+    FLog::SetShowProgress( m_Options.m_ShowProgress );
+    FLog::SetMonitorEnabled( m_Options.m_EnableMonitor );
+
+    m_BuildStats = FBuildStats();
+    m_DependencyGraph->ResetBuildState();
+    LightCache::ClearChangedFiles();
     return true;
 }
 
@@ -333,11 +477,15 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
     }
 
     // try to open the file
+    // (write to a temp file and replace the DB with it, since the DB is memory
+    // mapped when loaded, and a mapped file must not be truncated)
+    AStackString<> tmpFileName( nodeGraphDBFile );
+    tmpFileName += ".tmp";
     FileStream fileStream;
-    if ( fileStream.Open( nodeGraphDBFile, FileStream::WRITE_ONLY ) == false )
+    if ( fileStream.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false )
     {
         // failing to open the dep graph for saving is a serious problem
-        FLOG_ERROR( "Failed to open DepGraph for saving '%s'", nodeGraphDBFile );
+        FLOG_ERROR( "Failed to open DepGraph for saving '%s'", tmpFileName.Get() );
         return false;
     }
 
@@ -345,10 +493,22 @@ bool FBuild::SaveDependencyGraph( const char * nodeGraphDBFile ) const
     if ( fileStream.Write( memoryStream.GetData(), memoryStream.GetSize() ) != memoryStream.GetSize() )
     {
         FLOG_ERROR( "Saving DepGraph FAILED!" );
+        fileStream.Close();
+        FileIO::FileDelete( tmpFileName.Get() );
         return false;
     }
     fileStream.Close();
 
+    if ( FileIO::FileMove( tmpFileName, fileName ) == false )
+    {
+        FLOG_ERROR( "Failed to replace DepGraph. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
+        FileIO::FileDelete( tmpFileName.Get() );
+        return false;
+    }
+
+    // save tokenized bff files alongside the DB, for faster reparsing
+    m_DependencyGraph->SaveTokenCache( nodeGraphDBFile );
+
     FLOG_VERBOSE( "Saving DepGraph Complete in %2.3fs", (double)t.GetElapsed() );
     return true;
 }
@@ -380,10 +540,28 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
 
         // Worker list from Settings takes priority
         Array< AString > workers( settings->GetWorkerList() );
+        bool workerListIsRanked = false;
         if ( workers.IsEmpty() )
         {
+            // toolchains we'll use, so the coordinator can favor workers which have them
+            Array< uint64_t > toolIds;
+            const size_t numNodes = m_DependencyGraph->GetNodeCount();
+            for ( size_t i = 0; i < numNodes; ++i )
+            {
+                const Node * node = m_DependencyGraph->GetNodeByIndex( i );
+                if ( node->GetType() == Node::COMPILER_NODE )
+                {
+                    const CompilerNode * compilerNode = node->CastTo< CompilerNode >();
+                    if ( compilerNode->CanBeDistributed() && ( compilerNode->GetManifest().GetToolId() != 0 ) )
+                    {
+                        toolIds.Append( compilerNode->GetManifest().GetToolId() );
+                    }
+                }
+            }
+
             // check for workers through brokerage or environment
-            m_WorkerBrokerage.FindWorkers( workers );
+            m_WorkerBrokerage.FindWorkers( workers, toolIds );
+            workerListIsRanked = m_WorkerBrokerage.IsWorkerListRanked();
         }
 
         if ( workers.IsEmpty() )
@@ -394,7 +572,7 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
         else
         {
             OUTPUT( "Distributed Compilation : %u Workers in pool '%s'\n", (uint32_t)workers.GetSize(), m_WorkerBrokerage.GetBrokerageRootPaths().Get() );
-            m_Client = FNEW( Client( workers, m_Options.m_DistributionPort, settings->GetWorkerConnectionLimit(), m_Options.m_DistVerbose ) );
+            m_Client = FNEW( Client( workers, m_Options.m_DistributionPort, settings->GetWorkerConnectionLimit(), m_Options.m_DistVerbose, workerListIsRanked ) );
         }
     }
 
@@ -416,6 +594,26 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
         BuildProfiler::Get().StartMetricsGathering();
     }
 
+    // prioritize work on the longest chains of dependencies
+    NodeGraph::ComputeCriticalPath( nodeToBuild, m_Options.m_ShowCriticalPath );
+
+    // obtain stamps of input files in parallel, rather than as they are reached
+    {
+        // files known to be unchanged by a watcher (-watch) don't need checking
+        AStackString<> journalFileName;
+        FileChangeJournal::GetJournalFileName( m_DependencyGraphFile.Get(), journalFileName );
+        FileChangeJournal journal;
+        const bool useJournal = journal.Load( journalFileName.Get() );
+        if ( useJournal )
+        {
+            FLOG_VERBOSE( "Using file change journal '%s'", journalFileName.Get() );
+        }
+        m_DependencyGraph->ScanFileStamps( nodeToBuild,
+                                           m_Options.m_NumWorkerThreads,
+                                           useJournal ? &journal : nullptr,
+                                           m_Options.m_ContentStamps ? &m_FileStampCache : nullptr );
+    }
+
     bool stopping( false );
 
     // keep doing build passes until completed/failed
@@ -497,6 +695,18 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
         FDELETE m_JobQueue;
         m_JobQueue = nullptr;
 
+        // wait for background cache stores
+        if ( m_CachePublisher )
+        {
+            m_CachePublisher->Flush( m_Options.m_CachePublishTimeoutSecs * 1000 );
+        }
+
+        // discard unused prefetches
+        if ( m_CachePrefetcher )
+        {
+            m_CachePrefetcher->Clear();
+        }
+
         FLog::StopBuild();
     }
 
@@ -517,12 +727,54 @@ void FBuild::SaveDependencyGraph( MemoryStream & stream, const char* nodeGraphDB
     // TODO:C Move this into BuildStats
     const float timeTaken = m_Timer.GetElapsed();
     m_BuildStats.m_TotalBuildTime = timeTaken;
+    if ( m_Cache )
+    {
+        m_BuildStats.m_HasCacheTiers = m_Cache->GetTierStats( m_BuildStats.m_CacheTierStats );
+    }
 
     m_BuildStats.OnBuildStop( nodeToBuild );
 
     return ( nodeToBuild->GetState() == Node::UP_TO_DATE );
 }
 
+// WatchForChanges
+//------------------------------------------------------------------------------
+bool FBuild::WatchForChanges()
+{
+    // Watch all input files known to the graph
+    Array< const AString * > fileNames( 4096, true );
+    const size_t numNodes = m_DependencyGraph->GetNodeCount();
+    for ( size_t i = 0; i < numNodes; ++i )
+    {
+        const Node * node = m_DependencyGraph->GetNodeByIndex( i );
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            fileNames.Append( &node->GetName() );
+        }
+    }
+
+    AStackString<> journalFileName;
+    FileChangeJournal::GetJournalFileName( m_DependencyGraphFile.Get(), journalFileName );
+
+    AtomicStoreRelaxed( &s_StopBuild, false );
+    OUTPUT( "FBuild: Watching %u files for changes. Press Ctrl-C to stop.\n", (uint32_t)fileNames.GetSize() );
+    while ( GetStopBuild() == false )
+    {
+        FileChangeJournal journal;
+        if ( journal.StartWatching( journalFileName.Get(), fileNames ) == false )
+        {
+            return false;
+        }
+
+        // If changes are lost (too many to track), start again with a new
+        // snapshot. Builds in the meantime will check all files.
+        while ( ( GetStopBuild() == false ) && journal.Update( 500 ) )
+        {
+        }
+    }
+    return true;
+}
+
 // SetEnvironmentString
 //------------------------------------------------------------------------------
 void FBuild::SetEnvironmentString( const char * envString, uint32_t size, const AString & libEnvVar )
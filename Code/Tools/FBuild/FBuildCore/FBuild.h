@@ -9,6 +9,7 @@
 #include "Tools/FBuild/FBuildCore/FBuildOptions.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Helpers/FBuildStats.h"
+#include "Helpers/FileStampCache.h"
 #include "WorkerPool/WorkerBrokerage.h"
 
 #include "Core/Containers/Array.h"
@@ -19,7 +20,10 @@
 
 // Forward Declarations
 //------------------------------------------------------------------------------
+class CachePrefetcher;
+class CachePublisher;
 class Client;
+class CompressionDictionary;
 class Dependencies;
 class FileStream;
 class ICache;
@@ -40,12 +44,19 @@ public:
     // OR a previously saved NodeGraph DB (if available/matching the BFF)
     bool Initialize( const char * nodeGraphDBFile = nullptr );
 
+    // prepare an initialized graph for another build with new options (-daemon)
+    // returns false if the graph must be initialized again instead
+    bool ReuseForBuild( const FBuildOptions & options );
+
     // build a target
     bool Build( const char * target );
     bool Build( const AString & target );
     bool Build( const Array< AString > & targets );
     virtual bool Build( Node * nodeToBuild ); // Virtual to allow for testing
 
+    // record changes to input files for subsequent builds (until stopped)
+    bool WatchForChanges();
+
     // after a build we can store progress/parsed rules for next time
     bool SaveDependencyGraph( const char * nodeGraphDBFile ) const;
     void SaveDependencyGraph( MemoryStream & memorySteam, const char* nodeGraphDBFile ) const;
@@ -89,6 +100,8 @@ public:
     bool AddFileExistsCheck( const AString & fileName );
     BFFFileExists & GetFileExistsInfo() { return m_FileExistsInfo; }
 
+    FileStampCache & GetFileStampCache() { return m_FileStampCache; }
+
     BFFUserFunctions & GetUserFunctions() { return m_UserFunctions; }
 
     void GetLibEnvVar( AString & libEnvVar ) const;
@@ -105,6 +118,9 @@ public:
     static inline volatile bool * GetAbortBuildPointer() { return &s_AbortBuild; }
 
     inline ICache * GetCache() const { return m_Cache; }
+    inline CachePrefetcher * GetCachePrefetcher() const { return m_CachePrefetcher; }
+    inline CachePublisher * GetCachePublisher() const { return m_CachePublisher; }
+    inline const CompressionDictionary * GetCacheDictionary() const { return m_CacheDictionary; }
 
     static bool GetTempDir( AString & outTempDir );
 
@@ -114,10 +130,14 @@ public:
     uint32_t GetNumWorkerConnections() const;
 
 protected:
+    friend class BuildDaemon;
+
     bool GetTargets( const Array< AString > & targets, Dependencies & outDeps ) const;
 
     void UpdateBuildStatus( const Node * node );
 
+    static uint64_t GetProcessEnvironmentHash();
+
     static bool s_StopBuild;
     static volatile bool s_AbortBuild;  // -fastcancel - TODO:C merge with StopBuild
 
@@ -128,6 +148,9 @@ protected:
 
     AString m_DependencyGraphFile;
     ICache * m_Cache;
+    CachePrefetcher * m_CachePrefetcher;
+    CachePublisher * m_CachePublisher;
+    CompressionDictionary * m_CacheDictionary;
 
     Timer m_Timer;
     float m_LastProgressOutputTime;
@@ -147,10 +170,12 @@ protected:
     char *      m_EnvironmentString;
     uint32_t    m_EnvironmentStringSize; // size excluding last null
     AString     m_LibEnvVar; // LIB= value
+    uint64_t    m_ProcessEnvironmentHash; // environment the graph was initialized in
 
     Array< EnvironmentVarAndHash > m_ImportedEnvironmentVars;
     BFFFileExists m_FileExistsInfo;
     BFFUserFunctions m_UserFunctions;
+    FileStampCache m_FileStampCache;
 };
 
 //------------------------------------------------------------------------------
@@ -126,6 +126,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_UseCacheWrite = true;
                 continue;
             }
+            else if ( thisArg == "-cachefilter" )
+            {
+                m_CacheFilter = true;
+                continue;
+            }
             else if ( thisArg == "-cacheinfo" )
             {
                 m_CacheInfo = true;
@@ -148,6 +153,40 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-cacheprefetchthreads" )
+            {
+                const int sizeIndex = ( i + 1 );
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[ sizeIndex ], "%u", &m_CachePrefetchThreads ) ) != 1 )
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <threads> for '-cacheprefetchthreads' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
+            else if ( thisArg == "-cachepublishtimeout" )
+            {
+                const int sizeIndex = ( i + 1 );
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[ sizeIndex ], "%u", &m_CachePublishTimeoutSecs ) ) != 1 )
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <seconds> for '-cachepublishtimeout' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
             else if ( thisArg == "-cacheverbose" )
             {
                 m_CacheVerbose = true;
@@ -173,6 +212,25 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-cachedictionary" )
+            {
+                const int32_t pathIndex = ( i + 1 );
+                if ( pathIndex >= argc )
+                {
+                    OUTPUT( "FBuild: Error: Missing <file> for '-cachedictionary' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                m_CacheDictionaryFile = argv[ pathIndex ];
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += '"'; // surround file with quotes to avoid problems with spaces in the path
+                m_Args += m_CacheDictionaryFile;
+                m_Args += '"';
+                continue;
+            }
             else if ( thisArg == "-distcompressionlevel" )
             {
                 const int sizeIndex = ( i + 1 );
@@ -193,6 +251,26 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += argv[ sizeIndex ];
                 continue;
             }
+            else if ( thisArg == "-distresultchunk" )
+            {
+                const int sizeIndex = ( i + 1 );
+                uint32_t chunkSizeKiB;
+                if ( ( sizeIndex >= argc ) ||
+                     ( AString::ScanS( argv[sizeIndex], "%u", &chunkSizeKiB ) != 1 ) ||
+                     ( chunkSizeKiB > 0xFFFF ) ) // Sent to workers as 16 bits
+                {
+                    OUTPUT( "FBuild: Error: Missing or bad <sizeKiB> for '-distresultchunk' argument\n" );
+                    OUTPUT( "Try \"%s -help\"\n", programName.Get() );
+                    return OPTIONS_ERROR;
+                }
+                m_DistributionResultChunkSizeKiB = static_cast<uint16_t>( chunkSizeKiB );
+                i++; // skip extra arg we've consumed
+
+                // add to args we might pass to subprocess
+                m_Args += ' ';
+                m_Args += argv[ sizeIndex ];
+                continue;
+            }
             else if ( thisArg == "-clean" )
             {
                 m_ForceCleanBuild = true;
@@ -222,6 +300,16 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_Args += '"';
                 continue;
             }
+            else if ( thisArg == "-contentstamps" )
+            {
+                m_ContentStamps = true;
+                continue;
+            }
+            else if ( thisArg == "-daemon" )
+            {
+                m_Daemon = true;
+                continue;
+            }
             #if defined( __WINDOWS__ )
                 else if ( thisArg == "-debug" )
                 {
@@ -365,6 +453,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_ShowCommandOutput = true;
                 continue;
             }
+            else if ( thisArg == "-showcriticalpath" )
+            {
+                m_ShowCriticalPath = true;
+                continue;
+            }
             else if ( thisArg == "-showdeps" )
             {
                 m_DisplayDependencyDB = true;
@@ -405,6 +498,11 @@ FBuildOptions::OptionsResult FBuildOptions::ProcessCommandLine( int argc, char *
                 m_WaitMode = true;
                 continue;
             }
+            else if ( thisArg == "-watch" )
+            {
+                m_Watch = true;
+                continue;
+            }
             else if ( thisArg == "-why" )
             {
                 m_ShowBuildReason = true;
@@ -598,14 +696,32 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "                   - <= -1 : less compression, with -128 being the lowest\n"
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
+            " -cachedictionary <file>\n"
+            "                   Compress cache artifacts referring to the end of <file>\n"
+            "                   (such as a typical object file).\n"
+            " -cachefilter      Skip retrieving entries not in the filter written to the\n"
+            "                   cache by -cachetrim.\n"
             " -cacheinfo        Output cache statistics.\n"
+            " -cacheprefetchthreads <threads>\n"
+            "                   Threads retrieving likely cache hits ahead of\n"
+            "                   compilation (default: 8, 0 to disable).\n"
+            " -cachepublishtimeout <seconds>\n"
+            "                   Limit time waiting for background cache stores at the\n"
+            "                   end of the build (default: 0 - no limit).\n"
             " -cachetrim <size> Trim the cache to the given size in MiB.\n"
             " -cacheverbose     Emit details about cache interactions.\n"
             " -clean            Force a clean build.\n"
             " -compdb           Generate JSON compilation database for targets.\n"
-            " -config <path>    Explicitly specify the config file to use.\n"
+            " -config <path>    Explicitly specify the config file to use. Tokens of\n"
+            "                   unchanged config files without preprocessor directives\n"
+            "                   are cached next to the database (<fdb>.tokens).\n"
+            " -contentstamps    Detect changes to files using hashes of their contents,\n"
+            "                   instead of last write times.\n"
             " -continueafterdbmove\n"
             "       Allow builds after a DB move.\n"
+            " -daemon           (Linux/OSX) Stay resident, keeping the dependency graph\n"
+            "                   loaded to perform subsequent builds in the same working\n"
+            "                   dir (forwarded by fbuild), until Ctrl-C.\n"
             " -debug            (Windows) Break at startup, to attach debugger.\n"
             " -dist             Allow distributed compilation.\n"
             " -distverbose      Print detailed info for distributed compilation.\n"
@@ -614,6 +730,9 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             "                   - <= -1 : less compression, with -128 being the lowest\n"
             "                   - ==  0 : disable compression\n"
             "                   - >=  1 : more compression, with 12 being the highest\n"
+            " -distresultchunk <sizeKiB>\n"
+            "                   Stream larger results back from workers in chunks of this\n"
+            "                   size (default: 1024). 0 disables streaming.\n"
             " -dot[full]        Emit known dependency tree info for specified targets to an\n"
             "                   fbuild.gv file in DOT format.\n"
             " -fixuperrorpaths  Reformat error paths to be Visual Studio friendly.\n"
@@ -637,6 +756,7 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -report           Ouput report.html at build end. (Increases build time)\n"
             " -showcmds         Show command lines used to launch external processes.\n"
             " -showcmdoutput    Show output of external processes.\n"
+            " -showcriticalpath Show the critical path predicted from previous build times.\n"
             " -showdeps         Show known dependency tree for specified targets.\n"
             " -showtargets      Display primary targets, excluding those marked \"Hidden\".\n"
             " -showalltargets   Display primary targets, including those marked \"Hidden\".\n"
@@ -646,6 +766,8 @@ void FBuildOptions::DisplayHelp( const AString & programName ) const
             " -vs               VisualStudio mode. Same as -ide.\n"
             " -wait             Wait for a previous build to complete before starting.\n"
             "                   (Slower than building both targets in one invocation).\n"
+            " -watch            (Linux) After building, record changes to input files\n"
+            "                   to speed up subsequent builds, until Ctrl-C.\n"
             " -why              Show build reason for each item.\n"
             " -wrapper          (Windows) Spawn a sub-process to gracefully handle\n"
             "                   termination from Visual Studio.\n"
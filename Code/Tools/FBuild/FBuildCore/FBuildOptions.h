@@ -54,6 +54,9 @@ public:
     bool        m_StopOnFirstError                  = true;
     bool        m_FastCancel                        = true;
     bool        m_WaitMode                          = false;
+    bool        m_Watch                             = false;
+    bool        m_Daemon                            = false;
+    bool        m_ContentStamps                     = false;
     bool        m_DisplayTargetList                 = false;
     bool        m_ShowHiddenTargets                 = false;
     bool        m_DisplayDependencyDB               = false;
@@ -67,8 +70,12 @@ public:
     bool        m_UseCacheWrite                     = false;
     bool        m_CacheInfo                         = false;
     bool        m_CacheVerbose                      = false;
+    bool        m_CacheFilter                       = false; // Skip lookups which the cache's filter rules out
     uint32_t    m_CacheTrim                         = 0;
     int16_t     m_CacheCompressionLevel             = -1; // See Compresssor.h
+    uint32_t    m_CachePublishTimeoutSecs           = 0; // 0 = wait for all background stores
+    uint32_t    m_CachePrefetchThreads              = 8; // 0 = disable prefetching
+    AString     m_CacheDictionaryFile;                   // Empty = no dictionary
 
     // Distributed Compilation
     bool        m_AllowDistributed                  = false;
@@ -77,6 +84,7 @@ public:
     bool        m_AllowLocalRace                    = true;
     uint16_t    m_DistributionPort                  = Protocol::PROTOCOL_PORT;
     int16_t     m_DistributionCompressionLevel      = -1; // See Compresssor.h
+    uint16_t    m_DistributionResultChunkSizeKiB    = 1024; // Larger results are streamed back in chunks of this size (0 = disabled)
 
     // General Output
     bool        m_ShowVerbose                       = false;
@@ -84,6 +92,7 @@ public:
     bool        m_ShowCommandSummary                = true;
     bool        m_ShowCommandLines                  = false;
     bool        m_ShowCommandOutput                 = false;
+    bool        m_ShowCriticalPath                  = false;
     bool        m_ShowErrors                        = true;
     bool        m_ShowProgress                      = false;
     bool        m_ShowSummary                       = false;
@@ -87,7 +87,7 @@ CopyFileNode::~CopyFileNode() = default;
         }
         dstStamp = srcStamp;
     }
-    m_Stamp = dstStamp;
+    m_Stamp = FBuild::Get().GetOptions().m_ContentStamps ? GetFileStamp( m_Name ) : dstStamp;
     return NODE_RESULT_OK;
 }
 
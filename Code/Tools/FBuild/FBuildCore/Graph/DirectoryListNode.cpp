@@ -144,6 +144,7 @@ DirectoryListNode::~DirectoryListNode() = default;
     Array< FileIO::FileInfo > files( 4096, true );
     FileIO::GetFilesEx( m_Path, &m_Patterns, m_Recursive, &files );
 
+    m_Files.Clear(); // Node may be built again if the graph is kept in memory (-daemon)
     m_Files.SetCapacity( files.GetSize() );
 
     // filter exclusions
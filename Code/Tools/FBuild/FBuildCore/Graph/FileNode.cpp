@@ -9,7 +9,6 @@
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 
 // Core
-#include "Core/FileIO/FileIO.h"
 #include "Core/Strings/AStackString.h"
 
 #include <string.h> // for strstr
@@ -45,7 +44,7 @@ FileNode::~FileNode() = default;
 /*virtual*/ Node::BuildResult FileNode::DoBuild( Job * /*job*/ )
 {
     // NOTE: Not calling RecordStampFromBuiltFile as this is not a built file
-    m_Stamp = FileIO::GetFileLastWriteTime( m_Name );
+    m_Stamp = GetFileStamp( m_Name );
     // Don't assert m_Stamp != 0 as input file might not exist
     return NODE_RESULT_OK;
 }
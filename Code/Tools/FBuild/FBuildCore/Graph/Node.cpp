@@ -167,20 +167,20 @@ Node::~Node() = default;
     // Handle missing or modified files
     if ( IsAFile() )
     {
-        const uint64_t lastWriteTime = FileIO::GetFileLastWriteTime( m_Name );
+        const uint64_t fileStamp = GetFileStamp( m_Name );
 
-        if ( lastWriteTime == 0 )
+        if ( fileStamp == 0 )
         {
             // file is missing on disk
             FLOG_BUILD_REASON( "Need to build '%s' (missing)\n", GetName().Get() );
             return true;
         }
 
-        if ( lastWriteTime != m_Stamp )
+        if ( fileStamp != m_Stamp )
         {
             // on disk file doesn't match our file
             // (modified by some external process)
-            FLOG_BUILD_REASON( "Need to build '%s' (externally modified - stamp = %" PRIu64 ", disk = %" PRIu64 ")\n", GetName().Get(), m_Stamp, lastWriteTime );
+            FLOG_BUILD_REASON( "Need to build '%s' (externally modified - stamp = %" PRIu64 ", disk = %" PRIu64 ")\n", GetName().Get(), m_Stamp, fileStamp );
             return true;
         }
     }
@@ -237,6 +237,25 @@ bool Node::DetermineNeedToBuild( const Dependencies & deps ) const
     return false;
 }
 
+// HaveDependenciesChanged
+//------------------------------------------------------------------------------
+/*static*/ bool Node::HaveDependenciesChanged( const Dependencies & deps )
+{
+    for ( const Dependency & dep : deps )
+    {
+        if ( dep.IsWeak() )
+        {
+            continue;
+        }
+        const uint64_t stamp = dep.GetNode()->GetStamp();
+        if ( ( stamp == 0 ) || ( stamp != dep.GetNodeStamp() ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 // DoBuild
 //------------------------------------------------------------------------------
 /*virtual*/ Node::BuildResult Node::DoBuild( Job * /*job*/ )
@@ -1179,10 +1198,29 @@ bool Node::InitializePreBuildDependencies( NodeGraph & nodeGraph, const BFFToken
     return inoutCachedEnvString;
 }
 
+// GetFileStamp
+//------------------------------------------------------------------------------
+/*static*/ uint64_t Node::GetFileStamp( const AString & fileName )
+{
+    if ( FBuild::IsValid() && FBuild::Get().GetOptions().m_ContentStamps )
+    {
+        return FBuild::Get().GetFileStampCache().GetStamp( fileName );
+    }
+    return FileIO::GetFileLastWriteTime( fileName );
+}
+
 // RecordStampFromBuiltFile
 //------------------------------------------------------------------------------
 void Node::RecordStampFromBuiltFile()
 {
+    // With content stamps, a rebuilt file which is identical to the previous
+    // one keeps the same stamp, so dependent nodes don't need to be rebuilt
+    if ( FBuild::IsValid() && FBuild::Get().GetOptions().m_ContentStamps )
+    {
+        m_Stamp = FBuild::Get().GetFileStampCache().GetStamp( m_Name );
+        return;
+    }
+
     m_Stamp = FileIO::GetFileLastWriteTime( m_Name );
     
     // An external tool might fail to write a file. Higher level code checks for
@@ -102,6 +102,8 @@ public:
         STATS_BUILT_REMOTE  = 0x40, // node was built remotely
         STATS_FAILED        = 0x80, // node needed building, but failed
         STATS_FIRST_BUILD   = 0x100,// node has never been built before
+        STATS_CACHE_FILTERED= 0x200,// cache miss known from the cache filter, without a lookup
+        STATS_INPUTS_UNCHANGED  = 0x400,// needs building only because of its output (or -clean), inputs are as last built
         STATS_REPORT_PROCESSED  = 0x4000, // seen during report processing
         STATS_STATS_PROCESSED   = 0x8000 // mark during stats gathering (leave this last)
     };
@@ -164,6 +166,7 @@ public:
     static bool DoPreBuildFileDeletion( const AString & fileName );
 
     inline uint64_t GetStamp() const { return m_Stamp; }
+    static uint64_t GetFileStamp( const AString & fileName ); // Last write time, or hash of contents (-contentstamps)
 
     inline uint32_t GetIndex() const { return m_Index; }
 
@@ -201,6 +204,8 @@ protected:
     friend class NodeGraph;
     friend class ProjectGeneratorBase; // TODO:C Remove this
     friend class Report;
+    friend class TestGraph;
+    friend class TestJobQueue;
     friend class VSProjectConfig; // TODO:C Remove this
     friend class WorkerThread;
     friend class CompilationDatabase;
@@ -226,6 +231,7 @@ protected:
     virtual bool Finalize( NodeGraph & nodeGraph );
 
     bool DetermineNeedToBuild( const Dependencies & deps ) const;
+    static bool HaveDependenciesChanged( const Dependencies & deps ); // as above, without reporting why
 
     void SetLastBuildTime( uint32_t ms );
     inline void     AddProcessingTime( uint32_t ms )  { m_ProcessingTime += ms; }
@@ -268,7 +274,7 @@ protected:
         mutable bool    m_IsSaved = false;          // Help catch serialization errors
     #endif
     // Note: Unused byte here
-    uint32_t            m_RecursiveCost = 0;        // Recursive cost used during task ordering
+    uint32_t            m_RecursiveCost = 0;        // Longest chain of build times from here to the target (for task ordering)
     Node *              m_Next = nullptr;           // Node map in-place linked list pointer
     uint32_t            m_NameCRC;                  // Hash of mName. **Set by constructor**
     uint32_t            m_LastBuildTimeMs = 0;      // Time it took to do last known full build of this node
@@ -276,11 +282,14 @@ protected:
     uint32_t            m_CachingTime = 0;          // Time spent caching this node
     mutable uint32_t    m_ProgressAccumulator = 0;  // Used to estimate build progress percentage
     uint32_t            m_Index = INVALID_NODE_INDEX;   // Index into flat array of all nodes
+    uint32_t            m_PendingDependencies = 0;  // Incomplete dependencies this node is waiting on
 
     Dependencies        m_PreBuildDependencies;
     Dependencies        m_StaticDependencies;
     Dependencies        m_DynamicDependencies;
 
+    Array< Node * >     m_WaitingNodes;             // Nodes to notify when this node completes
+
     // Static Data
     static const char * const s_NodeTypeNames[];
 };
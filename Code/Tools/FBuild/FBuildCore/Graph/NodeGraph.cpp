@@ -7,9 +7,12 @@
 
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionSettings.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenCache.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/MetaData/Meta_IgnoreForComparison.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileChangeJournal.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileStampCache.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 
 #include "AliasNode.h"
@@ -43,11 +46,14 @@
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryMappedFile.h"
 #include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Math/CRC32.h"
 #include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Reflection/ReflectedProperty.h"
@@ -60,6 +66,23 @@
 // Defines
 //------------------------------------------------------------------------------
 
+// ScanFileStampsContext
+//------------------------------------------------------------------------------
+namespace
+{
+    // Work shared by threads obtaining file stamps in parallel
+    struct ScanFileStampsContext
+    {
+        const Array< const AString * > *    m_FileNames;
+        Array< uint64_t > *                 m_Stamps;
+        FileStampCache *                    m_StampCache; // Content stamps (-contentstamps)
+        volatile uint32_t                   m_NextBatch;
+    };
+
+    // Number of files each thread takes at a time
+    const uint32_t kScanFileStampsBatchSize = 256;
+}
+
 // Static Data
 //------------------------------------------------------------------------------
 /*static*/ uint32_t NodeGraph::s_BuildPassTag( 0 );
@@ -85,6 +108,7 @@ NodeGraph::NodeGraph()
 , m_NextNodeIndex( 0 )
 , m_UsedFiles( 16, true )
 , m_Settings( nullptr )
+, m_TokenCache( nullptr )
 {
     m_NodeMap = FNEW_ARRAY( Node *[NODEMAP_TABLE_SIZE] );
     memset( m_NodeMap, 0, sizeof( Node * ) * NODEMAP_TABLE_SIZE );
@@ -107,6 +131,8 @@ NodeGraph::~NodeGraph()
     }
 
     FDELETE_ARRAY( m_NodeMap );
+
+    FDELETE( m_TokenCache );
 }
 
 // Initialize
@@ -164,7 +190,7 @@ NodeGraph::~NodeGraph()
             // Create a fresh DB by parsing the BFF
             FDELETE( oldNG );
             NodeGraph * newNG = FNEW( NodeGraph );
-            if ( newNG->ParseFromRoot( bffFile ) == false )
+            if ( newNG->ParseFromRoot( bffFile, nodeGraphDBFile ) == false )
             {
                 FDELETE( newNG );
                 return nullptr; // ParseFromRoot will have emitted an error
@@ -175,7 +201,7 @@ NodeGraph::~NodeGraph()
         {
             // Create a fresh DB by parsing the modified BFF
             NodeGraph * newNG = FNEW( NodeGraph );
-            if ( newNG->ParseFromRoot( bffFile ) == false )
+            if ( newNG->ParseFromRoot( bffFile, nodeGraphDBFile ) == false )
             {
                 FDELETE( newNG );
                 FDELETE( oldNG );
@@ -201,12 +227,20 @@ NodeGraph::~NodeGraph()
 
 // ParseFromRoot
 //------------------------------------------------------------------------------
-bool NodeGraph::ParseFromRoot( const char * bffFile )
+bool NodeGraph::ParseFromRoot( const char * bffFile, const char * nodeGraphDBFile )
 {
     ASSERT( m_UsedFiles.IsEmpty() ); // NodeGraph cannot be recycled
 
+    // Re-use tokens from the last parse for unchanged files
+    ASSERT( m_TokenCache == nullptr );
+    m_TokenCache = FNEW( BFFTokenCache );
+    AStackString<> tokenCacheFile;
+    BFFTokenCache::GetCacheFileName( nodeGraphDBFile, tokenCacheFile );
+    m_TokenCache->Load( tokenCacheFile.Get() );
+
     // re-parse the BFF from scratch, clean build will result
     BFFParser bffParser( *this );
+    bffParser.SetTokenCache( m_TokenCache );
     const bool ok = bffParser.ParseFromFile( bffFile );
     if ( ok )
     {
@@ -231,22 +265,33 @@ bool NodeGraph::ParseFromRoot( const char * bffFile )
 //------------------------------------------------------------------------------
 NodeGraph::LoadResult NodeGraph::Load( const char * nodeGraphDBFile )
 {
-    // Open previously saved DB
-    FileStream fs;
-    if ( fs.Open( nodeGraphDBFile, FileStream::READ_ONLY ) == false )
+    // Map previously saved DB into memory, avoiding an up-front read and copy.
+    // The DB is replaced rather than rewritten when saved (see
+    // FBuild::SaveDependencyGraph) so the mapped file is never truncated.
+    MemoryMappedFile file;
+    UniquePtr< char > memory;
+    ConstMemoryStream ms;
+    if ( file.Open( nodeGraphDBFile ) )
     {
-        return LoadResult::MISSING_OR_INCOMPATIBLE;
+        ms.Replace( file.GetData(), file.GetSize(), false );
     }
-
-    // Read it into memory to avoid lots of tiny disk accesses
-    const size_t fileSize = (size_t)fs.GetFileSize();
-    UniquePtr< char > memory( (char *)ALLOC( fileSize ) );
-    if ( fs.ReadBuffer( memory.Get(), fileSize ) != fileSize )
+    else
     {
-        FLOG_ERROR( "Could not read Database. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
-        return LoadResult::LOAD_ERROR;
+        // Fall back to reading it into memory if it can't be mapped
+        FileStream fs;
+        if ( fs.Open( nodeGraphDBFile, FileStream::READ_ONLY ) == false )
+        {
+            return LoadResult::MISSING_OR_INCOMPATIBLE;
+        }
+        const size_t fileSize = (size_t)fs.GetFileSize();
+        memory = (char *)ALLOC( fileSize );
+        if ( fs.ReadBuffer( memory.Get(), fileSize ) != fileSize )
+        {
+            FLOG_ERROR( "Could not read Database. Error: %s File: '%s'", LAST_ERROR_STR, nodeGraphDBFile );
+            return LoadResult::LOAD_ERROR;
+        }
+        ms.Replace( memory.Get(), fileSize, false );
     }
-    ConstMemoryStream ms( memory.Get(), fileSize );
 
     // Load the Old DB
     const NodeGraph::LoadResult res = Load( ms, nodeGraphDBFile );
@@ -404,6 +449,12 @@ NodeGraph::LoadResult NodeGraph::Load( ConstMemoryStream & stream, const char *
         bffNeedsReparsing = true;
     }
 
+    // Hashes of files for content stamps (remain valid even if BFF is re-parsed)
+    if ( FBuild::Get().GetFileStampCache().Load( stream ) == false )
+    {
+        return LoadResult::LOAD_ERROR;
+    }
+
     ASSERT( m_AllNodes.GetSize() == 0 );
 
     // Read nodes
@@ -468,6 +519,20 @@ void NodeGraph::LoadNode( ConstMemoryStream & stream )
     ASSERT( n->GetIndex() == nodeIndex );
 }
 
+// SaveTokenCache
+//------------------------------------------------------------------------------
+void NodeGraph::SaveTokenCache( const char * nodeGraphDBFile ) const
+{
+    // Only a freshly parsed graph has tokens to save. Otherwise the BFF is
+    // unchanged and the existing cache remains valid.
+    if ( m_TokenCache )
+    {
+        AStackString<> tokenCacheFile;
+        BFFTokenCache::GetCacheFileName( nodeGraphDBFile, tokenCacheFile );
+        m_TokenCache->Save( tokenCacheFile.Get() );
+    }
+}
+
 // Save
 //------------------------------------------------------------------------------
 void NodeGraph::Save( MemoryStream & stream, const char* nodeGraphDBFile ) const
@@ -529,6 +594,9 @@ void NodeGraph::Save( MemoryStream & stream, const char* nodeGraphDBFile ) const
     // Write file_exists tracking info
     FBuild::Get().GetFileExistsInfo().Save( stream );
 
+    // Write hashes of files for content stamps
+    FBuild::Get().GetFileStampCache().Save( stream );
+
     // Write nodes
     const size_t numNodes = m_AllNodes.GetSize();
     stream.Write( (uint32_t)numNodes );
@@ -1196,11 +1264,12 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
 
     s_BuildPassTag++;
 
+    // Recurse from the root. On the first pass this discovers the work to be
+    // done. On subsequent passes any nodes still waiting on dependencies are
+    // skipped, so this is proportional to the number of targets, not the
+    // size of the graph.
     if ( nodeToBuild->GetType() == Node::PROXY_NODE )
     {
-        const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
-        size_t failedCount = 0;
-        size_t upToDateCount = 0;
         const Dependency * const end = nodeToBuild->GetStaticDependencies().End();
         for ( const Dependency * it = nodeToBuild->GetStaticDependencies().Begin(); it != end; ++it )
         {
@@ -1209,8 +1278,40 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
             {
                 BuildRecurse( n, 0 );
             }
+        }
+    }
+    else
+    {
+        if ( nodeToBuild->GetState() < Node::BUILDING )
+        {
+            BuildRecurse( nodeToBuild, 0 );
+        }
+    }
+
+    // Revisit nodes which were waiting on dependencies that have since completed.
+    // Processing them can complete further nodes (which are appended to the list)
+    // so we continue until no more progress can be made this pass.
+    Array< Node * > & nodesToRecheck = JobQueue::Get().GetNodesToRecheck();
+    for ( size_t i = 0; i < nodesToRecheck.GetSize(); ++i )
+    {
+        Node * n = nodesToRecheck[ i ];
+        if ( n->GetState() < Node::BUILDING )
+        {
+            BuildRecurse( n, 0 );
+        }
+    }
+    nodesToRecheck.Clear();
 
+    if ( nodeToBuild->GetType() == Node::PROXY_NODE )
+    {
+        const size_t total = nodeToBuild->GetStaticDependencies().GetSize();
+        size_t failedCount = 0;
+        size_t upToDateCount = 0;
+        const Dependency * const end = nodeToBuild->GetStaticDependencies().End();
+        for ( const Dependency * it = nodeToBuild->GetStaticDependencies().Begin(); it != end; ++it )
+        {
             // check result of recursion (which may or may not be complete)
+            const Node * n = it->GetNode();
             if ( n->GetState() == Node::UP_TO_DATE )
             {
                 upToDateCount++;
@@ -1228,13 +1329,6 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
             nodeToBuild->SetState( failedCount ? Node::FAILED : Node::UP_TO_DATE );
         }
     }
-    else
-    {
-        if ( nodeToBuild->GetState() < Node::BUILDING )
-        {
-            BuildRecurse( nodeToBuild, 0 );
-        }
-    }
 
     // Check for cyclice dependencies discoverable only at runtime
     if ( CheckForCyclicDependencies( nodeToBuild ) )
@@ -1246,6 +1340,389 @@ void NodeGraph::DoBuildPass( Node * nodeToBuild )
     JobQueue::Get().FlushJobBatch();
 }
 
+// OnNodeCompleted
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::OnNodeCompleted( Node * node )
+{
+    ASSERT( ( node->GetState() == Node::UP_TO_DATE ) || ( node->GetState() == Node::FAILED ) );
+
+    // Nodes waiting on this one can be revisited once they have nothing else
+    // outstanding
+    for ( Node * waitingNode : node->m_WaitingNodes )
+    {
+        ASSERT( waitingNode->m_PendingDependencies > 0 );
+        if ( --waitingNode->m_PendingDependencies == 0 )
+        {
+            JobQueue::Get().AddNodeToRecheck( waitingNode );
+        }
+    }
+    node->m_WaitingNodes.Destruct();
+}
+
+// ComputeCriticalPath
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::ComputeCriticalPath( Node * nodeToBuild, bool displayCriticalPath )
+{
+    PROFILE_FUNCTION;
+
+    // Order nodes such that dependencies precede the nodes which depend on them
+    Array< Node * > orderedNodes( 1024, true );
+    s_BuildPassTag++;
+    ComputeCriticalPathRecurse( nodeToBuild, orderedNodes );
+
+    // Visit nodes from the target downwards, so that all dependents of a node
+    // have been finalized before it is. Each node's cost is then the longest
+    // chain of previous build times from the node to the target (inclusive),
+    // so serial chains (e.g. PCH -> objects -> lib -> dll) are started first.
+    for ( size_t i = orderedNodes.GetSize(); i > 0; --i )
+    {
+        Node * node = orderedNodes[ i - 1 ];
+
+        // m_RecursiveCost holds the most expensive dependent seen so far
+        const uint32_t cost = ( node->m_RecursiveCost + node->GetLastBuildTime() );
+        node->m_RecursiveCost = cost;
+
+        const Dependencies * dependencyLists[] = { &node->m_PreBuildDependencies,
+                                                   &node->m_StaticDependencies,
+                                                   &node->m_DynamicDependencies };
+        for ( const Dependencies * dependencies : dependencyLists )
+        {
+            for ( const Dependency & dep : *dependencies )
+            {
+                Node * dependency = dep.GetNode();
+                dependency->m_RecursiveCost = Math::Max( dependency->m_RecursiveCost, cost );
+            }
+        }
+    }
+
+    if ( displayCriticalPath )
+    {
+        DisplayCriticalPath( orderedNodes );
+    }
+}
+
+// ComputeCriticalPathRecurse
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::ComputeCriticalPathRecurse( Node * node, Array< Node * > & orderedNodes )
+{
+    // don't recurse the same node multiple times in the same pass
+    const uint32_t buildPassTag = s_BuildPassTag;
+    if ( node->GetBuildPassTag() == buildPassTag )
+    {
+        return;
+    }
+    node->SetBuildPassTag( buildPassTag );
+
+    // cost is accumulated from dependents once all nodes are known
+    node->m_RecursiveCost = 0;
+
+    ComputeCriticalPathRecurse( node->m_PreBuildDependencies, orderedNodes );
+    ComputeCriticalPathRecurse( node->m_StaticDependencies, orderedNodes );
+    ComputeCriticalPathRecurse( node->m_DynamicDependencies, orderedNodes );
+
+    orderedNodes.Append( node );
+}
+
+// ComputeCriticalPathRecurse
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::ComputeCriticalPathRecurse( const Dependencies & dependencies, Array< Node * > & orderedNodes )
+{
+    for ( const Dependency & dep : dependencies )
+    {
+        ComputeCriticalPathRecurse( dep.GetNode(), orderedNodes );
+    }
+}
+
+// DisplayCriticalPath
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::DisplayCriticalPath( const Array< Node * > & orderedNodes )
+{
+    if ( orderedNodes.IsEmpty() )
+    {
+        return;
+    }
+
+    // The most expensive node starts the critical path
+    size_t index = 0;
+    for ( size_t i = 1; i < orderedNodes.GetSize(); ++i )
+    {
+        if ( orderedNodes[ i ]->m_RecursiveCost > orderedNodes[ index ]->m_RecursiveCost )
+        {
+            index = i;
+        }
+    }
+
+    OUTPUT( "Critical Path (predicted from previous build times): %2.3fs\n", (double)orderedNodes[ index ]->m_RecursiveCost / 1000.0 );
+
+    // Follow the path towards the target. The next node is the dependent whose
+    // cost accounts for the remaining cost of this one. Dependents always appear
+    // later in the ordering, so we only need to search forwards. The target is
+    // always the last node.
+    for ( ;; )
+    {
+        const Node * node = orderedNodes[ index ];
+        if ( node->GetType() != Node::PROXY_NODE )
+        {
+            OUTPUT( " %8.3fs : %s\n", (double)node->GetLastBuildTime() / 1000.0, node->GetName().Get() );
+        }
+
+        if ( index == ( orderedNodes.GetSize() - 1 ) )
+        {
+            break; // reached the target
+        }
+
+        const uint32_t remainingCost = ( node->m_RecursiveCost - node->GetLastBuildTime() );
+
+        size_t next = ( index + 1 );
+        for ( ; next < orderedNodes.GetSize(); ++next )
+        {
+            const Node * dependent = orderedNodes[ next ];
+            if ( ( dependent->m_RecursiveCost == remainingCost ) && IsDependency( dependent, node ) )
+            {
+                break;
+            }
+        }
+        if ( next == orderedNodes.GetSize() )
+        {
+            break; // only possible with cyclic dependencies
+        }
+        index = next;
+    }
+}
+
+// IsDependency
+//------------------------------------------------------------------------------
+/*static*/ bool NodeGraph::IsDependency( const Node * node, const Node * dependency )
+{
+    const Dependencies * dependencyLists[] = { &node->m_PreBuildDependencies,
+                                               &node->m_StaticDependencies,
+                                               &node->m_DynamicDependencies };
+    for ( const Dependencies * dependencies : dependencyLists )
+    {
+        for ( const Dependency & dep : *dependencies )
+        {
+            if ( dep.GetNode() == dependency )
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// ScanFileStamps
+//------------------------------------------------------------------------------
+void NodeGraph::ScanFileStamps( Node * nodeToBuild, uint32_t numThreads, const FileChangeJournal * journal, FileStampCache * stampCache ) const
+{
+    PROFILE_FUNCTION;
+
+    // Find the input files this build will need to check
+    Array< Node * > fileNodes( 1024, true );
+    s_BuildPassTag++;
+    ScanFileStampsRecurse( nodeToBuild, fileNodes );
+
+    // Files recorded as unchanged by a watcher don't need to be checked on disk
+    // (with content stamps, if hashed when last modified)
+    if ( journal )
+    {
+        size_t numToCheck = 0;
+        for ( Node * node : fileNodes )
+        {
+            uint64_t stamp;
+            if ( journal->GetStamp( node->GetName(), stamp ) &&
+                 ( ( stampCache == nullptr ) || stampCache->GetCachedStamp( node->GetName(), stamp, stamp ) ) )
+            {
+                node->m_Stamp = stamp;
+            }
+            else
+            {
+                fileNodes[ numToCheck++ ] = node;
+            }
+        }
+        fileNodes.SetSize( numToCheck );
+    }
+
+    if ( fileNodes.IsEmpty() )
+    {
+        return;
+    }
+
+    // Group files in the same directory together
+    fileNodes.QuickSort( []( const Node * a, const Node * b ) { return ( a->GetName() < b->GetName() ); } );
+
+    Array< const AString * > fileNames( fileNodes.GetSize(), false );
+    for ( const Node * node : fileNodes )
+    {
+        fileNames.Append( &node->GetName() );
+    }
+    Array< uint64_t > stamps;
+    stamps.SetSize( fileNodes.GetSize() );
+
+    ScanFileStampsContext context;
+    context.m_FileNames = &fileNames;
+    context.m_Stamps = &stamps;
+    context.m_StampCache = stampCache;
+    context.m_NextBatch = 0;
+
+    // Obtain stamps, using the main thread as one of the scanning threads
+    const uint32_t numBatches = (uint32_t)( ( fileNames.GetSize() + kScanFileStampsBatchSize - 1 ) / kScanFileStampsBatchSize );
+    numThreads = Math::Max( 1u, Math::Min( numThreads, numBatches ) );
+    Thread * threads = ( numThreads > 1 ) ? FNEW_ARRAY( Thread[ numThreads - 1 ] ) : nullptr;
+    for ( uint32_t i = 0; i < ( numThreads - 1 ); ++i )
+    {
+        threads[ i ].Start( ScanFileStampsThreadFunc, "ScanFileStamps", &context );
+    }
+    ScanFileStampsThreadFunc( &context );
+    for ( uint32_t i = 0; i < ( numThreads - 1 ); ++i )
+    {
+        threads[ i ].Join();
+    }
+    FDELETE_ARRAY threads;
+
+    // Missing files are left unstamped, to be checked during the build as usual
+    for ( size_t i = 0; i < fileNodes.GetSize(); ++i )
+    {
+        fileNodes[ i ]->m_Stamp = stamps[ i ];
+    }
+}
+
+// ScanFileStampsRecurse
+//------------------------------------------------------------------------------
+void NodeGraph::ScanFileStampsRecurse( Node * node, Array< Node * > & fileNodes ) const
+{
+    // don't recurse the same node multiple times in the same pass
+    const uint32_t buildPassTag = s_BuildPassTag;
+    if ( node->GetBuildPassTag() == buildPassTag )
+    {
+        return;
+    }
+    node->SetBuildPassTag( buildPassTag );
+
+    // Already processed in a previous build?
+    if ( node->GetState() != Node::NOT_PROCESSED )
+    {
+        return;
+    }
+
+    if ( node->GetType() == Node::FILE_NODE )
+    {
+        if ( node->GetStamp() == 0 )
+        {
+            fileNodes.Append( node );
+        }
+        return;
+    }
+
+    // Files generated by a Unity are consumed as FileNodes, so must be checked
+    // after the Unity has been built. Consumers depend statically on the Unity,
+    // so it is always seen before the files.
+    if ( node->GetType() == Node::UNITY_NODE )
+    {
+        for ( const AString & unityFileName : node->CastTo< UnityNode >()->GetUnityFileNames() )
+        {
+            Node * unityFileNode = FindNodeExact( unityFileName );
+            if ( unityFileNode )
+            {
+                unityFileNode->SetBuildPassTag( buildPassTag );
+            }
+        }
+    }
+
+    ScanFileStampsRecurse( node->m_PreBuildDependencies, fileNodes );
+
+    // Pre-build dependencies may modify files that the rest of the node depends
+    // on (such as generating headers), so those must be checked after they run
+    if ( node->m_PreBuildDependencies.IsEmpty() == false )
+    {
+        return;
+    }
+
+    ScanFileStampsRecurse( node->m_StaticDependencies, fileNodes );
+    ScanFileStampsRecurse( node->m_DynamicDependencies, fileNodes );
+}
+
+// ScanFileStampsRecurse
+//------------------------------------------------------------------------------
+void NodeGraph::ScanFileStampsRecurse( const Dependencies & dependencies, Array< Node * > & fileNodes ) const
+{
+    for ( const Dependency & dep : dependencies )
+    {
+        ScanFileStampsRecurse( dep.GetNode(), fileNodes );
+    }
+}
+
+// ScanFileStampsThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t NodeGraph::ScanFileStampsThreadFunc( void * userData )
+{
+    ScanFileStampsContext & context = *static_cast< ScanFileStampsContext * >( userData );
+    const Array< const AString * > & fileNames = *context.m_FileNames;
+    for ( ;; )
+    {
+        const size_t begin = (size_t)( AtomicInc( &context.m_NextBatch ) - 1 ) * kScanFileStampsBatchSize;
+        if ( begin >= fileNames.GetSize() )
+        {
+            break;
+        }
+        const size_t num = Math::Min( (size_t)kScanFileStampsBatchSize, ( fileNames.GetSize() - begin ) );
+        if ( context.m_StampCache )
+        {
+            // Hashing modified files is the expensive part, so is also done in parallel
+            for ( size_t i = begin; i < ( begin + num ); ++i )
+            {
+                ( *context.m_Stamps )[ i ] = context.m_StampCache->GetStamp( *fileNames[ i ] );
+            }
+            continue;
+        }
+        FileIO::GetFileLastWriteTimes( fileNames.Begin() + begin, num, context.m_Stamps->Begin() + begin );
+    }
+    return 0;
+}
+
+// ResetBuildState
+//------------------------------------------------------------------------------
+void NodeGraph::ResetBuildState()
+{
+    PROFILE_FUNCTION;
+
+    // Return nodes to the state they would have if loaded from the DB, so
+    // everything is checked again. The results of previous builds (stamps,
+    // dynamic dependencies etc.) are retained.
+    for ( Node * node : m_AllNodes )
+    {
+        node->m_State = Node::NOT_PROCESSED;
+        node->m_StatsFlags = 0;
+        node->m_RecursiveCost = 0;
+        node->m_ProcessingTime = 0;
+        node->m_CachingTime = 0;
+        node->m_ProgressAccumulator = 0;
+        node->m_PendingDependencies = 0;
+        node->m_WaitingNodes.Destruct();
+
+        // Stamps of input files are not saved in the DB either
+        if ( node->GetType() == Node::FILE_NODE )
+        {
+            node->m_Stamp = 0;
+        }
+    }
+}
+
+// HaveUsedFilesChanged
+//------------------------------------------------------------------------------
+bool NodeGraph::HaveUsedFilesChanged() const
+{
+    // Any change to the timestamp of a bff file is treated as a change. Loading
+    // the DB again will determine if the contents actually changed.
+    for ( const UsedFile & file : m_UsedFiles )
+    {
+        if ( FileIO::GetFileLastWriteTime( file.m_FileName ) != file.m_TimeStamp )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 // BuildRecurse
 //------------------------------------------------------------------------------
 void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
@@ -1255,8 +1732,30 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
     // already building, or queued to build?
     ASSERT( nodeToBuild->GetState() != Node::BUILDING );
 
-    // accumulate recursive cost
+    // Still waiting on dependencies? We'll be notified when they complete
+    if ( nodeToBuild->m_PendingDependencies > 0 )
+    {
+        return;
+    }
+
+    // Costs are computed up front by ComputeCriticalPath. Nodes discovered during
+    // the build (such as new dynamic dependencies) inherit their dependent's cost.
     cost += nodeToBuild->GetLastBuildTime();
+    if ( nodeToBuild->m_RecursiveCost > cost )
+    {
+        cost = nodeToBuild->m_RecursiveCost;
+    }
+    nodeToBuild->m_RecursiveCost = cost;
+
+    // Input files stamped up front by ScanFileStamps need no further work
+    if ( ( nodeToBuild->GetType() == Node::FILE_NODE ) && ( nodeToBuild->GetStamp() != 0 ) )
+    {
+        nodeToBuild->SetStatFlag( Node::STATS_PROCESSED );
+        nodeToBuild->SetStatFlag( Node::STATS_BUILT );
+        nodeToBuild->SetState( Node::UP_TO_DATE );
+        OnNodeCompleted( nodeToBuild );
+        return;
+    }
 
     // check pre-build dependencies
     if ( nodeToBuild->GetState() == Node::NOT_PROCESSED )
@@ -1298,6 +1797,15 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
         if ( forceClean ||
              nodeToBuild->DetermineNeedToBuildStatic() )
         {
+            // Note if the inputs are the same as last time (the rebuild is due to the output
+            // or -clean) so the cache key from the last build can be relied upon
+            if ( ( nodeToBuild->m_Stamp != 0 ) &&
+                 ( Node::HaveDependenciesChanged( nodeToBuild->m_StaticDependencies ) == false ) &&
+                 ( Node::HaveDependenciesChanged( nodeToBuild->m_DynamicDependencies ) == false ) )
+            {
+                nodeToBuild->SetStatFlag( Node::STATS_INPUTS_UNCHANGED );
+            }
+
             // Clear dynamic dependencies
             nodeToBuild->m_DynamicDependencies.Clear();
 
@@ -1315,6 +1823,7 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
             if ( nodeToBuild->DoDynamicDependencies( *this, forceClean ) == false )
             {
                 nodeToBuild->SetState( Node::FAILED );
+                OnNodeCompleted( nodeToBuild );
                 return;
             }
 
@@ -1343,7 +1852,6 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
     if ( ( nodeToBuild->GetStamp() == 0 ) || // Avoid redundant messages from DetermineNeedToBuild
          nodeToBuild->DetermineNeedToBuildDynamic() )
     {
-        nodeToBuild->m_RecursiveCost = cost;
         JobQueue::Get().AddJobToBatch( nodeToBuild );
     }
     else
@@ -1353,6 +1861,7 @@ void NodeGraph::BuildRecurse( Node * nodeToBuild, uint32_t cost )
             FLOG_BUILD_REASON( "Up-To-Date '%s'\n", nodeToBuild->GetName().Get() );
         }
         nodeToBuild->SetState( Node::UP_TO_DATE );
+        OnNodeCompleted( nodeToBuild );
     }
 }
 
@@ -1398,15 +1907,6 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             continue;
         }
 
-        if ( state == Node::BUILDING )
-        {
-            // ensure deepest traversal cost is kept
-            if ( cost > nodeToBuild->m_RecursiveCost )
-            {
-                nodeToBuild->m_RecursiveCost = cost;
-            }
-        }
-
         allDependenciesUpToDate = false;
 
         // dependency failed?
@@ -1417,10 +1917,15 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             {
                 // propogate failure state to this node
                 nodeToBuild->SetState( Node::FAILED );
+                OnNodeCompleted( nodeToBuild );
                 break;
             }
+            continue;
         }
 
+        // dependency is still in progress - we'll be revisited when it completes
+        WaitForDependency( nodeToBuild, n );
+
         // keep trying to progress other nodes...
     }
 
@@ -1431,6 +1936,7 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
             if ( numberNodesFailed > 0 )
             {
                 nodeToBuild->SetState( Node::FAILED );
+                OnNodeCompleted( nodeToBuild );
             }
         }
     }
@@ -1438,6 +1944,16 @@ bool NodeGraph::CheckDependencies( Node * nodeToBuild, const Dependencies & depe
     return allDependenciesUpToDate;
 }
 
+// WaitForDependency
+//------------------------------------------------------------------------------
+/*static*/ void NodeGraph::WaitForDependency( Node * nodeToBuild, Node * dependency )
+{
+    ASSERT( ( dependency->GetState() != Node::UP_TO_DATE ) && ( dependency->GetState() != Node::FAILED ) );
+
+    dependency->m_WaitingNodes.Append( nodeToBuild );
+    ++nodeToBuild->m_PendingDependencies;
+}
+
 // CleanPath
 //------------------------------------------------------------------------------
 /*static*/ void NodeGraph::CleanPath( AString & name, bool makeFullPath )
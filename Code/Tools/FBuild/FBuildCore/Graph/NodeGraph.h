@@ -16,6 +16,7 @@
 //------------------------------------------------------------------------------
 class AliasNode;
 class AString;
+class BFFTokenCache;
 class CompilerNode;
 class ConstMemoryStream;
 class CopyDirNode;
@@ -26,7 +27,9 @@ class DirectoryListNode;
 class DLLNode;
 class ExeNode;
 class ExecNode;
+class FileChangeJournal;
 class FileNode;
+class FileStampCache;
 class IOStream;
 class LibraryNode;
 class LinkerNode;
@@ -63,7 +66,7 @@ public:
     }
     inline ~NodeGraphHeader() = default;
 
-    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 165 };
+    enum : uint8_t { NODE_GRAPH_CURRENT_VERSION = 171 };
 
     bool IsValid() const;
     bool IsCompatibleVersion() const { return m_Version == NODE_GRAPH_CURRENT_VERSION; }
@@ -99,6 +102,7 @@ public:
 
     LoadResult Load( ConstMemoryStream & stream, const char * nodeGraphDBFile );
     void Save( MemoryStream & stream, const char * nodeGraphDBFile ) const;
+    void SaveTokenCache( const char * nodeGraphDBFile ) const;
     void SerializeToText( const Dependencies & dependencies, AString & outBuffer ) const;
     void SerializeToDotFormat( const Dependencies & deps, const bool fullGraph, AString & outBuffer ) const;
 
@@ -137,6 +141,13 @@ public:
     TextFileNode * CreateTextFileNode( const AString & name );
 
     void DoBuildPass( Node * nodeToBuild );
+    static void OnNodeCompleted( Node * node );
+    static void ComputeCriticalPath( Node * nodeToBuild, bool displayCriticalPath );
+    void ScanFileStamps( Node * nodeToBuild, uint32_t numThreads, const FileChangeJournal * journal, FileStampCache * stampCache ) const;
+
+    // graph kept in memory between builds (-daemon)
+    void ResetBuildState();
+    bool HaveUsedFilesChanged() const;
 
     static void CleanPath( AString & name, bool makeFullPath = true );
     static void CleanPath( const AString & name, AString & cleanPath, bool makeFullPath = true );
@@ -150,12 +161,13 @@ public:
 private:
     friend class FBuild;
 
-    bool ParseFromRoot( const char * bffFile );
+    bool ParseFromRoot( const char * bffFile, const char * nodeGraphDBFile );
 
     void AddNode( Node * node );
 
     void BuildRecurse( Node * nodeToBuild, uint32_t cost );
     bool CheckDependencies( Node * nodeToBuild, const Dependencies & dependencies, uint32_t cost );
+    static void WaitForDependency( Node * nodeToBuild, Node * dependency );
     static void UpdateBuildStatusRecurse( const Node * node,
                                           uint32_t & nodesBuiltTime,
                                           uint32_t & totalNodeTime );
@@ -163,6 +175,14 @@ private:
                                           uint32_t & nodesBuiltTime,
                                           uint32_t & totalNodeTime );
 
+    static void ComputeCriticalPathRecurse( Node * node, Array< Node * > & orderedNodes );
+    static void ComputeCriticalPathRecurse( const Dependencies & dependencies, Array< Node * > & orderedNodes );
+    static void DisplayCriticalPath( const Array< Node * > & orderedNodes );
+    static bool IsDependency( const Node * node, const Node * dependency );
+    void ScanFileStampsRecurse( Node * node, Array< Node * > & fileNodes ) const;
+    void ScanFileStampsRecurse( const Dependencies & dependencies, Array< Node * > & fileNodes ) const;
+    static uint32_t ScanFileStampsThreadFunc( void * userData );
+
     static bool CheckForCyclicDependencies( const Node * node );
     static bool CheckForCyclicDependenciesRecurse( const Node * node, Array< const Node * > & dependencyStack );
     static bool CheckForCyclicDependenciesRecurse( const Dependencies & dependencies,
@@ -234,6 +254,8 @@ private:
 
     const SettingsNode * m_Settings;
 
+    BFFTokenCache * m_TokenCache; // Tokens of bff files (only when parsed)
+
     static uint32_t s_BuildPassTag;
 };
 
@@ -6,6 +6,8 @@
 #include "ObjectNode.h"
 
 #include "Tools/FBuild/FBuildCore/BFF/Functions/FunctionObjectList.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePrefetcher.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePublisher.h"
 #include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriverBase.h"
 #include "Tools/FBuild/FBuildCore/ExeDrivers/Compiler/CompilerDriver_CL.h"
@@ -90,6 +92,7 @@ REFLECT_NODE_BEGIN( ObjectNode, Node, MetaNone() )
     REFLECT( m_PreprocessorFlags.m_Flags,           "PreprocessorFlags",                MetaHidden() )
     REFLECT( m_PCHCacheKey,                         "PCHCacheKey",                      MetaHidden() + MetaIgnoreForComparison() )
     REFLECT( m_OwnerObjectList,                     "OwnerObjectList",                  MetaHidden() )
+    REFLECT( m_LastCacheName,                       "LastCacheName",                    MetaHidden() + MetaIgnoreForComparison() )
 REFLECT_END( ObjectNode )
 
 // CONSTRUCTOR
@@ -331,6 +334,9 @@ ObjectNode::~ObjectNode()
     // to prevent unnecessary rebuilds of object that depend on this one, if this
     // is a precompiled header object.
     m_PCHCacheKey = oldNode.CastTo< ObjectNode >()->m_PCHCacheKey;
+
+    // Keep the last cache key for prefetching
+    m_LastCacheName = oldNode.CastTo< ObjectNode >()->m_LastCacheName;
 }
 
 // DoBuildMSCL_NoCache
@@ -1324,6 +1330,28 @@ const char * ObjectNode::GetObjExtension() const
     return m_CompilerOutputExtension.Get();
 }
 
+// PrefetchFromCache
+//------------------------------------------------------------------------------
+void ObjectNode::PrefetchFromCache()
+{
+    // The cache key from the last build is only valid if none of the inputs have
+    // changed (i.e. the output is missing/modified or this is a -clean build)
+    if ( m_LastCacheName.IsEmpty() ||
+         ( GetStatFlag( STATS_INPUTS_UNCHANGED ) == false ) ||
+         ( ShouldUseCache() == false ) )
+    {
+        return;
+    }
+
+    // Don't prefetch what the cache filter rules out
+    if ( FBuild::Get().GetOptions().m_CacheFilter && ( FBuild::Get().GetCache()->MayContain( m_LastCacheName ) == false ) )
+    {
+        return;
+    }
+
+    FBuild::Get().GetCachePrefetcher()->Prefetch( this, m_LastCacheName );
+}
+
 // GetCacheName
 //------------------------------------------------------------------------------
 const AString & ObjectNode::GetCacheName( Job * job ) const
@@ -1377,8 +1405,12 @@ const AString & ObjectNode::GetCacheName( Job * job ) const
         ASSERT( pchKey != 0 ); // Should not be in here if PCH is not cached
     }
 
+    // Dictionary used to compress the entry
+    const CompressionDictionary * dictionary = FBuild::Get().GetCacheDictionary();
+    const uint64_t dictionaryId = dictionary ? dictionary->GetId() : 0;
+
     AStackString<> cacheName;
-    ICache::GetCacheId( preprocessedSourceKey, commandLineKey, toolChainKey, pchKey, cacheName );
+    ICache::GetCacheId( preprocessedSourceKey, commandLineKey, toolChainKey, pchKey, dictionaryId, cacheName );
     job->SetCacheName(cacheName);
 
     return job->GetCacheName();
@@ -1396,15 +1428,41 @@ bool ObjectNode::RetrieveFromCache( Job * job )
     PROFILE_FUNCTION;
 
     const AString & cacheFileName = GetCacheName(job);
+    m_LastCacheName = cacheFileName;
 
     const Timer t;
 
     ICache * cache = FBuild::Get().GetCache();
     ASSERT( cache );
 
+    // Skip the lookup if the cache filter rules it out
+    CachePrefetcher * prefetcher = FBuild::Get().GetCachePrefetcher();
+    if ( FBuild::Get().GetOptions().m_CacheFilter && ( cache->MayContain( cacheFileName ) == false ) )
+    {
+        if ( prefetcher )
+        {
+            prefetcher->Discard( this );
+        }
+
+        // Output
+        if ( FBuild::Get().GetOptions().m_CacheVerbose )
+        {
+            FLOG_OUTPUT( "Obj: %s\n"
+                         " - Cache Miss (Filtered): %u ms '%s'\n",
+                         GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
+        }
+
+        SetStatFlag( Node::STATS_CACHE_MISS );
+        SetStatFlag( Node::STATS_CACHE_FILTERED );
+        return false;
+    }
+
+    // Use prefetched data if the key was predicted correctly
     void * cacheData( nullptr );
     size_t cacheDataSize( 0 );
-    if ( cache->Retrieve( cacheFileName, cacheData, cacheDataSize ) )
+    const bool hit = prefetcher ? prefetcher->Retrieve( this, cacheFileName, cacheData, cacheDataSize )
+                                : cache->Retrieve( cacheFileName, cacheData, cacheDataSize );
+    if ( hit )
     {
         const uint32_t retrieveTime = uint32_t( t.GetElapsedMS() );
 
@@ -1420,7 +1478,7 @@ bool ObjectNode::RetrieveFromCache( Job * job )
         MultiBuffer buffer( cacheData, cacheDataSize );
 
         // do decompression
-        if ( buffer.Decompress() == false )
+        if ( buffer.Decompress( FBuild::Get().GetCacheDictionary() ) == false )
         {
             FLOG_WARN( "Cache returned invalid data\n"
                        " - File: '%s'\n"
@@ -1551,11 +1609,18 @@ void ObjectNode::WriteToCache_FromUncompressedData( Job * job,
         return;
     }
 
+    // Compress and publish in the background if possible
+    if ( CanPublishToCacheAsync() &&
+         FBuild::Get().GetCachePublisher()->Queue( this, GetCacheName( job ), uncompressedData, uncompressedDataSize, false ) )
+    {
+        return;
+    }
+
     // Compress
     const Timer t;
     const uint32_t startCompress( (uint32_t)t.GetElapsedMS() );
     Compressor c;
-    c.Compress(uncompressedData, uncompressedDataSize, FBuild::Get().GetOptions().m_CacheCompressionLevel );
+    c.Compress( uncompressedData, uncompressedDataSize, FBuild::Get().GetOptions().m_CacheCompressionLevel, FBuild::Get().GetCacheDictionary(), true );
     const uint32_t compressionTime = ( (uint32_t)t.GetElapsedMS() - startCompress );
 
     WriteToCache_FromCompressedData( job,
@@ -1581,15 +1646,61 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
 
     const AString & cacheFileName = GetCacheName(job);
 
+    // Publish in the background if possible
+    if ( CanPublishToCacheAsync() &&
+         FBuild::Get().GetCachePublisher()->Queue( this, cacheFileName, compressedData, compressedDataSize, true ) )
+    {
+        return;
+    }
+
+    uint32_t cachingTime = 0;
+    if ( PublishToCache( cacheFileName, compressedData, compressedDataSize, compressionTimeMS, cachingTime ) )
+    {
+        OnPublishedToCache( cachingTime );
+    }
+}
+
+// CanPublishToCacheAsync
+//------------------------------------------------------------------------------
+bool ObjectNode::CanPublishToCacheAsync() const
+{
+    // Dependent objects need to know the PCH key to be able to pull from the cache
+    if ( IsCreatingPCH() && IsMSVC() )
+    {
+        return false;
+    }
+    return ( FBuild::Get().GetCachePublisher() != nullptr );
+}
+
+// PublishToCache
+//------------------------------------------------------------------------------
+bool ObjectNode::PublishToCache( const AString & cacheFileName,
+                                 const void * compressedData,
+                                 uint64_t compressedDataSize,
+                                 uint32_t compressionTimeMS,
+                                 uint32_t & outCachingTimeMS )
+{
     // Commit to cache
     const Timer t;
-    const uint32_t startPublish( (uint32_t)t.GetElapsedMS() );
-    if ( FBuild::Get().GetCache()->Publish( cacheFileName, compressedData, compressedDataSize ) )
+    const bool stored = FBuild::Get().GetCache()->Publish( cacheFileName, compressedData, compressedDataSize );
+    const uint32_t publishTime = (uint32_t)t.GetElapsedMS();
+    return OnPublishToCacheComplete( cacheFileName, compressedData, compressedDataSize, compressionTimeMS, publishTime, stored, outCachingTimeMS );
+}
+
+// OnPublishToCacheComplete
+//------------------------------------------------------------------------------
+bool ObjectNode::OnPublishToCacheComplete( const AString & cacheFileName,
+                                           const void * compressedData,
+                                           uint64_t compressedDataSize,
+                                           uint32_t compressionTimeMS,
+                                           uint32_t publishTimeMS,
+                                           bool stored,
+                                           uint32_t & outCachingTimeMS )
+{
+    if ( stored )
     {
         // cache store complete
-        const uint32_t publishTime = ( (uint32_t)t.GetElapsedMS() - startPublish );
-
-        SetStatFlag( Node::STATS_CACHE_STORE );
+        const Timer t;
 
         // Dependent objects need to know the PCH key to be able to pull from the cache
         if ( IsCreatingPCH() && IsMSVC() )
@@ -1597,8 +1708,8 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
             m_PCHCacheKey = xxHash::Calc64( compressedData, compressedDataSize );
         }
 
-        const uint32_t cachingTime = uint32_t( t.GetElapsedMS() );
-        AddCachingTime( cachingTime );
+        const uint32_t cachingTime = ( publishTimeMS + uint32_t( t.GetElapsedMS() ) );
+        outCachingTimeMS = cachingTime;
 
         // Output
         if ( FBuild::Get().GetOptions().m_CacheVerbose )
@@ -1607,26 +1718,34 @@ void ObjectNode::WriteToCache_FromCompressedData( Job * job,
             AStackString<> output;
             output.Format( "Obj: %s\n"
                            " - Cache Store: %u ms (Store: %u ms - Compress: %u ms) (Compressed: %" PRIu64 " - Uncompressed: %" PRIu64 ") '%s'\n",
-                           GetName().Get(), cachingTime, publishTime, compressionTimeMS, compressedDataSize, uncompressedDataSize, cacheFileName.Get() );
+                           GetName().Get(), cachingTime, publishTimeMS, compressionTimeMS, compressedDataSize, uncompressedDataSize, cacheFileName.Get() );
             if ( m_PCHCacheKey != 0 )
             {
                 output.AppendFormat( " - PCH Key: %" PRIx64 "\n", m_PCHCacheKey );
             }
             FLOG_OUTPUT( output );
         }
+        return true;
     }
-    else
-    {
-        // Cache store failed
 
-        // Output
-        if ( FBuild::Get().GetOptions().m_CacheVerbose )
-        {
-            FLOG_OUTPUT( "Obj: %s\n"
-                         " - Cache Store Fail: %u ms '%s'\n",
-                         GetName().Get(), uint32_t( t.GetElapsedMS() ), cacheFileName.Get() );
-        }
+    // Cache store failed
+
+    // Output
+    if ( FBuild::Get().GetOptions().m_CacheVerbose )
+    {
+        FLOG_OUTPUT( "Obj: %s\n"
+                     " - Cache Store Fail: %u ms '%s'\n",
+                     GetName().Get(), publishTimeMS, cacheFileName.Get() );
     }
+    return false;
+}
+
+// OnPublishedToCache
+//------------------------------------------------------------------------------
+void ObjectNode::OnPublishedToCache( uint32_t cachingTimeMS )
+{
+    SetStatFlag( Node::STATS_CACHE_STORE );
+    AddCachingTime( cachingTimeMS );
 }
 
 // GetExtraCacheFilePaths
@@ -168,6 +168,9 @@ public:
 
     void ExpandCompilerForceUsing( Args & fullArgs, const AString & pre, const AString & post ) const;
 
+    // Start retrieving the cache entry used last time (main thread)
+    void PrefetchFromCache();
+
 #if defined( ENABLE_FAKE_SYSTEM_FAILURE )
     // Fake system failure for tests
     enum FakeSystemFailureState : uint32_t
@@ -210,6 +213,20 @@ private:
                                           const void * compressedData,
                                           uint64_t compressedDataSize,
                                           uint32_t compressionTimeMS );
+    bool CanPublishToCacheAsync() const;
+    bool PublishToCache( const AString & cacheFileName,
+                         const void * compressedData,
+                         uint64_t compressedDataSize,
+                         uint32_t compressionTimeMS,
+                         uint32_t & outCachingTimeMS );
+    bool OnPublishToCacheComplete( const AString & cacheFileName,
+                                   const void * compressedData,
+                                   uint64_t compressedDataSize,
+                                   uint32_t compressionTimeMS,
+                                   uint32_t publishTimeMS,
+                                   bool stored,
+                                   uint32_t & outCachingTimeMS );
+    void OnPublishedToCache( uint32_t cachingTimeMS );
     void GetExtraCacheFilePaths( const Job * job, Array< AString > & outFileNames ) const;
 
     void EmitCompilationMessage( const Args & fullArgs, bool useDeoptimization, bool stealingRemoteJob = false, bool racingRemoteJob = false, bool useDedicatedPreprocessor = false, bool isRemote = false ) const;
@@ -231,6 +248,7 @@ private:
 
     static void HandleSystemFailures( Job * job, int result, const AString & stdOut, const AString & stdErr );
     bool ShouldUseDeoptimization() const;
+    friend class CachePublisher;
     friend class Client;
     bool ShouldUseCache() const;
     ArgsResponseFileMode GetResponseFileMode() const;
@@ -298,6 +316,7 @@ private:
     uint64_t            m_PCHCacheKey                       = 0;
     uint64_t            m_LightCacheKey                     = 0;
     AString             m_OwnerObjectList; // TODO:C This could be a pointer to the node in the future
+    AString             m_LastCacheName;   // Predicted cache key for prefetching
 
     // Not serialized
     Array< AString >    m_Includes;
@@ -29,6 +29,12 @@ REFLECT_NODE_BEGIN( SettingsNode, Node, MetaNone() )
     REFLECT(        m_CachePathMountPoint,      "CachePathMountPoint",      MetaOptional() )
     REFLECT(        m_CachePluginDLL,           "CachePluginDLL",           MetaOptional() )
     REFLECT(        m_CachePluginDLLConfig,     "CachePluginDLLConfig",     MetaOptional() )
+    REFLECT(        m_CachePathLocal,           "CachePathLocal",           MetaOptional() )
+    REFLECT(        m_CacheLocalSizeMiB,        "CacheLocalSizeMiB",        MetaOptional() + MetaRange( 1, 1024 * 1024 ) )
+    REFLECT(        m_CacheMemorySizeMiB,       "CacheMemorySizeMiB",       MetaOptional() + MetaRange( 0, 64 * 1024 ) )
+    REFLECT(        m_CachePacked,              "CachePacked",              MetaOptional() )
+    REFLECT(        m_CacheMaxSizeMiB,          "CacheMaxSizeMiB",          MetaOptional() + MetaRange( 0, 1024 * 1024 ) )
+    REFLECT(        m_CacheDedupMinSizeMiB,     "CacheDedupMinSizeMiB",     MetaOptional() + MetaRange( 0, 4 * 1024 ) )
     REFLECT_ARRAY(  m_Workers,                  "Workers",                  MetaOptional() )
     REFLECT(        m_WorkerConnectionLimit,    "WorkerConnectionLimit",    MetaOptional() )
     REFLECT(        m_DistributableJobMemoryLimitMiB, "DistributableJobMemoryLimitMiB", MetaOptional() + MetaRange( DIST_MEMORY_LIMIT_MIN, DIST_MEMORY_LIMIT_MAX ) )
@@ -38,12 +44,18 @@ REFLECT_END( SettingsNode )
 //------------------------------------------------------------------------------
 SettingsNode::SettingsNode()
 : Node( AString::GetEmpty(), Node::SETTINGS_NODE, Node::FLAG_NONE )
+, m_CacheLocalSizeMiB( 10 * 1024 )
+, m_CacheMemorySizeMiB( 0 )
+, m_CachePacked( false )
+, m_CacheMaxSizeMiB( 0 )
+, m_CacheDedupMinSizeMiB( 0 )
 , m_WorkerConnectionLimit( 15 )
 , m_DistributableJobMemoryLimitMiB( DIST_MEMORY_LIMIT_DEFAULT )
 {
     // Cache path from environment
     Env::GetEnvVariable( "FASTBUILD_CACHE_PATH", m_CachePathFromEnvVar );
     Env::GetEnvVariable( "FASTBUILD_CACHE_PATH_MOUNT_POINT", m_CachePathMountPointFromEnvVar );
+    Env::GetEnvVariable( "FASTBUILD_CACHE_PATH_LOCAL", m_CachePathLocalFromEnvVar );
 }
 
 // Initialize
@@ -100,6 +112,18 @@ const AString & SettingsNode::GetCachePathMountPoint() const
     return m_CachePathMountPointFromEnvVar;
 }
 
+// GetCachePathLocal
+//------------------------------------------------------------------------------
+const AString & SettingsNode::GetCachePathLocal() const
+{
+    // Settings() bff option overrides environment variable
+    if ( m_CachePathLocal.IsEmpty() == false )
+    {
+        return m_CachePathLocal;
+    }
+    return m_CachePathLocalFromEnvVar;
+}
+
 // GetCachePluginDLL
 //------------------------------------------------------------------------------
 const AString & SettingsNode::GetCachePluginDLL() const
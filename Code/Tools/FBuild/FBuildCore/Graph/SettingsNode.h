@@ -29,6 +29,12 @@ public:
     const AString &                     GetCachePathMountPoint() const;
     const AString &                     GetCachePluginDLL() const;
     const AString &                     GetCachePluginDLLConfig() const;
+    const AString &                     GetCachePathLocal() const;
+    uint32_t                            GetCacheLocalSizeMiB() const { return m_CacheLocalSizeMiB; }
+    uint32_t                            GetCacheMemorySizeMiB() const { return m_CacheMemorySizeMiB; }
+    bool                                GetCachePacked() const { return m_CachePacked; }
+    uint32_t                            GetCacheMaxSizeMiB() const { return m_CacheMaxSizeMiB; }
+    uint32_t                            GetCacheDedupMinSizeMiB() const { return m_CacheDedupMinSizeMiB; }
     inline const Array< AString > &     GetWorkerList() const { return m_Workers; }
     uint32_t                            GetWorkerConnectionLimit() const { return m_WorkerConnectionLimit; }
     uint32_t                            GetDistributableJobMemoryLimitMiB() const { return m_DistributableJobMemoryLimitMiB; }
@@ -39,6 +45,7 @@ private:
     // Settings from environment variables
     AString             m_CachePathFromEnvVar;
     AString             m_CachePathMountPointFromEnvVar;
+    AString             m_CachePathLocalFromEnvVar;
 
     // Exposed settings
     //friend class FunctionSettings;
@@ -47,6 +54,12 @@ private:
     AString             m_CachePathMountPoint;
     AString             m_CachePluginDLL;
     AString             m_CachePluginDLLConfig;
+    AString             m_CachePathLocal;
+    uint32_t            m_CacheLocalSizeMiB;
+    uint32_t            m_CacheMemorySizeMiB;
+    bool                m_CachePacked;
+    uint32_t            m_CacheMaxSizeMiB;
+    uint32_t            m_CacheDedupMinSizeMiB;
     Array< AString  >   m_Workers;
     uint32_t            m_WorkerConnectionLimit;
     uint32_t            m_DistributableJobMemoryLimitMiB;
@@ -0,0 +1,634 @@
+// BuildDaemon
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "BuildDaemon.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/FBuildOptions.h"
+#include "Tools/FBuild/FBuildCore/FBuildVersion.h"
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+
+// Core
+#include "Core/Env/Env.h"
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Tracing/Tracing.h"
+
+// System
+#if !defined( __WINDOWS__ )
+    #include <errno.h>
+    #include <poll.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+// Static Data
+//------------------------------------------------------------------------------
+/*static*/ BuildDaemon * BuildDaemon::s_Instance = nullptr;
+
+// Helpers
+//------------------------------------------------------------------------------
+#if !defined( __WINDOWS__ )
+namespace
+{
+    // Messages are sent as a uint32_t size followed by the message
+    enum MessageType : uint8_t
+    {
+        MSG_BUILD,  // Client -> Daemon : version, working dir, args and environment
+        MSG_OUTPUT, // Daemon -> Client : output text
+        MSG_RESULT, // Daemon -> Client : BuildDaemon::Result
+    };
+    const uint32_t kMaxMessageSize = ( 64 * 1024 * 1024 );
+
+    int32_t CreateSocket()
+    {
+        const int32_t s = socket( AF_UNIX, SOCK_STREAM, 0 );
+        #if defined( __APPLE__ )
+            if ( s >= 0 )
+            {
+                // Broken connections are handled at the point of sending
+                int nosigpipe = 1;
+                VERIFY( setsockopt( s, SOL_SOCKET, SO_NOSIGPIPE, (void *)&nosigpipe, sizeof( int ) ) == 0 );
+            }
+        #endif
+        return s;
+    }
+
+    bool MakeAddress( const AString & socketName, sockaddr_un & outAddress )
+    {
+        memset( &outAddress, 0, sizeof( outAddress ) );
+        if ( socketName.IsEmpty() || ( socketName.GetLength() >= sizeof( outAddress.sun_path ) ) )
+        {
+            return false;
+        }
+        outAddress.sun_family = AF_UNIX;
+        AString::Copy( socketName.Get(), outAddress.sun_path, socketName.GetLength() );
+        return true;
+    }
+
+    // Sockets are created in a directory only this user can access, so other
+    // users can't connect to the daemon or impersonate it
+    bool EnsurePrivateDir( const AString & dir, bool create )
+    {
+        if ( create && ( mkdir( dir.Get(), S_IRWXU ) != 0 ) && ( errno != EEXIST ) )
+        {
+            return false;
+        }
+        struct stat dirStat;
+        return ( lstat( dir.Get(), &dirStat ) == 0 ) &&
+               S_ISDIR( dirStat.st_mode ) &&
+               ( dirStat.st_uid == getuid() ) &&
+               ( ( dirStat.st_mode & ( S_IRWXG | S_IRWXO ) ) == 0 );
+    }
+
+    // Check the process at the other end of a connection belongs to this user
+    bool IsPeerCurrentUser( int32_t s )
+    {
+        #if defined( __LINUX__ )
+            ucred cred;
+            socklen_t credSize = sizeof( cred );
+            if ( getsockopt( s, SOL_SOCKET, SO_PEERCRED, &cred, &credSize ) != 0 )
+            {
+                return false;
+            }
+            return ( cred.uid == getuid() );
+        #else
+            uid_t uid;
+            gid_t gid;
+            if ( getpeereid( s, &uid, &gid ) != 0 )
+            {
+                return false;
+            }
+            return ( uid == getuid() );
+        #endif
+    }
+
+    bool WaitForData( int32_t s, uint32_t timeoutMS )
+    {
+        pollfd pollFD;
+        pollFD.fd = s;
+        pollFD.events = POLLIN;
+        pollFD.revents = 0;
+        return ( poll( &pollFD, 1, (int)timeoutMS ) > 0 ); // Data, disconnection or error
+    }
+
+    bool SendAll( int32_t s, const void * data, size_t size )
+    {
+        #if defined( __LINUX__ )
+            const int flags = MSG_NOSIGNAL; // Broken connections are handled at the point of sending
+        #else
+            const int flags = 0; // See CreateSocket
+        #endif
+        const char * pos = static_cast< const char * >( data );
+        while ( size > 0 )
+        {
+            const ssize_t sent = send( s, pos, size, flags );
+            if ( sent < 0 )
+            {
+                if ( errno == EINTR )
+                {
+                    continue;
+                }
+                return false;
+            }
+            pos += sent;
+            size -= (size_t)sent;
+        }
+        return true;
+    }
+
+    bool ReceiveAll( int32_t s, void * data, size_t size )
+    {
+        char * pos = static_cast< char * >( data );
+        while ( size > 0 )
+        {
+            const ssize_t received = recv( s, pos, size, 0 );
+            if ( received <= 0 )
+            {
+                if ( ( received < 0 ) && ( errno == EINTR ) )
+                {
+                    continue;
+                }
+                return false; // Disconnected or error
+            }
+            pos += received;
+            size -= (size_t)received;
+        }
+        return true;
+    }
+
+    bool SendMessage( int32_t s, const MemoryStream & message )
+    {
+        const uint32_t size = (uint32_t)message.GetSize();
+        return SendAll( s, &size, sizeof( size ) ) &&
+               SendAll( s, message.GetData(), size );
+    }
+
+    bool ReceiveMessage( int32_t s, ConstMemoryStream & outMessage )
+    {
+        uint32_t size = 0;
+        if ( ( ReceiveAll( s, &size, sizeof( size ) ) == false ) ||
+             ( size == 0 ) || ( size > kMaxMessageSize ) )
+        {
+            return false;
+        }
+        void * data = ALLOC( size );
+        if ( ReceiveAll( s, data, size ) == false )
+        {
+            FREE( data );
+            return false;
+        }
+        outMessage.Replace( data, size, true ); // Stream takes ownership
+        return true;
+    }
+
+    // Make the environment of this process match the client's
+    void SetEnvironment( const Array< AString > & environment )
+    {
+        Array< AString > oldEnvironment( 128, true );
+        Env::GetEnvironment( oldEnvironment );
+        for ( const AString & oldEnvVar : oldEnvironment )
+        {
+            if ( environment.Find( oldEnvVar ) )
+            {
+                continue; // Unchanged
+            }
+            const char * equals = oldEnvVar.Find( '=' );
+            const AStackString<> name( oldEnvVar.Get(), equals ? equals : oldEnvVar.GetEnd() );
+            unsetenv( name.Get() ); // Set again below if changed rather than removed
+        }
+        for ( const AString & envVar : environment )
+        {
+            if ( oldEnvironment.Find( envVar ) )
+            {
+                continue; // Unchanged
+            }
+            const char * equals = envVar.Find( '=' );
+            if ( equals && ( equals != envVar.Get() ) )
+            {
+                Env::SetEnvVariable( AStackString<>( envVar.Get(), equals ).Get(), AStackString<>( equals + 1 ) );
+            }
+        }
+    }
+}
+#endif
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+BuildDaemon::BuildDaemon() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+BuildDaemon::~BuildDaemon()
+{
+    FDELETE m_FBuild;
+}
+
+// Run
+//------------------------------------------------------------------------------
+bool BuildDaemon::Run( const FBuildOptions & options )
+{
+    #if defined( __WINDOWS__ )
+        (void)options;
+        OUTPUT( "FBuild: Error: -daemon is not supported on this platform.\n" );
+        return false;
+    #else
+        AStackString<> socketDir;
+        AStackString<> socketName;
+        sockaddr_un address;
+        if ( ( GetSocketName( options, socketDir, socketName ) == false ) ||
+             ( MakeAddress( socketName, address ) == false ) )
+        {
+            OUTPUT( "FBuild: Error: Invalid daemon socket name '%s'\n", socketName.Get() );
+            return false;
+        }
+        if ( EnsurePrivateDir( socketDir, true ) == false )
+        {
+            OUTPUT( "FBuild: Error: Daemon socket dir '%s' is not accessible only by this user\n", socketDir.Get() );
+            return false;
+        }
+
+        const int32_t listenSocket = CreateSocket();
+        if ( listenSocket < 0 )
+        {
+            OUTPUT( "FBuild: Error: Failed to create daemon socket. Error: %s\n", LAST_ERROR_STR );
+            return false;
+        }
+
+        // A socket left behind by a previous daemon can be replaced, as holding
+        // the main process mutex ensures no other daemon is running here
+        unlink( socketName.Get() );
+
+        // Only this user can connect
+        const mode_t oldMask = umask( 0077 );
+        const bool bound = ( bind( listenSocket, (const sockaddr *)&address, sizeof( address ) ) == 0 );
+        umask( oldMask );
+        if ( ( bound == false ) || ( listen( listenSocket, 8 ) != 0 ) )
+        {
+            OUTPUT( "FBuild: Error: Failed to listen on daemon socket '%s'. Error: %s\n", socketName.Get(), LAST_ERROR_STR );
+            close( listenSocket );
+            return false;
+        }
+
+        OUTPUT( "FBuild: Daemon waiting for builds in '%s'. Press Ctrl-C to stop.\n", options.GetWorkingDir().Get() );
+        while ( FBuild::GetStopBuild() == false )
+        {
+            // Builds are performed one at a time, in order of connection
+            if ( WaitForData( listenSocket, 500 ) == false )
+            {
+                continue;
+            }
+            const int32_t clientSocket = accept( listenSocket, nullptr, nullptr );
+            if ( clientSocket < 0 )
+            {
+                continue;
+            }
+            if ( IsPeerCurrentUser( clientSocket ) == false )
+            {
+                close( clientSocket );
+                continue;
+            }
+            #if defined( __APPLE__ )
+                int nosigpipe = 1;
+                VERIFY( setsockopt( clientSocket, SOL_SOCKET, SO_NOSIGPIPE, (void *)&nosigpipe, sizeof( int ) ) == 0 );
+            #endif
+            HandleClient( clientSocket, options );
+            close( clientSocket );
+        }
+
+        close( listenSocket );
+        unlink( socketName.Get() );
+
+        FDELETE m_FBuild;
+        m_FBuild = nullptr;
+        return true;
+    #endif
+}
+
+// CanForward
+//------------------------------------------------------------------------------
+/*static*/ bool BuildDaemon::CanForward( const FBuildOptions & options )
+{
+    #if defined( __WINDOWS__ )
+        (void)options;
+        return false;
+    #else
+        // Only builds are forwarded
+        return ( options.m_Daemon == false ) &&
+               ( options.m_Watch == false ) &&
+               ( options.m_DisplayTargetList == false ) &&
+               ( options.m_DisplayDependencyDB == false ) &&
+               ( options.m_GenerateDotGraph == false ) &&
+               ( options.m_GenerateCompilationDatabase == false ) &&
+               ( options.m_CacheInfo == false ) &&
+               ( options.m_CacheTrim == 0 );
+    #endif
+}
+
+// Forward
+//------------------------------------------------------------------------------
+/*static*/ bool BuildDaemon::ForwardBuild( const FBuildOptions & options, int argc, char * argv[], Result & outResult )
+{
+    #if defined( __WINDOWS__ )
+        (void)options;
+        (void)argc;
+        (void)argv;
+        (void)outResult;
+        return false;
+    #else
+        AStackString<> socketDir;
+        AStackString<> socketName;
+        sockaddr_un address;
+        if ( ( GetSocketName( options, socketDir, socketName ) == false ) ||
+             ( MakeAddress( socketName, address ) == false ) ||
+             ( EnsurePrivateDir( socketDir, false ) == false ) )
+        {
+            return false;
+        }
+
+        const int32_t s = CreateSocket();
+        if ( s < 0 )
+        {
+            return false;
+        }
+        if ( connect( s, (const sockaddr *)&address, sizeof( address ) ) != 0 )
+        {
+            close( s );
+            return false; // No daemon running
+        }
+        if ( IsPeerCurrentUser( s ) == false )
+        {
+            OUTPUT( "FBuild: Warning: Ignoring daemon socket '%s' owned by another user.\n", socketName.Get() );
+            close( s );
+            return false;
+        }
+
+        // Send the command line
+        MemoryStream request;
+        request.Write( (uint8_t)MSG_BUILD );
+        request.Write( FBUILD_VERSION );
+        request.Write( options.GetWorkingDir() );
+        request.Write( (uint32_t)argc );
+        for ( int i = 0; i < argc; ++i )
+        {
+            request.Write( AStackString<>( argv[ i ] ) );
+        }
+        Array< AString > environment( 128, true );
+        Env::GetEnvironment( environment );
+        request.Write( environment );
+        if ( SendMessage( s, request ) == false )
+        {
+            close( s );
+            return false;
+        }
+
+        // Display output until the build completes
+        outResult = RESULT_BUILD_FAILED;
+        for ( ;; )
+        {
+            // Disconnecting on Ctrl-C aborts the build
+            if ( FBuild::GetStopBuild() )
+            {
+                break;
+            }
+            if ( WaitForData( s, 100 ) == false )
+            {
+                continue;
+            }
+
+            ConstMemoryStream message;
+            uint8_t type = 0;
+            if ( ( ReceiveMessage( s, message ) == false ) ||
+                 ( message.Read( type ) == false ) )
+            {
+                OUTPUT( "FBuild: Error: Lost connection to daemon.\n" );
+                break;
+            }
+            if ( type == MSG_OUTPUT )
+            {
+                AStackString<> text;
+                if ( message.Read( text ) )
+                {
+                    Tracing::Output( text.Get() );
+                }
+            }
+            else if ( type == MSG_RESULT )
+            {
+                uint8_t result = RESULT_BUILD_FAILED;
+                VERIFY( message.Read( result ) );
+                outResult = (Result)result;
+                break;
+            }
+        }
+
+        close( s );
+        return true;
+    #endif
+}
+
+// GetSocketName
+//------------------------------------------------------------------------------
+/*static*/ bool BuildDaemon::GetSocketName( const FBuildOptions & options, AString & outSocketDir, AString & outSocketName )
+{
+    if ( FBuild::GetTempDir( outSocketDir ) == false )
+    {
+        return false;
+    }
+    #if defined( __WINDOWS__ )
+        outSocketDir += "fbuild_daemon";
+    #else
+        outSocketDir.AppendFormat( "fbuild_daemon_%u", (uint32_t)getuid() );
+    #endif
+    outSocketName = outSocketDir;
+    outSocketName.AppendFormat( "%c%08x.sock", NATIVE_SLASH, options.GetWorkingDirHash() );
+    return true;
+}
+
+#if !defined( __WINDOWS__ )
+    // HandleClient
+    //------------------------------------------------------------------------------
+    void BuildDaemon::HandleClient( int32_t clientSocket, const FBuildOptions & daemonOptions )
+    {
+        // Read the command line (sent immediately on connection)
+        ConstMemoryStream request;
+        uint8_t type = 0;
+        uint32_t version = 0;
+        AStackString<> workingDir;
+        uint32_t numArgs = 0;
+        if ( ( WaitForData( clientSocket, 5000 ) == false ) ||
+             ( ReceiveMessage( clientSocket, request ) == false ) ||
+             ( request.Read( type ) == false ) ||
+             ( type != MSG_BUILD ) ||
+             ( request.Read( version ) == false ) ||
+             ( request.Read( workingDir ) == false ) ||
+             ( request.Read( numArgs ) == false ) )
+        {
+            return; // Not a valid client
+        }
+        Array< AString > args( numArgs, false );
+        for ( uint32_t i = 0; i < numArgs; ++i )
+        {
+            if ( request.Read( args.EmplaceBack() ) == false )
+            {
+                return;
+            }
+        }
+        Array< AString > environment;
+        if ( request.Read( environment ) == false )
+        {
+            return;
+        }
+
+        // Forward all output to the client
+        m_ClientSocket = clientSocket;
+        AtomicStoreRelaxed( &m_ClientDisconnected, false );
+        s_Instance = this;
+        Tracing::AddCallbackOutput( &OutputCallback );
+
+        Result result = RESULT_BAD_ARGS;
+        if ( version != FBUILD_VERSION )
+        {
+            OUTPUT( "FBuild: Error: Daemon is running a different version of FASTBuild.\n" );
+        }
+        else if ( PathUtils::ArePathsEqual( workingDir, daemonOptions.GetWorkingDir() ) == false )
+        {
+            OUTPUT( "FBuild: Error: Daemon is running in a different working dir '%s'.\n", daemonOptions.GetWorkingDir().Get() );
+        }
+        else
+        {
+            Array< char * > argv( args.GetSize(), false );
+            for ( AString & arg : args )
+            {
+                argv.Append( arg.Get() );
+            }
+
+            // Build in the environment of the client. If it differs from the
+            // previous build, the graph is not reused.
+            SetEnvironment( environment );
+
+            FBuildOptions options;
+            options.m_SaveDBOnCompletion = true; // As for regular builds
+            if ( options.ProcessCommandLine( (int)argv.GetSize(), argv.Begin() ) == FBuildOptions::OPTIONS_OK )
+            {
+                result = Build( options );
+            }
+        }
+
+        Tracing::RemoveCallbackOutput( &OutputCallback );
+        s_Instance = nullptr;
+
+        if ( AtomicLoadRelaxed( &m_ClientDisconnected ) == false )
+        {
+            MemoryStream message;
+            message.Write( (uint8_t)MSG_RESULT );
+            message.Write( (uint8_t)result );
+            SendMessage( clientSocket, message );
+        }
+        m_ClientSocket = -1;
+    }
+
+    // Build
+    //------------------------------------------------------------------------------
+    BuildDaemon::Result BuildDaemon::Build( const FBuildOptions & options )
+    {
+        // Keep the previously loaded graph if possible
+        if ( m_FBuild && ( m_FBuild->ReuseForBuild( options ) == false ) )
+        {
+            FDELETE m_FBuild;
+            m_FBuild = nullptr;
+        }
+        if ( m_FBuild == nullptr )
+        {
+            m_FBuild = FNEW( FBuild( options ) );
+            if ( m_FBuild->Initialize() == false )
+            {
+                FDELETE m_FBuild;
+                m_FBuild = nullptr;
+                return RESULT_ERROR_LOADING_BFF;
+            }
+        }
+        else
+        {
+            FLOG_VERBOSE( "Reusing loaded dependency graph" );
+        }
+
+        // Abort the build if the client goes away (Ctrl-C etc.)
+        AtomicStoreRelaxed( &m_Building, true );
+        Thread clientThread;
+        clientThread.Start( ClientThreadFunc, "DaemonClient", this );
+
+        bool result = m_FBuild->Build( options.m_Targets );
+
+        AtomicStoreRelaxed( &m_Building, false );
+        clientThread.Join();
+
+        // The daemon itself should keep running
+        if ( AtomicLoadRelaxed( &m_ClientDisconnected ) )
+        {
+            AtomicStoreRelaxed( &FBuild::s_StopBuild, false );
+        }
+
+        if ( options.m_Profile )
+        {
+            if ( BuildProfiler::Get().SaveJSON( options, "fbuild_profile.json" ) == false )
+            {
+                result = false;
+            }
+        }
+
+        return result ? RESULT_OK : RESULT_BUILD_FAILED;
+    }
+
+    // OutputCallback
+    //------------------------------------------------------------------------------
+    /*static*/ bool BuildDaemon::OutputCallback( const char * message )
+    {
+        BuildDaemon * daemon = s_Instance;
+        if ( daemon && ( AtomicLoadRelaxed( &daemon->m_ClientDisconnected ) == false ) )
+        {
+            MemoryStream ms;
+            ms.Write( (uint8_t)MSG_OUTPUT );
+            ms.Write( AStackString<>( message ) );
+            if ( SendMessage( daemon->m_ClientSocket, ms ) == false )
+            {
+                AtomicStoreRelaxed( &daemon->m_ClientDisconnected, true );
+                FBuild::AbortBuild();
+            }
+        }
+        return true; // Also shown by the daemon
+    }
+
+    // ClientThreadFunc
+    //------------------------------------------------------------------------------
+    /*static*/ uint32_t BuildDaemon::ClientThreadFunc( void * userData )
+    {
+        BuildDaemon & daemon = *static_cast< BuildDaemon * >( userData );
+        while ( AtomicLoadRelaxed( &daemon.m_Building ) )
+        {
+            // Clients send nothing after the command line, so any activity is
+            // a disconnection
+            if ( WaitForData( daemon.m_ClientSocket, 100 ) )
+            {
+                AtomicStoreRelaxed( &daemon.m_ClientDisconnected, true );
+                FBuild::AbortBuild();
+                break;
+            }
+        }
+        return 0;
+    }
+#endif
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+// BuildDaemon - keep the dependency graph loaded between builds
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Env/Types.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+class FBuild;
+class FBuildOptions;
+
+// BuildDaemon
+//------------------------------------------------------------------------------
+// A resident process (-daemon) keeps the dependency graph, cache and LightCache
+// include information loaded, and performs builds on behalf of subsequent
+// invocations of FASTBuild in the same working dir. These act as thin clients,
+// forwarding their command line over a local socket and displaying the output
+// and result of the build.
+//
+// Builds are performed in the environment of the client, and the graph is loaded
+// again when it differs from that of the previous build. The socket is created
+// in a per-user directory (mode 0700) in the temp dir, and both ends check the
+// other belongs to the same user.
+class BuildDaemon
+{
+public:
+    explicit BuildDaemon();
+    ~BuildDaemon();
+
+    enum Result : uint8_t
+    {
+        RESULT_OK,
+        RESULT_BUILD_FAILED,
+        RESULT_ERROR_LOADING_BFF,
+        RESULT_BAD_ARGS,
+    };
+
+    // Daemon
+    bool Run( const FBuildOptions & options ); // Until Ctrl-C
+
+    // Client
+    static bool CanForward( const FBuildOptions & options );
+    static bool ForwardBuild( const FBuildOptions & options, int argc, char * argv[], Result & outResult ); // Returns false if no daemon is running
+
+private:
+    static bool GetSocketName( const FBuildOptions & options, AString & outSocketDir, AString & outSocketName );
+
+    #if !defined( __WINDOWS__ )
+        void HandleClient( int32_t clientSocket, const FBuildOptions & daemonOptions );
+        Result Build( const FBuildOptions & options );
+        static bool OutputCallback( const char * message );
+        static uint32_t ClientThreadFunc( void * userData );
+    #endif
+
+    FBuild *        m_FBuild = nullptr;         // Kept between builds when possible
+    int32_t         m_ClientSocket = -1;
+    volatile bool   m_Building = false;
+    volatile bool   m_ClientDisconnected = false;
+
+    static BuildDaemon * s_Instance;            // For output callback
+};
+
+//------------------------------------------------------------------------------
@@ -7,13 +7,19 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/ContentChunker.h"
 
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/Env/Assert.h"
+#include "Core/Env/Env.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/FileStream.h"
 #include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
 #include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 
 // External
@@ -22,6 +28,96 @@
 
 #include <memory.h>
 
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // LZ4 only refers back this far
+    constexpr uint32_t kMaxDictionarySize = ( 64 * 1024 );
+
+    // Blocks are compressed independently so they can be compressed in parallel
+    constexpr size_t kMultiThreadedMinSize = ( 8 * 1024 * 1024 );
+    constexpr uint32_t kMaxThreads = 8;
+
+    // Set in the compressed size of blocks which didn't compress
+    constexpr uint32_t kStoredBlockFlag = 0x80000000;
+}
+
+// BlockContext
+//------------------------------------------------------------------------------
+struct Compressor::BlockContext
+{
+    const char *                    m_Data;
+    const uint32_t *                m_BlockSizes;
+    const size_t *                  m_BlockOffsets;
+    int32_t                         m_CompressionLevel;
+    const CompressionDictionary *   m_Dictionary;
+    uint32_t                        m_NumBlocks;
+    uint32_t                        m_MaxCompressedBlockSize;
+    char *                          m_Output;               // m_MaxCompressedBlockSize per block
+    uint32_t *                      m_CompressedBlockSizes;
+    volatile uint32_t               m_NextBlock;
+};
+
+// CompressionDictionary - CONSTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::CompressionDictionary()
+    : m_Data( nullptr )
+    , m_Size( 0 )
+    , m_Id( 0 )
+{
+}
+
+// CompressionDictionary - DESTRUCTOR
+//------------------------------------------------------------------------------
+CompressionDictionary::~CompressionDictionary()
+{
+    FREE( m_Data );
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool CompressionDictionary::Load( const AString & fileName )
+{
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return false;
+    }
+    const uint64_t fileSize = f.GetFileSize();
+    if ( fileSize == 0 )
+    {
+        return false;
+    }
+
+    // Only the end of the file is used
+    const uint32_t size = (uint32_t)Math::Min< uint64_t >( fileSize, kMaxDictionarySize );
+    UniquePtr< char > mem( (char *)ALLOC( size ) );
+    if ( ( f.Seek( fileSize - size ) == false ) ||
+         ( f.ReadBuffer( mem.Get(), size ) != size ) )
+    {
+        return false;
+    }
+
+    SetData( mem.Get(), size );
+    return true;
+}
+
+// SetData
+//------------------------------------------------------------------------------
+void CompressionDictionary::SetData( const void * data, size_t dataSize )
+{
+    // Only the end of the data is used
+    const size_t size = Math::Min< size_t >( dataSize, kMaxDictionarySize );
+    const char * start = ( (const char *)data + ( dataSize - size ) );
+
+    FREE( m_Data );
+    m_Data = (char *)ALLOC( size );
+    memcpy( m_Data, start, size );
+    m_Size = (uint32_t)size;
+    m_Id = ( size > 0 ) ? xxHash::Calc64( m_Data, size ) : 0;
+}
+
 //------------------------------------------------------------------------------
 Compressor::Compressor()
     : m_Result( nullptr )
@@ -42,7 +138,7 @@ Compressor::~Compressor()
 {
     ASSERT( data );
     const Header * header = (const Header *)data;
-    if ( header->m_CompressionType > 1 )
+    if ( header->m_CompressionType > COMPRESSION_TYPE_LZ4_BLOCKS )
     {
         return false;
     }
@@ -69,30 +165,83 @@ Compressor::~Compressor()
     return header->m_UncompressedSize;
 }
 
+// GetBlockSizes
+//------------------------------------------------------------------------------
+/*static*/ bool Compressor::GetBlockSizes( const void * data, size_t dataSize, Array< uint32_t > & outSizes )
+{
+    if ( ( dataSize < ( sizeof( Header ) + sizeof( BlocksHeader ) ) ) || ( IsValidData( data, dataSize ) == false ) )
+    {
+        return false;
+    }
+    const Header * header = (const Header *)data;
+    if ( header->m_CompressionType != COMPRESSION_TYPE_LZ4_BLOCKS )
+    {
+        return false;
+    }
+    const BlocksHeader * blocksHeader = (const BlocksHeader *)( header + 1 );
+    const uint32_t numBlocks = blocksHeader->m_NumBlocks;
+    const size_t headersSize = sizeof( Header ) + sizeof( BlocksHeader ) + ( sizeof( uint32_t ) * 2 * (size_t)numBlocks );
+    if ( headersSize > dataSize )
+    {
+        return false; // Data is corrupt
+    }
+
+    const size_t oldSize = outSizes.GetSize();
+    outSizes.Append( (uint32_t)headersSize );
+    size_t totalSize = headersSize;
+    const uint32_t * compressedBlockSizes = (const uint32_t *)( blocksHeader + 1 );
+    for ( uint32_t i = 0; i < numBlocks; ++i )
+    {
+        const uint32_t blockSize = ( compressedBlockSizes[ i ] & ~kStoredBlockFlag );
+        outSizes.Append( blockSize );
+        totalSize += blockSize;
+    }
+    if ( totalSize != dataSize )
+    {
+        outSizes.SetSize( oldSize );
+        return false; // Data is corrupt
+    }
+    return true;
+}
+
 // Compress
 //------------------------------------------------------------------------------
-bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressionLevel )
+bool Compressor::Compress( const void * data,
+                           size_t dataSize,
+                           int32_t compressionLevel,
+                           const CompressionDictionary * dictionary,
+                           bool allowBlocks )
 {
     PROFILE_FUNCTION;
 
     ASSERT( data );
     ASSERT( m_Result == nullptr );
 
-    // allocate worst case output size for LZ4
-    const int worstCaseSize = LZ4_compressBound( (int)dataSize );
-    UniquePtr< char > output( (char *)ALLOC( (size_t)worstCaseSize ) );
-
+    UniquePtr< char > output;
     int32_t compressedSize;
+    uint32_t compressionType = COMPRESSION_TYPE_LZ4;
 
     // do compression
-    if ( compressionLevel > 0 )
+    if ( ( compressionLevel != 0 ) &&
+         ( ( dictionary && ( dictionary->GetSize() > 0 ) ) || ( allowBlocks && ( dataSize >= kMultiThreadedMinSize ) ) ) )
+    {
+        char * blocks = nullptr;
+        compressedSize = CompressBlocks( data, dataSize, compressionLevel, dictionary, blocks );
+        output = blocks;
+        compressionType = COMPRESSION_TYPE_LZ4_BLOCKS;
+    }
+    else if ( compressionLevel > 0 )
     {
         // Higher compression, using LZ4HC
+        const int worstCaseSize = LZ4_compressBound( (int)dataSize );
+        output = (char *)ALLOC( (size_t)worstCaseSize );
         compressedSize = LZ4_compress_HC( (const char*)data, output.Get(), (int)dataSize, worstCaseSize, compressionLevel );
     }
     else if ( compressionLevel < 0 )
     {
         // Lower compression, using regular LZ4
+        const int worstCaseSize = LZ4_compressBound( (int)dataSize );
+        output = (char *)ALLOC( (size_t)worstCaseSize );
         const int32_t acceleration = ( 0 - compressionLevel );
         compressedSize = LZ4_compress_fast( (const char*)data, output.Get(), (int)dataSize, worstCaseSize, acceleration );
     }
@@ -122,7 +271,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
     // fill out header
     Header * header = (Header*)m_Result;
-    header->m_CompressionType = compressed ? 1u : 0u;   // compression type
+    header->m_CompressionType = compressed ? compressionType : COMPRESSION_TYPE_NONE;
     header->m_UncompressedSize = (uint32_t)dataSize;    // input size
     header->m_CompressedSize = compressed ? (uint32_t)compressedSize : (uint32_t)dataSize;    // output size
 
@@ -131,7 +280,7 @@ bool Compressor::Compress( const void * data, size_t dataSize, int32_t compressi
 
 // Decompress
 //------------------------------------------------------------------------------
-bool Compressor::Decompress( const void * data )
+bool Compressor::Decompress( const void * data, const CompressionDictionary * dictionary )
 {
     PROFILE_FUNCTION;
 
@@ -141,14 +290,18 @@ bool Compressor::Decompress( const void * data )
     const Header * header = (const Header *)data;
 
     // handle uncompressed case
-    if ( header->m_CompressionType == 0 )
+    if ( header->m_CompressionType == COMPRESSION_TYPE_NONE )
     {
         m_Result = ALLOC( header->m_UncompressedSize );
         memcpy( m_Result, (const char *)data + sizeof( Header ), header->m_UncompressedSize );
         m_ResultSize = header->m_UncompressedSize;
         return true;
     }
-    ASSERT( header->m_CompressionType == 1 );
+    if ( header->m_CompressionType == COMPRESSION_TYPE_LZ4_BLOCKS )
+    {
+        return DecompressBlocks( *header, (const char *)data + sizeof( Header ), dictionary );
+    }
+    ASSERT( header->m_CompressionType == COMPRESSION_TYPE_LZ4 );
 
     // uncompressed size
     const uint32_t uncompressedSize = header->m_UncompressedSize;
@@ -172,4 +325,248 @@ bool Compressor::Decompress( const void * data )
     return false;
 }
 
+// CompressBlocks
+//------------------------------------------------------------------------------
+/*static*/ int32_t Compressor::CompressBlocks( const void * data,
+                                               size_t dataSize,
+                                               int32_t compressionLevel,
+                                               const CompressionDictionary * dictionary,
+                                               char * & outCompressed )
+{
+    // Split at content-defined boundaries, so inserting or removing data only
+    // changes the blocks around the edit
+    Array< uint32_t > blockSizes( 256, true );
+    ContentChunker::Split( data, dataSize, blockSizes );
+    if ( blockSizes.IsEmpty() )
+    {
+        blockSizes.Append( 0 );
+    }
+    const uint32_t numBlocks = (uint32_t)blockSizes.GetSize();
+    Array< size_t > blockOffsets( numBlocks, false );
+    size_t offset = 0;
+    uint32_t maxBlockSize = 0;
+    for ( const uint32_t blockSize : blockSizes )
+    {
+        blockOffsets.Append( offset );
+        offset += blockSize;
+        maxBlockSize = Math::Max( maxBlockSize, blockSize );
+    }
+
+    BlockContext context;
+    context.m_Data = (const char *)data;
+    context.m_BlockSizes = blockSizes.Begin();
+    context.m_BlockOffsets = blockOffsets.Begin();
+    context.m_CompressionLevel = compressionLevel;
+    context.m_Dictionary = ( dictionary && ( dictionary->GetSize() > 0 ) ) ? dictionary : nullptr;
+    context.m_NumBlocks = numBlocks;
+    context.m_MaxCompressedBlockSize = (uint32_t)LZ4_compressBound( (int)maxBlockSize );
+    UniquePtr< char > output( (char *)ALLOC( (size_t)context.m_MaxCompressedBlockSize * context.m_NumBlocks ) );
+    UniquePtr< uint32_t > compressedBlockSizes( (uint32_t *)ALLOC( sizeof( uint32_t ) * context.m_NumBlocks ) );
+    context.m_Output = output.Get();
+    context.m_CompressedBlockSizes = compressedBlockSizes.Get();
+    context.m_NextBlock = 0;
+
+    // Large inputs are compressed in parallel, with this thread helping
+    uint32_t numThreads = 1;
+    if ( dataSize >= kMultiThreadedMinSize )
+    {
+        numThreads = Math::Min( context.m_NumBlocks, Math::Min( Env::GetNumProcessors(), kMaxThreads ) );
+    }
+    Thread threads[ kMaxThreads ];
+    for ( uint32_t i = 1; i < numThreads; ++i )
+    {
+        threads[ i ].Start( CompressBlocksThreadFunc, "Compressor", &context );
+    }
+    CompressBlocksFromContext( context );
+    for ( uint32_t i = 1; i < numThreads; ++i )
+    {
+        threads[ i ].Join();
+    }
+
+    // Did the compression yield any benefit?
+    size_t compressedSize = sizeof( BlocksHeader ) + ( sizeof( uint32_t ) * 2 * (size_t)context.m_NumBlocks );
+    for ( uint32_t i = 0; i < context.m_NumBlocks; ++i )
+    {
+        compressedSize += ( context.m_CompressedBlockSizes[ i ] & ~kStoredBlockFlag );
+    }
+    if ( compressedSize >= dataSize )
+    {
+        return (int32_t)dataSize; // Act as if compression achieved nothing
+    }
+
+    // Pack blocks together
+    char * result = (char *)ALLOC( compressedSize );
+    BlocksHeader * blocksHeader = (BlocksHeader *)result;
+    blocksHeader->m_DictionaryId = context.m_Dictionary ? context.m_Dictionary->GetId() : 0;
+    blocksHeader->m_NumBlocks = context.m_NumBlocks;
+    blocksHeader->m_Padding = 0;
+    char * pos = ( result + sizeof( BlocksHeader ) );
+    memcpy( pos, context.m_CompressedBlockSizes, sizeof( uint32_t ) * context.m_NumBlocks );
+    pos += ( sizeof( uint32_t ) * context.m_NumBlocks );
+    memcpy( pos, context.m_BlockSizes, sizeof( uint32_t ) * context.m_NumBlocks );
+    pos += ( sizeof( uint32_t ) * context.m_NumBlocks );
+    for ( uint32_t i = 0; i < context.m_NumBlocks; ++i )
+    {
+        const uint32_t blockSize = ( context.m_CompressedBlockSizes[ i ] & ~kStoredBlockFlag );
+        memcpy( pos, context.m_Output + ( (size_t)i * context.m_MaxCompressedBlockSize ), blockSize );
+        pos += blockSize;
+    }
+    ASSERT( pos == ( result + compressedSize ) );
+
+    outCompressed = result;
+    return (int32_t)compressedSize;
+}
+
+// CompressBlocksThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Compressor::CompressBlocksThreadFunc( void * param )
+{
+    PROFILE_SET_THREAD_NAME( "Compressor" );
+
+    CompressBlocksFromContext( *static_cast< BlockContext * >( param ) );
+    return 0;
+}
+
+// CompressBlocksFromContext
+//------------------------------------------------------------------------------
+/*static*/ void Compressor::CompressBlocksFromContext( BlockContext & context )
+{
+    for ( ;; )
+    {
+        const uint32_t blockIndex = ( AtomicInc( &context.m_NextBlock ) - 1 );
+        if ( blockIndex >= context.m_NumBlocks )
+        {
+            return;
+        }
+        context.m_CompressedBlockSizes[ blockIndex ] = CompressBlock( context, blockIndex );
+    }
+}
+
+// CompressBlock
+//------------------------------------------------------------------------------
+/*static*/ uint32_t Compressor::CompressBlock( const BlockContext & context, uint32_t blockIndex )
+{
+    PROFILE_FUNCTION;
+
+    const char * src = ( context.m_Data + context.m_BlockOffsets[ blockIndex ] );
+    const int srcSize = (int)context.m_BlockSizes[ blockIndex ];
+    char * dst = ( context.m_Output + ( (size_t)blockIndex * context.m_MaxCompressedBlockSize ) );
+    const int dstCapacity = (int)context.m_MaxCompressedBlockSize;
+    const CompressionDictionary * dictionary = context.m_Dictionary;
+
+    int compressedSize;
+    if ( context.m_CompressionLevel > 0 )
+    {
+        // Higher compression, using LZ4HC
+        UniquePtr< char > mem( (char *)ALLOC( sizeof( LZ4_streamHC_t ), sizeof( void * ) ) );
+        LZ4_streamHC_t * stream = LZ4_initStreamHC( mem.Get(), sizeof( LZ4_streamHC_t ) );
+        LZ4_resetStreamHC_fast( stream, context.m_CompressionLevel );
+        if ( dictionary )
+        {
+            LZ4_loadDictHC( stream, dictionary->GetData(), (int)dictionary->GetSize() );
+        }
+        compressedSize = LZ4_compress_HC_continue( stream, src, dst, srcSize, dstCapacity );
+    }
+    else
+    {
+        // Lower compression, using regular LZ4
+        UniquePtr< char > mem( (char *)ALLOC( sizeof( LZ4_stream_t ), sizeof( void * ) ) );
+        LZ4_stream_t * stream = LZ4_initStream( mem.Get(), sizeof( LZ4_stream_t ) );
+        if ( dictionary )
+        {
+            LZ4_loadDict( stream, dictionary->GetData(), (int)dictionary->GetSize() );
+        }
+        const int32_t acceleration = ( 0 - context.m_CompressionLevel );
+        compressedSize = LZ4_compress_fast_continue( stream, src, dst, srcSize, dstCapacity, acceleration );
+    }
+
+    // Store blocks which don't compress
+    if ( ( compressedSize <= 0 ) || ( compressedSize >= srcSize ) )
+    {
+        memcpy( dst, src, (size_t)srcSize );
+        return ( (uint32_t)srcSize | kStoredBlockFlag );
+    }
+    return (uint32_t)compressedSize;
+}
+
+// DecompressBlocks
+//------------------------------------------------------------------------------
+bool Compressor::DecompressBlocks( const Header & header, const void * data, const CompressionDictionary * dictionary )
+{
+    const BlocksHeader * blocksHeader = (const BlocksHeader *)data;
+    const uint32_t numBlocks = blocksHeader->m_NumBlocks;
+    const uint32_t uncompressedSize = header.m_UncompressedSize;
+    if ( ( header.m_CompressedSize < sizeof( BlocksHeader ) ) ||
+         ( numBlocks == 0 ) ||
+         ( ( header.m_CompressedSize - sizeof( BlocksHeader ) ) / ( sizeof( uint32_t ) * 2 ) < numBlocks ) )
+    {
+        return false; // Data is corrupt
+    }
+    const uint32_t * compressedBlockSizes = (const uint32_t *)( blocksHeader + 1 );
+    const uint32_t * blockSizes = ( compressedBlockSizes + numBlocks );
+    uint64_t totalBlockSize = 0;
+    for ( uint32_t i = 0; i < numBlocks; ++i )
+    {
+        totalBlockSize += blockSizes[ i ];
+    }
+    if ( totalBlockSize != uncompressedSize )
+    {
+        return false; // Data is corrupt
+    }
+
+    // Data compressed with a dictionary needs the same dictionary
+    const char * dictData = nullptr;
+    int dictSize = 0;
+    if ( blocksHeader->m_DictionaryId != 0 )
+    {
+        if ( ( dictionary == nullptr ) || ( dictionary->GetId() != blocksHeader->m_DictionaryId ) )
+        {
+            return false;
+        }
+        dictData = dictionary->GetData();
+        dictSize = (int)dictionary->GetSize();
+    }
+
+    UniquePtr< char > result( (char *)ALLOC( uncompressedSize ) );
+
+    const char * src = (const char *)( blockSizes + numBlocks );
+    const char * const srcEnd = ( (const char *)data + header.m_CompressedSize );
+    size_t offset = 0;
+    for ( uint32_t i = 0; i < numBlocks; ++i )
+    {
+        const int dstSize = (int)blockSizes[ i ];
+        const bool stored = ( ( compressedBlockSizes[ i ] & kStoredBlockFlag ) != 0 );
+        const uint32_t srcSize = ( compressedBlockSizes[ i ] & ~kStoredBlockFlag );
+        if ( srcSize > (size_t)( srcEnd - src ) )
+        {
+            return false; // Data is corrupt
+        }
+
+        char * dst = ( result.Get() + offset );
+        if ( stored )
+        {
+            if ( srcSize != (uint32_t)dstSize )
+            {
+                return false; // Data is corrupt
+            }
+            memcpy( dst, src, srcSize );
+        }
+        else
+        {
+            const int bytesDecompressed = dictData ? LZ4_decompress_safe_usingDict( src, dst, (int)srcSize, dstSize, dictData, dictSize )
+                                                   : LZ4_decompress_safe( src, dst, (int)srcSize, dstSize );
+            if ( bytesDecompressed != dstSize )
+            {
+                return false; // Data is corrupt
+            }
+        }
+        src += srcSize;
+        offset += (size_t)dstSize;
+    }
+
+    m_Result = result.Release();
+    m_ResultSize = uncompressedSize;
+    return true;
+}
+
 //------------------------------------------------------------------------------
@@ -4,8 +4,37 @@
 
 // Includes
 //------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
 
+// Forward Declarations
+//------------------------------------------------------------------------------
+class AString;
+
+// CompressionDictionary
+//------------------------------------------------------------------------------
+// Content (such as a typical object file) which compressed data can refer to,
+// improving compression of small inputs. Data compressed with a dictionary can
+// only be decompressed with the same dictionary.
+class CompressionDictionary
+{
+public:
+    explicit CompressionDictionary();
+    ~CompressionDictionary();
+
+    bool Load( const AString & fileName );
+    void SetData( const void * data, size_t dataSize );
+
+    const char *    GetData() const { return m_Data; }
+    uint32_t        GetSize() const { return m_Size; }
+    uint64_t        GetId() const   { return m_Id; }
+
+private:
+    char *      m_Data;
+    uint32_t    m_Size;
+    uint64_t    m_Id;       // Hash of content, stored in compressed data
+};
+
 // Compressor
 //------------------------------------------------------------------------------
 class Compressor
@@ -17,12 +46,27 @@ public:
     static bool     IsValidData( const void * data, size_t dataSize );
     static uint32_t GetUncompressedSize( const void * data, size_t dataSize );
 
+    // Sizes of consecutive parts of data compressed as blocks: the headers,
+    // then each block. Blocks end at content-defined boundaries of the
+    // uncompressed data, so unchanged regions of similar inputs compress to
+    // identical blocks. Fails if the data isn't compressed as blocks.
+    static bool     GetBlockSizes( const void * data, size_t dataSize, Array< uint32_t > & outSizes );
+
     // compressionLevel:
     //   < 0 : use LZ4, with values directly mapping to "acceleration level"
     //  == 0 : disable compression
     //   > 0 : use LZ4HC, with values direcly mapping to "compression level"
-    bool Compress( const void * data, size_t dataSize, int32_t compressionLevel = -1 ); // -1 = default LZ4 compression level
-    bool Decompress( const void * data );
+    //
+    // With allowBlocks, large inputs (such as PCH) are split into independent
+    // content-defined blocks which are compressed on multiple threads. Inputs
+    // compressed using a dictionary are always stored as blocks. Older versions
+    // can't decompress blocks, so they are not sent over the network.
+    bool Compress( const void * data,
+                   size_t dataSize,
+                   int32_t compressionLevel = -1, // -1 = default LZ4 compression level
+                   const CompressionDictionary * dictionary = nullptr,
+                   bool allowBlocks = false );
+    bool Decompress( const void * data, const CompressionDictionary * dictionary = nullptr );
 
     const void *    GetResult() const       { return m_Result; }
     size_t          GetResultSize() const   { return m_ResultSize; }
@@ -30,12 +74,39 @@ public:
     inline void *   ReleaseResult()         { void * r = m_Result; m_Result = nullptr; m_ResultSize = 0; return r; }
 
 private:
+    enum : uint32_t
+    {
+        COMPRESSION_TYPE_NONE       = 0,
+        COMPRESSION_TYPE_LZ4        = 1,
+        COMPRESSION_TYPE_LZ4_BLOCKS = 2,
+    };
     struct Header
     {
         uint32_t m_CompressionType;
         uint32_t m_UncompressedSize;
         uint32_t m_CompressedSize;
     };
+    // Follows the Header for COMPRESSION_TYPE_LZ4_BLOCKS, followed in turn by the
+    // compressed size of each block, the uncompressed size of each block and
+    // then the blocks
+    struct BlocksHeader
+    {
+        uint64_t m_DictionaryId;    // 0 = no dictionary
+        uint32_t m_NumBlocks;
+        uint32_t m_Padding;
+    };
+    struct BlockContext;
+
+    static int32_t  CompressBlocks( const void * data,
+                                    size_t dataSize,
+                                    int32_t compressionLevel,
+                                    const CompressionDictionary * dictionary,
+                                    char * & outCompressed );
+    static uint32_t CompressBlocksThreadFunc( void * param );
+    static void     CompressBlocksFromContext( BlockContext & context );
+    static uint32_t CompressBlock( const BlockContext & context, uint32_t blockIndex );
+    bool            DecompressBlocks( const Header & header, const void * data, const CompressionDictionary * dictionary );
+
     void * m_Result;
     size_t m_ResultSize;
 };
@@ -0,0 +1,84 @@
+// ContentChunker - Split data into content-defined chunks
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "ContentChunker.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/Math/Conversions.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Boundary when the top 20 bits of the hash are clear (1 MiB on average,
+    // after kMinChunkSize)
+    constexpr uint64_t kBoundaryMask = 0xFFFFF00000000000ULL;
+}
+
+// Split
+//------------------------------------------------------------------------------
+/*static*/ void ContentChunker::Split( const void * data, size_t dataSize, Array< uint32_t > & outChunkSizes )
+{
+    ASSERT( data || ( dataSize == 0 ) );
+
+    const uint64_t * gear = GetGearTable();
+    const uint8_t * const start = static_cast< const uint8_t * >( data );
+    const uint8_t * const end = ( start + dataSize );
+    const uint8_t * chunkStart = start;
+    while ( chunkStart < end )
+    {
+        const size_t remaining = (size_t)( end - chunkStart );
+        if ( remaining <= kMinChunkSize )
+        {
+            outChunkSizes.Append( (uint32_t)remaining );
+            break;
+        }
+
+        // Gear hash: each byte is shifted out after 64 bytes, so the hash only
+        // depends on the last 64 bytes
+        const uint8_t * pos = ( chunkStart + kMinChunkSize );
+        const uint8_t * const maxEnd = ( chunkStart + Math::Min< size_t >( remaining, kMaxChunkSize ) );
+        uint64_t hash = 0;
+        while ( pos < maxEnd )
+        {
+            hash = ( ( hash << 1 ) + gear[ *pos ] );
+            ++pos;
+            if ( ( hash & kBoundaryMask ) == 0 )
+            {
+                break;
+            }
+        }
+
+        outChunkSizes.Append( (uint32_t)( pos - chunkStart ) );
+        chunkStart = pos;
+    }
+}
+
+// GetGearTable
+//------------------------------------------------------------------------------
+/*static*/ const uint64_t * ContentChunker::GetGearTable()
+{
+    // A fixed sequence of random values (splitmix64)
+    static const struct GearTable
+    {
+        GearTable()
+        {
+            uint64_t state = 0;
+            for ( uint64_t & value : m_Values )
+            {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+                z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+                value = ( z ^ ( z >> 31 ) );
+            }
+        }
+        uint64_t m_Values[ 256 ];
+    } sGearTable;
+    return sGearTable.m_Values;
+}
+
+//------------------------------------------------------------------------------
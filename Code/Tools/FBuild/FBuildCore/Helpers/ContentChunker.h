@@ -0,0 +1,32 @@
+// ContentChunker - Split data into content-defined chunks
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Env/Types.h"
+
+// ContentChunker
+//------------------------------------------------------------------------------
+// Chunk boundaries are where a rolling hash of the preceding bytes matches a
+// pattern, rather than at fixed offsets. Inserting or removing data therefore
+// only changes the chunks around the edit, and the remaining chunks of two
+// similar inputs are identical (and can be stored once).
+//
+// Boundaries must never change between versions, as they determine which
+// chunks are shared with existing cache entries.
+class ContentChunker
+{
+public:
+    // Sizes of consecutive chunks, which add up to dataSize
+    static void Split( const void * data, size_t dataSize, Array< uint32_t > & outChunkSizes );
+
+    enum : uint32_t { kMinChunkSize = ( 256 * 1024 ) };
+    enum : uint32_t { kMaxChunkSize = ( 4 * 1024 * 1024 ) };
+
+private:
+    static const uint64_t * GetGearTable();
+};
+
+//------------------------------------------------------------------------------
@@ -38,6 +38,7 @@ FBuildStats::FBuildStats()
     , m_TotalBuildTime( 0.0f )
     , m_TotalLocalCPUTimeMS( 0 )
     , m_TotalRemoteCPUTimeMS( 0 )
+    , m_HasCacheTiers( false )
     , m_RootNode( nullptr )
     , m_NodesByTime( 100 * 1000, true )
 {}
@@ -50,6 +51,7 @@ FBuildStats::Stats::Stats()
     , m_NumCacheHits( 0 )
     , m_NumCacheMisses( 0 )
     , m_NumCacheStores( 0 )
+    , m_NumCacheFiltered( 0 )
     , m_NumLightCache( 0 )
     , m_ProcessingTimeMS( 0 )
     , m_NumFailed( 0 )
@@ -110,6 +112,7 @@ void FBuildStats::GatherPostBuildStatistics( Node * node )
         m_Totals.m_NumCacheHits     += m_PerTypeStats[ i ].m_NumCacheHits;
         m_Totals.m_NumCacheMisses   += m_PerTypeStats[ i ].m_NumCacheMisses;
         m_Totals.m_NumCacheStores   += m_PerTypeStats[ i ].m_NumCacheStores;
+        m_Totals.m_NumCacheFiltered += m_PerTypeStats[ i ].m_NumCacheFiltered;
         m_Totals.m_NumLightCache    += m_PerTypeStats[ i ].m_NumLightCache;
         m_Totals.m_CachingTimeMS    += m_PerTypeStats[ i ].m_CachingTimeMS;
     }
@@ -188,8 +191,21 @@ void FBuildStats::OutputSummary() const
         }
         output.AppendFormat( " - Hits       : %u (%2.1f %%)\n", hits, (double)hitPerc );
         output.AppendFormat( " - Misses     : %u\n", misses );
+        if ( m_Totals.m_NumCacheFiltered > 0 )
+        {
+            // Misses known from the cache filter, without a lookup
+            output.AppendFormat( "   - Filtered : %u\n", m_Totals.m_NumCacheFiltered );
+        }
         output.AppendFormat( " - Stores     : %u\n", stores );
     }
+    if ( m_HasCacheTiers )
+    {
+        const CacheTierStats & tiers = m_CacheTierStats;
+        output += "Cache Tiers:    Hit     Miss    Store\n";
+        output.AppendFormat( " - Memory     : %-8u%-8u-\n", tiers.m_MemoryHits, tiers.m_MemoryMisses );
+        output.AppendFormat( " - Local      : %-8u%-8u%u\n", tiers.m_LocalHits, tiers.m_LocalMisses, tiers.m_LocalStores );
+        output.AppendFormat( " - Shared     : %-8u%-8u%u\n", tiers.m_SharedHits, tiers.m_SharedMisses, tiers.m_SharedStores );
+    }
 
     AStackString<> buffer;
     FormatTime( m_TotalBuildTime, buffer );
@@ -258,6 +274,10 @@ void FBuildStats::GatherPostBuildStatisticsRecurse( Node * node )
         {
             stats.m_NumCacheMisses++;
         }
+        if ( node->GetStatFlag( Node::STATS_CACHE_FILTERED ) )
+        {
+            stats.m_NumCacheFiltered++;
+        }
         if ( node->GetStatFlag( Node::STATS_CACHE_STORE ) )
         {
             stats.m_NumCacheStores++;
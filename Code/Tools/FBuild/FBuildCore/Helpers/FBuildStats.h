@@ -5,6 +5,7 @@
 // Includes
 //------------------------------------------------------------------------------
 #include "Core/Env/Types.h"
+#include "Tools/FBuild/FBuildCore/Cache/ICache.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 
 // Forward Declarations
@@ -32,6 +33,10 @@ public:
     uint32_t    m_TotalLocalCPUTimeMS;  // Total CPU time on local host
     uint32_t    m_TotalRemoteCPUTimeMS; // Total CPU time on remote workers
 
+    // hits/misses per cache tier (when using local cache tiers)
+    bool            m_HasCacheTiers;
+    CacheTierStats  m_CacheTierStats;
+
     // after the build it complete, accumulate all the stats
     void GatherPostBuildStatistics( Node * node );
 
@@ -43,6 +48,7 @@ public:
     uint32_t GetCacheHits() const       { return m_Totals.m_NumCacheHits; }
     uint32_t GetCacheMisses() const     { return m_Totals.m_NumCacheMisses; }
     uint32_t GetCacheStores() const     { return m_Totals.m_NumCacheStores; }
+    uint32_t GetCacheFiltered() const   { return m_Totals.m_NumCacheFiltered; }
     uint32_t GetLightCacheCount() const { return m_Totals.m_NumLightCache; }
 
     // get stats per node type
@@ -59,6 +65,7 @@ public:
         uint32_t m_NumCacheHits;
         uint32_t m_NumCacheMisses;
         uint32_t m_NumCacheStores;
+        uint32_t m_NumCacheFiltered;
         uint32_t m_NumLightCache;
 
         uint32_t m_ProcessingTimeMS;
@@ -0,0 +1,803 @@
+// FileChangeJournal
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileChangeJournal.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+
+// Core
+#include "Core/Env/ErrorFormat.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Process/Process.h"
+#include "Core/Process/Thread.h"
+#include "Core/Profile/Profile.h"
+#include "Core/Strings/AStackString.h"
+#include "Core/Time/Timer.h"
+
+// System
+#if defined( __LINUX__ )
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <stdio.h>
+    #include <sys/file.h>
+    #include <sys/inotify.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Helpers
+//------------------------------------------------------------------------------
+namespace
+{
+    // Find an item in an array sorted by name
+    template < class ARRAY, class GET_NAME >
+    auto FindSorted( ARRAY & items, const AString & name, const GET_NAME & getName ) -> decltype( items.Begin() )
+    {
+        size_t low = 0;
+        size_t high = items.GetSize();
+        while ( low < high )
+        {
+            const size_t mid = ( low + ( ( high - low ) / 2 ) );
+            const int32_t result = getName( items[ mid ] ).Compare( name );
+            if ( result == 0 )
+            {
+                return ( items.Begin() + mid );
+            }
+            if ( result < 0 )
+            {
+                low = ( mid + 1 );
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return nullptr;
+    }
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileChangeJournal::FileChangeJournal() = default;
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileChangeJournal::~FileChangeJournal()
+{
+    StopWatching();
+}
+
+// GetJournalFileName
+//------------------------------------------------------------------------------
+/*static*/ void FileChangeJournal::GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFileName )
+{
+    outJournalFileName = nodeGraphDBFile;
+    outJournalFileName += ".journal";
+}
+
+// StartWatching
+//------------------------------------------------------------------------------
+bool FileChangeJournal::StartWatching( const char * journalFileName, const Array< const AString * > & fileNames )
+{
+    PROFILE_FUNCTION;
+
+    #if defined( __LINUX__ )
+        ASSERT( m_INotifyFD == -1 );
+
+        // Watched paths are full paths, so the journal's directory must be too
+        NodeGraph::CleanPath( AStackString<>( journalFileName ), m_JournalFileName );
+        const char * journalSlash = m_JournalFileName.FindLast( NATIVE_SLASH );
+        m_JournalBaseName = journalSlash ? ( journalSlash + 1 ) : m_JournalFileName.Get();
+        m_SyncBaseName = m_JournalBaseName;
+        m_SyncBaseName += ".sync";
+
+        m_INotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+        if ( m_INotifyFD == -1 )
+        {
+            FLOG_ERROR( "Failed to initialize inotify. Error: %s", LAST_ERROR_STR );
+            return false;
+        }
+
+        // Watch the directory of each file. Files in the same directory are
+        // adjacent once sorted, so each directory is only considered once.
+        Array< const AString * > sortedFileNames( fileNames );
+        sortedFileNames.SortDeref();
+
+        const uint32_t watchMask = ( IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF |
+                                     IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO );
+        Array< const AString * > watchedFileNames( sortedFileNames.GetSize(), false );
+        AStackString<> dirName;
+        bool dirWatched = false;
+        bool haveDir = false;
+        bool reportedWatchFailure = false;
+        for ( const AString * fileName : sortedFileNames )
+        {
+            const char * lastSlash = fileName->FindLast( NATIVE_SLASH );
+            if ( lastSlash == nullptr )
+            {
+                continue; // Not a full path (will be checked on disk when used)
+            }
+
+            const size_t dirLen = (size_t)( lastSlash - fileName->Get() );
+            if ( ( haveDir == false ) ||
+                 ( dirName.GetLength() != dirLen ) ||
+                 ( AString::StrNCmp( dirName.Get(), fileName->Get(), dirLen ) != 0 ) )
+            {
+                haveDir = true;
+                dirName.Assign( fileName->Get(), lastSlash );
+                const int32_t wd = inotify_add_watch( m_INotifyFD, dirName.IsEmpty() ? "/" : dirName.Get(), watchMask );
+
+                // A directory seen via two paths (symlinks) can't be tracked
+                // unambiguously, so files in it are treated as untracked
+                dirWatched = ( ( wd != -1 ) && ( FindWatchedPath( wd ) == nullptr ) );
+
+                // Record which directory the path resolves to, as renaming an
+                // ancestor or changing a symlink in the path is not reported
+                struct stat dirStat;
+                dirWatched = dirWatched && ( stat( dirName.IsEmpty() ? "/" : dirName.Get(), &dirStat ) == 0 );
+                if ( dirWatched )
+                {
+                    Watch & watch = m_Watches.EmplaceBack();
+                    watch.m_WatchDescriptor = wd;
+                    watch.m_Path = dirName;
+
+                    WatchedDir & watchedDir = m_WatchedDirs.EmplaceBack();
+                    watchedDir.m_Path = dirName;
+                    watchedDir.m_Device = (uint64_t)dirStat.st_dev;
+                    watchedDir.m_Inode = (uint64_t)dirStat.st_ino;
+                }
+                else if ( ( wd == -1 ) && ( errno == ENOSPC ) && ( reportedWatchFailure == false ) )
+                {
+                    FLOG_WARN( "Unable to watch all directories. Consider increasing /proc/sys/fs/inotify/max_user_watches" );
+                    reportedWatchFailure = true;
+                }
+            }
+
+            if ( dirWatched )
+            {
+                watchedFileNames.Append( fileName );
+            }
+        }
+
+        // Watch the journal's directory, to be notified of sync requests
+        ASSERT( journalSlash );
+        AStackString<> journalDir( m_JournalFileName.Get(), journalSlash );
+        m_JournalWatchDescriptor = inotify_add_watch( m_INotifyFD, journalDir.IsEmpty() ? "/" : journalDir.Get(), watchMask );
+        if ( m_JournalWatchDescriptor == -1 )
+        {
+            FLOG_ERROR( "Failed to watch '%s'. Error: %s", journalDir.Get(), LAST_ERROR_STR );
+            StopWatching();
+            return false;
+        }
+        if ( FindWatchedPath( m_JournalWatchDescriptor ) == nullptr )
+        {
+            Watch & watch = m_Watches.EmplaceBack();
+            watch.m_WatchDescriptor = m_JournalWatchDescriptor;
+            watch.m_Path = journalDir;
+        }
+
+        // Record the stamps of the files now that they are being watched, so
+        // any later modification is guaranteed to be seen
+        Array< uint64_t > stamps;
+        stamps.SetSize( watchedFileNames.GetSize() );
+        FileIO::GetFileLastWriteTimes( watchedFileNames.Begin(), watchedFileNames.GetSize(), stamps.Begin() );
+        m_Stamps.SetCapacity( watchedFileNames.GetSize() );
+        for ( size_t i = 0; i < watchedFileNames.GetSize(); ++i )
+        {
+            FileStamp & fileStamp = m_Stamps.EmplaceBack();
+            fileStamp.m_FileName = *watchedFileNames[ i ];
+            fileStamp.m_Stamp = stamps[ i ];
+        }
+
+        if ( WriteJournal() == false )
+        {
+            StopWatching();
+            return false;
+        }
+
+        FLOG_VERBOSE( "Watching %u files in %u directories for changes", (uint32_t)watchedFileNames.GetSize(), (uint32_t)m_Watches.GetSize() );
+        return true;
+    #else
+        (void)journalFileName;
+        (void)fileNames;
+        FLOG_ERROR( "Watching for file changes is not supported on this platform" );
+        return false;
+    #endif
+}
+
+// Update
+//------------------------------------------------------------------------------
+bool FileChangeJournal::Update( uint32_t timeoutMS )
+{
+    #if defined( __LINUX__ )
+        ASSERT( m_INotifyFD != -1 );
+
+        pollfd pollFD;
+        pollFD.fd = m_INotifyFD;
+        pollFD.events = POLLIN;
+        pollFD.revents = 0;
+        if ( poll( &pollFD, 1, (int)timeoutMS ) <= 0 )
+        {
+            // Timeout or signal. Compact the journal while idle.
+            if ( m_RecordsSize > COMPACT_THRESHOLD )
+            {
+                Compact();
+            }
+            return true;
+        }
+
+        // Large enough for several events (each at most sizeof( inotify_event ) + NAME_MAX + 1)
+        // but small enough for the stack of a worker thread
+        alignas( inotify_event ) char buffer[ 4096 ];
+        for ( ;; )
+        {
+            const ssize_t len = read( m_INotifyFD, buffer, sizeof( buffer ) );
+            if ( len <= 0 )
+            {
+                return true; // No more events
+            }
+
+            const char * pos = buffer;
+            const char * const end = ( buffer + len );
+            while ( pos < end )
+            {
+                const inotify_event * event = reinterpret_cast< const inotify_event * >( pos );
+                pos += ( sizeof( inotify_event ) + event->len );
+
+                // Events were lost, so changes can no longer be tracked
+                if ( event->mask & IN_Q_OVERFLOW )
+                {
+                    FLOG_WARN( "Too many file changes to track. Subsequent builds will check all files." );
+                    WriteRecord( RECORD_OVERFLOW, AString::GetEmpty() );
+                    return false;
+                }
+
+                const AString * path = FindWatchedPath( event->wd );
+                if ( path == nullptr )
+                {
+                    continue;
+                }
+
+                // Directory itself was removed, moved or is no longer watched
+                if ( event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT ) )
+                {
+                    if ( AddChangedPath( *path ) )
+                    {
+                        WriteRecord( RECORD_DIR_CHANGED, *path );
+                        m_ChangedDirs.Append( *path );
+                    }
+                    continue;
+                }
+                if ( event->len == 0 )
+                {
+                    continue;
+                }
+
+                // Ignore changes to the journal, except for sync requests
+                if ( ( event->wd == m_JournalWatchDescriptor ) &&
+                     ( AString::StrNCmp( event->name, m_JournalBaseName.Get(), m_JournalBaseName.GetLength() ) == 0 ) )
+                {
+                    if ( ( event->mask & IN_CLOSE_WRITE ) && ( m_SyncBaseName == event->name ) )
+                    {
+                        // All changes made before the request have now been recorded
+                        AStackString<> syncFileName( m_JournalFileName );
+                        syncFileName += ".sync";
+                        FileStream f;
+                        if ( f.Open( syncFileName.Get(), FileStream::READ_ONLY ) )
+                        {
+                            AStackString<> syncToken;
+                            syncToken.SetLength( (uint32_t)f.GetFileSize() );
+                            if ( f.ReadBuffer( syncToken.Get(), syncToken.GetLength() ) == syncToken.GetLength() )
+                            {
+                                WriteRecord( RECORD_SYNC, syncToken );
+                            }
+                        }
+                    }
+                    continue;
+                }
+
+                AStackString<> changedPath( *path );
+                changedPath += NATIVE_SLASH;
+                changedPath += event->name;
+                if ( AddChangedPath( changedPath ) == false )
+                {
+                    continue; // Already recorded
+                }
+                if ( event->mask & IN_ISDIR )
+                {
+                    WriteRecord( RECORD_DIR_CHANGED, changedPath );
+                    m_ChangedDirs.Append( changedPath );
+                }
+                else
+                {
+                    WriteRecord( RECORD_FILE_CHANGED, changedPath );
+                    m_ChangedFiles.Append( changedPath );
+                }
+            }
+        }
+    #else
+        (void)timeoutMS;
+        return false;
+    #endif
+}
+
+// Compact
+//------------------------------------------------------------------------------
+bool FileChangeJournal::Compact()
+{
+    PROFILE_FUNCTION;
+
+    #if defined( __LINUX__ )
+        ASSERT( m_JournalFD != -1 );
+
+        // Files in changed directories remain untrusted
+        m_ChangedPaths.Destruct();
+        for ( const AString & changedDir : m_ChangedDirs )
+        {
+            AddChangedPath( changedDir );
+        }
+
+        // Re-stamp other changed files. Any change made after this is reported
+        // by inotify and recorded in the new journal.
+        Array< FileStamp * > fileStamps( m_ChangedFiles.GetSize(), false );
+        Array< const AString * > fileNames( m_ChangedFiles.GetSize(), false );
+        for ( const AString & changedFile : m_ChangedFiles )
+        {
+            FileStamp * fileStamp = FindSorted( m_Stamps, changedFile, []( const FileStamp & f ) -> const AString & { return f.m_FileName; } );
+            if ( ( fileStamp == nullptr ) || IsChanged( changedFile ) )
+            {
+                continue; // Not watched, or in a changed directory
+            }
+            fileStamps.Append( fileStamp );
+            fileNames.Append( &fileStamp->m_FileName );
+        }
+        Array< uint64_t > stamps;
+        stamps.SetSize( fileNames.GetSize() );
+        FileIO::GetFileLastWriteTimes( fileNames.Begin(), fileNames.GetSize(), stamps.Begin() );
+        for ( size_t i = 0; i < fileStamps.GetSize(); ++i )
+        {
+            fileStamps[ i ]->m_Stamp = stamps[ i ];
+        }
+        m_ChangedFiles.Clear();
+
+        if ( WriteJournal() == false )
+        {
+            return false; // Previous journal remains valid
+        }
+        FLOG_VERBOSE( "Compacted file change journal '%s'", m_JournalFileName.Get() );
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+// StopWatching
+//------------------------------------------------------------------------------
+void FileChangeJournal::StopWatching()
+{
+    #if defined( __LINUX__ )
+        if ( m_JournalFD != -1 )
+        {
+            // Remove the journal, unless it has been replaced by another watcher
+            struct stat ourFile;
+            struct stat currentFile;
+            if ( ( fstat( m_JournalFD, &ourFile ) == 0 ) &&
+                 ( stat( m_JournalFileName.Get(), &currentFile ) == 0 ) &&
+                 ( ourFile.st_dev == currentFile.st_dev ) &&
+                 ( ourFile.st_ino == currentFile.st_ino ) )
+            {
+                unlink( m_JournalFileName.Get() );
+
+                AStackString<> syncFileName( m_JournalFileName );
+                syncFileName += ".sync";
+                unlink( syncFileName.Get() );
+            }
+            close( m_JournalFD );
+            m_JournalFD = -1;
+        }
+        if ( m_INotifyFD != -1 )
+        {
+            close( m_INotifyFD ); // Also removes all watches
+            m_INotifyFD = -1;
+        }
+        m_Watches.Clear();
+        m_JournalWatchDescriptor = -1;
+    #endif
+    m_ChangedFiles.Clear();
+    m_ChangedDirs.Clear();
+    m_ChangedPaths.Destruct();
+    m_Stamps.Clear();
+    m_WatchedDirs.Clear();
+    m_RecordsSize = 0;
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool FileChangeJournal::Load( const char * journalFileName, uint32_t timeoutMS )
+{
+    PROFILE_FUNCTION;
+
+    #if defined( __LINUX__ )
+        ASSERT( m_Loaded == false );
+
+        const int fd = open( journalFileName, O_RDONLY | O_CLOEXEC );
+        if ( fd == -1 )
+        {
+            return false; // No journal
+        }
+
+        // The watcher holds an exclusive lock for as long as it is running. If
+        // we can acquire a lock, changes are no longer being recorded.
+        const bool watcherRunning = ( flock( fd, LOCK_SH | LOCK_NB ) != 0 ) && ( errno == EWOULDBLOCK );
+        close( fd );
+        if ( watcherRunning == false )
+        {
+            return false;
+        }
+
+        if ( ReadSnapshot( journalFileName ) == false )
+        {
+            return false;
+        }
+
+        // Ask the watcher to confirm it has processed all changes made up
+        // until now, by modifying a file it is watching.
+        AStackString<> syncToken;
+        syncToken.Format( "%u.%" PRIi64, Process::GetCurrentId(), Timer::GetNow() );
+        AStackString<> syncFileName( journalFileName );
+        syncFileName += ".sync";
+        {
+            FileStream f;
+            if ( ( f.Open( syncFileName.Get(), FileStream::WRITE_ONLY ) == false ) ||
+                 ( f.WriteBuffer( syncToken.Get(), syncToken.GetLength() ) != syncToken.GetLength() ) )
+            {
+                return false;
+            }
+        }
+
+        const Timer timer;
+        for ( ;; )
+        {
+            bool synced = false;
+            if ( ReadRecords( journalFileName, syncToken, synced ) == false )
+            {
+                return false; // Watcher lost track of changes
+            }
+            if ( synced )
+            {
+                break;
+            }
+            if ( timer.GetElapsedMS() > (float)timeoutMS )
+            {
+                FLOG_VERBOSE( "Timed out waiting for file change journal '%s'", journalFileName );
+                return false;
+            }
+            Thread::Sleep( 1 );
+        }
+
+        CheckWatchedDirs();
+        m_Loaded = true;
+        return true;
+    #else
+        (void)journalFileName;
+        (void)timeoutMS;
+        return false;
+    #endif
+}
+
+// GetStamp
+//------------------------------------------------------------------------------
+bool FileChangeJournal::GetStamp( const AString & fileName, uint64_t & outStamp ) const
+{
+    if ( m_Loaded == false )
+    {
+        return false;
+    }
+
+    // Changed since the snapshot?
+    if ( IsChanged( fileName ) )
+    {
+        return false;
+    }
+
+    const FileStamp * fileStamp = FindSorted( m_Stamps, fileName, []( const FileStamp & f ) -> const AString & { return f.m_FileName; } );
+    if ( fileStamp == nullptr )
+    {
+        return false; // Not watched
+    }
+    outStamp = fileStamp->m_Stamp;
+    return true;
+}
+
+// IsChanged
+//------------------------------------------------------------------------------
+bool FileChangeJournal::IsChanged( const AString & path ) const
+{
+    if ( m_ChangedPaths.IsEmpty() )
+    {
+        return false;
+    }
+    if ( m_ChangedPaths.Find( path ) )
+    {
+        return true;
+    }
+
+    // Or any directory containing it
+    AStackString<> dirName;
+    for ( const char * slash = path.Find( NATIVE_SLASH ); slash; slash = path.Find( NATIVE_SLASH, slash + 1 ) )
+    {
+        dirName.Assign( path.Get(), slash );
+        if ( m_ChangedPaths.Find( dirName ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// AddChangedPath
+//------------------------------------------------------------------------------
+bool FileChangeJournal::AddChangedPath( const AString & path )
+{
+    if ( m_ChangedPaths.Find( path ) )
+    {
+        return false; // Already known
+    }
+    m_ChangedPaths.Insert( path, true );
+    return true;
+}
+
+#if defined( __LINUX__ )
+    // WriteRecord
+    //------------------------------------------------------------------------------
+    void FileChangeJournal::WriteRecord( RecordType type, const AString & value )
+    {
+        // Records are written with a single write, so readers never see the
+        // middle of a record (but may see a partially written one at the end)
+        MemoryStream record( 512, 512 );
+        WriteRecord( record, type, value );
+        if ( write( m_JournalFD, record.GetData(), record.GetSize() ) != (ssize_t)record.GetSize() )
+        {
+            FLOG_WARN( "Failed to write to file change journal '%s'. Error: %s", m_JournalFileName.Get(), LAST_ERROR_STR );
+        }
+        m_RecordsSize += record.GetSize();
+    }
+
+    // WriteRecord
+    //------------------------------------------------------------------------------
+    void FileChangeJournal::WriteRecord( MemoryStream & stream, RecordType type, const AString & value ) const
+    {
+        stream.Write( (uint8_t)type );
+        stream.Write( value );
+    }
+
+    // WriteJournal
+    //------------------------------------------------------------------------------
+    bool FileChangeJournal::WriteJournal()
+    {
+        // Snapshot of watched directories and the stamps of existing files
+        MemoryStream snapshot( 1024 * 1024, 1024 * 1024 );
+        const char identifier[ 3 ] = { 'F', 'C', 'J' };
+        snapshot.Write( identifier, sizeof( identifier ) );
+        snapshot.Write( (uint8_t)JOURNAL_VERSION );
+        snapshot.Write( (uint32_t)m_WatchedDirs.GetSize() );
+        for ( const WatchedDir & watchedDir : m_WatchedDirs )
+        {
+            snapshot.Write( watchedDir.m_Path );
+            snapshot.Write( watchedDir.m_Device );
+            snapshot.Write( watchedDir.m_Inode );
+        }
+        uint32_t numStamps = 0;
+        for ( const FileStamp & fileStamp : m_Stamps )
+        {
+            numStamps += ( fileStamp.m_Stamp != 0 ) ? 1 : 0;
+        }
+        snapshot.Write( numStamps );
+        for ( const FileStamp & fileStamp : m_Stamps )
+        {
+            if ( fileStamp.m_Stamp != 0 ) // Missing files are checked on disk when used
+            {
+                snapshot.Write( fileStamp.m_FileName );
+                snapshot.Write( fileStamp.m_Stamp );
+            }
+        }
+
+        // Changes which can't be folded into the snapshot
+        for ( const AString & changedDir : m_ChangedDirs )
+        {
+            WriteRecord( snapshot, RECORD_DIR_CHANGED, changedDir );
+        }
+
+        // Write the journal, holding a lock for as long as we're watching so
+        // readers can tell the journal is still being maintained
+        AStackString<> tmpFileName( m_JournalFileName );
+        tmpFileName += ".tmp";
+        const int32_t fd = open( tmpFileName.Get(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH );
+        if ( ( fd == -1 ) ||
+             ( flock( fd, LOCK_EX | LOCK_NB ) != 0 ) ||
+             ( write( fd, snapshot.GetData(), snapshot.GetSize() ) != (ssize_t)snapshot.GetSize() ) ||
+             ( rename( tmpFileName.Get(), m_JournalFileName.Get() ) != 0 ) )
+        {
+            FLOG_ERROR( "Failed to write file change journal '%s'. Error: %s", m_JournalFileName.Get(), LAST_ERROR_STR );
+            if ( fd != -1 )
+            {
+                close( fd );
+                unlink( tmpFileName.Get() );
+            }
+            return false;
+        }
+
+        // Replace the previous journal (if compacting)
+        if ( m_JournalFD != -1 )
+        {
+            close( m_JournalFD );
+        }
+        m_JournalFD = fd;
+        m_RecordsSize = 0;
+        return true;
+    }
+
+    // FindWatchedPath
+    //------------------------------------------------------------------------------
+    const AString * FileChangeJournal::FindWatchedPath( int32_t watchDescriptor ) const
+    {
+        for ( const Watch & watch : m_Watches )
+        {
+            if ( watch.m_WatchDescriptor == watchDescriptor )
+            {
+                return &watch.m_Path;
+            }
+        }
+        return nullptr;
+    }
+
+    // ReadSnapshot
+    //------------------------------------------------------------------------------
+    bool FileChangeJournal::ReadSnapshot( const char * journalFileName )
+    {
+        // Remember which file we read, as compaction replaces the journal
+        AString data;
+        if ( ReadJournal( journalFileName, 0, data ) == false )
+        {
+            return false;
+        }
+        ConstMemoryStream f( data.Get(), data.GetLength() );
+
+        char identifier[ 3 ];
+        uint8_t version = 0;
+        uint32_t numDirs = 0;
+        if ( ( f.Read( identifier, sizeof( identifier ) ) != sizeof( identifier ) ) ||
+             ( identifier[ 0 ] != 'F' ) || ( identifier[ 1 ] != 'C' ) || ( identifier[ 2 ] != 'J' ) ||
+             ( f.Read( version ) == false ) ||
+             ( version != JOURNAL_VERSION ) ||
+             ( f.Read( numDirs ) == false ) )
+        {
+            return false;
+        }
+
+        m_WatchedDirs.SetCapacity( numDirs );
+        for ( uint32_t i = 0; i < numDirs; ++i )
+        {
+            WatchedDir & watchedDir = m_WatchedDirs.EmplaceBack();
+            if ( ( f.Read( watchedDir.m_Path ) == false ) ||
+                 ( f.Read( watchedDir.m_Device ) == false ) ||
+                 ( f.Read( watchedDir.m_Inode ) == false ) )
+            {
+                return false;
+            }
+        }
+
+        uint32_t numStamps = 0;
+        if ( f.Read( numStamps ) == false )
+        {
+            return false;
+        }
+        m_Stamps.SetCapacity( numStamps );
+        for ( uint32_t i = 0; i < numStamps; ++i )
+        {
+            FileStamp & fileStamp = m_Stamps.EmplaceBack();
+            if ( ( f.Read( fileStamp.m_FileName ) == false ) ||
+                 ( f.Read( fileStamp.m_Stamp ) == false ) )
+            {
+                return false;
+            }
+        }
+
+        m_RecordsOffset = f.Tell();
+        return true;
+    }
+
+    // ReadRecords
+    //------------------------------------------------------------------------------
+    bool FileChangeJournal::ReadRecords( const char * journalFileName, const AString & syncToken, bool & outSynced )
+    {
+        // Read everything appended since we last looked
+        AString data;
+        if ( ReadJournal( journalFileName, m_RecordsOffset, data ) == false )
+        {
+            return false; // Missing, or replaced by compaction
+        }
+
+        const uint64_t baseOffset = m_RecordsOffset;
+        ConstMemoryStream records( data.Get(), data.GetLength() );
+        for ( ;; )
+        {
+            uint8_t type;
+            AStackString<> value;
+            if ( ( records.Read( type ) == false ) ||
+                 ( records.Read( value ) == false ) )
+            {
+                break; // Incomplete record will be read next time
+            }
+            m_RecordsOffset = ( baseOffset + records.Tell() );
+
+            switch ( (RecordType)type )
+            {
+                case RECORD_FILE_CHANGED:   AddChangedPath( value ); break;
+                case RECORD_DIR_CHANGED:    AddChangedPath( value ); break;
+                case RECORD_SYNC:           outSynced = outSynced || ( value == syncToken ); break;
+                case RECORD_OVERFLOW:       return false;
+                default:                    return false; // Corrupt
+            }
+        }
+        return true;
+    }
+
+    // ReadJournal
+    //------------------------------------------------------------------------------
+    bool FileChangeJournal::ReadJournal( const char * journalFileName, uint64_t offset, AString & outData )
+    {
+        const int fd = open( journalFileName, O_RDONLY | O_CLOEXEC );
+        if ( fd == -1 )
+        {
+            return false;
+        }
+
+        // The first read determines which journal we use. If it has since been
+        // replaced (compacted), the records we have seen no longer apply.
+        struct stat journalStat;
+        bool ok = ( fstat( fd, &journalStat ) == 0 ) && ( (uint64_t)journalStat.st_size >= offset );
+        if ( ok && ( offset == 0 ) )
+        {
+            m_JournalInode = (uint64_t)journalStat.st_ino;
+        }
+        ok = ok && ( (uint64_t)journalStat.st_ino == m_JournalInode );
+        if ( ok )
+        {
+            const size_t size = (size_t)( (uint64_t)journalStat.st_size - offset );
+            outData.SetLength( (uint32_t)size );
+            ok = ( size == 0 ) || ( pread( fd, outData.Get(), size, (off_t)offset ) == (ssize_t)size );
+        }
+        close( fd );
+        return ok;
+    }
+
+    // CheckWatchedDirs
+    //------------------------------------------------------------------------------
+    void FileChangeJournal::CheckWatchedDirs()
+    {
+        // Renaming an ancestor, or changing a symlink in the path, makes the
+        // path refer to a different directory without any event being seen
+        for ( const WatchedDir & watchedDir : m_WatchedDirs )
+        {
+            struct stat dirStat;
+            if ( ( stat( watchedDir.m_Path.IsEmpty() ? "/" : watchedDir.m_Path.Get(), &dirStat ) != 0 ) ||
+                 ( (uint64_t)dirStat.st_dev != watchedDir.m_Device ) ||
+                 ( (uint64_t)dirStat.st_ino != watchedDir.m_Inode ) )
+            {
+                AddChangedPath( watchedDir.m_Path );
+            }
+        }
+    }
+#endif
+
+//------------------------------------------------------------------------------
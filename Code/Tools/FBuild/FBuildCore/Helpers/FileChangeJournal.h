@@ -0,0 +1,120 @@
+// FileChangeJournal - record of input files changed since a snapshot
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class MemoryStream;
+
+// FileChangeJournal
+//------------------------------------------------------------------------------
+// A watcher (-watch) records the stamps of a set of files, then monitors their
+// directories for changes (using inotify), appending the paths of changed
+// files to a journal alongside the DB. Subsequent builds can then trust the
+// recorded stamps of unchanged files instead of checking each one on disk.
+//
+// The journal is only trusted while the watcher which wrote it is still
+// running, and only once the watcher confirms it has caught up with all file
+// system changes made before the build started. Otherwise (including if the
+// watcher could not keep up with changes) builds check every file as usual.
+// Watched directories which no longer resolve to the same directory (because
+// an ancestor was renamed or a symlink in the path was changed, which inotify
+// does not report) are not trusted either.
+//
+// While idle, the watcher periodically compacts the journal, re-stamping the
+// changed files and replacing the records with a new snapshot.
+class FileChangeJournal
+{
+public:
+    explicit FileChangeJournal();
+    ~FileChangeJournal();
+
+    static void GetJournalFileName( const char * nodeGraphDBFile, AString & outJournalFileName );
+
+    // Watcher
+    bool StartWatching( const char * journalFileName, const Array< const AString * > & fileNames );
+    bool Update( uint32_t timeoutMS ); // Returns false if changes can no longer be tracked
+    bool Compact();
+    void StopWatching();
+
+    // Reader
+    bool Load( const char * journalFileName, uint32_t timeoutMS = 1000 );
+    bool GetStamp( const AString & fileName, uint64_t & outStamp ) const;
+
+private:
+    enum : uint8_t { JOURNAL_VERSION = 2 };
+    enum : uint32_t { COMPACT_THRESHOLD = ( 64 * 1024 ) }; // Size of records which triggers compaction
+    enum RecordType : uint8_t
+    {
+        RECORD_FILE_CHANGED,
+        RECORD_DIR_CHANGED,
+        RECORD_SYNC,
+        RECORD_OVERFLOW,
+    };
+
+    struct FileStamp
+    {
+        AString     m_FileName;
+        uint64_t    m_Stamp;            // 0 if missing (watcher only)
+    };
+
+    struct WatchedDir
+    {
+        AString     m_Path;
+        uint64_t    m_Device;
+        uint64_t    m_Inode;
+    };
+
+    bool IsChanged( const AString & path ) const;
+    bool AddChangedPath( const AString & path ); // Returns false if already known
+
+    #if defined( __LINUX__ )
+        struct Watch
+        {
+            int32_t     m_WatchDescriptor;
+            AString     m_Path;
+        };
+
+        void WriteRecord( RecordType type, const AString & value );
+        void WriteRecord( MemoryStream & stream, RecordType type, const AString & value ) const;
+        bool WriteJournal();
+        const AString * FindWatchedPath( int32_t watchDescriptor ) const;
+        bool ReadSnapshot( const char * journalFileName );
+        bool ReadRecords( const char * journalFileName, const AString & syncToken, bool & outSynced );
+        bool ReadJournal( const char * journalFileName, uint64_t offset, AString & outData );
+        void CheckWatchedDirs();
+    #endif
+
+    // Watcher state
+    AString                 m_JournalFileName;
+    AString                 m_JournalBaseName;
+    AString                 m_SyncBaseName;
+    Array< AString >        m_ChangedFiles;     // Re-stamped when compacting
+    Array< AString >        m_ChangedDirs;      // Kept when compacting
+    uint64_t                m_RecordsSize = 0;  // Appended since the snapshot
+    #if defined( __LINUX__ )
+        Array< Watch >      m_Watches;
+        int32_t             m_INotifyFD = -1;
+        int32_t             m_JournalFD = -1;
+        int32_t             m_JournalWatchDescriptor = -1;
+    #endif
+
+    // Shared state
+    Array< FileStamp >      m_Stamps;           // Sorted by name
+    Array< WatchedDir >     m_WatchedDirs;
+    UnorderedMap< AString, bool > m_ChangedPaths; // Files and dirs changed since the snapshot (used as a set)
+
+    // Reader state
+    uint64_t                m_JournalInode = 0;
+    uint64_t                m_RecordsOffset = 0;
+    bool                    m_Loaded = false;
+};
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,175 @@
+// FileStampCache - hashes of file contents used as stamps (-contentstamps)
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FileStampCache.h"
+
+// Core
+#include "Core/Env/Assert.h"
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Math/xxHash.h"
+#include "Core/Mem/Mem.h"
+#include "Core/Process/Atomic.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Files are hashed in chunks to limit memory use for large files
+    constexpr uint32_t kHashChunkSize = ( 1024 * 1024 );
+}
+
+// CONSTRUCTOR
+//------------------------------------------------------------------------------
+FileStampCache::FileStampCache()
+    : m_EntryList( 0, true )
+{
+}
+
+// DESTRUCTOR
+//------------------------------------------------------------------------------
+FileStampCache::~FileStampCache() = default;
+
+// GetStamp
+//------------------------------------------------------------------------------
+uint64_t FileStampCache::GetStamp( const AString & fileName )
+{
+    FileIO::FileInfo info;
+    if ( FileIO::GetFileInfo( fileName, info ) == false )
+    {
+        return 0; // Missing
+    }
+
+    // Unmodified since last hashed?
+    {
+        MutexHolder mh( m_Mutex );
+        const EntryMap::KeyValue * keyValue = m_Entries.Find( fileName );
+        if ( keyValue &&
+             ( keyValue->m_Value.m_LastWriteTime == info.m_LastWriteTime ) &&
+             ( keyValue->m_Value.m_Size == info.m_Size ) )
+        {
+            return keyValue->m_Value.m_Hash;
+        }
+    }
+
+    // Hash outside of the lock so files can be hashed in parallel
+    const uint64_t hash = HashFile( fileName, info.m_Size );
+    if ( hash == 0 )
+    {
+        return 0; // Deleted or not readable
+    }
+    AtomicInc( &m_NumFilesHashed );
+
+    MutexHolder mh( m_Mutex );
+    EntryMap::KeyValue * keyValue = m_Entries.Find( fileName );
+    if ( keyValue == nullptr )
+    {
+        keyValue = &m_Entries.Insert( fileName, Entry() );
+        m_EntryList.Append( keyValue );
+    }
+    keyValue->m_Value.m_LastWriteTime = info.m_LastWriteTime;
+    keyValue->m_Value.m_Size = info.m_Size;
+    keyValue->m_Value.m_Hash = hash;
+    return hash;
+}
+
+// GetCachedStamp
+//------------------------------------------------------------------------------
+bool FileStampCache::GetCachedStamp( const AString & fileName, uint64_t lastWriteTime, uint64_t & outStamp )
+{
+    MutexHolder mh( m_Mutex );
+    const EntryMap::KeyValue * keyValue = m_Entries.Find( fileName );
+    if ( keyValue && ( keyValue->m_Value.m_LastWriteTime == lastWriteTime ) )
+    {
+        outStamp = keyValue->m_Value.m_Hash;
+        return true;
+    }
+    return false;
+}
+
+// Save
+//------------------------------------------------------------------------------
+void FileStampCache::Save( IOStream & stream ) const
+{
+    MutexHolder mh( m_Mutex );
+
+    stream.Write( (uint32_t)m_EntryList.GetSize() );
+    for ( const EntryMap::KeyValue * keyValue : m_EntryList )
+    {
+        stream.Write( keyValue->m_Key );
+        stream.Write( keyValue->m_Value.m_LastWriteTime );
+        stream.Write( keyValue->m_Value.m_Size );
+        stream.Write( keyValue->m_Value.m_Hash );
+    }
+}
+
+// Load
+//------------------------------------------------------------------------------
+bool FileStampCache::Load( ConstMemoryStream & stream )
+{
+    MutexHolder mh( m_Mutex );
+
+    m_Entries.Destruct();
+    m_EntryList.Clear();
+
+    uint32_t numEntries = 0;
+    if ( stream.Read( numEntries ) == false )
+    {
+        return false;
+    }
+    m_EntryList.SetCapacity( numEntries );
+    AString fileName;
+    for ( uint32_t i = 0; i < numEntries; ++i )
+    {
+        Entry entry;
+        if ( ( stream.Read( fileName ) == false ) ||
+             ( stream.Read( entry.m_LastWriteTime ) == false ) ||
+             ( stream.Read( entry.m_Size ) == false ) ||
+             ( stream.Read( entry.m_Hash ) == false ) ||
+             ( m_Entries.Find( fileName ) != nullptr ) )
+        {
+            // Discard a corrupt cache (files will be hashed again)
+            m_Entries.Destruct();
+            m_EntryList.Clear();
+            return false;
+        }
+        m_EntryList.Append( &m_Entries.Insert( fileName, entry ) );
+    }
+    return true;
+}
+
+// HashFile
+//------------------------------------------------------------------------------
+/*static*/ uint64_t FileStampCache::HashFile( const AString & fileName, uint64_t size )
+{
+    FileStream f;
+    if ( f.Open( fileName.Get(), FileStream::READ_ONLY ) == false )
+    {
+        return 0;
+    }
+
+    // Combine hashes of each chunk
+    const uint32_t bufferSize = (uint32_t)Math::Min< uint64_t >( size, kHashChunkSize );
+    char * buffer = (char *)ALLOC( Math::Max( bufferSize, 1u ) );
+    uint64_t hash = xxHash::Calc64( &size, sizeof( size ) );
+    for ( ;; )
+    {
+        const uint64_t bytesRead = f.ReadBuffer( buffer, bufferSize );
+        if ( bytesRead == 0 )
+        {
+            break;
+        }
+        const uint64_t hashes[ 2 ] = { hash, xxHash::Calc64( buffer, (size_t)bytesRead ) };
+        hash = xxHash::Calc64( hashes, sizeof( hashes ) );
+    }
+    FREE( buffer );
+
+    // 0 is reserved for missing files
+    return ( hash != 0 ) ? hash : 1;
+}
+
+//------------------------------------------------------------------------------
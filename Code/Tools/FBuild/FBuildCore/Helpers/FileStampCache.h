@@ -0,0 +1,58 @@
+// FileStampCache - hashes of file contents used as stamps (-contentstamps)
+//------------------------------------------------------------------------------
+#pragma once
+
+// Includes
+//------------------------------------------------------------------------------
+#include "Core/Containers/Array.h"
+#include "Core/Containers/UnorderedMap.h"
+#include "Core/Env/Types.h"
+#include "Core/Process/Mutex.h"
+#include "Core/Strings/AString.h"
+
+// Forward Declarations
+//------------------------------------------------------------------------------
+class ConstMemoryStream;
+class IOStream;
+
+// FileStampCache
+//------------------------------------------------------------------------------
+// When using content stamps, a file's stamp is a hash of its contents, so files
+// touched without being modified (branch switches etc.) don't trigger rebuilds.
+// To avoid hashing files every build, the hash is cached along with the last
+// write time and size of the file when it was hashed, and saved in the DB.
+class FileStampCache
+{
+public:
+    explicit FileStampCache();
+    ~FileStampCache();
+
+    // Hash of the file contents (or 0 if missing), re-hashed only if modified
+    uint64_t GetStamp( const AString & fileName );
+
+    // For files known not to have changed since the given last write time
+    bool GetCachedStamp( const AString & fileName, uint64_t lastWriteTime, uint64_t & outStamp );
+
+    void Save( IOStream & stream ) const;
+    bool Load( ConstMemoryStream & stream ); // Returns false (and empties the cache) if corrupt
+
+    uint32_t GetNumFilesHashed() const { return m_NumFilesHashed; }
+
+private:
+    static uint64_t HashFile( const AString & fileName, uint64_t size );
+
+    struct Entry
+    {
+        uint64_t    m_LastWriteTime;
+        uint64_t    m_Size;
+        uint64_t    m_Hash;
+    };
+    using EntryMap = UnorderedMap< AString, Entry >;
+
+    mutable Mutex                       m_Mutex;
+    EntryMap                            m_Entries;
+    Array< const EntryMap::KeyValue * > m_EntryList;    // For saving
+    volatile uint32_t                   m_NumFilesHashed = 0;
+};
+
+//------------------------------------------------------------------------------
@@ -13,8 +13,13 @@
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
 #include "Core/FileIO/MemoryStream.h"
+#include "Core/Math/Conversions.h"
+#include "Core/Strings/AStackString.h"
 #include "Core/Strings/AString.h"
 
+// system
+#include <string.h> // for memcpy
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 MultiBuffer::MultiBuffer()
@@ -172,7 +177,7 @@ void MultiBuffer::Compress( int32_t compressionLevel )
 
 // Decompress
 //------------------------------------------------------------------------------
-bool MultiBuffer::Decompress()
+bool MultiBuffer::Decompress( const CompressionDictionary * dictionary )
 {
     ASSERT( m_ReadStream ); // Data needs to be populated
 
@@ -182,7 +187,7 @@ bool MultiBuffer::Decompress()
         return false;
     }
     Compressor c;
-    if ( c.Decompress( m_ReadStream->GetData() ) == false )
+    if ( c.Decompress( m_ReadStream->GetData(), dictionary ) == false )
     {
         return false;
     }
@@ -193,6 +198,39 @@ bool MultiBuffer::Decompress()
     return true;
 }
 
+// SplitIntoChunks
+//------------------------------------------------------------------------------
+void MultiBuffer::SplitIntoChunks( size_t chunkSize, int32_t compressionLevel )
+{
+    ASSERT( m_WriteStream ); // Data needs to be populated
+    ASSERT( chunkSize > 0 );
+
+    const char * data = static_cast< const char * >( m_WriteStream->GetData() );
+    const size_t dataSize = m_WriteStream->GetSize();
+    const size_t numChunks = ( ( dataSize + chunkSize - 1 ) / chunkSize );
+
+    MemoryStream * chunks = FNEW( MemoryStream( dataSize + ( numChunks * sizeof( uint32_t ) ) ) );
+    for ( size_t offset = 0; offset < dataSize; offset += chunkSize )
+    {
+        const size_t size = Math::Min( chunkSize, ( dataSize - offset ) );
+        if ( compressionLevel != 0 )
+        {
+            Compressor c;
+            c.Compress( data + offset, size, compressionLevel );
+            chunks->Write( (uint32_t)c.GetResultSize() );
+            chunks->WriteBuffer( c.GetResult(), c.GetResultSize() );
+        }
+        else
+        {
+            chunks->Write( (uint32_t)size );
+            chunks->WriteBuffer( data + offset, size );
+        }
+    }
+
+    FDELETE( m_WriteStream );
+    m_WriteStream = chunks;
+}
+
 // GetData
 //------------------------------------------------------------------------------
 const void * MultiBuffer::GetData() const
@@ -216,4 +254,192 @@ void * MultiBuffer::Release( size_t & outSize )
     return m_WriteStream->Release();
 }
 
+// CONSTRUCTOR (MultiBufferWriter)
+//------------------------------------------------------------------------------
+MultiBufferWriter::MultiBufferWriter( const Array< AString > & fileNames )
+    : m_FileNames( fileNames )
+{
+    ASSERT( fileNames.GetSize() <= MultiBuffer::MAX_FILES );
+}
+
+// DESTRUCTOR (MultiBufferWriter)
+//------------------------------------------------------------------------------
+MultiBufferWriter::~MultiBufferWriter()
+{
+    if ( m_FileStream.IsOpen() )
+    {
+        m_FileStream.Close();
+    }
+
+    // Remove partially received results
+    if ( m_Committed == false )
+    {
+        const size_t numStarted = Math::Min( m_FileIndex + 1, m_FileNames.GetSize() );
+        for ( size_t i = 0; i < numStarted; ++i )
+        {
+            AStackString<> tmpFileName;
+            GetTmpFileName( i, tmpFileName );
+            FileIO::FileDelete( tmpFileName.Get() );
+        }
+    }
+}
+
+// Write
+//------------------------------------------------------------------------------
+bool MultiBufferWriter::Write( const void * data, size_t dataSize )
+{
+    ASSERT( m_Committed == false );
+
+    if ( m_Failed )
+    {
+        return false; // Remaining data is discarded
+    }
+
+    const uint8_t * pos = static_cast< const uint8_t * >( data );
+    const uint8_t * const end = ( pos + dataSize );
+
+    // Header (number of files, then the size of each) can span several writes
+    while ( ( pos < end ) && ( m_HeaderBytes < m_HeaderSize ) )
+    {
+        const size_t bytes = Math::Min( (size_t)( end - pos ), (size_t)( m_HeaderSize - m_HeaderBytes ) );
+        memcpy( m_Header + m_HeaderBytes, pos, bytes );
+        m_HeaderBytes += (uint32_t)bytes;
+        pos += bytes;
+
+        if ( m_HeaderBytes == sizeof( uint32_t ) )
+        {
+            uint32_t numFiles;
+            memcpy( &numFiles, m_Header, sizeof( uint32_t ) );
+
+            // Caller and MultiBuffer are out of sync
+            if ( numFiles != m_FileNames.GetSize() )
+            {
+                m_Failed = true;
+                return false;
+            }
+            m_HeaderSize += ( numFiles * (uint32_t)sizeof( uint64_t ) );
+        }
+        else if ( m_HeaderBytes == m_HeaderSize )
+        {
+            if ( BeginFile( 0 ) == false )
+            {
+                m_Failed = true;
+                return false;
+            }
+        }
+    }
+
+    // File data
+    while ( pos < end )
+    {
+        // More data than the header describes
+        if ( m_FileIndex >= m_FileNames.GetSize() )
+        {
+            m_Failed = true;
+            return false;
+        }
+
+        const size_t bytes = (size_t)Math::Min( (uint64_t)( end - pos ), m_FileBytesRemaining );
+        if ( m_FileStream.WriteBuffer( pos, bytes ) != bytes )
+        {
+            m_Failed = true;
+            return false;
+        }
+        m_FileBytesRemaining -= bytes;
+        pos += bytes;
+
+        if ( ( m_FileBytesRemaining == 0 ) && ( BeginFile( m_FileIndex + 1 ) == false ) )
+        {
+            m_Failed = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Commit
+//------------------------------------------------------------------------------
+bool MultiBufferWriter::Commit( size_t * outProblemFileIndex )
+{
+    ASSERT( m_Committed == false );
+
+    // All files must have been completely received
+    const bool complete = ( m_HeaderBytes == m_HeaderSize ) && ( m_HeaderSize > sizeof( uint32_t ) ) &&
+                          ( m_FileIndex == m_FileNames.GetSize() );
+    if ( m_Failed || ( complete == false ) )
+    {
+        if ( outProblemFileIndex )
+        {
+            *outProblemFileIndex = Math::Min( m_FileIndex, m_FileNames.GetSize() - 1 );
+        }
+        return false;
+    }
+
+    // Move into place
+    m_Committed = true;
+    for ( size_t i = 0; i < m_FileNames.GetSize(); ++i )
+    {
+        AStackString<> tmpFileName;
+        GetTmpFileName( i, tmpFileName );
+        const AString & fileName = m_FileNames[ i ];
+        if ( FileIO::FileMove( tmpFileName, fileName ) == false )
+        {
+            // See MultiBuffer::ExtractFile
+            FileIO::WorkAroundForWindowsFilePermissionProblem( fileName, FileStream::WRITE_ONLY, 15 ); // 15 secs max wait
+
+            // Try again
+            if ( FileIO::FileMove( tmpFileName, fileName ) == false )
+            {
+                if ( outProblemFileIndex )
+                {
+                    *outProblemFileIndex = i;
+                }
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// BeginFile
+//------------------------------------------------------------------------------
+bool MultiBufferWriter::BeginFile( size_t index )
+{
+    if ( m_FileStream.IsOpen() )
+    {
+        m_FileStream.Close();
+    }
+
+    // Empty files have no data to wait for, so are completed immediately
+    for ( m_FileIndex = index; m_FileIndex < m_FileNames.GetSize(); ++m_FileIndex )
+    {
+        AStackString<> tmpFileName;
+        GetTmpFileName( m_FileIndex, tmpFileName );
+        if ( m_FileStream.Open( tmpFileName.Get(), FileStream::WRITE_ONLY ) == false )
+        {
+            return false;
+        }
+
+        uint64_t fileSize;
+        memcpy( &fileSize, m_Header + sizeof( uint32_t ) + ( m_FileIndex * sizeof( uint64_t ) ), sizeof( uint64_t ) );
+        if ( fileSize > 0 )
+        {
+            m_FileBytesRemaining = fileSize;
+            return true;
+        }
+        m_FileStream.Close();
+    }
+    return true;
+}
+
+// GetTmpFileName
+//------------------------------------------------------------------------------
+void MultiBufferWriter::GetTmpFileName( size_t index, AString & outTmpFileName ) const
+{
+    outTmpFileName = m_FileNames[ index ];
+    outTmpFileName += ".tmp";
+}
+
 //------------------------------------------------------------------------------
@@ -7,10 +7,12 @@
 // Core
 #include "Core/Containers/Array.h"
 #include "Core/Env/Types.h"
+#include "Core/FileIO/FileStream.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
 class AString;
+class CompressionDictionary;
 class ConstMemoryStream;
 class MemoryStream;
 
@@ -27,18 +29,52 @@ public:
     bool ExtractFile( size_t index, const AString& fileName ) const;
 
     void Compress( int32_t compressionLevel );
-    bool Decompress();
+    bool Decompress( const CompressionDictionary * dictionary = nullptr );
+
+    // Replace the data with a sequence of [uint32_t size][chunk], with each chunk
+    // compressed independently (if compressionLevel != 0) so it can be consumed on arrival
+    void SplitIntoChunks( size_t chunkSize, int32_t compressionLevel );
 
     const void *    GetData() const;
     uint64_t        GetDataSize() const;
 
     void *          Release( size_t & outSize );
 
-private:
     enum : uint32_t { MAX_FILES = 4 };
 
+private:
     ConstMemoryStream * m_ReadStream;
     MemoryStream *      m_WriteStream;
 };
 
+// MultiBufferWriter
+//------------------------------------------------------------------------------
+// Extracts the files from MultiBuffer data which arrives in pieces, without
+// holding it all in memory. Files are written alongside their final location
+// and only moved into place by Commit, so an incomplete result never replaces
+// a file (and is cleaned up if not committed).
+class MultiBufferWriter
+{
+public:
+    explicit MultiBufferWriter( const Array< AString > & fileNames );
+    ~MultiBufferWriter();
+
+    bool Write( const void * data, size_t dataSize );
+    bool Commit( size_t * outProblemFileIndex = nullptr );
+
+private:
+    bool BeginFile( size_t index );
+    void GetTmpFileName( size_t index, AString & outTmpFileName ) const;
+
+    Array< AString >    m_FileNames;
+    FileStream          m_FileStream;
+    size_t              m_FileIndex             = 0;
+    uint64_t            m_FileBytesRemaining    = 0;
+    uint32_t            m_HeaderSize            = sizeof( uint32_t ); // Grows once number of files is known
+    uint32_t            m_HeaderBytes           = 0;
+    uint8_t             m_Header[ sizeof( uint32_t ) + ( sizeof( uint64_t ) * MultiBuffer::MAX_FILES ) ];
+    bool                m_Failed                = false;
+    bool                m_Committed             = false;
+};
+
 //------------------------------------------------------------------------------
@@ -13,10 +13,12 @@
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
+#include "Tools/FBuild/FBuildCore/Helpers/Compressor.h"
 #include <Tools/FBuild/FBuildCore/Helpers/MultiBuffer.h>
 #include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
 
+#include "Core/Containers/UniquePtr.h"
 #include "Core/Env/ErrorFormat.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
@@ -29,6 +31,7 @@
 #define CLIENT_STATUS_UPDATE_FREQUENCY_SECONDS ( 0.1f )
 #define CONNECTION_REATTEMPT_DELAY_TIME ( 10.0f )
 #define SYSTEM_ERROR_ATTEMPT_COUNT ( 3 )
+#define MIN_JOBS_FOR_TOOLCHAIN_SYNC ( 32 )
 #define DIST_INFO( ... ) do { if ( m_DetailedLogging ) { FLOG_OUTPUT( __VA_ARGS__ ); } } while( false )
 
 // CONSTRUCTOR
@@ -36,10 +39,13 @@
 Client::Client( const Array< AString > & workerList,
                 uint16_t port,
                 uint32_t workerConnectionLimit,
-                bool detailedLogging )
-    : m_WorkerList( workerList )
+                bool detailedLogging,
+                bool workerListIsRanked )
+    : TCPConnectionPool( true ) // Message handlers read files and wait on locks held while sending
+    , m_WorkerList( workerList )
     , m_ShouldExit( false )
     , m_DetailedLogging( detailedLogging )
+    , m_WorkerListIsRanked( workerListIsRanked )
     , m_WorkerConnectionLimit( workerConnectionLimit )
     , m_Port( port )
 {
@@ -95,6 +101,13 @@ Client::~Client()
     // we had the connection drop between message and payload
     FREE( (void *)( ss->m_CurrentMessage ) );
 
+    // Discard any partially received result
+    FDELETE( ss->m_StreamedResult );
+    ss->m_StreamedResult = nullptr;
+
+    ss->m_ToolIds.Clear();
+    ss->m_ToolIdsKnown = false;
+
     ss->m_RemoteName.Clear();
     AtomicStoreRelaxed( &ss->m_Connection, static_cast< const ConnectionInfo * >( nullptr ) );
     ss->m_CurrentMessage = nullptr;
@@ -177,8 +190,9 @@ void Client::LookForWorkers()
     // randomize the start index to better distribute workers when there
     // are many workers/clients - otherwise all clients will attempt to connect
     // to the same subset of workers
+    // (unless the coordinator has already distributed them)
     Random r;
-    const size_t startIndex = r.GetRandIndex( (uint32_t)numWorkers );
+    const size_t startIndex = m_WorkerListIsRanked ? 0 : r.GetRandIndex( (uint32_t)numWorkers );
 
     // find someone to connect to
     for ( size_t j=0; j<numWorkers; j++ )
@@ -338,6 +352,22 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
                 (uint32_t)memoryStream.GetSize() );
 }
 
+// SendMessageInternal
+//------------------------------------------------------------------------------
+void Client::SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & payloadHeader, const void * payloadData, size_t payloadDataSize )
+{
+    if ( msg.Send( connection, payloadHeader, payloadData, payloadDataSize ) )
+    {
+        return;
+    }
+
+    DIST_INFO( "Send Failed: %s (Type: %u, Size: %u, Payload: %u)\n",
+                ((ServerState *)connection->GetUserData())->m_RemoteName.Get(),
+                (uint32_t)msg.GetType(),
+                msg.GetSize(),
+                (uint32_t)( payloadHeader.GetSize() + payloadDataSize ) );
+}
+
 // OnReceive
 //------------------------------------------------------------------------------
 /*virtual*/ void Client::OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory )
@@ -378,7 +408,7 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
         case Protocol::MSG_REQUEST_JOB:
         {
             const Protocol::MsgRequestJob * msg = static_cast< const Protocol::MsgRequestJob * >( imsg );
-            Process( connection, msg );
+            Process( connection, msg, payload, payloadSize );
             break;
         }
         case Protocol::MSG_JOB_RESULT:
@@ -393,6 +423,18 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
             Process( connection, msg, payload, payloadSize );
             break;
         }
+        case Protocol::MSG_JOB_RESULT_CHUNK:
+        {
+            const Protocol::MsgJobResultChunk * msg = static_cast< const Protocol::MsgJobResultChunk * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
+        case Protocol::MSG_JOB_RESULT_STREAMED:
+        {
+            const Protocol::MsgJobResultStreamed * msg = static_cast< const Protocol::MsgJobResultStreamed * >( imsg );
+            Process( connection, msg, payload, payloadSize );
+            break;
+        }
         case Protocol::MSG_REQUEST_MANIFEST:
         {
             const Protocol::MsgRequestManifest * msg = static_cast< const Protocol::MsgRequestManifest * >( imsg );
@@ -423,7 +465,7 @@ void Client::SendMessageInternal( const ConnectionInfo * connection, const Proto
 
 // Process( MsgRequestJob )
 //------------------------------------------------------------------------------
-void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * )
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob *, const void * payload, size_t payloadSize )
 {
     PROFILE_SECTION( "MsgRequestJob" );
 
@@ -439,7 +481,25 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
         return;
     }
 
-    Job * job = JobQueue::Get().GetDistributableJobToProcess( true );
+    // take note of the toolchains the server has (older servers don't send them)
+    if ( payload )
+    {
+        Array< uint64_t > toolIds;
+        ConstMemoryStream ms( payload, payloadSize );
+        ms.Read( toolIds );
+
+        MutexHolder mh( ss->m_Mutex );
+        for ( const uint64_t toolId : toolIds )
+        {
+            if ( ss->m_ToolIds.Find( toolId ) == nullptr )
+            {
+                ss->m_ToolIds.Append( toolId );
+            }
+        }
+        ss->m_ToolIdsKnown = true;
+    }
+
+    Job * job = GetJobForWorker( ss );
     if ( job == nullptr )
     {
         PROFILE_SECTION( "NoJob" );
@@ -451,9 +511,9 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
         return;
     }
 
-    // send the job to the client
+    // send the job to the client (the job data is sent directly after the serialized header)
     MemoryStream stream;
-    job->Serialize( stream );
+    job->SerializeHeader( stream );
 
     MutexHolder mh( ss->m_Mutex );
 
@@ -471,6 +531,13 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
     const uint64_t toolId = manifest.GetToolId();
     ASSERT( toolId );
 
+    // the server will have this toolchain once it has synchronized it, so
+    // further jobs using it should prefer this server
+    if ( ss->m_ToolIds.Find( toolId ) == nullptr )
+    {
+        ss->m_ToolIds.Append( toolId );
+    }
+
     // output to signify remote start
     if ( FBuild::Get().GetOptions().m_ShowCommandSummary )
     {
@@ -480,17 +547,25 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
 
     // Determine compression level we'd like the Server to use for returning the results
     int16_t resultCompressionLevel = -1; // Default compression level
+    uint16_t resultChunkSizeKiB = 0; // Don't stream results
     if ( FBuild::IsValid() )
     {
         // If we will write the results to the cache, and this node is cacheable
         // then we want to respect higher cache compression levels if set
         const int16_t cacheCompressionLevel = FBuild::Get().GetOptions().m_CacheCompressionLevel;
-        if ( ( cacheCompressionLevel != 0 ) && 
-             ( FBuild::Get().GetOptions().m_UseCacheWrite ) && 
-             ( job->GetNode()->CastTo< ObjectNode >()->ShouldUseCache() ) )
+        const bool writeToCache = ( FBuild::Get().GetOptions().m_UseCacheWrite ) &&
+                                  ( job->GetNode()->CastTo< ObjectNode >()->ShouldUseCache() );
+        if ( ( cacheCompressionLevel != 0 ) && writeToCache )
         {
             resultCompressionLevel = Math::Max( resultCompressionLevel, cacheCompressionLevel );
         }
+
+        // Large results can be streamed and written as they arrive, unless the
+        // whole (compressed) result is needed to write to the cache
+        if ( writeToCache == false )
+        {
+            resultChunkSizeKiB = FBuild::Get().GetOptions().m_DistributionResultChunkSizeKiB;
+        }
     }
     
     // Take note of the results compression level so we know to expect
@@ -499,9 +574,55 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgRequ
 
     {
         PROFILE_SECTION( "SendJob" );
-        const Protocol::MsgJob msg( toolId, resultCompressionLevel );
-        SendMessageInternal( connection, msg, stream );
+        const Protocol::MsgJob msg( toolId, resultCompressionLevel, resultChunkSizeKiB );
+        SendMessageInternal( connection, msg, stream, job->GetData(), job->GetDataSize() );
+    }
+}
+
+// GetJobForWorker
+//------------------------------------------------------------------------------
+Job * Client::GetJobForWorker( ServerState * ss )
+{
+    Array< uint64_t > toolIds;
+    {
+        MutexHolder mh( ss->m_Mutex );
+        if ( ss->m_ToolIdsKnown == false )
+        {
+            // no toolchain info, so just take the most expensive job
+            return JobQueue::Get().GetDistributableJobToProcess( true );
+        }
+        toolIds = ss->m_ToolIds;
     }
+
+    // find the toolchains our other servers have
+    // (the server list is never resized, so m_ServerListMutex is not needed. It is
+    // held while connecting, which would stall us)
+    Array< uint64_t > otherToolIds;
+    for ( ServerState & other : m_ServerList )
+    {
+        if ( ( &other == ss ) || ( AtomicLoadRelaxed( &other.m_Connection ) == nullptr ) )
+        {
+            continue;
+        }
+        MutexHolder mh( other.m_Mutex );
+        if ( other.m_Denylisted )
+        {
+            continue;
+        }
+        for ( const uint64_t toolId : other.m_ToolIds )
+        {
+            if ( otherToolIds.Find( toolId ) == nullptr )
+            {
+                otherToolIds.Append( toolId );
+            }
+        }
+    }
+
+    // Synchronizing a toolchain another server already has can transfer hundreds of
+    // MiB, so is only worthwhile when there is plenty of work to share
+    const bool allowToolchainSync = ( JobQueue::Get().GetNumDistributableJobsAvailable() >= MIN_JOBS_FOR_TOOLCHAIN_SYNC );
+
+    return JobQueue::Get().GetDistributableJobToProcess( true, toolIds, otherToolIds, allowToolchainSync );
 }
 
 // Process( MsgJobResult )
@@ -522,9 +643,97 @@ void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobR
     ProcessJobResultCommon( connection, compressed, payload, payloadSize );
 }
 
+// Process( MsgJobResultChunk )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResultChunk" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // First chunk of a result?
+    if ( ss->m_StreamedResult == nullptr )
+    {
+        const ObjectNode * objectNode = nullptr;
+        {
+            MutexHolder mh( ss->m_Mutex );
+            Job ** job = ss->m_Jobs.FindDeref( msg->GetJobId() );
+            if ( job )
+            {
+                objectNode = (*job)->GetNode()->CastTo< ObjectNode >();
+            }
+        }
+        if ( objectNode == nullptr )
+        {
+            ASSERT( false ); // this indicates a protocol bug
+            DIST_INFO( "Protocol Error: %s\n", ss->m_RemoteName.Get() );
+            Disconnect( connection );
+            return;
+        }
+
+        // Files are written as chunks arrive, so make sure they have somewhere to go
+        // (failures are reported once the result is complete)
+        Node::EnsurePathExistsForFile( objectNode->GetName() );
+
+        StackArray< AString > fileNames;
+        GetResultFileNames( objectNode, fileNames );
+        ss->m_StreamedResult = FNEW( MultiBufferWriter( fileNames ) );
+        ss->m_StreamedResultJobId = msg->GetJobId();
+    }
+    else if ( ss->m_StreamedResultJobId != msg->GetJobId() )
+    {
+        ASSERT( false ); // this indicates a protocol bug (chunks from different jobs are never interleaved)
+        DIST_INFO( "Protocol Error: %s\n", ss->m_RemoteName.Get() );
+        Disconnect( connection );
+        return;
+    }
+
+    // Each chunk is compressed independently, so only one is held in memory at a time
+    if ( msg->IsCompressed() )
+    {
+        Compressor c;
+        if ( ( Compressor::IsValidData( payload, payloadSize ) == false ) || ( c.Decompress( payload ) == false ) )
+        {
+            DIST_INFO( "Invalid result chunk: %s\n", ss->m_RemoteName.Get() );
+            Disconnect( connection );
+            return;
+        }
+        ss->m_StreamedResult->Write( c.GetResult(), c.GetResultSize() );
+    }
+    else
+    {
+        ss->m_StreamedResult->Write( payload, payloadSize );
+    }
+}
+
+// Process( MsgJobResultStreamed )
+//------------------------------------------------------------------------------
+void Client::Process( const ConnectionInfo * connection, const Protocol::MsgJobResultStreamed * /*msg*/, const void * payload, size_t payloadSize )
+{
+    PROFILE_SECTION( "MsgJobResultStreamed" );
+
+    ServerState * ss = (ServerState *)connection->GetUserData();
+    ASSERT( ss );
+
+    // Results are only streamed in several chunks
+    UniquePtr< MultiBufferWriter, DeleteDeletor > streamedResult( ss->m_StreamedResult );
+    ss->m_StreamedResult = nullptr;
+    if ( streamedResult.Get() == nullptr )
+    {
+        ASSERT( false ); // this indicates a protocol bug
+        DIST_INFO( "Protocol Error: %s\n", ss->m_RemoteName.Get() );
+        Disconnect( connection );
+        return;
+    }
+
+    const bool compressed = false; // chunks were decompressed as they arrived
+    ProcessJobResultCommon( connection, compressed, payload, payloadSize, streamedResult.Get() );
+}
+
 // ProcessJobResultCommon
 //------------------------------------------------------------------------------
-void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize )
+void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize, MultiBufferWriter * streamedResult )
 {
     // Take note of the current time. We'll consider the job to have completed at this time.
     // Doing it as soon as possible makes it more accurate, as work below can take a non-trivial
@@ -704,8 +913,10 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
         ObjectNode * objectNode = node->CastTo< ObjectNode >();
 
         // Store to cache if needed
+        // (results to be written to the cache are never streamed)
         const bool writeToCache = FBuild::Get().GetOptions().m_UseCacheWrite &&
-                                  objectNode->ShouldUseCache();
+                                  objectNode->ShouldUseCache() &&
+                                  ( streamedResult == nullptr );
         if ( writeToCache )
         {
             if ( isCompressed )
@@ -723,13 +934,6 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
             }
         }
 
-        // Decompress if needed
-        MultiBuffer mb( data, dataSize );
-        if ( isCompressed )
-        {
-            mb.Decompress();
-        }
-
         const AString & nodeName = objectNode->GetName();
         if ( Node::EnsurePathExistsForFile( nodeName ) == false )
         {
@@ -738,27 +942,32 @@ void Client::ProcessJobResultCommon( const ConnectionInfo * connection, bool isC
         }
         else
         {
-            size_t fileIndex = 0;
-
-            const ObjectNode * on = job->GetNode()->CastTo< ObjectNode >();
-
-            // 1. Object file
-            result = WriteFileToDisk( nodeName, mb, fileIndex++ );
+            StackArray< AString > fileNames;
+            GetResultFileNames( objectNode, fileNames );
 
-            // 2. PDB file (optional)
-            if ( result && on->IsUsingPDB() )
+            if ( streamedResult )
             {
-                AStackString<> pdbName;
-                on->GetPDBName( pdbName );
-                result = WriteFileToDisk( pdbName, mb, fileIndex++ );
+                // Files were written as the result arrived, so just move them into place
+                size_t problemFileIndex = 0;
+                result = streamedResult->Commit( &problemFileIndex );
+                if ( result == false )
+                {
+                    FLOG_ERROR( "Failed to create file. Error: %s File: '%s'", LAST_ERROR_STR, fileNames[ problemFileIndex ].Get() );
+                }
             }
-
-            // 3. .nativecodeanalysis.xml (optional)
-            if ( result && on->IsUsingStaticAnalysisMSVC() )
+            else
             {
-                AStackString<> xmlFileName;
-                on->GetNativeAnalysisXMLPath( xmlFileName );
-                result = WriteFileToDisk( xmlFileName, mb, fileIndex++ );
+                // Decompress if needed
+                MultiBuffer mb( data, dataSize );
+                if ( isCompressed )
+                {
+                    mb.Decompress();
+                }
+
+                for ( size_t i = 0; result && ( i < fileNames.GetSize() ); ++i )
+                {
+                    result = WriteFileToDisk( fileNames[ i ], mb, i );
+                }
             }
 
             if ( result )
@@ -935,6 +1144,30 @@ bool Client::WriteFileToDisk( const AString & fileName, const MultiBuffer & mult
     return true;
 }
 
+// GetResultFileNames
+//------------------------------------------------------------------------------
+/*static*/ void Client::GetResultFileNames( const ObjectNode * objectNode, Array< AString > & outFileNames )
+{
+    // 1. Object file
+    outFileNames.Append( objectNode->GetName() );
+
+    // 2. PDB file (optional)
+    if ( objectNode->IsUsingPDB() )
+    {
+        AStackString<> pdbName;
+        objectNode->GetPDBName( pdbName );
+        outFileNames.Append( pdbName );
+    }
+
+    // 3. .nativecodeanalysis.xml (optional)
+    if ( objectNode->IsUsingStaticAnalysisMSVC() )
+    {
+        AStackString<> xmlFileName;
+        objectNode->GetNativeAnalysisXMLPath( xmlFileName );
+        outFileNames.Append( xmlFileName );
+    }
+}
+
 // CONSTRUCTOR( ServerState )
 //------------------------------------------------------------------------------
 Client::ServerState::ServerState()
@@ -942,6 +1175,9 @@ Client::ServerState::ServerState()
     , m_CurrentMessage( nullptr )
     , m_NumJobsAvailable( 0 )
     , m_Jobs( 16, true )
+    , m_StreamedResult( nullptr )
+    , m_StreamedResultJobId( 0 )
+    , m_ToolIdsKnown( false )
     , m_Denylisted( false )
 {
     m_DelayTimer.Start( 999.0f );
@@ -17,11 +17,15 @@ class ConstMemoryStream;
 class Job;
 class MemoryStream;
 class MultiBuffer;
+class MultiBufferWriter;
+class ObjectNode;
 namespace Protocol
 {
     class IMessage;
     class MsgJobResult;
+    class MsgJobResultChunk;
     class MsgJobResultCompressed;
+    class MsgJobResultStreamed;
     class MsgRequestJob;
     class MsgRequestManifest;
     class MsgRequestFile;
@@ -37,27 +41,34 @@ public:
     Client( const Array< AString > & workerList,
             uint16_t port,
             uint32_t workerConnectionLimit,
-            bool detailedLogging );
+            bool detailedLogging,
+            bool workerListIsRanked = false );
     virtual ~Client() override;
 
 private:
     virtual void OnDisconnected( const ConnectionInfo * connection ) override;
     virtual void OnReceive( const ConnectionInfo * connection, void * data, uint32_t size, bool & keepMemory ) override;
 
-    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestJob * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResult *, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultCompressed * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultChunk * msg, const void * payload, size_t payloadSize );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgJobResultStreamed * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestManifest * msg );
     void Process( const ConnectionInfo * connection, const Protocol::MsgRequestFile * msg );
 
-    void ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize );
+    void ProcessJobResultCommon( const ConnectionInfo * connection, bool isCompressed, const void * payload, size_t payloadSize, MultiBufferWriter * streamedResult = nullptr );
 
     const ToolManifest * FindManifest( const ConnectionInfo * connection, uint64_t toolId ) const;
     bool WriteFileToDisk( const AString& fileName, const MultiBuffer & multiBuffer, size_t index ) const;
+    static void GetResultFileNames( const ObjectNode * objectNode, Array< AString > & outFileNames );
 
     static uint32_t ThreadFuncStatic( void * param );
     void            ThreadFunc();
 
+    struct ServerState;
+    Job *           GetJobForWorker( ServerState * ss );
+
     void            LookForWorkers();
     void            CommunicateJobAvailability();
 
@@ -65,10 +76,12 @@ private:
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg );
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & memoryStream );
     void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const ConstMemoryStream & memoryStream );
+    void            SendMessageInternal( const ConnectionInfo * connection, const Protocol::IMessage & msg, const MemoryStream & payloadHeader, const void * payloadData, size_t payloadDataSize );
 
     Array< AString >    m_WorkerList;   // workers to connect to
     Atomic<bool>        m_ShouldExit;   // signal from main thread
     bool                m_DetailedLogging;
+    bool                m_WorkerListIsRanked; // workers are ordered best first
     Thread::ThreadHandle m_Thread;      // the thread to find and manage workers
 
     // state
@@ -86,6 +99,10 @@ private:
         Timer                   m_DelayTimer;
         uint32_t                m_NumJobsAvailable;     // num jobs we've told this server we have available
         Array< Job * >          m_Jobs;                 // jobs we've sent to this server
+        MultiBufferWriter *     m_StreamedResult;       // result being received in chunks (if any)
+        uint32_t                m_StreamedResultJobId;
+        Array< uint64_t >       m_ToolIds;              // toolchains the server has (or has been sent jobs for)
+        bool                    m_ToolIdsKnown;         // older servers don't send their toolchains
 
         bool                    m_Denylisted;
     };
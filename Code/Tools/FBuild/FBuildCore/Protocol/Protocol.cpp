@@ -35,10 +35,11 @@
             "Manifest",
             "RequestFile",
             "File",
-            "JobResultCompressed",
-            "RequestWorkerList",
+            "JobResultCompressed/RequestWorkerList",
             "WorkerList",
-            "SetWorkerStatus"
+            "SetWorkerStatus",
+            "JobResultChunk",
+            "JobResultStreamed"
         };
         static_assert( ( sizeof( msgNames ) / sizeof(const char *) ) == Protocol::NUM_MESSAGES, "msgNames item count doesn't match NUM_MESSAGES" );
 
@@ -90,6 +91,18 @@ bool Protocol::IMessage::Send( const ConnectionInfo * connection, const ConstMem
     return pool.Send( connection, this, m_MsgSize, payload.GetData(), payload.GetSize() );
 }
 
+// IMessage::Send (with payload in two parts)
+//------------------------------------------------------------------------------
+bool Protocol::IMessage::Send( const ConnectionInfo * connection, const MemoryStream & payloadHeader, const void * payloadData, size_t payloadDataSize ) const
+{
+    ASSERT( connection );
+    ASSERT( m_HasPayload == true ); // must NOT use Send with payload
+
+    // payload data is sent directly from the caller's buffer, avoiding a copy into the stream
+    TCPConnectionPool & pool = connection->GetTCPConnectionPool();
+    return pool.Send( connection, this, m_MsgSize, payloadHeader.GetData(), payloadHeader.GetSize(), payloadData, payloadDataSize );
+}
+
 // IMessage::Broadcast
 //------------------------------------------------------------------------------
 bool Protocol::IMessage::Broadcast( TCPConnectionPool * pool ) const
@@ -129,7 +142,7 @@ Protocol::MsgStatus::MsgStatus( uint32_t numJobsAvailable )
 // MsgRequestJob
 //------------------------------------------------------------------------------
 Protocol::MsgRequestJob::MsgRequestJob()
-    : Protocol::IMessage( Protocol::MSG_REQUEST_JOB, sizeof( MsgRequestJob ), false )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_JOB, sizeof( MsgRequestJob ), true )
 {
 }
 
@@ -142,12 +155,12 @@ Protocol::MsgNoJobAvailable::MsgNoJobAvailable()
 
 // MsgJob
 //------------------------------------------------------------------------------
-Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel )
+Protocol::MsgJob::MsgJob( uint64_t toolId, int16_t resultCompressionLevel, uint16_t resultChunkSizeKiB )
     : Protocol::IMessage( Protocol::MSG_JOB, sizeof( MsgJob ), true )
     , m_ResultCompressionLevel( resultCompressionLevel )
+    , m_ResultChunkSizeKiB( resultChunkSizeKiB )
     , m_ToolId( toolId )
 {
-    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
     ASSERT( toolId );
 }
 
@@ -165,6 +178,23 @@ Protocol::MsgJobResultCompressed::MsgJobResultCompressed()
 {
 }
 
+// MsgJobResultChunk
+//------------------------------------------------------------------------------
+Protocol::MsgJobResultChunk::MsgJobResultChunk( uint32_t jobId, bool isCompressed )
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULT_CHUNK, sizeof( MsgJobResultChunk ), true )
+    , m_JobId( jobId )
+    , m_IsCompressed( isCompressed )
+{
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+}
+
+// MsgJobResultStreamed
+//------------------------------------------------------------------------------
+Protocol::MsgJobResultStreamed::MsgJobResultStreamed()
+    : Protocol::IMessage( Protocol::MSG_JOB_RESULT_STREAMED, sizeof( MsgJobResultStreamed ), true )
+{
+}
+
 // MsgRequestManifest
 //------------------------------------------------------------------------------
 Protocol::MsgRequestManifest::MsgRequestManifest( uint64_t toolId )
@@ -204,7 +234,7 @@ Protocol::MsgFile::MsgFile( uint64_t toolId, uint32_t fileId )
 // MsgRequestWorkerList
 //------------------------------------------------------------------------------
 Protocol::MsgRequestWorkerList::MsgRequestWorkerList()
-    : Protocol::IMessage( Protocol::MSG_REQUEST_WORKER_LIST, sizeof( MsgRequestWorkerList ), false )
+    : Protocol::IMessage( Protocol::MSG_REQUEST_WORKER_LIST, sizeof( MsgRequestWorkerList ), true )
     , m_ProtocolVersion( PROTOCOL_VERSION_MAJOR )
     , m_Platform(Env::GetPlatform())
 {
@@ -219,12 +249,22 @@ Protocol::MsgWorkerList::MsgWorkerList()
 
 // MsgSetWorkerStatus
 //------------------------------------------------------------------------------
-Protocol::MsgSetWorkerStatus::MsgSetWorkerStatus( bool isAvailable )
-    : Protocol::IMessage( Protocol::MSG_SET_WORKER_STATUS, sizeof( MsgSetWorkerStatus ), false )
+Protocol::MsgSetWorkerStatus::MsgSetWorkerStatus( bool isAvailable,
+                                                  uint16_t numCPUs,
+                                                  uint16_t numJobsActive,
+                                                  uint16_t numJobsQueued,
+                                                  uint16_t rttMS )
+    : Protocol::IMessage( Protocol::MSG_SET_WORKER_STATUS, sizeof( MsgSetWorkerStatus ), true )
     , m_IsAvailable( isAvailable )
     , m_ProtocolVersion( PROTOCOL_VERSION_MAJOR )
     , m_Platform(Env::GetPlatform())
+    , m_NumCPUs( numCPUs )
+    , m_NumJobsActive( numJobsActive )
+    , m_NumJobsQueued( numJobsQueued )
+    , m_RTTMS( rttMS )
 {
+    memset( m_Padding2, 0, sizeof( m_Padding2 ) );
+    memset( m_Padding3, 0, sizeof( m_Padding3 ) );
 }
 
 //------------------------------------------------------------------------------
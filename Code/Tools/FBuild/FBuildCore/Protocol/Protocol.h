@@ -32,7 +32,7 @@ namespace Protocol
 
     // Protocol Version
     enum : uint32_t { PROTOCOL_VERSION_MAJOR = 22 };    // Changes here make workers incompatible
-    enum : uint8_t  { PROTOCOL_VERSION_MINOR = 2 };     // Changes must be forwards and backwards compatible
+    enum : uint8_t  { PROTOCOL_VERSION_MINOR = 5 };     // Changes must be forwards and backwards compatible
 
     enum { PROTOCOL_TEST_PORT = PROTOCOL_PORT + 1 }; // Different port for use by tests
 
@@ -45,7 +45,7 @@ namespace Protocol
         MSG_CONNECTION          = 1, // Server <- Client : Initial handshake
         MSG_STATUS              = 2, // Server <- Client : Update status (work available)
 
-        MSG_REQUEST_JOB         = 3, // Server -> Client : Ask for a job to do
+        MSG_REQUEST_JOB         = 3, // Server -> Client : Ask for a job to do (and advertise synchronized toolchains)
         MSG_NO_JOB_AVAILABLE    = 4, // Server <- Client : Respond that no jobs are available
         MSG_JOB                 = 5, // Server <- Client : Respond with a job to do
 
@@ -59,9 +59,12 @@ namespace Protocol
 
         MSG_JOB_RESULT_COMPRESSED   = 11, // Server -> Client : Return completed job (compressed)
 
-        MSG_REQUEST_WORKER_LIST = 11,// Client -> Coordinator : Ask coordinator for the list of workers
-        MSG_WORKER_LIST         = 12,// Client <- Coordinator : Respond with the list of workers
-        MSG_SET_WORKER_STATUS   = 13,// Server -> Coordinator : Sets worker status (available or unavailable)
+        MSG_REQUEST_WORKER_LIST = 11,// Client -> Coordinator : Ask coordinator for the list of workers (and the client's toolchains)
+        MSG_WORKER_LIST         = 12,// Client <- Coordinator : Respond with the list of workers (best first)
+        MSG_SET_WORKER_STATUS   = 13,// Server -> Coordinator : Sets worker status (available or unavailable, load and toolchains)
+
+        MSG_JOB_RESULT_CHUNK    = 14,// Server -> Client : Part of a completed job's results (requested via MsgJob)
+        MSG_JOB_RESULT_STREAMED = 15,// Server -> Client : Completes a job after all of its result chunks
 
         NUM_MESSAGES            // leave last
     };
@@ -81,6 +84,7 @@ namespace Protocol
         bool Send( const ConnectionInfo * connection ) const;
         bool Send( const ConnectionInfo * connection, const MemoryStream & payload ) const;
         bool Send( const ConnectionInfo * connection, const ConstMemoryStream & payload ) const;
+        bool Send( const ConnectionInfo * connection, const MemoryStream & payloadHeader, const void * payloadData, size_t payloadDataSize ) const;
         bool Broadcast( TCPConnectionPool * pool ) const;
 
         inline MessageType  GetType() const { return m_MsgType; }
@@ -135,6 +139,8 @@ namespace Protocol
 
     // MsgRequestJob
     //------------------------------------------------------------------------------
+    // Payload is the ids of the toolchains the worker has synchronized, so the client
+    // can prefer jobs which don't need a toolchain sync (older workers send no payload)
     class MsgRequestJob : public IMessage
     {
     public:
@@ -156,13 +162,14 @@ namespace Protocol
     class MsgJob : public IMessage
     {
     public:
-        explicit MsgJob( uint64_t toolId, int16_t resultCompressionLevel );
+        explicit MsgJob( uint64_t toolId, int16_t resultCompressionLevel, uint16_t resultChunkSizeKiB );
 
         inline uint64_t GetToolId() const { return m_ToolId; }
         int16_t         GetResultCompressionLevel() const { return m_ResultCompressionLevel; }
+        uint16_t        GetResultChunkSizeKiB() const { return m_ResultChunkSizeKiB; }
     private:
         int16_t     m_ResultCompressionLevel;
-        char        m_Padding2[ 2 ];
+        uint16_t    m_ResultChunkSizeKiB; // 0 = don't stream results (always 0 from older clients)
         uint64_t m_ToolId;
     };
     static_assert( sizeof( MsgJob ) == sizeof( IMessage ) + 4/*alignment*/ + 8, "MsgJob message has incorrect size" );
@@ -185,6 +192,31 @@ namespace Protocol
     };
     static_assert( sizeof( MsgJobResultCompressed ) == sizeof( IMessage ), "MsgJobResultCompressed message has incorrect size" );
 
+    // MsgJobResultChunk
+    //------------------------------------------------------------------------------
+    class MsgJobResultChunk : public IMessage
+    {
+    public:
+        MsgJobResultChunk( uint32_t jobId, bool isCompressed );
+
+        inline uint32_t GetJobId() const { return m_JobId; }
+        inline bool     IsCompressed() const { return m_IsCompressed; }
+    private:
+        uint32_t    m_JobId;
+        bool        m_IsCompressed;
+        char        m_Padding2[ 3 ];
+    };
+    static_assert( sizeof( MsgJobResultChunk ) == sizeof( IMessage ) + 8, "MsgJobResultChunk message has incorrect size" );
+
+    // MsgJobResultStreamed
+    //------------------------------------------------------------------------------
+    class MsgJobResultStreamed : public IMessage
+    {
+    public:
+        MsgJobResultStreamed();
+    };
+    static_assert( sizeof( MsgJobResultStreamed ) == sizeof( IMessage ), "MsgJobResultStreamed message has incorrect size" );
+
     // MsgRequestManifest
     //------------------------------------------------------------------------------
     class MsgRequestManifest : public IMessage
@@ -254,6 +286,7 @@ namespace Protocol
 
     // MsgRequestWorkersList
     //------------------------------------------------------------------------------
+    // Payload is the ids of the client's toolchains (older clients send no payload)
     class MsgRequestWorkerList : public IMessage
     {
     public:
@@ -278,20 +311,37 @@ namespace Protocol
 
     // MsgSetWorkerStatus
     //------------------------------------------------------------------------------
+    // Payload is the ids of the toolchains the worker has synchronized. Older
+    // workers send a smaller message (without load) and no payload.
     class MsgSetWorkerStatus : public IMessage
     {
     public:
-        explicit MsgSetWorkerStatus( bool isAvailable );
+        explicit MsgSetWorkerStatus( bool isAvailable,
+                                     uint16_t numCPUs = 0,
+                                     uint16_t numJobsActive = 0,
+                                     uint16_t numJobsQueued = 0,
+                                     uint16_t rttMS = 0 );
 
         inline bool     IsAvailable() const { return m_IsAvailable; }
         inline uint32_t GetProtocolVersion() const { return m_ProtocolVersion; }
         inline uint8_t  GetPlatform() const { return m_Platform; }
+        inline bool     HasLoad() const { return ( GetSize() >= sizeof( MsgSetWorkerStatus ) ); }
+        inline uint16_t GetNumCPUs() const { return m_NumCPUs; }
+        inline uint16_t GetNumJobsActive() const { return m_NumJobsActive; }
+        inline uint16_t GetNumJobsQueued() const { return m_NumJobsQueued; }
+        inline uint16_t GetRTTMS() const { return m_RTTMS; }
     private:
         bool            m_IsAvailable;
         uint32_t        m_ProtocolVersion;
         uint8_t         m_Platform;
+        uint8_t         m_Padding2[ 1 ];
+        uint16_t        m_NumCPUs;          // CPUs offered for remote work
+        uint16_t        m_NumJobsActive;    // Jobs being built
+        uint16_t        m_NumJobsQueued;    // Jobs received but not yet started
+        uint16_t        m_RTTMS;            // Time taken to connect to the coordinator
+        uint8_t         m_Padding3[ 2 ];
     };
-    static_assert( sizeof( MsgSetWorkerStatus ) == sizeof( IMessage ) + 12, "MsgSetWorkerStatus message has incorrect size" );
+    static_assert( sizeof( MsgSetWorkerStatus ) == sizeof( IMessage ) + 20, "MsgSetWorkerStatus message has incorrect size" );
 };
 
 //------------------------------------------------------------------------------
@@ -29,7 +29,8 @@
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 Server::Server( uint32_t numThreadsInJobQueue )
-    : m_ShouldExit( false )
+    : TCPConnectionPool( true ) // Message handlers write files and wait on locks held while sending
+    , m_ShouldExit( false )
     , m_ClientList( 32, true )
 {
     m_JobQueueRemote = FNEW( JobQueueRemote( numThreadsInJobQueue ? numThreadsInJobQueue : Env::GetNumProcessors() ) );
@@ -102,6 +103,22 @@ bool Server::IsSynchingTool( AString & statusStr ) const
     return false; // no toolchain is currently synching
 }
 
+// GetSynchronizedToolIds
+//------------------------------------------------------------------------------
+void Server::GetSynchronizedToolIds( Array< uint64_t > & outToolIds ) const
+{
+    MutexHolder manifestMH( m_ToolManifestsMutex );
+
+    outToolIds.SetCapacity( m_Tools.GetSize() );
+    for ( const ToolManifest * tool : m_Tools )
+    {
+        if ( tool->IsSynchronized() )
+        {
+            outToolIds.Append( tool->GetToolId() );
+        }
+    }
+}
+
 // OnConnected
 //------------------------------------------------------------------------------
 /*virtual*/ void Server::OnConnected( const ConnectionInfo * connection )
@@ -342,6 +359,7 @@ void Server::Process( const ConnectionInfo * connection, const Protocol::MsgJob
         Job * job = FNEW( Job( ms ) );
         job->SetUserData( cs );
         job->SetResultCompressionLevel( msg->GetResultCompressionLevel() );
+        job->SetResultChunkSize( msg->GetResultChunkSizeKiB() * (uint32_t)KILOBYTE );
     
         // Get ToolId
         const uint64_t toolId = msg->GetToolId();
@@ -650,6 +668,12 @@ void Server::FindNeedyClients()
         // sort clients to find neediest first
         m_ClientList.SortDeref();
 
+        // advertise our toolchains so clients can avoid sending jobs which need a sync
+        Array< uint64_t > toolIds;
+        GetSynchronizedToolIds( toolIds );
+        MemoryStream toolIdsStream;
+        toolIdsStream.Write( toolIds );
+
         const Protocol::MsgRequestJob msg;
 
         while ( availableJobs > 0 )
@@ -668,7 +692,7 @@ void Server::FindNeedyClients()
                 }
 
                 // request job from this client
-                msg.Send( cs->m_Connection );
+                msg.Send( cs->m_Connection, toolIdsStream );
                 cs->m_NumJobsRequested++;
                 availableJobs--;
                 anyJobsRequested = true;
@@ -713,26 +737,51 @@ void Server::FinalizeCompletedJobs()
                 ms.Write( job->GetNode()->GetLastBuildTime() );
                 ms.Write( job->GetRemoteThreadIndex() ); // The thread used to build the job to assist with visualization
 
-                // write the data - build result for success, or output+errors for failure
-                ms.Write( (uint32_t)job->GetDataSize() );
-                ms.WriteBuffer( job->GetData(), job->GetDataSize() );
+                // Successful results may have been split into chunks to stream (see JobQueueRemote::ReadResults)
+                const bool streamed = ( result == Node::UP_TO_DATE ) && ( job->GetResultChunkSize() > 0 );
+
+                // the data - build result for success, or output+errors for failure
+                // (sent directly from the job after the header, avoiding a copy)
+                ms.Write( streamed ? (uint32_t)0 : (uint32_t)job->GetDataSize() );
 
                 {
                     MutexHolder mh2( cs->m_Mutex );
                     ASSERT( cs->m_NumJobsActive );
                     cs->m_NumJobsActive--;
     
-                    if ( job->GetResultCompressionLevel() == 0 )
+                    if ( streamed )
+                    {
+                        // Each chunk, followed by the result itself
+                        const bool isCompressed = ( job->GetResultCompressionLevel() != 0 );
+                        ConstMemoryStream chunks( job->GetData(), job->GetDataSize() );
+                        bool sent = true;
+                        while ( sent && ( chunks.Tell() < chunks.GetSize() ) )
+                        {
+                            uint32_t chunkSize = 0;
+                            VERIFY( chunks.Read( chunkSize ) );
+                            const ConstMemoryStream chunk( (const char *)chunks.GetData() + chunks.Tell(), chunkSize );
+                            chunks.Seek( chunks.Tell() + chunkSize );
+
+                            const Protocol::MsgJobResultChunk msg( job->GetJobId(), isCompressed );
+                            sent = msg.Send( cs->m_Connection, chunk );
+                        }
+                        if ( sent )
+                        {
+                            const Protocol::MsgJobResultStreamed msg;
+                            msg.Send( cs->m_Connection, ms );
+                        }
+                    }
+                    else if ( job->GetResultCompressionLevel() == 0 )
                     {
                         // Uncompressed
                         const Protocol::MsgJobResult msg;
-                        msg.Send( cs->m_Connection, ms );
+                        msg.Send( cs->m_Connection, ms, job->GetData(), job->GetDataSize() );
                     }
                     else
                     {
                         // Compressed
                         const Protocol::MsgJobResultCompressed msg;
-                        msg.Send( cs->m_Connection, ms );
+                        msg.Send( cs->m_Connection, ms, job->GetData(), job->GetDataSize() );
                     }
                 }
             }
@@ -35,6 +35,7 @@ public:
     static void GetHostForJob( const Job * job, AString & hostName );
 
     bool IsSynchingTool( AString & statusStr ) const;
+    void GetSynchronizedToolIds( Array< uint64_t > & outToolIds ) const;
 
 private:
     // TCPConnection interface
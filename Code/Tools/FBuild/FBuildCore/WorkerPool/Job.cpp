@@ -161,6 +161,14 @@ void Job::Serialize( IOStream & stream )
 {
     PROFILE_FUNCTION;
 
+    SerializeHeader( stream );
+    stream.Write( m_Data, m_DataSize );
+}
+
+// SerializeHeader
+//------------------------------------------------------------------------------
+void Job::SerializeHeader( IOStream & stream )
+{
     // write jobid
     stream.Write( m_JobId );
     stream.Write( m_Node->GetName() );
@@ -174,7 +182,6 @@ void Job::Serialize( IOStream & stream )
     stream.Write( IsDataCompressed() );
 
     stream.Write( m_DataSize );
-    stream.Write( m_Data, m_DataSize );
 }
 
 // Deserialize
@@ -65,6 +65,7 @@ public:
 
     // serialization for remote distribution
     void Serialize( IOStream & stream );
+    void SerializeHeader( IOStream & stream ); // Serialize without the data, which must follow
     void Deserialize( IOStream & stream );
 
     void                GetMessagesForLog( AString & buffer ) const;
@@ -77,6 +78,8 @@ public:
 
     void                SetResultCompressionLevel( int16_t compressionLevel )   { m_ResultCompressionLevel = compressionLevel; }
     int16_t             GetResultCompressionLevel() const                       { return m_ResultCompressionLevel; }
+    void                SetResultChunkSize( uint32_t chunkSize )                { m_ResultChunkSize = chunkSize; }
+    uint32_t            GetResultChunkSize() const                              { return m_ResultChunkSize; }
 
     enum DistributionState : uint8_t
     {
@@ -121,6 +124,7 @@ private:
     BuildProfilerScope * m_BuildProfilerScope = nullptr;    // Additional context when profiling a build
     ToolManifest *      m_ToolManifest      = nullptr;
     int16_t             m_ResultCompressionLevel = 0; // Compression level of returned results
+    uint32_t            m_ResultChunkSize   = 0; // On server, size of chunks to stream results in (0 = not streamed)
 
     Array< AString >    m_Messages;
 
@@ -9,26 +9,256 @@
 
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/FLog.h"
+#include "Tools/FBuild/FBuildCore/Graph/CompilerNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/Node.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Helpers/BuildProfiler.h"
 
 #include "Core/Time/Timer.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Process/Atomic.h"
 #include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 
-// JobCostSorter
+// Push
 //------------------------------------------------------------------------------
-class JobCostSorter
+/*static*/ void JobHeap::Push( Array< Job * > & heap, Job * job )
 {
-public:
-    inline bool operator () ( const Job * job1, const Job * job2 ) const
+    heap.Append( job );
+
+    // Move parents down until we find the insertion point
+    Job ** jobs = heap.Begin();
+    size_t index = ( heap.GetSize() - 1 );
+    while ( index > 0 )
+    {
+        const size_t parent = ( ( index - 1 ) / ARITY );
+        if ( IsMoreExpensive( job, jobs[ parent ] ) == false )
+        {
+            break;
+        }
+        jobs[ index ] = jobs[ parent ];
+        index = parent;
+    }
+    jobs[ index ] = job;
+}
+
+// Pop
+//------------------------------------------------------------------------------
+/*static*/ Job * JobHeap::Pop( Array< Job * > & heap )
+{
+    return Remove( heap, 0 );
+}
+
+// Remove
+//------------------------------------------------------------------------------
+/*static*/ Job * JobHeap::Remove( Array< Job * > & heap, size_t indexToRemove )
+{
+    ASSERT( indexToRemove < heap.GetSize() );
+
+    Job ** jobs = heap.Begin();
+    Job * const removedJob = jobs[ indexToRemove ];
+
+    // Re-insert the last job, starting from the removed job's position
+    Job * const lastJob = heap.Top();
+    heap.Pop();
+    const size_t size = heap.GetSize();
+    if ( indexToRemove == size )
+    {
+        return removedJob; // removed the last job
+    }
+
+    // Move parents down until we find the insertion point
+    // (only possible when removing from the middle of the heap)
+    size_t index = indexToRemove;
+    while ( index > 0 )
+    {
+        const size_t parent = ( ( index - 1 ) / ARITY );
+        if ( IsMoreExpensive( lastJob, jobs[ parent ] ) == false )
+        {
+            break;
+        }
+        jobs[ index ] = jobs[ parent ];
+        index = parent;
+    }
+
+    // Move most expensive children up until we find the insertion point
+    for ( ;; )
     {
-        return ( job1->GetNode()->GetRecursiveCost() < job2->GetNode()->GetRecursiveCost() );
+        const size_t firstChild = ( ( index * ARITY ) + 1 );
+        if ( firstChild >= size )
+        {
+            break;
+        }
+        const size_t endChild = Math::Min( firstChild + ARITY, size );
+        size_t mostExpensiveChild = firstChild;
+        for ( size_t child = ( firstChild + 1 ); child < endChild; ++child )
+        {
+            if ( IsMoreExpensive( jobs[ child ], jobs[ mostExpensiveChild ] ) )
+            {
+                mostExpensiveChild = child;
+            }
+        }
+        if ( IsMoreExpensive( jobs[ mostExpensiveChild ], lastJob ) == false )
+        {
+            break;
+        }
+        jobs[ index ] = jobs[ mostExpensiveChild ];
+        index = mostExpensiveChild;
     }
-};
+    jobs[ index ] = lastJob;
+
+    return removedJob;
+}
+
+// IsMoreExpensive
+//------------------------------------------------------------------------------
+/*static*/ bool JobHeap::IsMoreExpensive( const Job * job1, const Job * job2 )
+{
+    return ( job1->GetNode()->GetRecursiveCost() > job2->GetNode()->GetRecursiveCost() );
+}
+
+// DistributableJobs CONSTRUCTOR
+//------------------------------------------------------------------------------
+DistributableJobs::DistributableJobs()
+    : m_ToolJobs( 8, true )
+    , m_NumJobs( 0 )
+{
+}
+
+// DistributableJobs DESTRUCTOR
+//------------------------------------------------------------------------------
+DistributableJobs::~DistributableJobs()
+{
+    ASSERT( m_NumJobs == 0 ); // Jobs must be deleted by the owner
+    for ( ToolJobs * toolJobs : m_ToolJobs )
+    {
+        FDELETE toolJobs;
+    }
+}
+
+// Push
+//------------------------------------------------------------------------------
+void DistributableJobs::Push( Job * job, uint64_t toolId )
+{
+    ToolJobs * heap = nullptr;
+    for ( ToolJobs * toolJobs : m_ToolJobs )
+    {
+        if ( toolJobs->m_ToolId == toolId )
+        {
+            heap = toolJobs;
+            break;
+        }
+    }
+    if ( heap == nullptr )
+    {
+        heap = FNEW( ToolJobs );
+        heap->m_ToolId = toolId;
+        heap->m_Jobs.SetCapacity( 1024 );
+        m_ToolJobs.Append( heap );
+    }
+
+    JobHeap::Push( heap->m_Jobs, job );
+    ++m_NumJobs;
+}
+
+// Pop
+//------------------------------------------------------------------------------
+Job * DistributableJobs::Pop()
+{
+    // Find the most expensive job of any toolchain
+    ToolJobs * best = nullptr;
+    for ( ToolJobs * toolJobs : m_ToolJobs )
+    {
+        ASSERT( toolJobs->m_Jobs.IsEmpty() == false );
+        if ( ( best == nullptr ) ||
+             ( toolJobs->m_Jobs[ 0 ]->GetNode()->GetRecursiveCost() > best->m_Jobs[ 0 ]->GetNode()->GetRecursiveCost() ) )
+        {
+            best = toolJobs;
+        }
+    }
+    return best ? PopFrom( best ) : nullptr;
+}
+
+// Pop
+//------------------------------------------------------------------------------
+Job * DistributableJobs::Pop( const Array< uint64_t > & toolIds,
+                              const Array< uint64_t > & otherToolIds,
+                              bool allowToolchainSync )
+{
+    // Find the most expensive job of the most preferred kind
+    enum : uint32_t { NOT_WANTED = 0, NEEDS_SYNC = 1, NO_SYNC = 2 };
+    ToolJobs * best = nullptr;
+    uint32_t bestPreference = NOT_WANTED;
+    for ( ToolJobs * toolJobs : m_ToolJobs )
+    {
+        ASSERT( toolJobs->m_Jobs.IsEmpty() == false );
+
+        uint32_t preference = NEEDS_SYNC;
+        if ( toolIds.Find( toolJobs->m_ToolId ) )
+        {
+            preference = NO_SYNC;
+        }
+        else if ( ( allowToolchainSync == false ) && otherToolIds.Find( toolJobs->m_ToolId ) )
+        {
+            preference = NOT_WANTED;
+        }
+
+        if ( ( preference > bestPreference ) ||
+             ( ( preference == bestPreference ) && ( preference != NOT_WANTED ) &&
+               ( toolJobs->m_Jobs[ 0 ]->GetNode()->GetRecursiveCost() > best->m_Jobs[ 0 ]->GetNode()->GetRecursiveCost() ) ) )
+        {
+            best = toolJobs;
+            bestPreference = preference;
+        }
+    }
+    return best ? PopFrom( best ) : nullptr;
+}
+
+// DeleteJobs
+//------------------------------------------------------------------------------
+void DistributableJobs::DeleteJobs()
+{
+    for ( ToolJobs * toolJobs : m_ToolJobs )
+    {
+        for ( Job * job : toolJobs->m_Jobs )
+        {
+            FDELETE job;
+        }
+        FDELETE toolJobs;
+    }
+    m_ToolJobs.Clear();
+    m_NumJobs = 0;
+}
+
+// PopFrom
+//------------------------------------------------------------------------------
+Job * DistributableJobs::PopFrom( ToolJobs * toolJobs )
+{
+    ASSERT( m_NumJobs > 0 );
+    --m_NumJobs;
+    Job * job = JobHeap::Pop( toolJobs->m_Jobs );
+
+    // Stop searching toolchains with no jobs left
+    if ( toolJobs->m_Jobs.IsEmpty() )
+    {
+        ToolJobs ** iter = m_ToolJobs.Find( toolJobs );
+        ASSERT( iter );
+        m_ToolJobs.Erase( iter );
+        FDELETE toolJobs;
+    }
+    return job;
+}
+
+// GetToolId
+//------------------------------------------------------------------------------
+static uint64_t GetToolId( const Job * job )
+{
+    // Only ObjectNodes are distributed
+    const Node * compiler = job->GetNode()->CastTo< ObjectNode >()->GetCompiler();
+    return compiler->CastTo< CompilerNode >()->GetManifest().GetToolId();
+}
 
 // JobSubQueue CONSTRUCTOR
 //------------------------------------------------------------------------------
@@ -55,34 +285,16 @@ uint32_t JobSubQueue::GetCount() const
 
 // JobSubQueue:QueueJobs
 //------------------------------------------------------------------------------
-void JobSubQueue::QueueJobs( Array< Node * > & nodes )
+void JobSubQueue::QueueJobs( const Array< Job * > & jobs )
 {
-    // Create wrapper Jobs around Nodes
-    Array< Job * > jobs( nodes.GetSize() );
-    for ( Node * node : nodes )
-    {
-        Job * job = FNEW( Job( node ) );
-        jobs.Append( job );
-    }
-
-    // Sort Jobs by cost
-    JobCostSorter sorter;
-    jobs.Sort( sorter );
-
-    // lock to add job
+    // lock to add jobs
     MutexHolder mh( m_Mutex );
-    const bool wasEmpty = m_Jobs.IsEmpty();
-
-    m_Jobs.Append( jobs );
-    AtomicAdd( &m_Count, (uint32_t)jobs.GetSize() );
 
-    if ( wasEmpty )
+    for ( Job * job : jobs )
     {
-        return; // skip re-sorting
+        JobHeap::Push( m_Jobs, job );
     }
-
-    // sort merged lists
-    m_Jobs.Sort( sorter );
+    AtomicAdd( &m_Count, (uint32_t)jobs.GetSize() );
 }
 
 // RemoveJob
@@ -106,17 +318,16 @@ Job * JobSubQueue::RemoveJob()
 
     VERIFY( AtomicDec( &m_Count ) != static_cast< uint32_t >( -1 ) );
 
-    Job * job = m_Jobs.Top();
-    m_Jobs.Pop();
-
-    return job;
+    return JobHeap::Pop( m_Jobs );
 }
 
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 JobQueue::JobQueue( uint32_t numWorkerThreads ) :
+    m_NodesToRecheck( 1024, true ),
+    m_LocalJobs_Available( numWorkerThreads + 1, false ),
+    m_NextLocalQueue( 0 ),
     m_NumLocalJobsActive( 0 ),
-    m_DistributableJobs_Available( 1024, true ),
     m_DistributableJobs_InProgress( 1024, true ),
     #if defined( __WINDOWS__ )
         m_MainThreadSemaphore( 1 ), // On Windows, take advantage of signalling limit
@@ -133,6 +344,14 @@ JobQueue::JobQueue( uint32_t numWorkerThreads ) :
 
     WorkerThread::InitTmpDir();
 
+    // Each worker has its own queue to avoid contention. When building on the
+    // main thread (no workers) a single queue is used.
+    const uint32_t numQueues = Math::Max( numWorkerThreads, 1u );
+    for ( uint32_t i=0; i<numQueues; ++i )
+    {
+        m_LocalJobs_Available.Append( FNEW( JobSubQueue ) );
+    }
+
     for ( uint32_t i=0; i<numWorkerThreads; ++i )
     {
         // identify each worker with an id starting from 1
@@ -154,9 +373,13 @@ JobQueue::~JobQueue()
     SignalStopWorkers();
 
     // delete incomplete jobs
-    while ( Job * job = m_LocalJobs_Available.RemoveJob() )
+    for ( JobSubQueue * subQueue : m_LocalJobs_Available )
     {
-        FDELETE job;
+        while ( Job * job = subQueue->RemoveJob() )
+        {
+            FDELETE job;
+        }
+        FDELETE subQueue;
     }
 
     // wait for workers to finish - ok if they stopped before this
@@ -172,12 +395,7 @@ JobQueue::~JobQueue()
         MutexHolder m( m_DistributedJobsMutex );
         // we may have some distributable jobs that could not be built,
         // so delete them here before checking mem usage below
-        const size_t numJobsAvailable = m_DistributableJobs_Available.GetSize();
-        for ( size_t i=0; i<numJobsAvailable; ++i )
-        {
-            FDELETE m_DistributableJobs_Available[ i ];
-        }
-        m_DistributableJobs_Available.Clear();
+        m_DistributableJobs_Available.DeleteJobs();
     }
 
     ASSERT( m_CompletedJobs.IsEmpty() );
@@ -232,7 +450,11 @@ void JobQueue::GetJobStats( uint32_t & numJobs,
 {
     MutexHolder m( m_DistributedJobsMutex );
 
-    numJobs = m_LocalJobs_Available.GetCount();
+    numJobs = 0;
+    for ( const JobSubQueue * subQueue : m_LocalJobs_Available )
+    {
+        numJobs += subQueue->GetCount();
+    }
     numJobsDist = (uint32_t)m_DistributableJobs_Available.GetSize();
     numJobsActive = AtomicLoadRelaxed( &m_NumLocalJobsActive );
     numJobsDistActive = (uint32_t)m_DistributableJobs_InProgress.GetSize();
@@ -268,8 +490,40 @@ void JobQueue::FlushJobBatch()
         return;
     }
 
+    // Start retrieving likely cache hits before workers pick up the jobs
+    if ( FBuild::Get().GetCachePrefetcher() )
+    {
+        for ( Node * node : m_LocalJobs_Staging )
+        {
+            if ( node->GetType() == Node::OBJECT_NODE )
+            {
+                node->CastTo< ObjectNode >()->PrefetchFromCache();
+            }
+        }
+    }
+
+    // Create wrapper Jobs around Nodes, spreading them evenly over the worker
+    // queues. Expensive jobs are still found quickly since workers consume
+    // from the front of each queue and steal from others when theirs is empty.
+    // The starting queue rotates between flushes so that small batches don't
+    // all land on the same queue.
+    const size_t numQueues = m_LocalJobs_Available.GetSize();
+    Array< Array< Job * > > jobsPerQueue;
+    jobsPerQueue.SetSize( numQueues );
+    for ( size_t i = 0; i < m_LocalJobs_Staging.GetSize(); ++i )
+    {
+        jobsPerQueue[ ( m_NextLocalQueue + i ) % numQueues ].Append( FNEW( Job( m_LocalJobs_Staging[ i ] ) ) );
+    }
+    m_NextLocalQueue = ( ( m_NextLocalQueue + m_LocalJobs_Staging.GetSize() ) % numQueues );
+
     // Make the jobs available
-    m_LocalJobs_Available.QueueJobs( m_LocalJobs_Staging );
+    for ( size_t i = 0; i < numQueues; ++i )
+    {
+        if ( jobsPerQueue[ i ].IsEmpty() == false )
+        {
+            m_LocalJobs_Available[ i ]->QueueJobs( jobsPerQueue[ i ] );
+        }
+    }
     m_WorkerThreadSemaphore.Signal( (uint32_t)m_LocalJobs_Staging.GetSize() );
     m_LocalJobs_Staging.Clear();
 }
@@ -284,15 +538,12 @@ void JobQueue::QueueDistributableJob( Job * job )
     {
         MutexHolder m( m_DistributedJobsMutex );
 
-        m_DistributableJobs_Available.Append( job );
-
         // Jobs that have been preprocsssed and are ready to be distributed are
         // added here. The order of completion of preprocessing doesn't correlate
         // with the remining cost of compilation (and is often the reverse).
-        // We re-sort the distributable jobs when adding new ones to ensure the
-        // most expensive ones are at the end of the list and will be distributed first.
-        JobCostSorter sorter;
-        m_DistributableJobs_Available.Sort( sorter );
+        // We keep the distributable jobs ordered by cost to ensure the most
+        // expensive ones will be distributed first.
+        m_DistributableJobs_Available.Push( job, GetToolId( job ) );
 
         job->SetDistributionState( Job::DIST_AVAILABLE );
     }
@@ -314,10 +565,31 @@ Job * JobQueue::GetDistributableJobToProcess( bool remote )
         return nullptr;
     }
 
-    // Jobs are sorted from least to most expensive, so we consume
-    // from the end of the list.
-    Job * job = m_DistributableJobs_Available.Top();
-    m_DistributableJobs_Available.Pop();
+    // Jobs are ordered by cost, so we consume the most expensive first
+    Job * job = m_DistributableJobs_Available.Pop();
+
+    ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
+
+    // Tag job as in-use
+    job->SetDistributionState( remote ? Job::DIST_BUILDING_REMOTELY : Job::DIST_BUILDING_LOCALLY );
+    m_DistributableJobs_InProgress.Append( job );
+    return job;
+}
+
+// GetDistributableJobToProcess
+//------------------------------------------------------------------------------
+Job * JobQueue::GetDistributableJobToProcess( bool remote,
+                                              const Array< uint64_t > & toolIds,
+                                              const Array< uint64_t > & otherToolIds,
+                                              bool allowToolchainSync )
+{
+    MutexHolder m( m_DistributedJobsMutex );
+
+    Job * job = m_DistributableJobs_Available.Pop( toolIds, otherToolIds, allowToolchainSync );
+    if ( job == nullptr )
+    {
+        return nullptr;
+    }
 
     ASSERT( job->GetDistributionState() == Job::DIST_AVAILABLE );
 
@@ -492,7 +764,7 @@ void JobQueue::ReturnUnfinishedDistributableJob( Job * job )
             }
 
             // Put back in available queue
-            m_DistributableJobs_Available.Append( job );
+            m_DistributableJobs_Available.Push( job, GetToolId( job ) );
             job->SetDistributionState( Job::DIST_AVAILABLE );
         }
     }
@@ -525,6 +797,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
         {
             n->SetState( Node::FAILED );
         }
+        NodeGraph::OnNodeCompleted( n );
 
         // Free normal jobs
         if ( job->GetDistributionState() == Job::DIST_NONE )
@@ -575,6 +848,7 @@ void JobQueue::FinalizeCompletedJobs( NodeGraph & nodeGraph )
     for ( Job * job : m_CompletedJobsFailed2 )
     {
         job->GetNode()->SetState( Node::FAILED );
+        NodeGraph::OnNodeCompleted( job->GetNode() );
 
         // Free normal jobs
         if ( job->GetDistributionState() == Job::DIST_NONE )
@@ -630,11 +904,17 @@ void JobQueue::WorkerThreadWait( uint32_t maxWaitMS )
 //------------------------------------------------------------------------------
 Job * JobQueue::GetJobToProcess()
 {
-    Job * job = m_LocalJobs_Available.RemoveJob();
-    if ( job )
+    // Consume from our own queue first, then try to steal from the others
+    const size_t numQueues = m_LocalJobs_Available.GetSize();
+    const size_t ownQueue = ( WorkerThread::GetThreadIndex() % numQueues );
+    for ( size_t i = 0; i < numQueues; ++i )
     {
-        AtomicInc( &m_NumLocalJobsActive );
-        return job;
+        Job * job = m_LocalJobs_Available[ ( ownQueue + i ) % numQueues ]->RemoveJob();
+        if ( job )
+        {
+            AtomicInc( &m_NumLocalJobsActive );
+            return job;
+        }
     }
 
     return nullptr;
@@ -18,6 +18,64 @@ class Job;
 class WorkerThread;
 
 
+// JobHeap
+//------------------------------------------------------------------------------
+// Maintains an array of Jobs as a 4-ary heap with the most expensive job at the
+// front. Adding or removing a job is O(log n), so queuing new work never
+// requires re-sorting the jobs which are already queued.
+class JobHeap
+{
+public:
+    static void     Push( Array< Job * > & heap, Job * job );
+    static Job *    Pop( Array< Job * > & heap );
+    static Job *    Remove( Array< Job * > & heap, size_t index );
+
+private:
+    enum : size_t { ARITY = 4 };
+
+    static bool     IsMoreExpensive( const Job * job1, const Job * job2 );
+};
+
+// DistributableJobs
+//------------------------------------------------------------------------------
+// Jobs available for distribution, in a heap per toolchain. The most expensive
+// job for a given toolchain is found without searching every job.
+class DistributableJobs
+{
+public:
+    DistributableJobs();
+    ~DistributableJobs();
+
+    void    Push( Job * job, uint64_t toolId );
+    Job *   Pop(); // Most expensive job
+
+    // Prefer jobs for toolchains the worker already has (toolIds), then jobs for
+    // toolchains no worker has. Jobs for toolchains only other workers have
+    // (otherToolIds) are left for them, unless allowToolchainSync.
+    Job *   Pop( const Array< uint64_t > & toolIds,
+                 const Array< uint64_t > & otherToolIds,
+                 bool allowToolchainSync );
+
+    void    DeleteJobs();
+
+    inline size_t GetSize() const { return m_NumJobs; }
+    inline bool IsEmpty() const { return ( m_NumJobs == 0 ); }
+    inline size_t GetNumToolchains() const { return m_ToolJobs.GetSize(); }
+
+private:
+    struct ToolJobs
+    {
+        uint64_t        m_ToolId;
+        Array< Job * >  m_Jobs; // Heap ordered, most expensive at front
+    };
+    Job *   PopFrom( ToolJobs * toolJobs );
+
+    // Few toolchains are used in a build, so these are searched linearly. Only
+    // toolchains with jobs are kept, so the search stays short as they finish.
+    Array< ToolJobs * > m_ToolJobs;
+    size_t              m_NumJobs;
+};
+
 // JobSubQueue
 //------------------------------------------------------------------------------
 class JobSubQueue
@@ -29,14 +87,14 @@ public:
     uint32_t GetCount() const;
 
     // jobs pushed by the main thread
-    void QueueJobs( Array< Node * > & nodes );
+    void QueueJobs( const Array< Job * > & jobs );
 
     // jobs consumed by workers
     Job * RemoveJob();
 private:
     uint32_t    m_Count;    // access the current count
     Mutex       m_Mutex;    // lock to add/remove jobs
-    Array< Job * > m_Jobs;  // Sorted, most expensive at end
+    Array< Job * > m_Jobs;  // Heap ordered, most expensive at front
 };
 
 // JobQueue
@@ -51,6 +109,8 @@ public:
     void AddJobToBatch( Node * node );  // Add new job to the staging queue
     void FlushJobBatch();               // Sort and flush the staging queue
     bool HasJobsToFlush() const { return ( m_LocalJobs_Staging.IsEmpty() == false ); }
+    void AddNodeToRecheck( Node * node ) { m_NodesToRecheck.Append( node ); }
+    Array< Node * > & GetNodesToRecheck() { return m_NodesToRecheck; }
     void FinalizeCompletedJobs( NodeGraph & nodeGraph );
     void MainThreadWait( uint32_t maxWaitMS );
 
@@ -82,6 +142,10 @@ private:
     // client side of protocol consumes jobs via this interface
     friend class Client;
     Job *       GetDistributableJobToProcess( bool remote );
+    Job *       GetDistributableJobToProcess( bool remote,
+                                              const Array< uint64_t > & toolIds,
+                                              const Array< uint64_t > & otherToolIds,
+                                              bool allowToolchainSync );
     Job *       OnReturnRemoteJob( uint32_t jobId,
                                    bool systemError,
                                    bool & outRaceLost,
@@ -93,16 +157,21 @@ private:
     // Semaphore to manage work
     Semaphore           m_WorkerThreadSemaphore;
 
+    // Nodes whose outstanding dependencies have completed since they were last
+    // checked. Only these are revisited by subsequent build passes.
+    Array< Node * >     m_NodesToRecheck;
+
     // Jobs available for local processing
     Array< Node * >     m_LocalJobs_Staging;
-    JobSubQueue         m_LocalJobs_Available;
+    Array< JobSubQueue * > m_LocalJobs_Available; // One per worker thread. Idle workers steal from others.
+    size_t              m_NextLocalQueue;   // Queue receiving the first job of the next flush
 
     // Jobs in progress locally
     uint32_t            m_NumLocalJobsActive;
 
     // Jobs available for distributed processing (can also be done locally)
     mutable Mutex       m_DistributedJobsMutex;
-    Array< Job * >      m_DistributableJobs_Available;  // Available, not in progress anywhere
+    DistributableJobs   m_DistributableJobs_Available;  // Available, not in progress anywhere
     Array< Job * >      m_DistributableJobs_InProgress; // In progress remotely, locally or both
 
     // Semaphore to manage thread idle
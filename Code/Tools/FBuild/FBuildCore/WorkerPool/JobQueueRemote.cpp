@@ -99,6 +99,22 @@ void JobQueueRemote::GetWorkerStatus( size_t index, AString & hostName, AString
     ( (WorkerThreadRemote *)m_Workers[ index ] )->GetStatus( hostName, status, isIdle );
 }
 
+// GetNumJobsActive
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumJobsActive() const
+{
+    MutexHolder m( m_InFlightJobsMutex );
+    return m_InFlightJobs.GetSize();
+}
+
+// GetNumJobsQueued
+//------------------------------------------------------------------------------
+size_t JobQueueRemote::GetNumJobsQueued() const
+{
+    MutexHolder m( m_PendingJobsMutex );
+    return m_PendingJobs.GetSize();
+}
+
 // MainThreadWait
 //------------------------------------------------------------------------------
 void JobQueueRemote::MainThreadWait( uint32_t timeoutMS )
@@ -365,7 +381,7 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
             if ( job->IsLocal() )
             {
                 // we should have recorded the new file time for remote job we built locally
-                ASSERT( node->m_Stamp == FileIO::GetFileLastWriteTime(node->GetName()) );
+                ASSERT( node->m_Stamp == Node::GetFileStamp( node->GetName() ) );
             }
         #endif
 
@@ -454,11 +470,23 @@ void JobQueueRemote::FinishedProcessingJob( Job * job, bool success )
         FLOG_ERROR( "Error reading file: '%s'", fileNames[ problemFileIndex ].Get() );
     }
 
-    // Compress result
+    // Large results are streamed in chunks if the client asked for that, so
+    // it can write them out while the rest is still being received
     const int32_t compressionLevel = job->GetResultCompressionLevel();
-    if ( compressionLevel != 0 )
+    const uint32_t chunkSize = job->GetResultChunkSize();
+    if ( ( chunkSize > 0 ) && ( mb.GetDataSize() > chunkSize ) )
+    {
+        mb.SplitIntoChunks( chunkSize, compressionLevel );
+    }
+    else
     {
-        mb.Compress( compressionLevel );
+        job->SetResultChunkSize( 0 ); // Send as a single result
+
+        // Compress result
+        if ( compressionLevel != 0 )
+        {
+            mb.Compress( compressionLevel );
+        }
     }
 
     // transfer data to job
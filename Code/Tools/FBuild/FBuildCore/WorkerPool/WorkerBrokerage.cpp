@@ -18,6 +18,7 @@
 #include "Core/Env/Env.h"
 #include "Core/FileIO/FileIO.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/MemoryStream.h"
 #include "Core/FileIO/PathUtils.h"
 #include "Core/Network/Network.h"
 #include "Core/Network/TCPConnectionPool.h"
@@ -83,7 +84,9 @@ WorkerBrokerage::WorkerBrokerage()
     , m_SettingsWriteTime( 0 )
     , m_ConnectionPool( nullptr )
     , m_Connection( nullptr )
+    , m_CoordinatorRTTMS( 0 )
     , m_WorkerListUpdateReady( false )
+    , m_WorkerListRanked( false )
 {
 }
 
@@ -192,7 +195,7 @@ void WorkerBrokerage::InitBrokerage()
 WorkerBrokerage::~WorkerBrokerage()
 {
     // Ensure the file disappears when closing
-    if ( m_Availability )
+    if ( m_Availability && ( m_BrokerageFilePath.IsEmpty() == false ) )
     {
         FileIO::FileDelete( m_BrokerageFilePath.Get() );
     }
@@ -200,7 +203,7 @@ WorkerBrokerage::~WorkerBrokerage()
 
 // FindWorkers
 //------------------------------------------------------------------------------
-void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
+void WorkerBrokerage::FindWorkers( Array< AString > & workerList, const Array< uint64_t > & toolIds )
 {
     PROFILE_FUNCTION;
 
@@ -231,12 +234,14 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
     {
         m_WorkerListUpdateReady = false;
 
-
         OUTPUT( "Requesting worker list\n");
 
-        const Protocol::MsgRequestWorkerList msg;
-        msg.Send( m_Connection );
+        // send our toolchains so workers which already have them are preferred
+        MemoryStream ms;
+        ms.Write( toolIds );
 
+        const Protocol::MsgRequestWorkerList msg;
+        msg.Send( m_Connection, ms );
 
         while ( m_WorkerListUpdateReady == false )
         {
@@ -251,6 +256,7 @@ void WorkerBrokerage::FindWorkers( Array< AString > & workerList )
             FLOG_WARN( "No workers received from coordinator" );
             return; // no files found
         }
+        m_WorkerListRanked = true;
 
         // presize
         if ( ( workerList.GetSize() + m_WorkerListUpdate.GetSize() ) > workerList.GetCapacity() )
@@ -327,13 +333,13 @@ void WorkerBrokerage::UpdateWorkerList( Array< uint32_t > &workerListUpdate )
 
 // SetAvailability
 //------------------------------------------------------------------------------
-void WorkerBrokerage::SetAvailability( bool available )
+void WorkerBrokerage::SetAvailability( bool available, const WorkerLoad * load )
 {
         // Init the brokerage if not already
     InitBrokerage();
 
     // ignore if brokerage not configured
-    if ( m_BrokerageRoots.IsEmpty() )
+    if ( m_BrokerageRoots.IsEmpty() && m_CoordinatorAddress.IsEmpty() )
     {
         return;
     }
@@ -346,12 +352,10 @@ void WorkerBrokerage::SetAvailability( bool available )
         {
             if ( ConnectToCoordinator() )
             {
-
-                const Protocol::MsgSetWorkerStatus msg( available );
-                msg.Send( m_Connection );
+                SendWorkerStatus( available, load );
                 DisconnectFromCoordinator();
             }
-            else
+            else if ( m_BrokerageRoots.IsEmpty() == false ) // Not when only using a coordinator
             {
                 // If settings have changed, (re)create the file 
                 // If settings have not changed, update the modification timestamp
@@ -468,11 +472,10 @@ void WorkerBrokerage::SetAvailability( bool available )
     {
         if ( ConnectToCoordinator() )
         {
-            const Protocol::MsgSetWorkerStatus msg( available );
-            msg.Send( m_Connection );
+            SendWorkerStatus( available, nullptr );
             DisconnectFromCoordinator();
         }
-        else
+        else if ( m_BrokerageRoots.IsEmpty() == false ) // Not when only using a coordinator
         {
             // remove file to remove availability
             FileIO::FileDelete( m_BrokerageFilePath.Get() );
@@ -484,7 +487,8 @@ void WorkerBrokerage::SetAvailability( bool available )
     m_Availability = available;
     
     // Handle brokerage cleaning
-    if ( m_TimerLastCleanBroker.GetElapsed() >= sBrokerageElapsedTimeBetweenClean )
+    if ( m_BrokerageRoots.IsEmpty() == false &&
+         m_TimerLastCleanBroker.GetElapsed() >= sBrokerageElapsedTimeBetweenClean )
     {
         const uint64_t fileTimeNow = Time::FileTimeToSeconds( Time::GetCurrentFileTime() );
 
@@ -538,6 +542,7 @@ bool WorkerBrokerage::ConnectToCoordinator()
     if ( m_CoordinatorAddress.IsEmpty() == false )
     {
         m_ConnectionPool = FNEW( WorkerConnectionPool );
+        const Timer connectTimer;
         m_Connection = m_ConnectionPool->Connect( m_CoordinatorAddress, Protocol::COORDINATOR_PORT, 2000, this ); // 2000ms connection timeout
         if ( m_Connection == nullptr )
         {
@@ -548,6 +553,10 @@ bool WorkerBrokerage::ConnectToCoordinator()
             return false;
         }
 
+        // connection time approximates our distance from the clients
+        // (limited by the connection timeout, so always fits)
+        m_CoordinatorRTTMS = (uint16_t)connectTimer.GetElapsedMS();
+
         OUTPUT( "Connected to the coordinator\n" );
         return true;
     }
@@ -555,6 +564,31 @@ bool WorkerBrokerage::ConnectToCoordinator()
     return false;
 }
 
+// SendWorkerStatus
+//------------------------------------------------------------------------------
+void WorkerBrokerage::SendWorkerStatus( bool available, const WorkerLoad * load )
+{
+    ASSERT( m_Connection );
+
+    MemoryStream ms;
+    if ( load )
+    {
+        const Protocol::MsgSetWorkerStatus msg( available,
+                                                load->m_NumCPUs,
+                                                load->m_NumJobsActive,
+                                                load->m_NumJobsQueued,
+                                                m_CoordinatorRTTMS );
+        ms.Write( load->m_ToolIds );
+        msg.Send( m_Connection, ms );
+    }
+    else
+    {
+        const Protocol::MsgSetWorkerStatus msg( available );
+        ms.Write( Array< uint64_t >() );
+        msg.Send( m_Connection, ms );
+    }
+}
+
 // DisconnectFromCoordinator
 //------------------------------------------------------------------------------
 void WorkerBrokerage::DisconnectFromCoordinator()
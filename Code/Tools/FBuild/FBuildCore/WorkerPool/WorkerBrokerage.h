@@ -11,6 +11,7 @@
 //------------------------------------------------------------------------------
 class WorkerConnectionPool;
 class ConnectionInfo;
+struct WorkerLoad;
 
 // WorkerBrokerage
 //------------------------------------------------------------------------------
@@ -25,16 +26,18 @@ public:
     inline const AString & GetHostName() const { return m_HostName; }
 
     // client interface
-    void FindWorkers( Array< AString > & workerList );
+    void FindWorkers( Array< AString > & workerList, const Array< uint64_t > & toolIds );
     void UpdateWorkerList( Array< uint32_t > &workerListUpdate );
+    inline bool IsWorkerListRanked() const { return m_WorkerListRanked; }
 
     // server interface
-    void SetAvailability( bool available );
+    void SetAvailability( bool available, const WorkerLoad * load = nullptr );
 private:
     void InitBrokerage();
     void UpdateBrokerageFilePath();
 
     bool ConnectToCoordinator();
+    void SendWorkerStatus( bool available, const WorkerLoad * load );
     void DisconnectFromCoordinator();
 
     Array<AString>      m_BrokerageRoots;
@@ -52,8 +55,10 @@ private:
     AString             m_CoordinatorAddress;
     WorkerConnectionPool * m_ConnectionPool;
     const ConnectionInfo * m_Connection;
+    uint16_t            m_CoordinatorRTTMS;     // Time taken to connect to the coordinator
     Array< uint32_t >   m_WorkerListUpdate;
     bool                m_WorkerListUpdateReady;
+    bool                m_WorkerListRanked;     // Coordinator orders workers best first
 };
 
 //------------------------------------------------------------------------------
@@ -10,16 +10,84 @@
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 
 // Core
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AStackString.h"
 #include "Core/Tracing/Tracing.h"
 #include "Core/FileIO/ConstMemoryStream.h"
 #include "Core/FileIO/MemoryStream.h"
 
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    // Workers send status every 10s while available
+    constexpr float kWorkerStatusTimeoutSecs = ( 60.0f );
+
+    // Clients only ask for workers at the start of a build, so allocations are
+    // kept for roughly the length of one
+    constexpr float kClientAllocationTimeoutSecs = ( 10 * 60.0f );
+
+    // RankedWorker
+    //------------------------------------------------------------------------------
+    struct RankedWorker
+    {
+        WorkerInfo *    m_Worker;
+        uint32_t        m_Share;        // Spare CPUs the client can expect (x256)
+        bool            m_HasToolchain; // Worker already has one of the client's toolchains
+    };
+
+    // RankedWorkerSorter
+    //------------------------------------------------------------------------------
+    class RankedWorkerSorter
+    {
+    public:
+        // Workers with spare CPUs first, preferring those which already have one of
+        // the client's toolchains (avoiding a costly sync), then the least loaded
+        // and the closest
+        inline bool operator () ( const RankedWorker & a, const RankedWorker & b ) const
+        {
+            const bool aHasSpare = ( a.m_Share > 0 );
+            const bool bHasSpare = ( b.m_Share > 0 );
+            if ( aHasSpare != bHasSpare )
+            {
+                return aHasSpare;
+            }
+            if ( a.m_HasToolchain != b.m_HasToolchain )
+            {
+                return a.m_HasToolchain;
+            }
+            if ( a.m_Share != b.m_Share )
+            {
+                return ( a.m_Share > b.m_Share );
+            }
+            if ( a.m_Worker->m_Load.m_RTTMS != b.m_Worker->m_Load.m_RTTMS )
+            {
+                return ( a.m_Worker->m_Load.m_RTTMS < b.m_Worker->m_Load.m_RTTMS );
+            }
+            return ( a.m_Worker->m_Address < b.m_Worker->m_Address );
+        }
+    };
+
+    // ReadToolIds
+    //------------------------------------------------------------------------------
+    void ReadToolIds( const void * payload, size_t payloadSize, Array< uint64_t > & outToolIds )
+    {
+        ConstMemoryStream ms( payload, payloadSize );
+        uint32_t numToolIds = 0;
+        if ( ( ms.Read( numToolIds ) == false ) ||
+             ( ( payloadSize - sizeof( uint32_t ) ) < ( (size_t)numToolIds * sizeof( uint64_t ) ) ) )
+        {
+            return; // Malformed
+        }
+        outToolIds.SetSize( numToolIds );
+        ms.ReadBuffer( outToolIds.Begin(), (size_t)numToolIds * sizeof( uint64_t ) );
+    }
+}
+
 // CONSTRUCTOR
 //------------------------------------------------------------------------------
 WorkerConnectionPool::WorkerConnectionPool()
     : TCPConnectionPool()
-    , m_CurrentMessage( nullptr )
 {
 }
 
@@ -37,26 +105,34 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
     keepMemory = true; // we'll take care of freeing the memory
 
     // are we expecting a msg, or the payload for a msg?
+    // (many workers and clients can be sending to the coordinator at once)
+    const Protocol::IMessage * imsg = nullptr;
     void * payload = nullptr;
     size_t payloadSize = 0;
-    if ( m_CurrentMessage == nullptr )
     {
-        // message
-        m_CurrentMessage = static_cast< const Protocol::IMessage * >( data );
-        if ( m_CurrentMessage->HasPayload() )
+        MutexHolder mh( m_PendingMessagesMutex );
+        PendingMessage * pending = m_PendingMessages.Find( connection );
+        if ( pending == nullptr )
         {
-            return;
+            // message
+            imsg = static_cast< const Protocol::IMessage * >( data );
+            if ( imsg->HasPayload() )
+            {
+                m_PendingMessages.Append( PendingMessage{ connection, imsg } );
+                return;
+            }
+        }
+        else
+        {
+            // payload
+            imsg = pending->m_Message;
+            ASSERT( imsg->HasPayload() );
+            payload = data;
+            payloadSize = size;
+            m_PendingMessages.Erase( pending );
         }
-    }
-    else
-    {
-        // payload
-        ASSERT( m_CurrentMessage->HasPayload() );
-        payload = data;
-        payloadSize = size;
     }
 
-    const Protocol::IMessage * imsg = m_CurrentMessage;
     const Protocol::MessageType messageType = imsg->GetType();
 
     PROTOCOL_DEBUG( "Coordinator : %u (%s)\n", messageType, GetProtocolMessageDebugName( messageType ) );
@@ -66,7 +142,7 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
         case Protocol::MSG_REQUEST_WORKER_LIST:
         {
             const Protocol::MsgRequestWorkerList * msg = static_cast< const Protocol::MsgRequestWorkerList * >( imsg );
-            Process( connection, msg );
+            Process( connection, msg, payload, payloadSize );
             break;
         }
         case Protocol::MSG_WORKER_LIST:
@@ -78,7 +154,7 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
         case Protocol::MSG_SET_WORKER_STATUS:
         {
             const Protocol::MsgSetWorkerStatus * msg = static_cast< const Protocol::MsgSetWorkerStatus * >( imsg );
-            Process( connection, msg );
+            Process( connection, msg, payload, payloadSize );
             break;
         }
         default:
@@ -94,9 +170,8 @@ void WorkerConnectionPool::OnReceive( const ConnectionInfo * connection, void *
     }
 
     // free everything
-    FREE( (void *)( m_CurrentMessage ) );
+    FREE( (void *)( imsg ) );
     FREE( payload );
-    m_CurrentMessage = nullptr;
 }
 
 // OnConnected
@@ -110,27 +185,39 @@ void WorkerConnectionPool::OnConnected( const ConnectionInfo * connection )
 
 // OnDisconnected
 //------------------------------------------------------------------------------
-void WorkerConnectionPool::OnDisconnected( const ConnectionInfo * )
+void WorkerConnectionPool::OnDisconnected( const ConnectionInfo * connection )
 {
+    // free message if connection dropped between message and payload
+    MutexHolder mh( m_PendingMessagesMutex );
+    PendingMessage * pending = m_PendingMessages.Find( connection );
+    if ( pending )
+    {
+        FREE( (void *)( pending->m_Message ) );
+        m_PendingMessages.Erase( pending );
+    }
 }
 
 // Process ( MsgRequestWorkerList )
 //------------------------------------------------------------------------------
-void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg )
+void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg, const void * payload, size_t payloadSize )
 {
     OUTPUT( "Process ( MsgRequestWorkerList )\n");
 
-    MutexHolder mh( m_Mutex );
-    
+    // toolchains the client uses (if known)
+    Array< uint64_t > toolIds;
+    if ( payload )
+    {
+        ReadToolIds( payload, payloadSize, toolIds );
+    }
+
+    Array< uint32_t > workers;
+    AllocateWorkers( connection->GetRemoteAddress(), msg->GetProtocolVersion(), msg->GetPlatform(), toolIds, workers );
+
     MemoryStream ms;
-    const size_t numWorkers( m_Workers.GetSize() );
-    ms.Write( (uint32_t)numWorkers );
-    for ( size_t i = 0; i < numWorkers; ++i )
+    ms.Write( (uint32_t)workers.GetSize() );
+    for ( const uint32_t worker : workers )
     {
-        if ( m_Workers[ i ].m_ProtocolVersion == msg->GetProtocolVersion() && m_Workers[ i ].m_Platform == msg->GetPlatform() )
-        {
-            ms.Write( m_Workers[ i ].m_Address );
-        }
+        ms.Write( worker );
     }
 
     const Protocol::MsgWorkerList resultMsg;
@@ -167,24 +254,169 @@ void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Pro
 
 // Process ( MsgSetWorkerStatus )
 //------------------------------------------------------------------------------
-void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg )
+void WorkerConnectionPool::Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg, const void * payload, size_t payloadSize )
+{
+    // load (if sent by the worker)
+    WorkerLoad load;
+    if ( msg->HasLoad() )
+    {
+        load.m_NumCPUs = msg->GetNumCPUs();
+        load.m_NumJobsActive = msg->GetNumJobsActive();
+        load.m_NumJobsQueued = msg->GetNumJobsQueued();
+        load.m_RTTMS = msg->GetRTTMS();
+    }
+    if ( payload )
+    {
+        ReadToolIds( payload, payloadSize, load.m_ToolIds );
+    }
+
+    UpdateWorker( connection->GetRemoteAddress(), msg->GetProtocolVersion(), msg->GetPlatform(), msg->IsAvailable(), load );
+}
+
+// UpdateWorker
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::UpdateWorker( uint32_t address, uint32_t protocolVersion, uint8_t platform, bool isAvailable, const WorkerLoad & load )
 {
     MutexHolder mh( m_Mutex );
 
-    const uint32_t workerAddress = connection->GetRemoteAddress();
-    if ( msg->IsAvailable() )
+    WorkerInfo * worker = m_Workers.Find( address );
+    if ( isAvailable == false )
     {
-        if ( m_Workers.Find( workerAddress ) == nullptr )
+        if ( worker )
         {
-            AStackString<> remoteAddr;
-            TCPConnectionPool::GetAddressAsString( workerAddress, remoteAddr );
-            OUTPUT( "New worker available: %s\n", remoteAddr.Get() );
-            m_Workers.Append( WorkerInfo( workerAddress, msg->GetProtocolVersion(), msg->GetPlatform() ) );
+            m_Workers.Erase( worker );
         }
+        return;
     }
-    else
+
+    if ( worker == nullptr )
     {
-        m_Workers.FindAndErase( workerAddress );
+        AStackString<> remoteAddr;
+        TCPConnectionPool::GetAddressAsString( address, remoteAddr );
+        OUTPUT( "New worker available: %s\n", remoteAddr.Get() );
+        m_Workers.Append( WorkerInfo( address, protocolVersion, platform ) );
+        worker = &m_Workers.Top();
+    }
+
+    worker->m_ProtocolVersion = protocolVersion;
+    worker->m_Platform = platform;
+    worker->m_Load = load;
+    worker->m_LastStatusTimer.Start();
+}
+
+// AllocateWorkers
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::AllocateWorkers( uint32_t clientAddress,
+                                            uint32_t protocolVersion,
+                                            uint8_t platform,
+                                            const Array< uint64_t > & toolIds,
+                                            Array< uint32_t > & outWorkers )
+{
+    MutexHolder mh( m_Mutex );
+
+    // A new request from a client (i.e. a new build) replaces its previous allocation
+    m_Clients.FindAndErase( clientAddress );
+    RemoveExpired();
+
+    // Rank compatible workers
+    Array< RankedWorker > ranked( m_Workers.GetSize(), false );
+    for ( WorkerInfo & worker : m_Workers )
+    {
+        if ( ( worker.m_ProtocolVersion != protocolVersion ) || ( worker.m_Platform != platform ) )
+        {
+            continue;
+        }
+
+        // Spare CPUs are shared with the other clients this worker is allocated to
+        // (older workers don't send their load, so are assumed to have one spare)
+        const WorkerLoad & load = worker.m_Load;
+        uint32_t spareCPUs = 1;
+        if ( load.m_NumCPUs > 0 )
+        {
+            const uint32_t busyCPUs = ( (uint32_t)load.m_NumJobsActive + load.m_NumJobsQueued );
+            spareCPUs = ( load.m_NumCPUs > busyCPUs ) ? ( load.m_NumCPUs - busyCPUs ) : 0;
+        }
+
+        RankedWorker rankedWorker;
+        rankedWorker.m_Worker = &worker;
+        rankedWorker.m_Share = ( ( spareCPUs * 256 ) / ( worker.m_NumClients + 1 ) );
+        rankedWorker.m_HasToolchain = false;
+        for ( const uint64_t toolId : toolIds )
+        {
+            if ( load.m_ToolIds.Find( toolId ) )
+            {
+                rankedWorker.m_HasToolchain = true;
+                break;
+            }
+        }
+        ranked.Append( rankedWorker );
+    }
+    ranked.Sort( RankedWorkerSorter() );
+
+    // The client is allocated its fair share of the best workers, which makes them
+    // less attractive to the next client
+    const size_t numClients = ( m_Clients.GetSize() + 1 );
+    const size_t numAllocated = ( ( ranked.GetSize() + numClients - 1 ) / numClients );
+    if ( numAllocated > 0 )
+    {
+        ClientAllocation allocation;
+        allocation.m_Address = clientAddress;
+        allocation.m_Workers.SetCapacity( numAllocated );
+        for ( size_t i = 0; i < numAllocated; ++i )
+        {
+            allocation.m_Workers.Append( ranked[ i ].m_Worker->m_Address );
+            ranked[ i ].m_Worker->m_NumClients++;
+        }
+        m_Clients.Append( allocation );
+    }
+
+    // All workers are returned, best first, so the client can fall back to others
+    outWorkers.SetCapacity( ranked.GetSize() );
+    for ( const RankedWorker & rankedWorker : ranked )
+    {
+        outWorkers.Append( rankedWorker.m_Worker->m_Address );
+    }
+}
+
+// RemoveExpired
+//------------------------------------------------------------------------------
+void WorkerConnectionPool::RemoveExpired()
+{
+    // NOTE: m_Mutex must be held
+
+    // Workers which stopped sending status have gone away without saying so
+    for ( size_t i = m_Workers.GetSize(); i > 0; --i )
+    {
+        if ( m_Workers[ i - 1 ].m_LastStatusTimer.GetElapsed() > kWorkerStatusTimeoutSecs )
+        {
+            m_Workers.EraseIndex( i - 1 );
+        }
+    }
+
+    // Forget allocations to clients which have probably finished building
+    for ( size_t i = m_Clients.GetSize(); i > 0; --i )
+    {
+        if ( m_Clients[ i - 1 ].m_Timer.GetElapsed() > kClientAllocationTimeoutSecs )
+        {
+            m_Clients.EraseIndex( i - 1 );
+        }
+    }
+
+    // Count remaining allocations
+    for ( WorkerInfo & worker : m_Workers )
+    {
+        worker.m_NumClients = 0;
+    }
+    for ( const ClientAllocation & client : m_Clients )
+    {
+        for ( const uint32_t address : client.m_Workers )
+        {
+            WorkerInfo * worker = m_Workers.Find( address );
+            if ( worker )
+            {
+                worker->m_NumClients++;
+            }
+        }
     }
 }
 
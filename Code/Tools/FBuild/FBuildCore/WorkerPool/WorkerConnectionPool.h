@@ -7,6 +7,7 @@
 
 // Core
 #include "Core/Network/TCPConnectionPool.h"
+#include "Core/Time/Timer.h"
 
 // Forward Declarations
 //------------------------------------------------------------------------------
@@ -18,6 +19,17 @@ namespace Protocol
     class MsgSetWorkerStatus;
 }
 
+// WorkerLoad
+//------------------------------------------------------------------------------
+struct WorkerLoad
+{
+    uint16_t            m_NumCPUs           = 0;    // CPUs offered for remote work (0 = unknown)
+    uint16_t            m_NumJobsActive     = 0;    // Jobs being built
+    uint16_t            m_NumJobsQueued     = 0;    // Jobs received but not yet started
+    uint16_t            m_RTTMS             = 0;    // Time taken to connect to the coordinator
+    Array< uint64_t >   m_ToolIds;                  // Toolchains already synchronized
+};
+
 // WorkerInfo
 //------------------------------------------------------------------------------
 struct WorkerInfo
@@ -33,6 +45,9 @@ struct WorkerInfo
     uint32_t    m_Address;
     uint32_t    m_ProtocolVersion;
     uint8_t     m_Platform;
+    uint32_t    m_NumClients = 0;   // Clients this worker is currently allocated to
+    WorkerLoad  m_Load;
+    Timer       m_LastStatusTimer;  // Time since last status update
 };
 
 // WorkerConnectionPool
@@ -43,19 +58,50 @@ public:
     WorkerConnectionPool();
     virtual ~WorkerConnectionPool() override;
 
+    // coordinator interface
+    void UpdateWorker( uint32_t address, uint32_t protocolVersion, uint8_t platform, bool isAvailable, const WorkerLoad & load );
+    void AllocateWorkers( uint32_t clientAddress,
+                          uint32_t protocolVersion,
+                          uint8_t platform,
+                          const Array< uint64_t > & toolIds,
+                          Array< uint32_t > & outWorkers );
+
 private:
-    // network events - NOTE: these happen in another thread! (but never at the same time)
+    // network events - NOTE: these happen in another thread! (but never at the same time for a given connection)
     virtual void OnReceive( const ConnectionInfo *, void * /*data*/, uint32_t /*size*/, bool & /*keepMemory*/ ) override;
     virtual void OnConnected( const ConnectionInfo * ) override;
     virtual void OnDisconnected( const ConnectionInfo * ) override;
 
-    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgRequestWorkerList * msg, const void * payload, size_t payloadSize );
     void Process( const ConnectionInfo * connection, const Protocol::MsgWorkerList * msg, const void * payload, size_t payloadSize );
-    void Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg );
+    void Process( const ConnectionInfo * connection, const Protocol::MsgSetWorkerStatus * msg, const void * payload, size_t payloadSize );
+
+    void RemoveExpired();
+
+    // A message waiting for its payload
+    struct PendingMessage
+    {
+        bool operator == ( const ConnectionInfo * connection ) const { return ( connection == m_Connection ); }
+
+        const ConnectionInfo *      m_Connection;
+        const Protocol::IMessage *  m_Message;
+    };
+
+    // The workers given to a client, which count towards their load
+    struct ClientAllocation
+    {
+        bool operator == ( uint32_t address ) const { return ( address == m_Address ); }
+
+        uint32_t            m_Address;
+        Timer               m_Timer;    // Time since allocation
+        Array< uint32_t >   m_Workers;
+    };
 
     Mutex                       m_Mutex;
     Array< WorkerInfo >         m_Workers;
-    const Protocol::IMessage    * m_CurrentMessage;
+    Array< ClientAllocation >   m_Clients;
+    Mutex                       m_PendingMessagesMutex;
+    Array< PendingMessage >     m_PendingMessages;
 };
 
 //------------------------------------------------------------------------------
@@ -14,12 +14,15 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestArgs )
     REGISTER_TESTGROUP( TestBFFParsing )
     REGISTER_TESTGROUP( TestBuildAndLinkLibrary )
+    REGISTER_TESTGROUP( TestBuildDaemon )
     REGISTER_TESTGROUP( TestBuildFBuild )
     REGISTER_TESTGROUP( TestCache )
     REGISTER_TESTGROUP( TestCachePlugin )
     REGISTER_TESTGROUP( TestCompilationDatabase )
     REGISTER_TESTGROUP( TestCompiler )
     REGISTER_TESTGROUP( TestCompressor )
+    REGISTER_TESTGROUP( TestContentStamps )
+    REGISTER_TESTGROUP( TestCoordinator )
     REGISTER_TESTGROUP( TestCopy )
     REGISTER_TESTGROUP( TestDistributed )
     REGISTER_TESTGROUP( TestDLL )
@@ -27,9 +30,11 @@ int main( int, char *[] )
     REGISTER_TESTGROUP( TestExe )
     REGISTER_TESTGROUP( TestExec )
     REGISTER_TESTGROUP( TestFastCancel )
+    REGISTER_TESTGROUP( TestFileChangeJournal )
     REGISTER_TESTGROUP( TestGraph )
     REGISTER_TESTGROUP( TestIf )
     REGISTER_TESTGROUP( TestIncludeParser )
+    REGISTER_TESTGROUP( TestJobQueue )
     REGISTER_TESTGROUP( TestLibrary )
     REGISTER_TESTGROUP( TestLinker )
     REGISTER_TESTGROUP( TestListDependencies )
@@ -335,6 +335,13 @@ const Node * FBuildForTest::GetNode( const char * nodeName ) const
     return m_DependencyGraph->FindNode( AStackString<>( nodeName ) );
 }
 
+// GetNode
+//------------------------------------------------------------------------------
+Node * FBuildForTest::GetNode( const char * nodeName )
+{
+    return m_DependencyGraph->FindNode( AStackString<>( nodeName ) );
+}
+
 // SerializeDepGraphToText
 //------------------------------------------------------------------------------
 void FBuildForTest::SerializeDepGraphToText( const char * nodeName, AString & outBuffer ) const
@@ -345,6 +352,15 @@ void FBuildForTest::SerializeDepGraphToText( const char * nodeName, AString & ou
     m_DependencyGraph->SerializeToText( deps, outBuffer );
 }
 
+// SetCache
+//------------------------------------------------------------------------------
+void FBuildForTest::SetCache( ICache * cache )
+{
+    ASSERT( m_Cache );
+    ASSERT( m_CachePrefetcher == nullptr ); // Would still refer to the previous cache
+    m_Cache = cache;
+}
+
 // Build
 //------------------------------------------------------------------------------
 /*virtual*/ bool FBuildForTest::Build( Node * nodeToBuild )
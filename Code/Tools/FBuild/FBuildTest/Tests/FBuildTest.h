@@ -15,6 +15,7 @@
 // Forward Declarations
 //------------------------------------------------------------------------------
 struct FBuildStats;
+class ICache;
 
 // FBuildTest
 //------------------------------------------------------------------------------
@@ -91,9 +92,14 @@ public:
 
     void GetNodesOfType( Node::Type type, Array<const Node*> & outNodes ) const;
     const Node * GetNode( const char * nodeName ) const;
+    Node * GetNode( const char * nodeName );
 
     void SerializeDepGraphToText( const char * nodeName, AString & outBuffer ) const;
 
+    // Replace the cache created by Initialize, taking ownership of the new one.
+    // The previous cache is not freed, so it can be wrapped by the new one.
+    void SetCache( ICache * cache );
+
     using FBuild::Build;
     virtual bool Build( Node * nodeToBuild ) override;
 };
@@ -7,6 +7,8 @@
 
 // FBuildCore
 #include "Tools/FBuild/FBuildCore/BFF/BFFParser.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenCache.h"
+#include "Tools/FBuild/FBuildCore/BFF/Tokenizer/BFFTokenizer.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
 
@@ -81,6 +83,7 @@ private:
     void ErrorRowAndColumn() const;
     void ForEach() const;
     void FunctionHeaders() const;
+    void TokenCache() const;
 };
 
 // Register Tests
@@ -145,6 +148,7 @@ REGISTER_TESTS_BEGIN( TestBFFParsing )
     REGISTER_TEST( ErrorRowAndColumn )
     REGISTER_TEST( ForEach )
     REGISTER_TEST( FunctionHeaders )
+    REGISTER_TEST( TokenCache )
 REGISTER_TESTS_END
 
 // Empty
@@ -298,6 +302,19 @@ void TestBFFParsing::IncludeDirective() const
     Parse( "missing.bff", true ); // Expect failure
 
     Parse( "Tools/FBuild/FBuildTest/Data/TestBFFParsing/includes.bff" );
+
+    // Missing include file in a block excluded by directives
+    Parse( "Tools/FBuild/FBuildTest/Data/TestBFFParsing/includes_conditional.bff" );
+    TEST_ASSERT( GetRecordedOutput().Find( "IfFileExistsDirective" ) == nullptr );
+
+    // Included files are loaded ahead of tokenization
+    {
+        FBuild fBuild;
+        BFFTokenizer tokenizer;
+        TEST_ASSERT( tokenizer.TokenizeFromFile( AStackString<>( "Tools/FBuild/FBuildTest/Data/TestBFFParsing/includes.bff" ) ) );
+        TEST_ASSERT( tokenizer.GetUsedFiles().GetSize() > 1 );
+        TEST_ASSERT( tokenizer.GetNumPrefetchedFilesUsed() == tokenizer.GetUsedFiles().GetSize() );
+    }
 }
 
 // Include_ExcessiveDepth
@@ -1096,4 +1113,53 @@ void TestBFFParsing::FunctionHeaders() const
                    "ObjectList( .Name ) {}\n" );
 }
 
+// TokenCache
+//------------------------------------------------------------------------------
+void TestBFFParsing::TokenCache() const
+{
+    const AStackString<> bffFile( "Tools/FBuild/FBuildTest/Data/TestGraph/TokenCache/fbuild.bff" );
+    const char * const cacheFile = "../tmp/Test/BFFParsing/TokenCache/fbuild.fdb.tokens";
+    EnsureFileDoesNotExist( cacheFile );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/BFFParsing/TokenCache/" ) ) );
+
+    FBuild fBuild;
+
+    // Tokenize with an empty cache
+    Array< AString > tokens;
+    uint32_t numMisses = 0;
+    {
+        BFFTokenCache cache;
+        cache.Load( cacheFile );
+        BFFTokenizer tokenizer;
+        tokenizer.SetTokenCache( &cache );
+        TEST_ASSERT( tokenizer.TokenizeFromFile( bffFile ) );
+        TEST_ASSERT( cache.GetNumHits() == 0 );
+        numMisses = cache.GetNumMisses();
+        TEST_ASSERT( numMisses > 1 );
+        for ( const BFFToken & token : tokenizer.GetTokens() )
+        {
+            tokens.Append( token.GetValueString() );
+        }
+        TEST_ASSERT( cache.Save( cacheFile ) );
+    }
+
+    // Tokenize again. Only the file without directives (targets.bff) is re-used
+    {
+        BFFTokenCache cache;
+        cache.Load( cacheFile );
+        BFFTokenizer tokenizer;
+        tokenizer.SetTokenCache( &cache );
+        TEST_ASSERT( tokenizer.TokenizeFromFile( bffFile ) );
+        TEST_ASSERT( cache.GetNumHits() == 1 );
+        TEST_ASSERT( cache.GetNumMisses() == ( numMisses - 1 ) );
+
+        // Tokens are the same as when tokenized from scratch
+        TEST_ASSERT( tokenizer.GetTokens().GetSize() == tokens.GetSize() );
+        for ( size_t i = 0; i < tokens.GetSize(); ++i )
+        {
+            TEST_ASSERT( tokenizer.GetTokens()[ i ].GetValueString() == tokens[ i ] );
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
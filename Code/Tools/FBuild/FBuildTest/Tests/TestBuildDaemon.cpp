@@ -0,0 +1,344 @@
+// TestBuildDaemon.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/BuildDaemon.h"
+
+// Core
+#include "Core/Env/Env.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+
+// TestBuildDaemon
+//------------------------------------------------------------------------------
+class TestBuildDaemon : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void ReuseGraph() const;
+    void ReuseGraph_BFFChange() const;
+    void ReuseGraph_OptionsChange() const;
+    void ReuseGraph_CacheOptionsChange() const;
+    void ReuseGraph_EnvironmentChange() const;
+    void ForwardBuilds() const;
+
+    void PrepareInputs() const;
+    void MakeBFFCopy( const char * bffFile, AString & outBFFContents ) const;
+
+    struct ClientContext
+    {
+        uint32_t                m_NumForwarded;
+        BuildDaemon::Result     m_Results[ 2 ];
+    };
+    static uint32_t ClientThreadFunc( void * userData );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestBuildDaemon )
+    REGISTER_TEST( ReuseGraph )
+    REGISTER_TEST( ReuseGraph_BFFChange )
+    REGISTER_TEST( ReuseGraph_OptionsChange )
+    REGISTER_TEST( ReuseGraph_CacheOptionsChange )
+    REGISTER_TEST( ReuseGraph_EnvironmentChange )
+    #if defined( __LINUX__ ) || defined( __OSX__ )
+        REGISTER_TEST( ForwardBuilds )
+    #endif
+REGISTER_TESTS_END
+
+// ReuseGraph
+//------------------------------------------------------------------------------
+void TestBuildDaemon::ReuseGraph() const
+{
+    PrepareInputs();
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestBuildDaemon/fbuild.bff";
+    options.m_Profile = false; // Profiling prevents reuse of the graph
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // Initial build
+    TEST_ASSERT( fBuild.Build( "All" ) );
+    EnsureFileExists( "../tmp/Test/BuildDaemon/Dst/file.txt" );
+    EnsureFileExists( "../tmp/Test/BuildDaemon/Dst/Dir/a.txt" );
+
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 2,     2,      Node::COPY_FILE_NODE );
+    CheckStatsNode ( 1,     1,      Node::COPY_DIR_NODE );
+    CheckStatsNode ( 1,     1,      Node::DIRECTORY_LIST_NODE );
+
+    // Build again with the graph kept in memory: nothing to do
+    TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+    TEST_ASSERT( fBuild.Build( "All" ) );
+
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 2,     0,      Node::COPY_FILE_NODE );
+    CheckStatsNode ( 1,     0,      Node::COPY_DIR_NODE );
+    CheckStatsNode ( 1,     1,      Node::DIRECTORY_LIST_NODE );
+
+    // Modify a file and add a file to the copied dir
+    #if defined( __OSX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+    #endif
+    MakeFile( "../tmp/Test/BuildDaemon/Src/file.txt", "modified" );
+    MakeFile( "../tmp/Test/BuildDaemon/Src/Dir/b.txt", "b" );
+
+    // Only the changes are built
+    TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+    TEST_ASSERT( fBuild.Build( "All" ) );
+    EnsureFileExists( "../tmp/Test/BuildDaemon/Dst/Dir/b.txt" );
+
+    AString contents;
+    LoadFileContentsAsString( "../tmp/Test/BuildDaemon/Dst/file.txt", contents );
+    TEST_ASSERT( contents == "modified" );
+
+    //               Seen,  Built,  Type
+    CheckStatsNode ( 3,     2,      Node::COPY_FILE_NODE );
+    CheckStatsNode ( 1,     1,      Node::COPY_DIR_NODE );
+    CheckStatsNode ( 1,     1,      Node::DIRECTORY_LIST_NODE );
+}
+
+// ReuseGraph_BFFChange
+//------------------------------------------------------------------------------
+void TestBuildDaemon::ReuseGraph_BFFChange() const
+{
+    PrepareInputs();
+
+    // Use a copy of the bff which can be modified
+    const AStackString<> bffFile( "../tmp/Test/BuildDaemon/fbuild.bff" );
+    AString bffContents;
+    MakeBFFCopy( bffFile.Get(), bffContents );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = bffFile;
+    options.m_Profile = false; // Profiling prevents reuse of the graph
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.Build( "All" ) );
+
+    // Unmodified bff
+    TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+    TEST_ASSERT( fBuild.Build( "All" ) );
+
+    // Modified bff must be parsed again
+    #if defined( __OSX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+    #endif
+    bffContents += "\n// Modified\n";
+    MakeFile( bffFile.Get(), bffContents.Get() );
+    TEST_ASSERT( fBuild.ReuseForBuild( options ) == false );
+}
+
+// ReuseGraph_OptionsChange
+//------------------------------------------------------------------------------
+void TestBuildDaemon::ReuseGraph_OptionsChange() const
+{
+    PrepareInputs();
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestBuildDaemon/fbuild.bff";
+    options.m_Profile = false; // Profiling prevents reuse of the graph
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // Options which only affect the build can change
+    {
+        FBuildTestOptions buildOptions( options );
+        buildOptions.m_ForceCleanBuild = true;
+        buildOptions.m_StopOnFirstError = false;
+        TEST_ASSERT( fBuild.ReuseForBuild( buildOptions ) );
+    }
+
+    // Options used to load the graph or initialize the cache can't
+    {
+        FBuildTestOptions otherOptions( options );
+        otherOptions.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCopy/copy.bff";
+        TEST_ASSERT( fBuild.ReuseForBuild( otherOptions ) == false );
+    }
+    {
+        FBuildTestOptions otherOptions( options );
+        otherOptions.m_UseCacheRead = !options.m_UseCacheRead;
+        TEST_ASSERT( fBuild.ReuseForBuild( otherOptions ) == false );
+    }
+}
+
+// ReuseGraph_CacheOptionsChange
+//------------------------------------------------------------------------------
+void TestBuildDaemon::ReuseGraph_CacheOptionsChange() const
+{
+    PrepareInputs();
+
+    const char * dictionaryFile = "../tmp/Test/BuildDaemon/cache.dict";
+    MakeFile( dictionaryFile, "dictionary" );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestBuildDaemon/fbuild.bff";
+    options.m_Profile = false; // Profiling prevents reuse of the graph
+    options.m_UseCacheRead = true;
+    options.m_CacheDictionaryFile = dictionaryFile;
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+
+    // Cache options consumed by Initialize() can't change
+    {
+        FBuildTestOptions otherOptions( options );
+        otherOptions.m_CachePrefetchThreads = ( options.m_CachePrefetchThreads + 1 );
+        TEST_ASSERT( fBuild.ReuseForBuild( otherOptions ) == false );
+    }
+    {
+        FBuildTestOptions otherOptions( options );
+        otherOptions.m_CacheDictionaryFile = "../tmp/Test/BuildDaemon/other.dict";
+        TEST_ASSERT( fBuild.ReuseForBuild( otherOptions ) == false );
+    }
+
+    // Modified dictionary changes cache keys
+    MakeFile( dictionaryFile, "modified dictionary" );
+    TEST_ASSERT( fBuild.ReuseForBuild( options ) == false );
+}
+
+// ForwardBuilds
+//------------------------------------------------------------------------------
+void TestBuildDaemon::ForwardBuilds() const
+{
+    PrepareInputs();
+
+    // The daemon saves the DB alongside the bff, so use a copy
+    AString bffContents;
+    MakeBFFCopy( "../tmp/Test/BuildDaemon/fbuild.bff", bffContents );
+
+    // Builds are forwarded from another thread, as they would be from
+    // another process
+    ClientContext context;
+    context.m_NumForwarded = 0;
+    context.m_Results[ 0 ] = BuildDaemon::RESULT_BAD_ARGS;
+    context.m_Results[ 1 ] = BuildDaemon::RESULT_BAD_ARGS;
+    Thread thread;
+    thread.Start( ClientThreadFunc, "BuildDaemonClient", &context );
+
+    // Daemon for this working dir (builds must be performed on the main thread)
+    {
+        const FBuildTestOptions options;
+        BuildDaemon daemon;
+        TEST_ASSERT( daemon.Run( options ) ); // Until stopped by the client
+    }
+    thread.Join();
+
+    // Both builds are performed by the daemon
+    TEST_ASSERT( context.m_NumForwarded == 2 );
+    TEST_ASSERT( context.m_Results[ 0 ] == BuildDaemon::RESULT_OK );
+    TEST_ASSERT( context.m_Results[ 1 ] == BuildDaemon::RESULT_OK );
+    EnsureFileExists( "../tmp/Test/BuildDaemon/Dst/file.txt" );
+
+    // Second build uses the graph kept by the daemon
+    TEST_ASSERT( GetRecordedOutput().Find( "Reusing loaded dependency graph" ) );
+}
+
+// ReuseGraph_EnvironmentChange
+//------------------------------------------------------------------------------
+void TestBuildDaemon::ReuseGraph_EnvironmentChange() const
+{
+    PrepareInputs();
+    EnsureFileDoesNotExist( "../tmp/Test/BuildDaemon/Dst/env1.txt" );
+    EnsureFileDoesNotExist( "../tmp/Test/BuildDaemon/Dst/env2.txt" );
+
+    // The destination is #imported from the environment
+    TEST_ASSERT( Env::SetEnvVariable( "FASTBUILD_TEST_DAEMON_DEST", AStackString<>( "env1.txt" ) ) );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestBuildDaemon/environment.bff";
+    options.m_Profile = false; // Profiling prevents reuse of the graph
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "CopyFile" ) );
+        EnsureFileExists( "../tmp/Test/BuildDaemon/Dst/env1.txt" );
+
+        // Unchanged environment
+        TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+
+        // A change to the environment (the daemon adopts that of each client)
+        // means the graph can't be reused
+        TEST_ASSERT( Env::SetEnvVariable( "FASTBUILD_TEST_DAEMON_DEST", AStackString<>( "env2.txt" ) ) );
+        TEST_ASSERT( fBuild.ReuseForBuild( options ) == false );
+    }
+
+    // Loading the graph again picks up the change
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "CopyFile" ) );
+        EnsureFileExists( "../tmp/Test/BuildDaemon/Dst/env2.txt" );
+        TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+    }
+}
+
+// PrepareInputs
+//------------------------------------------------------------------------------
+void TestBuildDaemon::PrepareInputs() const
+{
+    EnsureDirExists( "../tmp/Test/BuildDaemon/Src/Dir/" );
+    MakeFile( "../tmp/Test/BuildDaemon/Src/file.txt", "file" );
+    MakeFile( "../tmp/Test/BuildDaemon/Src/Dir/a.txt", "a" );
+    EnsureFileDoesNotExist( "../tmp/Test/BuildDaemon/Src/Dir/b.txt" );
+
+    // clean up anything left over from previous runs
+    EnsureFileDoesNotExist( "../tmp/Test/BuildDaemon/Dst/file.txt" );
+    EnsureFileDoesNotExist( "../tmp/Test/BuildDaemon/Dst/Dir/a.txt" );
+    EnsureFileDoesNotExist( "../tmp/Test/BuildDaemon/Dst/Dir/b.txt" );
+}
+
+// MakeBFFCopy
+//------------------------------------------------------------------------------
+void TestBuildDaemon::MakeBFFCopy( const char * bffFile, AString & outBFFContents ) const
+{
+    LoadFileContentsAsString( "Tools/FBuild/FBuildTest/Data/TestBuildDaemon/fbuild.bff", outBFFContents );
+    outBFFContents.Replace( "#include \"../testcommon.bff\"", "#include \"../../../Code/Tools/FBuild/FBuildTest/Data/testcommon.bff\"" );
+    MakeFile( bffFile, outBFFContents.Get() );
+}
+
+// ClientThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestBuildDaemon::ClientThreadFunc( void * userData )
+{
+    ClientContext & context = *static_cast< ClientContext * >( userData );
+
+    const FBuildTestOptions options;
+    char * argv[] = { const_cast< char * >( "fbuild" ),
+                      const_cast< char * >( "-config" ),
+                      const_cast< char * >( "../tmp/Test/BuildDaemon/fbuild.bff" ),
+                      const_cast< char * >( "-verbose" ),
+                      const_cast< char * >( "All" ) };
+    const int argc = (int)( sizeof( argv ) / sizeof( argv[ 0 ] ) );
+
+    // Wait for the daemon to be ready
+    for ( uint32_t i = 0; i < 500; ++i )
+    {
+        if ( BuildDaemon::ForwardBuild( options, argc, argv, context.m_Results[ 0 ] ) )
+        {
+            context.m_NumForwarded++;
+            break;
+        }
+        Thread::Sleep( 10 );
+    }
+
+    // Build again
+    if ( ( context.m_NumForwarded == 1 ) &&
+         BuildDaemon::ForwardBuild( options, argc, argv, context.m_Results[ 1 ] ) )
+    {
+        context.m_NumForwarded++;
+    }
+
+    // Stop the daemon
+    FBuild::AbortBuild();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
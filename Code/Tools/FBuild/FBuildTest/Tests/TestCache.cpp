@@ -6,15 +6,78 @@
 #include "FBuildTest.h"
 
 // FBuild
+#include "Tools/FBuild/FBuildCore/Cache/Cache.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePrefetcher.h"
+#include "Tools/FBuild/FBuildCore/Cache/CachePublisher.h"
+#include "Tools/FBuild/FBuildCore/Cache/CacheServer.h"
+#include "Tools/FBuild/FBuildCore/Cache/LayeredCache.h"
+#include "Tools/FBuild/FBuildCore/Cache/NetworkCache.h"
+#include "Tools/FBuild/FBuildCore/Cache/PackedCache.h"
 #include "Tools/FBuild/FBuildCore/FBuild.h"
 #include "Tools/FBuild/FBuildCore/Graph/ObjectNode.h"
 #include "Tools/FBuild/FBuildCore/Graph/SettingsNode.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 
 // Core
+#include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/FileStream.h"
+#include "Core/FileIO/PathUtils.h"
+#include "Core/Math/Random.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
 #include "Core/Profile/Profile.h"
 #include "Core/Strings/AStackString.h"
+#include "Core/Time/Time.h"
+#include "Core/Time/Timer.h"
+
+// system
+#include <memory.h>
+
+// BlockingCache
+//------------------------------------------------------------------------------
+// Wraps another cache, holding up publishing until released
+class BlockingCache : public ICache
+{
+public:
+    explicit BlockingCache( ICache * cache ) : m_Cache( cache ) {}
+    virtual ~BlockingCache() override { FDELETE m_Cache; }
+
+    virtual bool Init( const AString & cachePath,
+                       const AString & cachePathMountPoint,
+                       bool cacheRead,
+                       bool cacheWrite,
+                       bool cacheVerbose,
+                       const AString & pluginDLLConfig ) override
+    {
+        return m_Cache->Init( cachePath, cachePathMountPoint, cacheRead, cacheWrite, cacheVerbose, pluginDLLConfig );
+    }
+    virtual void Shutdown() override { m_Cache->Shutdown(); }
+    virtual bool Publish( const AString & cacheId, const void * data, size_t dataSize ) override
+    {
+        AtomicInc( &m_NumPublishesStarted );
+        while ( AtomicLoadAcquire( &m_Released ) == false )
+        {
+            Thread::Sleep( 1 );
+        }
+        return m_Cache->Publish( cacheId, data, dataSize );
+    }
+    virtual bool Retrieve( const AString & cacheId, void * & data, size_t & dataSize ) override
+    {
+        return m_Cache->Retrieve( cacheId, data, dataSize );
+    }
+    virtual void FreeMemory( void * data, size_t dataSize ) override { m_Cache->FreeMemory( data, dataSize ); }
+    virtual bool OutputInfo( bool showProgress ) override { return m_Cache->OutputInfo( showProgress ); }
+    virtual bool Trim( bool showProgress, uint32_t sizeMiB ) override { return m_Cache->Trim( showProgress, sizeMiB ); }
+
+    void        Release()                       { AtomicStoreRelease( &m_Released, true ); }
+    uint32_t    GetNumPublishesStarted() const  { return AtomicLoadAcquire( &m_NumPublishesStarted ); }
+
+private:
+    ICache *            m_Cache;
+    volatile bool       m_Released = false;
+    volatile uint32_t   m_NumPublishesStarted = 0;
+};
 
 // TestCache
 //------------------------------------------------------------------------------
@@ -26,6 +89,20 @@ private:
     void Write() const;
     void Read() const;
     void ReadWrite() const;
+    void LocalCacheTiers() const;
+    void MemoryTierEviction() const;
+    void Prefetch() const;
+    void PackedStorage() const;
+    void PackedIndexing() const;
+    void BackgroundTrim() const;
+    void DedupLargeEntries() const;
+    void DedupCompressedObjects() const;
+    void NetworkCacheServer() const;
+    void BatchApi() const;
+    void PublishAsync() const;
+    void PublishQueueBound() const;
+    void PublishTimeout() const;
+    void Filter() const;
     void ConsistentCacheKeysWithDist() const;
 
     void LightCache_IncludeUsingMacro() const;
@@ -55,6 +132,10 @@ private:
 
     // Helpers
     void CheckForDependencies( const FBuildForTest & fBuild, const char * const files[], size_t numFiles ) const;
+    void BuildWithCacheTiers( FBuildForTest & fBuild, uint32_t expectedHits, CacheTierStats & outTierStats ) const;
+    void DeleteFilesInDir( const char * path ) const;
+    void CheckBatchApi( ICache & cache ) const;
+    size_t CountFilesInDir( const char * path, const char * wildCard ) const;
     void LightCache_IncludeUsingUndefinedMacros( const char * consfigFile,
                                                  bool expectedBuildResult,
                                                  bool expectedLightCacheUsage,
@@ -69,6 +150,20 @@ REGISTER_TESTS_BEGIN( TestCache )
     REGISTER_TEST( Write )
     REGISTER_TEST( Read )
     REGISTER_TEST( ReadWrite )
+    REGISTER_TEST( LocalCacheTiers )
+    REGISTER_TEST( MemoryTierEviction )
+    REGISTER_TEST( Prefetch )
+    REGISTER_TEST( PackedStorage )
+    REGISTER_TEST( PackedIndexing )
+    REGISTER_TEST( BackgroundTrim )
+    REGISTER_TEST( DedupLargeEntries )
+    REGISTER_TEST( DedupCompressedObjects )
+    REGISTER_TEST( NetworkCacheServer )
+    REGISTER_TEST( BatchApi )
+    REGISTER_TEST( PublishAsync )
+    REGISTER_TEST( PublishQueueBound )
+    REGISTER_TEST( PublishTimeout )
+    REGISTER_TEST( Filter )
     REGISTER_TEST( ConsistentCacheKeysWithDist )
     REGISTER_TEST( ExtraFiles_GCNO )
     #if defined( __WINDOWS__ )
@@ -270,6 +365,1159 @@ void TestCache::ReadWrite() const
     #endif
 }
 
+// LocalCacheTiers
+//------------------------------------------------------------------------------
+void TestCache::LocalCacheTiers() const
+{
+    const char * sharedPath = "../tmp/Test/Cache/LayeredCache/Shared";
+    const char * localPath = "../tmp/Test/Cache/LayeredCache/Local";
+    DeleteFilesInDir( sharedPath );
+    DeleteFilesInDir( localPath );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/LayeredCache/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheRead = true;
+    options.m_UseCacheWrite = true;
+    options.m_Profile = false; // Prevents reuse of the FBuild
+
+    CacheTierStats tiers;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+
+        // Empty cache: stored in all tiers
+        BuildWithCacheTiers( fBuild, 0, tiers );
+        TEST_ASSERT( tiers.m_SharedMisses == 2 );
+        TEST_ASSERT( tiers.m_SharedStores == 2 );
+        TEST_ASSERT( tiers.m_LocalStores == 2 );
+
+        // Same process: memory hits
+        TEST_ASSERT( fBuild.ReuseForBuild( options ) );
+        BuildWithCacheTiers( fBuild, 2, tiers );
+        TEST_ASSERT( tiers.m_MemoryHits == 2 );
+        TEST_ASSERT( ( tiers.m_LocalHits + tiers.m_SharedHits ) == 0 );
+    }
+
+    // New process: local disk hits
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        BuildWithCacheTiers( fBuild, 2, tiers );
+        TEST_ASSERT( tiers.m_MemoryMisses == 2 );
+        TEST_ASSERT( tiers.m_LocalHits == 2 );
+        TEST_ASSERT( tiers.m_SharedHits == 0 );
+    }
+
+    // Empty local cache: shared hits are promoted
+    DeleteFilesInDir( localPath );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        BuildWithCacheTiers( fBuild, 2, tiers );
+        TEST_ASSERT( tiers.m_LocalMisses == 2 );
+        TEST_ASSERT( tiers.m_SharedHits == 2 );
+        TEST_ASSERT( tiers.m_LocalStores == 2 );
+        TEST_ASSERT( tiers.m_SharedStores == 0 );
+    }
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        BuildWithCacheTiers( fBuild, 2, tiers );
+        TEST_ASSERT( tiers.m_LocalHits == 2 );
+    }
+}
+
+// MemoryTierEviction
+//------------------------------------------------------------------------------
+void TestCache::MemoryTierEviction() const
+{
+    const AStackString<> sharedPath( "../tmp/Test/Cache/MemoryTierEviction/Shared/" );
+    DeleteFilesInDir( sharedPath.Get() );
+
+    // Memory tier with space for two entries
+    LayeredCache cache( FNEW( Cache() ), AString::GetEmpty(), 0, 1 );
+    TEST_ASSERT( cache.Init( sharedPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    const AStackString<> idA( "00000000000000AA_00000000_0000000000000000-00000000.0" );
+    const AStackString<> idB( "00000000000000BB_00000000_0000000000000000-00000000.0" );
+    const AStackString<> idC( "00000000000000CC_00000000_0000000000000000-00000000.0" );
+    const size_t entrySize = ( 400 * 1024 );
+    UniquePtr< char > entry( (char *)ALLOC( entrySize ) );
+    memset( entry.Get(), 0, entrySize );
+    TEST_ASSERT( cache.Publish( idA, entry.Get(), entrySize ) );
+    TEST_ASSERT( cache.Publish( idB, entry.Get(), entrySize ) );
+
+    // Use A, so B is least recently used and is evicted by C
+    void * data = nullptr;
+    size_t dataSize = 0;
+    TEST_ASSERT( cache.Retrieve( idA, data, dataSize ) );
+    cache.FreeMemory( data, dataSize );
+    TEST_ASSERT( cache.Publish( idC, entry.Get(), entrySize ) );
+
+    CacheTierStats tiers;
+    TEST_ASSERT( cache.GetTierStats( tiers ) ); // Reset
+    TEST_ASSERT( tiers.m_MemoryHits == 1 );
+    TEST_ASSERT( tiers.m_SharedStores == 3 );
+
+    const AString * ids[] = { &idC, &idA, &idB }; // B last, as it evicts the least recently used entry
+    for ( const AString * id : ids )
+    {
+        TEST_ASSERT( cache.Retrieve( *id, data, dataSize ) );
+        TEST_ASSERT( dataSize == entrySize );
+        cache.FreeMemory( data, dataSize );
+    }
+    TEST_ASSERT( cache.GetTierStats( tiers ) );
+    TEST_ASSERT( tiers.m_MemoryHits == 2 );     // C and A
+    TEST_ASSERT( tiers.m_MemoryMisses == 1 );   // B, retrieved from the shared cache
+    TEST_ASSERT( tiers.m_SharedHits == 1 );
+    TEST_ASSERT( tiers.m_SharedStores == 0 );
+
+    cache.Shutdown();
+}
+
+// Prefetch
+//------------------------------------------------------------------------------
+void TestCache::Prefetch() const
+{
+    DeleteFilesInDir( "../tmp/Test/Cache/Prefetch/Cache" );
+
+    // Copy the source files so they can be modified
+    const char * srcFileA = "../tmp/Test/Cache/Prefetch/Src/a.cpp";
+    const char * srcFileB = "../tmp/Test/Cache/Prefetch/Src/b.cpp";
+    TEST_ASSERT( FileIO::EnsurePathExistsForFile( AStackString<>( srcFileA ) ) );
+    TEST_ASSERT( FileIO::FileCopy( "Tools/FBuild/FBuildTest/Data/TestCache/a.cpp", srcFileA ) );
+    TEST_ASSERT( FileIO::FileCopy( "Tools/FBuild/FBuildTest/Data/TestCache/b.cpp", srcFileB ) );
+    #if defined( __WINDOWS__ )
+        const char * objFileA = "../tmp/Test/Cache/Prefetch/Out/a.obj";
+    #else
+        const char * objFileA = "../tmp/Test/Cache/Prefetch/Out/a.o";
+    #endif
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Prefetch/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheRead = true;
+    options.m_UseCacheWrite = true;
+    const char * dbFile = "../tmp/Test/Cache/Prefetch/fbuild.fdb";
+
+    // Populate the cache - no previous cache keys to prefetch
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 2 );
+        TEST_ASSERT( fBuild.GetCachePrefetcher()->GetNumPrefetchesUsed() == 0 );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    // Clean build - entries from the previous build are prefetched
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+        TEST_ASSERT( fBuild.GetCachePrefetcher()->GetNumPrefetchesUsed() == 2 );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    // Incremental build with a missing output - the entry is prefetched
+    options.m_ForceCleanBuild = false;
+    TEST_ASSERT( FileIO::FileDelete( objFileA ) );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+        TEST_ASSERT( fBuild.GetCachePrefetcher()->GetNumPrefetchesUsed() == 1 );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    // Incremental build with a modified input - the previous key is stale, so
+    // isn't prefetched
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( srcFileB, FileStream::WRITE_ONLY ) );
+        const char * modifiedSource = "const char * FunctionB() { return \"Modified\"; }\n";
+        TEST_ASSERT( f.WriteBuffer( modifiedSource, AString::StrLen( modifiedSource ) ) == AString::StrLen( modifiedSource ) );
+    }
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheMisses == 1 );
+        TEST_ASSERT( fBuild.GetCachePrefetcher()->GetNumPrefetchesUsed() == 0 );
+    }
+
+    // Prefetching disabled
+    options.m_ForceCleanBuild = true;
+    options.m_CachePrefetchThreads = 0;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+        TEST_ASSERT( fBuild.GetCachePrefetcher() == nullptr );
+    }
+}
+
+// PackedStorage
+//------------------------------------------------------------------------------
+void TestCache::PackedStorage() const
+{
+    const char * cachePath = "../tmp/Test/Cache/PackedStorage/Cache";
+    DeleteFilesInDir( cachePath );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/PackedStorage/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    // Write twice - entries already in the cache are not uploaded again
+    options.m_UseCacheWrite = true;
+    size_t numPackFilesWritten = 0;
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 2 );
+        if ( i == 0 )
+        {
+            numPackFilesWritten = CountFilesInDir( cachePath, "*.fpk" );
+            TEST_ASSERT( ( numPackFilesWritten == 1 ) || ( numPackFilesWritten == 2 ) ); // Entries can be in the same shard
+        }
+        TEST_ASSERT( CountFilesInDir( cachePath, "*.fpk" ) == numPackFilesWritten );
+    }
+
+    // Duplicate each pack file, as if the same entries were also written concurrently
+    // by another machine
+    {
+        Array< AString > files;
+        FileIO::GetFiles( AStackString<>( cachePath ), AStackString<>( "*.fpk" ), true, &files );
+        FileIO::GetFiles( AStackString<>( cachePath ), AStackString<>( "*.fidx" ), true, &files );
+        for ( const AString & file : files )
+        {
+            const char * extension = file.FindLast( '.' );
+            AStackString<> copy( file.Get(), extension );
+            copy += "-Copy";
+            copy += extension;
+            TEST_ASSERT( FileIO::FileCopy( file.Get(), copy.Get() ) );
+        }
+    }
+
+    // Entries are not stored in individual files, and pack files are indexed
+    const size_t numPackFiles = CountFilesInDir( cachePath, "*.fpk" );
+    TEST_ASSERT( numPackFiles == ( numPackFilesWritten * 2 ) );
+    TEST_ASSERT( CountFilesInDir( cachePath, "*.fidx" ) == numPackFiles );
+    TEST_ASSERT( CountFilesInDir( cachePath, "*" ) == ( numPackFiles * 2 ) );
+
+    // Read
+    options.m_UseCacheWrite = false;
+    options.m_UseCacheRead = true;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+    }
+
+    // Trimming (to a size larger than the cache) merges small pack files, dropping duplicates
+    {
+        FBuildTestOptions trimOptions( options );
+        trimOptions.m_UseCacheRead = false;
+        trimOptions.m_CacheTrim = 1024;
+        FBuildForTest fBuild( trimOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheTrim() );
+    }
+    TEST_ASSERT( CountFilesInDir( cachePath, "*.fpk" ) == ( numPackFiles / 2 ) );
+    TEST_ASSERT( CountFilesInDir( cachePath, "*.fidx" ) == ( numPackFiles / 2 ) );
+
+    // Entries are still available
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+    }
+}
+
+// PackedIndexing
+//------------------------------------------------------------------------------
+void TestCache::PackedIndexing() const
+{
+    const AStackString<> cachePath( "../tmp/Test/Cache/PackedIndexing/Cache/" );
+    const AStackString<> otherCachePath( "../tmp/Test/Cache/PackedIndexing/OtherCache/" );
+    DeleteFilesInDir( cachePath.Get() );
+    DeleteFilesInDir( otherCachePath.Get() );
+
+    // Enough entries per shard that those added are merged into the sorted index
+    // several times, both into an empty index and into existing entries
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        const uint32_t numEntries = ( 200 * 1000 );
+        AStackString<> cacheId;
+        for ( uint32_t half = 0; half < 2; ++half )
+        {
+            for ( uint32_t i = ( half * numEntries / 2 ); i < ( ( half + 1 ) * numEntries / 2 ); ++i )
+            {
+                cacheId.Format( "%08X", i );
+                TEST_ASSERT( cache.Publish( cacheId, &i, sizeof( i ) ) );
+            }
+            for ( uint32_t i = 0; i < ( ( half + 1 ) * numEntries / 2 ); ++i )
+            {
+                cacheId.Format( "%08X", i );
+                void * data = nullptr;
+                size_t dataSize = 0;
+                TEST_ASSERT( cache.Retrieve( cacheId, data, dataSize ) );
+                TEST_ASSERT( ( dataSize == sizeof( i ) ) && ( memcmp( data, &i, sizeof( i ) ) == 0 ) );
+                cache.FreeMemory( data, dataSize );
+            }
+        }
+        cache.Shutdown();
+    }
+
+    // Write a segment with another cache, to copy in as if written by another process
+    const AStackString<> cacheId( "PackedIndexing" );
+    const char entryData[] = "EntryData";
+    AStackString<> segmentFile;
+    {
+        PackedCache cache;
+        TEST_ASSERT( cache.Init( otherCachePath, AString::GetEmpty(), false, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.Publish( cacheId, entryData, sizeof( entryData ) ) );
+        cache.Shutdown();
+
+        Array< AString > files;
+        FileIO::GetFiles( otherCachePath, AStackString<>( "*.fpk" ), true, &files );
+        TEST_ASSERT( files.GetSize() == 1 );
+        segmentFile = files[ 0 ];
+    }
+    TEST_ASSERT( segmentFile.BeginsWith( otherCachePath ) );
+    AStackString<> copiedSegmentFile( cachePath );
+    copiedSegmentFile += ( segmentFile.Get() + otherCachePath.GetLength() );
+
+    // Only the size of the segment is visible so far (as can happen over a network
+    // share), so its header is unreadable
+    {
+        FileStream segment;
+        TEST_ASSERT( segment.Open( segmentFile.Get(), FileStream::READ_ONLY ) );
+        Array< char > zeros;
+        zeros.SetSize( (size_t)segment.GetFileSize() );
+        FileStream f;
+        TEST_ASSERT( f.Open( copiedSegmentFile.Get(), FileStream::WRITE_ONLY ) );
+        memset( zeros.Begin(), 0, zeros.GetSize() );
+        TEST_ASSERT( f.WriteBuffer( zeros.Begin(), zeros.GetSize() ) == zeros.GetSize() );
+    }
+    PackedCache cache;
+    TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, false, false, AString::GetEmpty() ) );
+    void * data = nullptr;
+    size_t dataSize = 0;
+    TEST_ASSERT( cache.Retrieve( cacheId, data, dataSize ) == false );
+
+    // Once the contents are visible the segment is indexed (it was not treated as complete)
+    TEST_ASSERT( FileIO::FileCopy( segmentFile.Get(), copiedSegmentFile.Get() ) );
+    TEST_ASSERT( cache.Trim( false, 1024 ) ); // Looks for new entries
+    TEST_ASSERT( cache.Retrieve( cacheId, data, dataSize ) );
+    TEST_ASSERT( ( dataSize == sizeof( entryData ) ) && ( memcmp( data, entryData, sizeof( entryData ) ) == 0 ) );
+    cache.FreeMemory( data, dataSize );
+
+    // Deleted segments are forgotten
+    TEST_ASSERT( FileIO::FileDelete( copiedSegmentFile.Get() ) );
+    TEST_ASSERT( cache.Trim( false, 1024 ) );
+    TEST_ASSERT( cache.Retrieve( cacheId, data, dataSize ) == false );
+    cache.Shutdown();
+}
+
+// BackgroundTrim
+//------------------------------------------------------------------------------
+void TestCache::BackgroundTrim() const
+{
+    const AStackString<> cachePath( "../tmp/Test/Cache/BackgroundTrim/Cache/" );
+    DeleteFilesInDir( cachePath.Get() );
+
+    // Fill a bucket well beyond its share (1/256th) of a 1 MiB limit, with
+    // entries of increasing age
+    const size_t numEntries = 4;
+    const char * const cacheIds[ numEntries ] = { "00000001", "00000002", "00000003", "00000004" };
+    char data[ 2048 ] = { 0 };
+    for ( size_t i = 0; i < numEntries; ++i )
+    {
+        AStackString<> fileName;
+        fileName.Format( "%s00%c00%c%s", cachePath.Get(), NATIVE_SLASH, NATIVE_SLASH, cacheIds[ i ] );
+        TEST_ASSERT( FileIO::EnsurePathExistsForFile( fileName ) );
+        {
+            FileStream f;
+            TEST_ASSERT( f.Open( fileName.Get(), FileStream::WRITE_ONLY ) );
+            TEST_ASSERT( f.WriteBuffer( data, sizeof( data ) ) == sizeof( data ) );
+        }
+        const uint64_t oldTime = ( FileIO::GetFileLastWriteTime( fileName ) / 2 );
+        TEST_ASSERT( FileIO::SetFileLastWriteTime( fileName, oldTime - ( i * ( oldTime / 1000 ) ) ) );
+    }
+
+    // Buckets leased by another client are left alone
+    AStackString<> bucketPath( cachePath );
+    bucketPath += "00";
+    AStackString<> leaseFileName;
+    leaseFileName.Format( "%sTrimLeases%c00.lease", cachePath.Get(), NATIVE_SLASH );
+    TEST_ASSERT( FileIO::EnsurePathExistsForFile( leaseFileName ) );
+    {
+        FileStream f;
+        TEST_ASSERT( f.Open( leaseFileName.Get(), FileStream::WRITE_ONLY ) );
+    }
+    {
+        Cache cache( 1 );
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        Thread::Sleep( 3000 ); // Long enough to complete a pass over all buckets
+        cache.Shutdown();
+    }
+    TEST_ASSERT( CountFilesInDir( bucketPath.Get(), "*" ) == numEntries );
+
+    // Lease has expired
+    const uint64_t leaseTime = FileIO::GetFileLastWriteTime( leaseFileName );
+    TEST_ASSERT( FileIO::SetFileLastWriteTime( leaseFileName, leaseTime - ( leaseTime / 1000 ) ) );
+
+    Cache cache( 1 );
+    TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Use the oldest entry (before trimming starts)
+    void * retrievedData = nullptr;
+    size_t retrievedDataSize = 0;
+    TEST_ASSERT( cache.Retrieve( AStackString<>( cacheIds[ numEntries - 1 ] ), retrievedData, retrievedDataSize ) );
+    cache.FreeMemory( retrievedData, retrievedDataSize );
+
+    // Least recently used entries are trimmed while the cache is in use
+    const Timer t;
+    while ( CountFilesInDir( bucketPath.Get(), "*" ) > 1 )
+    {
+        TEST_ASSERT( t.GetElapsed() < 30.0f );
+        Thread::Sleep( 100 );
+    }
+    cache.Shutdown();
+
+    void * remainingData = nullptr;
+    size_t remainingDataSize = 0;
+    TEST_ASSERT( cache.Retrieve( AStackString<>( cacheIds[ numEntries - 1 ] ), remainingData, remainingDataSize ) );
+    cache.FreeMemory( remainingData, remainingDataSize );
+}
+
+// DedupLargeEntries
+//------------------------------------------------------------------------------
+void TestCache::DedupLargeEntries() const
+{
+    const AStackString<> cachePath( "../tmp/Test/Cache/DedupLargeEntries/Cache/" );
+    DeleteFilesInDir( cachePath.Get() );
+
+    Cache cache( 0, 1 ); // Entries of 1 MiB or more are chunked
+    TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // A large entry
+    const size_t sizeA = ( 8 * 1024 * 1024 );
+    UniquePtr< char > dataA( (char *)ALLOC( sizeA ) );
+    Random r( 1234 );
+    for ( size_t i = 0; i < sizeA; ++i )
+    {
+        dataA.Get()[ i ] = (char)r.GetRand();
+    }
+    const AStackString<> idA( "AAAA0001" );
+    TEST_ASSERT( cache.Publish( idA, dataA.Get(), sizeA ) );
+    const size_t numChunksA = CountFilesInDir( cachePath.Get(), "*.chunk" );
+    TEST_ASSERT( numChunksA > 4 );
+
+    // A similar entry, with data inserted, shares most chunks
+    const size_t insertPos = ( 3 * 1024 * 1024 );
+    const size_t insertSize = 1000;
+    const size_t sizeB = ( sizeA + insertSize );
+    UniquePtr< char > dataB( (char *)ALLOC( sizeB ) );
+    memcpy( dataB.Get(), dataA.Get(), insertPos );
+    memset( dataB.Get() + insertPos, 'B', insertSize );
+    memcpy( dataB.Get() + insertPos + insertSize, dataA.Get() + insertPos, sizeA - insertPos );
+    const AStackString<> idB( "BBBB0002" );
+    TEST_ASSERT( cache.Publish( idB, dataB.Get(), sizeB ) );
+    const size_t numChunksAB = CountFilesInDir( cachePath.Get(), "*.chunk" );
+    TEST_ASSERT( numChunksAB > numChunksA );
+    TEST_ASSERT( numChunksAB <= ( numChunksA + 2 ) );
+
+    // Small entries are not chunked
+    const char smallData[] = "Small";
+    TEST_ASSERT( cache.Publish( AStackString<>( "CCCC0003" ), smallData, sizeof( smallData ) ) );
+    TEST_ASSERT( CountFilesInDir( cachePath.Get(), "*.chunk" ) == numChunksAB );
+
+    // Entries are reassembled
+    {
+        void * data = nullptr;
+        size_t dataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idA, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == sizeA ) && ( memcmp( data, dataA.Get(), sizeA ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+        TEST_ASSERT( cache.Retrieve( idB, data, dataSize ) );
+        TEST_ASSERT( ( dataSize == sizeB ) && ( memcmp( data, dataB.Get(), sizeB ) == 0 ) );
+        cache.FreeMemory( data, dataSize );
+    }
+
+    // Entries with missing chunks (trimmed independently) are misses
+    {
+        Array< AString > chunks;
+        FileIO::GetFiles( cachePath, AStackString<>( "*.chunk" ), true, &chunks );
+        for ( const AString & chunk : chunks )
+        {
+            TEST_ASSERT( FileIO::FileDelete( chunk.Get() ) );
+        }
+        void * data = nullptr;
+        size_t dataSize = 0;
+        TEST_ASSERT( cache.Retrieve( idA, data, dataSize ) == false );
+    }
+
+    cache.Shutdown();
+}
+
+// DedupCompressedObjects
+//------------------------------------------------------------------------------
+void TestCache::DedupCompressedObjects() const
+{
+    const char * cachePath = "../tmp/Test/Cache/DedupCompressedObjects/Cache";
+    const char * srcFile = "../tmp/Test/Cache/DedupCompressedObjects/large.cpp";
+    DeleteFilesInDir( cachePath );
+    TEST_ASSERT( FileIO::EnsurePathExists( AStackString<>( "../tmp/Test/Cache/DedupCompressedObjects/" ) ) );
+
+    // Generate a source file producing a large, compressible object, optionally
+    // with data inserted near the start
+    auto writeSource = [ srcFile ]( bool insertData ) -> bool
+    {
+        FileStream f;
+        if ( f.Open( srcFile, FileStream::WRITE_ONLY ) == false )
+        {
+            return false;
+        }
+        AString source( 16 * 1024 * 1024 );
+        source += "extern const char g_LargeData[];\nconst char g_LargeData[] =\n";
+        // Lines of words from a small vocabulary compress, but don't repeat
+        Random r( 1234 );
+        AStackString<> words[ 64 ];
+        for ( AStackString<> & word : words )
+        {
+            for ( uint32_t i = 0; i < 7; ++i )
+            {
+                word += (char)( 'a' + r.GetRandIndex( 26 ) );
+            }
+            word += ' ';
+        }
+        const uint32_t numLines = ( 12 * 1024 * 1024 ) / 64;
+        for ( uint32_t line = 0; line < numLines; ++line )
+        {
+            if ( insertData && ( line == ( numLines / 4 ) ) )
+            {
+                source += "\"Inserted data which shifts everything after it\"\n";
+            }
+            source += '"';
+            for ( uint32_t i = 0; i < 8; ++i )
+            {
+                source += words[ r.GetRandIndex( 64 ) ];
+            }
+            source += "\"\n";
+        }
+        source += ";\n";
+        return ( f.WriteBuffer( source.Get(), source.GetLength() ) == source.GetLength() );
+    };
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/DedupCompressedObjects/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+
+    // Object is large enough to be compressed in blocks, which are stored as chunks
+    TEST_ASSERT( writeSource( false ) );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+    }
+    const size_t numChunksA = CountFilesInDir( cachePath, "*.chunk" );
+    TEST_ASSERT( numChunksA > 4 );
+
+    // A similar object, with data inserted, shares most chunks
+    TEST_ASSERT( writeSource( true ) );
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 1 );
+    }
+    const size_t numChunksAB = CountFilesInDir( cachePath, "*.chunk" );
+    TEST_ASSERT( numChunksAB > numChunksA );
+    TEST_ASSERT( ( numChunksAB - numChunksA ) <= ( numChunksA / 2 ) );
+
+    // Entries are reassembled and decompressed
+    options.m_UseCacheWrite = false;
+    options.m_UseCacheRead = true;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 1 );
+    }
+}
+
+// NetworkCacheServer
+//------------------------------------------------------------------------------
+void TestCache::NetworkCacheServer() const
+{
+    const AStackString<> cachePath( "../tmp/Test/Cache/NetworkCacheServer/Cache/" );
+    DeleteFilesInDir( cachePath.Get() );
+
+    // Serve a local cache
+    Cache backend;
+    TEST_ASSERT( backend.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+    CacheServer server( backend, 4 );
+    TEST_ASSERT( server.Listen( CacheProtocol::CACHE_SERVER_TEST_PORT ) );
+
+    AStackString<> serverPath;
+    serverPath.Format( "fbcache://127.0.0.1:%u", (uint32_t)CacheProtocol::CACHE_SERVER_TEST_PORT );
+    NetworkCache cache;
+    TEST_ASSERT( cache.Init( serverPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+
+    // Misses
+    AStackString<> missingId;
+    ICache::GetCacheId( 0xAAAA0001, 0, 0, 0, 0, missingId );
+    {
+        void * data = nullptr;
+        size_t dataSize = 0;
+        TEST_ASSERT( cache.Retrieve( missingId, data, dataSize ) == false );
+    }
+
+    // Ids not generated by GetCacheId are rejected, as they are used to build paths
+    {
+        TEST_ASSERT( ICache::IsValidCacheId( missingId ) );
+        AStackString<> dictionaryId;
+        ICache::GetCacheId( 0xAAAA0001, 0, 0, 0, 0x1234, dictionaryId );
+        TEST_ASSERT( ICache::IsValidCacheId( dictionaryId ) );
+
+        const char * const badIds[] = { "", "AAAA0001", "../../Escape", "..\\..\\Escape" };
+        for ( const char * badId : badIds )
+        {
+            TEST_ASSERT( ICache::IsValidCacheId( AStackString<>( badId ) ) == false );
+            TEST_ASSERT( cache.Publish( AStackString<>( badId ), "data", 4 ) == false );
+        }
+        AStackString<> traversalId( missingId );
+        traversalId[ 0 ] = '.';
+        traversalId[ 1 ] = '.';
+        traversalId[ 2 ] = '/';
+        TEST_ASSERT( ICache::IsValidCacheId( traversalId ) == false );
+        TEST_ASSERT( cache.Publish( traversalId, "data", 4 ) == false );
+        TEST_ASSERT( server.GetNumConnections() == 1 );
+    }
+
+    // Threads share the connection, with requests in flight at once. Some
+    // entries are larger than a frame, so are sent and received in parts.
+    struct ThreadData
+    {
+        NetworkCache *  m_Cache;
+        uint32_t        m_Index;
+        volatile bool   m_OK;
+    };
+    auto threadFunc = []( void * param ) -> uint32_t
+    {
+        ThreadData & threadData = *static_cast< ThreadData * >( param );
+        for ( uint32_t i = 0; i < 8; ++i )
+        {
+            const size_t size = ( i == 0 ) ? ( 9 * 1024 * 1024 + threadData.m_Index ) : ( 1000 * i + threadData.m_Index );
+            UniquePtr< char > entry( (char *)ALLOC( size ) );
+            Random r( threadData.m_Index * 100 + i );
+            for ( size_t j = 0; j < size; ++j )
+            {
+                entry.Get()[ j ] = (char)r.GetRand();
+            }
+            AStackString<> cacheId;
+            ICache::GetCacheId( threadData.m_Index, i, 0, 0, 0, cacheId );
+            if ( threadData.m_Cache->Publish( cacheId, entry.Get(), size ) == false )
+            {
+                return 0;
+            }
+            void * data = nullptr;
+            size_t dataSize = 0;
+            if ( threadData.m_Cache->Retrieve( cacheId, data, dataSize ) == false )
+            {
+                return 0;
+            }
+            const bool match = ( dataSize == size ) && ( memcmp( data, entry.Get(), size ) == 0 );
+            threadData.m_Cache->FreeMemory( data, dataSize );
+            if ( match == false )
+            {
+                return 0;
+            }
+        }
+        threadData.m_OK = true;
+        return 0;
+    };
+    const uint32_t numThreads = 8;
+    ThreadData threadData[ numThreads ];
+    Thread threads[ numThreads ];
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threadData[ i ].m_Cache = &cache;
+        threadData[ i ].m_Index = i;
+        threadData[ i ].m_OK = false;
+        threads[ i ].Start( threadFunc, "NetworkCacheTest", &threadData[ i ] );
+    }
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threads[ i ].Join();
+        TEST_ASSERT( threadData[ i ].m_OK );
+    }
+    TEST_ASSERT( server.GetNumConnections() == 1 );
+
+    // Entries are stored by the server's cache
+    CacheServer::Stats stats;
+    server.GetStats( stats );
+    TEST_ASSERT( stats.m_Publishes == ( numThreads * 8 ) );
+    TEST_ASSERT( stats.m_Hits == ( numThreads * 8 ) );
+    {
+        void * data = nullptr;
+        size_t dataSize = 0;
+        AStackString<> cacheId;
+        ICache::GetCacheId( 3, 0, 0, 0, 0, cacheId );
+        TEST_ASSERT( backend.Retrieve( cacheId, data, dataSize ) );
+        TEST_ASSERT( dataSize == ( 9 * 1024 * 1024 + 3 ) );
+        backend.FreeMemory( data, dataSize );
+    }
+
+    // Oversized messages are rejected before their bodies are allocated
+    {
+        TCPConnectionPool client;
+        const ConnectionInfo * ci = client.Connect( AStackString<>( "127.0.0.1" ), CacheProtocol::CACHE_SERVER_TEST_PORT );
+        TEST_ASSERT( ci );
+        CacheProtocol::FrameHeader header;
+        memset( &header, 0, sizeof( header ) );
+        header.m_MsgType = CacheProtocol::MSG_PUBLISH;
+        header.m_RequestId = 1;
+        header.m_BodySize = ( (uint64_t)CacheProtocol::kMaxBodySize + 1 );
+        TEST_ASSERT( client.Send( ci, &header, sizeof( header ) ) );
+
+        // The server drops the connection
+        const Timer timer;
+        while ( client.GetNumConnections() > 0 )
+        {
+            TEST_ASSERT( timer.GetElapsed() < 10.0f );
+            Thread::Sleep( 10 );
+        }
+        client.ShutdownAllConnections();
+    }
+
+    cache.Shutdown();
+    server.ShutdownAllConnections();
+    backend.Shutdown();
+}
+
+// BatchApi
+//------------------------------------------------------------------------------
+void TestCache::BatchApi() const
+{
+    // Local cache
+    {
+        const AStackString<> cachePath( "../tmp/Test/Cache/BatchApi/Local/" );
+        DeleteFilesInDir( cachePath.Get() );
+        Cache cache;
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.SupportsExists() );
+        CheckBatchApi( cache );
+        cache.Shutdown();
+    }
+
+    // Packed cache (checks only read the record headers), behind local tiers
+    {
+        const AStackString<> cachePath( "../tmp/Test/Cache/BatchApi/Packed/" );
+        DeleteFilesInDir( cachePath.Get() );
+        LayeredCache cache( FNEW( PackedCache() ), AString::GetEmpty(), 0, 0 );
+        TEST_ASSERT( cache.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.SupportsExists() );
+        CheckBatchApi( cache );
+        cache.Shutdown();
+    }
+
+    // Network cache (requests are pipelined)
+    {
+        const AStackString<> cachePath( "../tmp/Test/Cache/BatchApi/Network/" );
+        DeleteFilesInDir( cachePath.Get() );
+        Cache backend;
+        TEST_ASSERT( backend.Init( cachePath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        CacheServer server( backend, 4 );
+        TEST_ASSERT( server.Listen( CacheProtocol::CACHE_SERVER_TEST_PORT ) );
+
+        AStackString<> serverPath;
+        serverPath.Format( "fbcache://127.0.0.1:%u", (uint32_t)CacheProtocol::CACHE_SERVER_TEST_PORT );
+        NetworkCache cache;
+        TEST_ASSERT( cache.Init( serverPath, AString::GetEmpty(), true, true, false, AString::GetEmpty() ) );
+        TEST_ASSERT( cache.SupportsExists() );
+        CheckBatchApi( cache );
+
+        cache.Shutdown();
+        server.ShutdownAllConnections();
+        backend.Shutdown();
+    }
+}
+
+// PublishAsync
+//------------------------------------------------------------------------------
+void TestCache::PublishAsync() const
+{
+    DeleteFilesInDir( "../tmp/Test/Cache/AsyncPublish/Cache" );
+    #if defined( __WINDOWS__ )
+        const char * const objFiles[] = { "../tmp/Test/Cache/AsyncPublish/Out/a.obj",
+                                          "../tmp/Test/Cache/AsyncPublish/Out/b.obj" };
+    #else
+        const char * const objFiles[] = { "../tmp/Test/Cache/AsyncPublish/Out/a.o",
+                                          "../tmp/Test/Cache/AsyncPublish/Out/b.o" };
+    #endif
+    for ( const char * objFile : objFiles )
+    {
+        EnsureFileDoesNotExist( objFile );
+    }
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/AsyncPublish/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+    options.m_NumWorkerThreads = 1; // A single worker, which publishing must not hold up
+
+    // Publishing is held up until every object has been compiled, which can
+    // only happen if the worker doesn't wait for its stores
+    struct ReleaseData
+    {
+        BlockingCache *         m_Cache;
+        const char * const *    m_ObjFiles;
+        volatile bool           m_AllObjectsBuilt;
+    };
+    auto releaseFunc = []( void * param ) -> uint32_t
+    {
+        ReleaseData & data = *static_cast< ReleaseData * >( param );
+        const Timer t;
+        while ( t.GetElapsed() < 30.0f )
+        {
+            if ( FileIO::FileExists( data.m_ObjFiles[ 0 ] ) && FileIO::FileExists( data.m_ObjFiles[ 1 ] ) )
+            {
+                data.m_AllObjectsBuilt = true;
+                break;
+            }
+            Thread::Sleep( 1 );
+        }
+        data.m_Cache->Release();
+        return 0;
+    };
+
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        BlockingCache * cache = FNEW( BlockingCache( fBuild.GetCache() ) );
+        fBuild.SetCache( cache );
+
+        ReleaseData releaseData{ cache, objFiles, false };
+        Thread releaseThread;
+        releaseThread.Start( releaseFunc, "ReleaseCache", &releaseData );
+
+        // The build waits for background stores before completing
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        releaseThread.Join();
+        TEST_ASSERT( releaseData.m_AllObjectsBuilt );
+        TEST_ASSERT( cache->GetNumPublishesStarted() == 2 );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 2 );
+    }
+
+    // Entries were stored
+    options.m_UseCacheWrite = false;
+    options.m_UseCacheRead = true;
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+    }
+}
+
+// PublishQueueBound
+//------------------------------------------------------------------------------
+void TestCache::PublishQueueBound() const
+{
+    DeleteFilesInDir( "../tmp/Test/Cache/AsyncPublish/Cache" );
+    #if defined( __WINDOWS__ )
+        const char * const objFile = "../tmp/Test/Cache/AsyncPublish/Out/a.obj";
+    #else
+        const char * const objFile = "../tmp/Test/Cache/AsyncPublish/Out/a.o";
+    #endif
+
+    // By default, up to 256 MiB of entries can be waiting to be published
+    TEST_ASSERT( CachePublisher::kDefaultMaxQueuedBytes == ( 256 * MEGABYTE ) );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/AsyncPublish/fbuild.bff";
+    const char * const dbFile = "../tmp/Test/Cache/AsyncPublish/fbuild.fdb";
+
+    // Build to create the object nodes to publish for
+    {
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    options.m_UseCacheWrite = true;
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize( dbFile ) );
+    BlockingCache * cache = FNEW( BlockingCache( fBuild.GetCache() ) );
+    fBuild.SetCache( cache );
+    Node * node = fBuild.GetNode( objFile );
+    TEST_ASSERT( node );
+    ObjectNode * objectNode = node->CastTo< ObjectNode >();
+
+    // Use a smaller bound with the same behavior
+    CachePublisher publisher( 4 * MEGABYTE );
+    const size_t dataSize = ( 3 * MEGABYTE );
+    UniquePtr< char > data( (char *)ALLOC( dataSize ) );
+    memset( data.Get(), 'x', dataSize );
+    AStackString<> cacheIds[ 4 ];
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        ICache::GetCacheId( i, 0, 0, 0, 0, cacheIds[ i ] );
+    }
+
+    // Entries are queued until the bound is reached...
+    TEST_ASSERT( publisher.Queue( objectNode, cacheIds[ 0 ], data.Get(), dataSize, false ) );
+    TEST_ASSERT( publisher.Queue( objectNode, cacheIds[ 1 ], data.Get(), MEGABYTE, false ) );
+
+    // ...beyond which callers must publish themselves
+    TEST_ASSERT( publisher.Queue( objectNode, cacheIds[ 2 ], data.Get(), 1, false ) == false );
+
+    // Once published, the space is available again
+    cache->Release();
+    TEST_ASSERT( publisher.Flush( 0 ) );
+    TEST_ASSERT( cache->GetNumPublishesStarted() == 2 );
+    TEST_ASSERT( publisher.Queue( objectNode, cacheIds[ 3 ], data.Get(), dataSize, false ) );
+    TEST_ASSERT( publisher.Flush( 0 ) );
+    TEST_ASSERT( cache->GetNumPublishesStarted() == 3 );
+}
+
+// PublishTimeout
+//------------------------------------------------------------------------------
+void TestCache::PublishTimeout() const
+{
+    DeleteFilesInDir( "../tmp/Test/Cache/AsyncPublish/Cache" );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/AsyncPublish/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+    options.m_UseCacheWrite = true;
+    options.m_CachePublishTimeoutSecs = 1;
+
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize() );
+    BlockingCache * cache = FNEW( BlockingCache( fBuild.GetCache() ) );
+    fBuild.SetCache( cache );
+
+    // The build stops waiting for stores which don't complete in time
+    const Timer t;
+    TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+    const float buildTime = t.GetElapsed();
+    TEST_ASSERT( cache->GetNumPublishesStarted() > 0 );
+    TEST_ASSERT( buildTime >= 1.0f );
+    TEST_ASSERT( buildTime < 20.0f );
+
+    // Stores which didn't complete aren't reported
+    TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 0 );
+
+    // Let the abandoned stores finish, so the publisher can be shut down
+    cache->Release();
+}
+
+// Filter
+//------------------------------------------------------------------------------
+void TestCache::Filter() const
+{
+    const char * cachePath = "../tmp/Test/Cache/Filter/Cache";
+    DeleteFilesInDir( cachePath );
+
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestCache/Filter/fbuild.bff";
+    options.m_ForceCleanBuild = true;
+
+    // Trimming writes the filter (empty, since the cache is empty)
+    FBuildTestOptions trimOptions( options );
+    trimOptions.m_CacheTrim = 1024;
+    {
+        FBuildForTest fBuild( trimOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheTrim() );
+    }
+
+    // Entries not in the cache are skipped...
+    FBuildTestOptions readOptions( options );
+    readOptions.m_UseCacheRead = true;
+    readOptions.m_CacheFilter = true;
+    {
+        FBuildForTest fBuild( readOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheMisses == 2 );
+        TEST_ASSERT( fBuild.GetStats().GetCacheFiltered() == 2 );
+    }
+
+    // ...unless the filter isn't used
+    {
+        FBuildTestOptions noFilterOptions( readOptions );
+        noFilterOptions.m_CacheFilter = false;
+        FBuildForTest fBuild( noFilterOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheMisses == 2 );
+        TEST_ASSERT( fBuild.GetStats().GetCacheFiltered() == 0 );
+    }
+
+    // Write
+    FBuildTestOptions writeOptions( options );
+    writeOptions.m_UseCacheWrite = true;
+    {
+        FBuildForTest fBuild( writeOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheStores == 2 );
+    }
+
+    // Entries published since the filter was written are recorded as updates to it
+    const AStackString<> updatesPath( "../tmp/Test/Cache/Filter/Cache/FilterUpdates" );
+    Array< AString > updateFiles;
+    FileIO::GetFiles( updatesPath, AStackString<>( "*.ids" ), false, &updateFiles );
+    TEST_ASSERT( updateFiles.GetSize() == 1 );
+    {
+        FBuildForTest fBuild( readOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+        TEST_ASSERT( fBuild.GetStats().GetCacheFiltered() == 0 );
+    }
+
+    // Recent updates are kept when trimming, as they may still be written to
+    {
+        FBuildForTest fBuild( trimOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheTrim() );
+    }
+    TEST_ASSERT( FileIO::FileExists( updateFiles[ 0 ].Get() ) );
+
+    // Once no longer written, they are deleted by the next trim, as the filter includes the entries
+    #if defined( __WINDOWS__ )
+        const uint64_t oneDay = ( 24 * 60 * 60 * (uint64_t)10000000 );
+    #else
+        const uint64_t oneDay = ( 24 * 60 * 60 * (uint64_t)1000000000 );
+    #endif
+    TEST_ASSERT( FileIO::SetFileLastWriteTime( updateFiles[ 0 ], Time::GetCurrentFileTime() - oneDay ) );
+    {
+        FBuildForTest fBuild( trimOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.CacheTrim() );
+    }
+    TEST_ASSERT( FileIO::FileExists( updateFiles[ 0 ].Get() ) == false );
+    {
+        FBuildForTest fBuild( readOptions );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+        TEST_ASSERT( fBuild.GetStats().GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == 2 );
+        TEST_ASSERT( fBuild.GetStats().GetCacheFiltered() == 0 );
+    }
+}
+
+// BuildWithCacheTiers
+//------------------------------------------------------------------------------
+void TestCache::BuildWithCacheTiers( FBuildForTest & fBuild, uint32_t expectedHits, CacheTierStats & outTierStats ) const
+{
+    TEST_ASSERT( fBuild.Build( "ObjectList" ) );
+
+    const FBuildStats & stats = fBuild.GetStats();
+    TEST_ASSERT( stats.GetStatsFor( Node::OBJECT_NODE ).m_NumCacheHits == expectedHits );
+    TEST_ASSERT( stats.m_HasCacheTiers );
+    outTierStats = stats.m_CacheTierStats;
+}
+
+// CheckBatchApi
+//------------------------------------------------------------------------------
+void TestCache::CheckBatchApi( ICache & cache ) const
+{
+    const uint32_t numItems = 6;
+    AStackString<> cacheIds[ numItems ];
+    AStackString<> contents[ numItems ];
+    CacheBatchItem items[ numItems ];
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        ICache::GetCacheId( i, 0xBA7C4, 0, 0, 0, cacheIds[ i ] );
+        contents[ i ].Format( "Contents of entry %u", i );
+        items[ i ].m_CacheId = &cacheIds[ i ];
+        items[ i ].m_PublishData = contents[ i ].Get();
+        items[ i ].m_PublishDataSize = contents[ i ].GetLength();
+    }
+
+    // Nothing exists yet
+    cache.ExistsBatch( items, numItems );
+    for ( const CacheBatchItem & item : items )
+    {
+        TEST_ASSERT( item.m_Result == false );
+    }
+
+    // Publish even entries
+    CacheBatchItem publishItems[ numItems / 2 ];
+    for ( uint32_t i = 0; i < ( numItems / 2 ); ++i )
+    {
+        publishItems[ i ] = items[ i * 2 ];
+    }
+    cache.PublishBatch( publishItems, numItems / 2 );
+    for ( const CacheBatchItem & item : publishItems )
+    {
+        TEST_ASSERT( item.m_Result );
+    }
+
+    // Only published entries exist, and are retrieved
+    cache.ExistsBatch( items, numItems );
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        TEST_ASSERT( items[ i ].m_Result == ( ( i % 2 ) == 0 ) );
+    }
+    cache.RetrieveBatch( items, numItems );
+    for ( uint32_t i = 0; i < numItems; ++i )
+    {
+        const CacheBatchItem & item = items[ i ];
+        if ( ( i % 2 ) == 0 )
+        {
+            TEST_ASSERT( item.m_Result );
+            TEST_ASSERT( item.m_DataSize == contents[ i ].GetLength() );
+            TEST_ASSERT( memcmp( item.m_Data, contents[ i ].Get(), item.m_DataSize ) == 0 );
+            cache.FreeMemory( item.m_Data, item.m_DataSize );
+        }
+        else
+        {
+            TEST_ASSERT( item.m_Result == false );
+            TEST_ASSERT( item.m_Data == nullptr );
+        }
+    }
+}
+
+// DeleteFilesInDir
+//------------------------------------------------------------------------------
+void TestCache::DeleteFilesInDir( const char * path ) const
+{
+    Array< AString > files;
+    FileIO::GetFiles( AStackString<>( path ), AStackString<>( "*" ), true, &files );
+    for ( const AString & file : files )
+    {
+        TEST_ASSERT( FileIO::FileDelete( file.Get() ) );
+    }
+}
+
+// CountFilesInDir
+//------------------------------------------------------------------------------
+size_t TestCache::CountFilesInDir( const char * path, const char * wildCard ) const
+{
+    Array< AString > files;
+    FileIO::GetFiles( AStackString<>( path ), AStackString<>( wildCard ), true, &files );
+    return files.GetSize();
+}
+
 // ConsistentCacheKeysWithDist
 //------------------------------------------------------------------------------
 void TestCache::ConsistentCacheKeysWithDist() const
@@ -10,6 +10,7 @@
 // Core
 #include "Core/Containers/UniquePtr.h"
 #include "Core/FileIO/FileStream.h"
+#include "Core/Math/Conversions.h"
 #include "Core/Strings/AString.h"
 #include "Core/Time/Timer.h"
 #include "Core/Tracing/Tracing.h"
@@ -27,12 +28,15 @@ private:
     void CompressPreprocessedFile() const;
     void CompressObjFile() const;
     void TestHeaderValidity() const;
+    void CompressLargeData() const;
+    void CompressWithDictionary() const;
 
     void CompressSimpleHelper( const char * data,
                                size_t size,
                                size_t expectedCompressedSize,
                                bool shouldCompress ) const;
     void CompressHelper( const char * fileName ) const;
+    void LoadFile( const char * fileName, UniquePtr< char > & outData, size_t & outDataSize ) const;
 };
 
 // Register Tests
@@ -42,6 +46,8 @@ REGISTER_TESTS_BEGIN( TestCompressor )
     REGISTER_TEST( CompressPreprocessedFile )
     REGISTER_TEST( CompressObjFile )
     REGISTER_TEST( TestHeaderValidity )
+    REGISTER_TEST( CompressLargeData )
+    REGISTER_TEST( CompressWithDictionary )
 REGISTER_TESTS_END
 
 // CompressSimple
@@ -226,4 +232,94 @@ void TestCompressor::TestHeaderValidity() const
     TEST_ASSERT( Compressor::IsValidData( buffer.Get(), 44 ) == false );
 }
 
+// CompressLargeData
+//------------------------------------------------------------------------------
+void TestCompressor::CompressLargeData() const
+{
+    // Large enough to be compressed in parallel blocks
+    UniquePtr< char > file;
+    size_t fileSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", file, fileSize );
+    const size_t dataSize = ( 20 * 1024 * 1024 ) + 123; // Last block is partial
+    UniquePtr< char > data( (char *)ALLOC( dataSize ) );
+    for ( size_t pos = 0; pos < dataSize; pos += fileSize )
+    {
+        memcpy( data.Get() + pos, file.Get(), Math::Min( fileSize, dataSize - pos ) );
+    }
+
+    const int32_t compressionLevels[] = { -1, 1 };
+    for ( const int32_t compressionLevel : compressionLevels )
+    {
+        Compressor c;
+        TEST_ASSERT( c.Compress( data.Get(), dataSize, compressionLevel, nullptr, true ) ); // true = allowBlocks
+        TEST_ASSERT( c.GetResultSize() < dataSize );
+
+        Compressor d;
+        TEST_ASSERT( d.Decompress( c.GetResult() ) );
+        TEST_ASSERT( d.GetResultSize() == dataSize );
+        TEST_ASSERT( memcmp( data.Get(), d.GetResult(), dataSize ) == 0 );
+    }
+}
+
+// CompressWithDictionary
+//------------------------------------------------------------------------------
+void TestCompressor::CompressWithDictionary() const
+{
+    UniquePtr< char > file;
+    size_t fileSize;
+    LoadFile( "Tools/FBuild/FBuildTest/Data/TestCompressor/TestPreprocessedFile.ii", file, fileSize );
+
+    // Small input, with similar content to the dictionary
+    CompressionDictionary dictionary;
+    dictionary.SetData( file.Get(), fileSize );
+    const char * data = ( file.Get() + fileSize - ( 8 * 1024 ) );
+    const size_t dataSize = ( 4 * 1024 );
+
+    const int32_t compressionLevels[] = { -1, 1 };
+    for ( const int32_t compressionLevel : compressionLevels )
+    {
+        Compressor c;
+        TEST_ASSERT( c.Compress( data, dataSize, compressionLevel ) );
+        Compressor cd;
+        TEST_ASSERT( cd.Compress( data, dataSize, compressionLevel, &dictionary ) );
+        TEST_ASSERT( cd.GetResultSize() < c.GetResultSize() );
+
+        // Dictionary is required to decompress
+        {
+            Compressor d;
+            TEST_ASSERT( d.Decompress( cd.GetResult() ) == false );
+        }
+        {
+            CompressionDictionary otherDictionary;
+            otherDictionary.SetData( file.Get(), fileSize / 2 );
+            Compressor d;
+            TEST_ASSERT( d.Decompress( cd.GetResult(), &otherDictionary ) == false );
+        }
+        {
+            Compressor d;
+            TEST_ASSERT( d.Decompress( cd.GetResult(), &dictionary ) );
+            TEST_ASSERT( d.GetResultSize() == dataSize );
+            TEST_ASSERT( memcmp( data, d.GetResult(), dataSize ) == 0 );
+        }
+
+        // Data compressed without a dictionary can still be decompressed
+        {
+            Compressor d;
+            TEST_ASSERT( d.Decompress( c.GetResult(), &dictionary ) );
+            TEST_ASSERT( memcmp( data, d.GetResult(), dataSize ) == 0 );
+        }
+    }
+}
+
+// LoadFile
+//------------------------------------------------------------------------------
+void TestCompressor::LoadFile( const char * fileName, UniquePtr< char > & outData, size_t & outDataSize ) const
+{
+    FileStream fs;
+    TEST_ASSERT( fs.Open( fileName ) );
+    outDataSize = (size_t)fs.GetFileSize();
+    outData = (char *)ALLOC( outDataSize );
+    TEST_ASSERT( fs.Read( outData.Get(), outDataSize ) == outDataSize );
+}
+
 //------------------------------------------------------------------------------
@@ -0,0 +1,165 @@
+// TestContentStamps.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileStampCache.h"
+
+// Core
+#include "Core/FileIO/ConstMemoryStream.h"
+#include "Core/FileIO/FileIO.h"
+#include "Core/FileIO/MemoryStream.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+
+// TestContentStamps
+//------------------------------------------------------------------------------
+class TestContentStamps : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void Build() const;
+    void Build_NoRebuild() const;
+    void TouchedFile() const;
+    void ModifiedFile() const;
+    void IdenticalOutput() const;
+    void CorruptCache() const;
+
+    void BuildCopies( size_t numBuilt, uint32_t numFilesHashed ) const;
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestContentStamps )
+    REGISTER_TEST( Build )
+    REGISTER_TEST( Build_NoRebuild )
+    REGISTER_TEST( TouchedFile )
+    REGISTER_TEST( ModifiedFile )
+    REGISTER_TEST( IdenticalOutput )
+    REGISTER_TEST( CorruptCache )
+REGISTER_TESTS_END
+
+// Build
+//------------------------------------------------------------------------------
+void TestContentStamps::Build() const
+{
+    // clean up anything left over from previous runs
+    EnsureDirExists( "../tmp/Test/ContentStamps/" );
+    EnsureFileDoesNotExist( "../tmp/Test/ContentStamps/fbuild.fdb" );
+    EnsureFileDoesNotExist( "../tmp/Test/ContentStamps/file.copy1" );
+    EnsureFileDoesNotExist( "../tmp/Test/ContentStamps/file.copy2" );
+    MakeFile( "../tmp/Test/ContentStamps/file.txt", "contents" );
+
+    // Input and both outputs are hashed
+    BuildCopies( 2, 3 );
+}
+
+// Build_NoRebuild
+//------------------------------------------------------------------------------
+void TestContentStamps::Build_NoRebuild() const
+{
+    // Hashes are loaded from the DB, so nothing needs to be hashed
+    BuildCopies( 0, 0 );
+}
+
+// TouchedFile
+//------------------------------------------------------------------------------
+void TestContentStamps::TouchedFile() const
+{
+    // Rewrite input with the same contents
+    #if defined( __OSX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+    #endif
+    MakeFile( "../tmp/Test/ContentStamps/file.txt", "contents" );
+
+    // Input is hashed again, but nothing is built
+    BuildCopies( 0, 1 );
+}
+
+// ModifiedFile
+//------------------------------------------------------------------------------
+void TestContentStamps::ModifiedFile() const
+{
+    #if defined( __OSX__ )
+        Thread::Sleep( 1000 ); // Work around low time resolution of HFS+
+    #endif
+    MakeFile( "../tmp/Test/ContentStamps/file.txt", "modified" );
+
+    // Everything is built
+    BuildCopies( 2, 3 );
+
+    AString contents;
+    LoadFileContentsAsString( "../tmp/Test/ContentStamps/file.copy2", contents );
+    TEST_ASSERT( contents == "modified" );
+}
+
+// IdenticalOutput
+//------------------------------------------------------------------------------
+void TestContentStamps::IdenticalOutput() const
+{
+    // Force first copy to be rebuilt
+    EnsureFileDoesNotExist( "../tmp/Test/ContentStamps/file.copy1" );
+
+    // Rebuilt output is identical, so the second copy doesn't need building
+    BuildCopies( 1, 1 );
+}
+
+// CorruptCache
+//------------------------------------------------------------------------------
+void TestContentStamps::CorruptCache() const
+{
+    AStackString<> fileName( "../tmp/Test/ContentStamps/Corrupt/file.txt" );
+    EnsureDirExists( "../tmp/Test/ContentStamps/Corrupt/" );
+    MakeFile( fileName.Get(), "contents" );
+    const uint64_t lastWriteTime = FileIO::GetFileLastWriteTime( fileName );
+
+    MemoryStream saved;
+    {
+        FileStampCache cache;
+        TEST_ASSERT( cache.GetStamp( fileName ) != 0 );
+        cache.Save( saved );
+    }
+
+    // Intact
+    uint64_t stamp = 0;
+    {
+        FileStampCache cache;
+        ConstMemoryStream stream( saved.GetData(), saved.GetSize() );
+        TEST_ASSERT( cache.Load( stream ) );
+        TEST_ASSERT( cache.GetCachedStamp( fileName, lastWriteTime, stamp ) );
+    }
+
+    // Truncated cache is discarded
+    {
+        FileStampCache cache;
+        ConstMemoryStream stream( saved.GetData(), saved.GetSize() - 1 );
+        TEST_ASSERT( cache.Load( stream ) == false );
+        TEST_ASSERT( cache.GetCachedStamp( fileName, lastWriteTime, stamp ) == false );
+    }
+}
+
+// BuildCopies
+//------------------------------------------------------------------------------
+void TestContentStamps::BuildCopies( size_t numBuilt, uint32_t numFilesHashed ) const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestContentStamps/fbuild.bff";
+    options.m_ContentStamps = true;
+    FBuild fBuild( options );
+    TEST_ASSERT( fBuild.Initialize( "../tmp/Test/ContentStamps/fbuild.fdb" ) );
+
+    TEST_ASSERT( fBuild.Build( "Copy2" ) );
+    TEST_ASSERT( fBuild.SaveDependencyGraph( "../tmp/Test/ContentStamps/fbuild.fdb" ) );
+    EnsureFileExists( "../tmp/Test/ContentStamps/file.copy2" );
+
+    // Check stats
+    //               Seen,  Built,      Type
+    CheckStatsNode ( 2,     numBuilt,   Node::COPY_FILE_NODE );
+    TEST_ASSERT( fBuild.GetFileStampCache().GetNumFilesHashed() == numFilesHashed );
+}
+
+//------------------------------------------------------------------------------
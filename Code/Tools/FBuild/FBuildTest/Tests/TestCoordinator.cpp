@@ -0,0 +1,196 @@
+// TestCoordinator.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerBrokerage.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerConnectionPool.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Env/Env.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    constexpr uint32_t kWorkerA = 0x0100000A; // 10.0.0.1
+    constexpr uint32_t kWorkerB = 0x0200000A; // 10.0.0.2
+    constexpr uint32_t kWorkerC = 0x0300000A; // 10.0.0.3
+    constexpr uint32_t kClient1 = 0x6400000A; // 10.0.0.100
+    constexpr uint32_t kClient2 = 0x6500000A; // 10.0.0.101
+    constexpr uint8_t kPlatform = 0;
+}
+
+// TestCoordinator
+//------------------------------------------------------------------------------
+class TestCoordinator : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void RankBySpareCPUs() const;
+    void PreferWorkersWithToolchain() const;
+    void ShareWorkersBetweenClients() const;
+    void IgnoreUnavailableAndIncompatible() const;
+    void UnreachableCoordinator() const;
+
+    static void UpdateWorker( WorkerConnectionPool & pool,
+                              uint32_t address,
+                              uint16_t numCPUs,
+                              uint16_t numJobsActive,
+                              uint64_t toolId = 0 );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestCoordinator )
+    REGISTER_TEST( RankBySpareCPUs )
+    REGISTER_TEST( PreferWorkersWithToolchain )
+    REGISTER_TEST( ShareWorkersBetweenClients )
+    REGISTER_TEST( IgnoreUnavailableAndIncompatible )
+    REGISTER_TEST( UnreachableCoordinator )
+REGISTER_TESTS_END
+
+// RankBySpareCPUs
+//------------------------------------------------------------------------------
+void TestCoordinator::RankBySpareCPUs() const
+{
+    WorkerConnectionPool pool;
+    UpdateWorker( pool, kWorkerA, 8, 8 ); // 0 spare
+    UpdateWorker( pool, kWorkerB, 8, 2 ); // 6 spare
+    UpdateWorker( pool, kWorkerC, 4, 0 ); // 4 spare
+
+    Array< uint32_t > workers;
+    pool.AllocateWorkers( kClient1, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, Array< uint64_t >(), workers );
+    TEST_ASSERT( workers.GetSize() == 3 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerB );
+    TEST_ASSERT( workers[ 1 ] == kWorkerC );
+    TEST_ASSERT( workers[ 2 ] == kWorkerA );
+}
+
+// PreferWorkersWithToolchain
+//------------------------------------------------------------------------------
+void TestCoordinator::PreferWorkersWithToolchain() const
+{
+    const uint64_t toolId = 0x1234567890ABCDEF;
+
+    WorkerConnectionPool pool;
+    UpdateWorker( pool, kWorkerA, 8, 0 );           // 8 spare
+    UpdateWorker( pool, kWorkerB, 8, 6, toolId );   // 2 spare, has toolchain
+    UpdateWorker( pool, kWorkerC, 8, 8, toolId );   // 0 spare, has toolchain
+
+    // Without toolchain info, the least loaded worker is best
+    Array< uint32_t > workers;
+    pool.AllocateWorkers( kClient1, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, Array< uint64_t >(), workers );
+    TEST_ASSERT( workers.GetSize() == 3 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerA );
+
+    // A worker with the toolchain is preferred, as long as it has spare CPUs
+    Array< uint64_t > toolIds;
+    toolIds.Append( toolId );
+    workers.Clear();
+    pool.AllocateWorkers( kClient1, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, toolIds, workers );
+    TEST_ASSERT( workers.GetSize() == 3 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerB );
+    TEST_ASSERT( workers[ 1 ] == kWorkerA );
+    TEST_ASSERT( workers[ 2 ] == kWorkerC );
+}
+
+// ShareWorkersBetweenClients
+//------------------------------------------------------------------------------
+void TestCoordinator::ShareWorkersBetweenClients() const
+{
+    WorkerConnectionPool pool;
+    UpdateWorker( pool, kWorkerA, 8, 0 ); // 8 spare
+    UpdateWorker( pool, kWorkerB, 6, 0 ); // 6 spare
+
+    // A lone client is allocated every worker
+    Array< uint32_t > workers;
+    pool.AllocateWorkers( kClient1, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, Array< uint64_t >(), workers );
+    TEST_ASSERT( workers.GetSize() == 2 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerA );
+    TEST_ASSERT( workers[ 1 ] == kWorkerB );
+
+    // A second client shares them (A: 8/2, B: 6/2), and is allocated half
+    workers.Clear();
+    pool.AllocateWorkers( kClient2, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, Array< uint64_t >(), workers );
+    TEST_ASSERT( workers.GetSize() == 2 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerA );
+    TEST_ASSERT( workers[ 1 ] == kWorkerB );
+
+    // When the first client asks again, A is shared with the second (8/2) but B is not
+    workers.Clear();
+    pool.AllocateWorkers( kClient1, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, Array< uint64_t >(), workers );
+    TEST_ASSERT( workers.GetSize() == 2 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerB );
+    TEST_ASSERT( workers[ 1 ] == kWorkerA );
+}
+
+// IgnoreUnavailableAndIncompatible
+//------------------------------------------------------------------------------
+void TestCoordinator::IgnoreUnavailableAndIncompatible() const
+{
+    WorkerConnectionPool pool;
+    UpdateWorker( pool, kWorkerA, 8, 0 );
+    UpdateWorker( pool, kWorkerB, 8, 0 );
+    pool.UpdateWorker( kWorkerC, Protocol::PROTOCOL_VERSION_MAJOR + 1, kPlatform, true, WorkerLoad() );
+
+    // Worker leaves
+    pool.UpdateWorker( kWorkerA, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, false, WorkerLoad() );
+
+    Array< uint32_t > workers;
+    pool.AllocateWorkers( kClient1, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, Array< uint64_t >(), workers );
+    TEST_ASSERT( workers.GetSize() == 1 );
+    TEST_ASSERT( workers[ 0 ] == kWorkerB );
+}
+
+// UnreachableCoordinator
+//------------------------------------------------------------------------------
+void TestCoordinator::UnreachableCoordinator() const
+{
+    // Nothing is listening on the coordinator port locally
+    Env::SetEnvVariable( "FASTBUILD_COORDINATOR", AStackString<>( "127.0.0.1" ) );
+
+    {
+        WorkerBrokerage brokerage;
+
+        // Availability is only updated periodically
+        brokerage.SetAvailability( true );
+        Thread::Sleep( 11 * 1000 );
+
+        // A worker only using a coordinator has no brokerage file to fall back to
+        brokerage.SetAvailability( true );
+        TEST_ASSERT( brokerage.GetBrokerageRoots().IsEmpty() );
+        brokerage.SetAvailability( false );
+        brokerage.SetAvailability( true );
+    }
+
+    Env::SetEnvVariable( "FASTBUILD_COORDINATOR", AString::GetEmpty() );
+}
+
+// UpdateWorker
+//------------------------------------------------------------------------------
+/*static*/ void TestCoordinator::UpdateWorker( WorkerConnectionPool & pool,
+                                               uint32_t address,
+                                               uint16_t numCPUs,
+                                               uint16_t numJobsActive,
+                                               uint64_t toolId )
+{
+    WorkerLoad load;
+    load.m_NumCPUs = numCPUs;
+    load.m_NumJobsActive = numJobsActive;
+    if ( toolId != 0 )
+    {
+        load.m_ToolIds.Append( toolId );
+    }
+    pool.UpdateWorker( address, Protocol::PROTOCOL_VERSION_MAJOR, kPlatform, true, load );
+}
+
+//------------------------------------------------------------------------------
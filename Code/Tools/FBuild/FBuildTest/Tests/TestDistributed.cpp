@@ -38,6 +38,7 @@ private:
         void RemoteRaceSystemFailure();
     #endif
     void AnonymousNamespaces();
+    void StreamedResults() const;
     void ErrorsAreCorrectlyReported_MSVC() const;
     void ErrorsAreCorrectlyReported_Clang() const;
     void WarningsAreCorrectlyReported_MSVC() const;
@@ -68,6 +69,7 @@ REGISTER_TESTS_BEGIN( TestDistributed )
         REGISTER_TEST( RemoteRaceSystemFailure )
     #endif
     REGISTER_TEST( AnonymousNamespaces )
+    REGISTER_TEST( StreamedResults )
     REGISTER_TEST( ShutdownMemoryLeak )
     #if defined( __WINDOWS__ )
         REGISTER_TEST( ErrorsAreCorrectlyReported_MSVC ) // TODO:B Enable for OSX and Linux
@@ -253,6 +255,38 @@ void TestDistributed::AnonymousNamespaces()
     TestHelper( target, 1 );
 }
 
+// StreamedResults
+//------------------------------------------------------------------------------
+void TestDistributed::StreamedResults() const
+{
+    // Check that results larger than the chunk size are streamed back in
+    // chunks and written to disk correctly
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestDistributed/fbuild.bff";
+    options.m_AllowDistributed = true;
+    options.m_NumWorkerThreads = 1;
+    options.m_ForceCleanBuild = true;
+    options.m_NoLocalConsumptionOfRemoteJobs = true; // ensure all jobs happen on the remote worker
+    options.m_DistributionPort = Protocol::PROTOCOL_TEST_PORT;
+    options.m_DistributionResultChunkSizeKiB = 1; // Smaller than any object file
+    FBuild fBuild( options );
+
+    TEST_ASSERT( fBuild.Initialize() );
+
+    // start a client to emulate the other end
+    Server s( 1 );
+    s.Listen( Protocol::PROTOCOL_TEST_PORT );
+
+    const char * target( "../tmp/Test/Distributed/dist.lib" );
+    TEST_ASSERT( fBuild.Build( target ) );
+    TEST_ASSERT( FileIO::FileExists( target ) );
+
+    // Files are received alongside their final location, so nothing should be left behind
+    Array< AString > files;
+    FileIO::GetFiles( AStackString<>( "../tmp/Test/Distributed" ), AStackString<>( "*.tmp" ), false, &files );
+    TEST_ASSERT( files.IsEmpty() );
+}
+
 // TestForceInclude
 //------------------------------------------------------------------------------
 void TestDistributed::TestForceInclude() const
@@ -0,0 +1,294 @@
+// TestFileChangeJournal.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/Helpers/FileChangeJournal.h"
+
+// Core
+#include "Core/FileIO/FileIO.h"
+#include "Core/Process/Atomic.h"
+#include "Core/Process/Thread.h"
+#include "Core/Strings/AStackString.h"
+
+// TestFileChangeJournal
+//------------------------------------------------------------------------------
+class TestFileChangeJournal : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void TrackChanges() const;
+    void WatcherNotRunning() const;
+    void ParentDirRenamed() const;
+    void Compaction() const;
+
+    struct WatcherContext
+    {
+        FileChangeJournal * m_Journal;
+        volatile bool       m_Stop;
+    };
+    static uint32_t WatcherThreadFunc( void * userData );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestFileChangeJournal )
+    #if defined( __LINUX__ )
+        REGISTER_TEST( TrackChanges )
+        REGISTER_TEST( WatcherNotRunning )
+        REGISTER_TEST( ParentDirRenamed )
+        REGISTER_TEST( Compaction )
+    #endif
+REGISTER_TESTS_END
+
+// TrackChanges
+//------------------------------------------------------------------------------
+void TestFileChangeJournal::TrackChanges() const
+{
+    // Full paths are needed, as they would be for FileNodes
+    const FBuildTestOptions options;
+    const FBuild fBuild( options );
+
+    AStackString<> unchangedFile;
+    AStackString<> changedFile;
+    AStackString<> deletedFile;
+    AStackString<> createdFile;
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/TrackChanges/unchanged.txt" ), unchangedFile );
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/TrackChanges/changed.txt" ), changedFile );
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/TrackChanges/deleted.txt" ), deletedFile );
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/TrackChanges/created.txt" ), createdFile );
+    const char * const journalFile = "../tmp/Test/FileChangeJournal/TrackChanges/fbuild.fdb.journal";
+
+    EnsureDirExists( "../tmp/Test/FileChangeJournal/TrackChanges/" );
+    MakeFile( unchangedFile.Get(), "unchanged" );
+    MakeFile( changedFile.Get(), "changed" );
+    MakeFile( deletedFile.Get(), "deleted" );
+    EnsureFileDoesNotExist( createdFile );
+
+    // Start watching
+    FileChangeJournal watcher;
+    Array< const AString * > fileNames( 4, false );
+    fileNames.Append( &unchangedFile );
+    fileNames.Append( &changedFile );
+    fileNames.Append( &deletedFile );
+    fileNames.Append( &createdFile );
+    TEST_ASSERT( watcher.StartWatching( journalFile, fileNames ) );
+
+    // Process changes in the background, as the watching process would
+    WatcherContext context;
+    context.m_Journal = &watcher;
+    context.m_Stop = false;
+    Thread thread;
+    thread.Start( WatcherThreadFunc, "Watcher", &context );
+
+    // Make some changes
+    MakeFile( changedFile.Get(), "modified" );
+    MakeFile( createdFile.Get(), "created" );
+    EnsureFileDoesNotExist( deletedFile );
+
+    // Only unchanged files can be trusted
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) );
+        uint64_t stamp = 0;
+        TEST_ASSERT( journal.GetStamp( unchangedFile, stamp ) );
+        TEST_ASSERT( stamp == FileIO::GetFileLastWriteTime( unchangedFile ) );
+        TEST_ASSERT( journal.GetStamp( changedFile, stamp ) == false );
+        TEST_ASSERT( journal.GetStamp( deletedFile, stamp ) == false );
+        TEST_ASSERT( journal.GetStamp( createdFile, stamp ) == false );
+    }
+
+    AtomicStoreRelaxed( &context.m_Stop, true );
+    thread.Join();
+    watcher.StopWatching();
+    TEST_ASSERT( FileIO::FileExists( journalFile ) == false );
+}
+
+// WatcherNotRunning
+//------------------------------------------------------------------------------
+void TestFileChangeJournal::WatcherNotRunning() const
+{
+    const FBuildTestOptions options;
+    const FBuild fBuild( options );
+
+    AStackString<> file;
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/WatcherNotRunning/file.txt" ), file );
+    const char * const journalFile = "../tmp/Test/FileChangeJournal/WatcherNotRunning/fbuild.fdb.journal";
+
+    EnsureDirExists( "../tmp/Test/FileChangeJournal/WatcherNotRunning/" );
+    MakeFile( file.Get(), "file" );
+
+    // No journal
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) == false );
+    }
+
+    // Journal from a watcher which is not processing changes is not trusted
+    {
+        FileChangeJournal watcher;
+        Array< const AString * > fileNames( 1, false );
+        fileNames.Append( &file );
+        TEST_ASSERT( watcher.StartWatching( journalFile, fileNames ) );
+
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile, 100 ) == false );
+    }
+
+    // Stopped watcher has removed the journal
+    TEST_ASSERT( FileIO::FileExists( journalFile ) == false );
+}
+
+// ParentDirRenamed
+//------------------------------------------------------------------------------
+void TestFileChangeJournal::ParentDirRenamed() const
+{
+    const FBuildTestOptions options;
+    const FBuild fBuild( options );
+
+    // Only the journal's directory and the file's directory are watched
+    AStackString<> file;
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent/Dir/file.txt" ), file );
+    const char * const journalFile = "../tmp/Test/FileChangeJournal/ParentDirRenamed/fbuild.fdb.journal";
+
+    // Remove output from previous runs
+    EnsureFileDoesNotExist( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent/Dir/file.txt" );
+    EnsureFileDoesNotExist( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Renamed/Dir/file.txt" );
+    FileIO::DirectoryDelete( AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent/Dir" ) );
+    FileIO::DirectoryDelete( AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent" ) );
+    FileIO::DirectoryDelete( AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Renamed/Dir" ) );
+    FileIO::DirectoryDelete( AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Renamed" ) );
+
+    EnsureDirExists( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent/Dir/" );
+    MakeFile( file.Get(), "file" );
+
+    FileChangeJournal watcher;
+    Array< const AString * > fileNames( 1, false );
+    fileNames.Append( &file );
+    TEST_ASSERT( watcher.StartWatching( journalFile, fileNames ) );
+
+    WatcherContext context;
+    context.m_Journal = &watcher;
+    context.m_Stop = false;
+    Thread thread;
+    thread.Start( WatcherThreadFunc, "Watcher", &context );
+
+    // Unchanged file can be trusted
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) );
+        uint64_t stamp = 0;
+        TEST_ASSERT( journal.GetStamp( file, stamp ) );
+    }
+
+    // Replace the watched directory by renaming its parent. inotify reports
+    // nothing for the watched directory, which now has a different path.
+    TEST_ASSERT( FileIO::FileMove( AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent" ),
+                                   AStackString<>( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Renamed" ) ) );
+    EnsureDirExists( "../tmp/Test/FileChangeJournal/ParentDirRenamed/Root/Parent/Dir/" );
+    MakeFile( file.Get(), "replaced" );
+
+    // File in the replaced directory is not trusted
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) );
+        uint64_t stamp = 0;
+        TEST_ASSERT( journal.GetStamp( file, stamp ) == false );
+    }
+
+    AtomicStoreRelaxed( &context.m_Stop, true );
+    thread.Join();
+}
+
+// Compaction
+//------------------------------------------------------------------------------
+void TestFileChangeJournal::Compaction() const
+{
+    const FBuildTestOptions options;
+    const FBuild fBuild( options );
+
+    AStackString<> unchangedFile;
+    AStackString<> changedFile;
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/Compaction/unchanged.txt" ), unchangedFile );
+    NodeGraph::CleanPath( AStackString<>( "../tmp/Test/FileChangeJournal/Compaction/changed.txt" ), changedFile );
+    const char * const journalFile = "../tmp/Test/FileChangeJournal/Compaction/fbuild.fdb.journal";
+
+    EnsureDirExists( "../tmp/Test/FileChangeJournal/Compaction/" );
+    MakeFile( unchangedFile.Get(), "unchanged" );
+    MakeFile( changedFile.Get(), "changed" );
+
+    FileChangeJournal watcher;
+    Array< const AString * > fileNames( 2, false );
+    fileNames.Append( &unchangedFile );
+    fileNames.Append( &changedFile );
+    TEST_ASSERT( watcher.StartWatching( journalFile, fileNames ) );
+
+    WatcherContext context;
+    context.m_Journal = &watcher;
+    context.m_Stop = false;
+    Thread thread;
+    thread.Start( WatcherThreadFunc, "Watcher", &context );
+
+    // Modify a file, and wait for the watcher to record it
+    MakeFile( changedFile.Get(), "modified" );
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) );
+        uint64_t stamp = 0;
+        TEST_ASSERT( journal.GetStamp( changedFile, stamp ) == false );
+    }
+    FileIO::FileInfo before;
+    TEST_ASSERT( FileIO::GetFileInfo( AStackString<>( journalFile ), before ) );
+
+    // Compact, with the watcher paused
+    AtomicStoreRelaxed( &context.m_Stop, true );
+    thread.Join();
+    TEST_ASSERT( watcher.Compact() );
+    FileIO::FileInfo after;
+    TEST_ASSERT( FileIO::GetFileInfo( AStackString<>( journalFile ), after ) );
+    TEST_ASSERT( after.m_Size < before.m_Size );
+    context.m_Stop = false;
+    Thread thread2;
+    thread2.Start( WatcherThreadFunc, "Watcher", &context );
+
+    // Changed file has been re-stamped
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) );
+        uint64_t stamp = 0;
+        TEST_ASSERT( journal.GetStamp( unchangedFile, stamp ) );
+        TEST_ASSERT( stamp == FileIO::GetFileLastWriteTime( unchangedFile ) );
+        TEST_ASSERT( journal.GetStamp( changedFile, stamp ) );
+        TEST_ASSERT( stamp == FileIO::GetFileLastWriteTime( changedFile ) );
+    }
+
+    // Changes after compaction are still seen
+    MakeFile( changedFile.Get(), "modified again" );
+    {
+        FileChangeJournal journal;
+        TEST_ASSERT( journal.Load( journalFile ) );
+        uint64_t stamp = 0;
+        TEST_ASSERT( journal.GetStamp( changedFile, stamp ) == false );
+    }
+
+    AtomicStoreRelaxed( &context.m_Stop, true );
+    thread2.Join();
+}
+
+// WatcherThreadFunc
+//------------------------------------------------------------------------------
+/*static*/ uint32_t TestFileChangeJournal::WatcherThreadFunc( void * userData )
+{
+    WatcherContext & context = *static_cast< WatcherContext * >( userData );
+    while ( AtomicLoadRelaxed( &context.m_Stop ) == false )
+    {
+        context.m_Journal->Update( 10 );
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
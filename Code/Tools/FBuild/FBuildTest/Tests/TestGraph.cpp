@@ -34,6 +34,9 @@
 #include "Core/Strings/AStackString.h"
 #include "Core/Time/Timer.h"
 
+// system
+#include <stdio.h>
+
 // TestGraph
 //------------------------------------------------------------------------------
 class TestGraph : public FBuildTest
@@ -57,6 +60,9 @@ private:
     void DBVersionChanged() const;
     void FixupErrorPaths() const;
     void CyclicDependency() const;
+    void ShowCriticalPath() const;
+    void CriticalPathOrdering() const;
+    void BFFTokenCache() const;
 };
 
 // Register Tests
@@ -78,6 +84,9 @@ REGISTER_TESTS_BEGIN( TestGraph )
     REGISTER_TEST( DBVersionChanged )
     REGISTER_TEST( FixupErrorPaths )
     REGISTER_TEST( CyclicDependency )
+    REGISTER_TEST( ShowCriticalPath )
+    REGISTER_TEST( CriticalPathOrdering )
+    REGISTER_TEST( BFFTokenCache )
 REGISTER_TESTS_END
 
 // NodeTestHelper
@@ -351,6 +360,10 @@ void TestGraph::TestSerialization() const
         TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile2 ) );
         TEST_ASSERT( FileIO::FileExists( dbFile2 ) );
 
+        // the loaded DB can be saved over, since it is replaced
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile1 ) );
+        TEST_ASSERT( FileIO::FileExists( "../tmp/Test/Graph/fbuild.db.1.tmp" ) == false );
+
         // keep working dir active
 
         // compare the two files
@@ -997,4 +1010,194 @@ void TestGraph::CyclicDependency() const
     }
 }
 
+// ShowCriticalPath
+//------------------------------------------------------------------------------
+void TestGraph::ShowCriticalPath() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/DeepGraph.bff";
+    const char * const dbFile = "../tmp/Test/Graph/ShowCriticalPath.fdb";
+
+    // Build once to record build times
+    {
+        options.m_ForceCleanBuild = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    // Build again, predicting the critical path from the recorded times
+    options.m_ForceCleanBuild = false;
+    options.m_ShowCriticalPath = true;
+    FBuildForTest fBuild( options );
+    TEST_ASSERT( fBuild.Initialize( dbFile ) );
+    TEST_ASSERT( fBuild.Build( "all" ) );
+
+    // The critical path passes through the only compilation, which all targets depend on
+    Array< const Node * > objectNodes;
+    fBuild.GetNodesOfType( Node::OBJECT_NODE, objectNodes );
+    TEST_ASSERT( objectNodes.GetSize() == 1 );
+    const Node * objectNode = objectNodes[ 0 ];
+    TEST_ASSERT( objectNode->GetLastBuildTime() > 0 );
+
+    const AString & output = GetRecordedOutput();
+    const char * pos = output.Find( "Critical Path (predicted from previous build times): " );
+    TEST_ASSERT( pos );
+    double reportedCost = 0.0;
+    TEST_ASSERT( sscanf( pos, "Critical Path (predicted from previous build times): %lfs", &reportedCost ) == 1 );
+
+    // Steps are reported in order from the start of the path to the target
+    Array< AString > steps;
+    uint32_t stepsCost = 0;
+    for ( pos = output.Find( '\n', pos ) + 1; pos[ 0 ] == ' '; pos = output.Find( '\n', pos ) + 1 )
+    {
+        double stepTime = 0.0;
+        char stepName[ 256 ];
+        TEST_ASSERT( sscanf( pos, " %lfs : %255[^\n]", &stepTime, stepName ) == 2 );
+        stepsCost += (uint32_t)( stepTime * 1000.0 + 0.5 );
+        steps.EmplaceBack( stepName );
+    }
+    TEST_ASSERT( steps.GetSize() >= 3 );
+    const AString * objectStep = steps.Find( objectNode->GetName() );
+    TEST_ASSERT( objectStep );
+    TEST_ASSERT( *( objectStep + 1 ) == "ObjectList_0" );
+    TEST_ASSERT( steps.Top() == "all" );
+
+    // The reported cost is the sum of the steps, and includes the compilation
+    TEST_ASSERT( (uint32_t)( reportedCost * 1000.0 + 0.5 ) == stepsCost );
+    TEST_ASSERT( stepsCost >= objectNode->GetLastBuildTime() );
+}
+
+// CriticalPathOrdering
+//------------------------------------------------------------------------------
+void TestGraph::CriticalPathOrdering() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/CriticalPath/fbuild.bff";
+    options.m_NumWorkerThreads = 1; // Start steps one at a time, in priority order
+    const char * const dbFile = "../tmp/Test/Graph/CriticalPath/fbuild.fdb";
+    const char * const short1 = "../tmp/Test/Graph/CriticalPath/short1.txt";
+    const char * const longA = "../tmp/Test/Graph/CriticalPath/longA.txt";
+    const char * const longB = "../tmp/Test/Graph/CriticalPath/longB.txt";
+    const char * const outputFiles[] = { short1,
+                                         "../tmp/Test/Graph/CriticalPath/short2.txt",
+                                         "../tmp/Test/Graph/CriticalPath/short3.txt",
+                                         "../tmp/Test/Graph/CriticalPath/short4.txt",
+                                         longA,
+                                         longB };
+
+    // Obtain the destination of the first copy started since the given point in the output
+    auto getFirstCopy = [ this ]( const char * start, AString & outDest )
+    {
+        const char * copy = GetRecordedOutput().Find( "Copy: ", start );
+        TEST_ASSERT( copy );
+        const char * dest = GetRecordedOutput().Find( " -> ", copy );
+        const char * lineEnd = GetRecordedOutput().Find( '\n', copy );
+        TEST_ASSERT( dest && lineEnd && ( dest < lineEnd ) );
+        outDest.Assign( dest + 4, lineEnd );
+    };
+
+    // Build once to create the DB
+    {
+        options.m_ForceCleanBuild = true;
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+    options.m_ForceCleanBuild = false;
+
+    // Rebuild everything with the given previous build times for the first short
+    // step and the steps of the long chain, returning the first step started
+    auto buildWithTimes = [ & ]( uint32_t short1Time, uint32_t longATime, uint32_t longBTime, AString & outFirstCopy )
+    {
+        {
+            FBuildForTest fBuild( options );
+            TEST_ASSERT( fBuild.Initialize( dbFile ) );
+            Node * short1Node = fBuild.GetNode( short1 );
+            Node * longANode = fBuild.GetNode( longA );
+            Node * longBNode = fBuild.GetNode( longB );
+            TEST_ASSERT( short1Node && longANode && longBNode );
+            short1Node->SetLastBuildTime( short1Time );
+            longANode->SetLastBuildTime( longATime );
+            longBNode->SetLastBuildTime( longBTime );
+            TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        }
+
+        for ( const char * outputFile : outputFiles )
+        {
+            EnsureFileDoesNotExist( outputFile );
+        }
+        const size_t outputOffset = GetRecordedOutput().GetLength();
+
+        FBuildForTest fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        CheckStatsNode( 6, 6, Node::COPY_FILE_NODE );
+
+        getFirstCopy( GetRecordedOutput().Get() + outputOffset, outFirstCopy );
+    };
+
+    // A step slower than the whole chain is started first
+    {
+        AStackString<> firstCopy;
+        buildWithTimes( 700, 300, 300, firstCopy );
+        TEST_ASSERT( firstCopy.EndsWith( "short1.txt" ) );
+    }
+
+    // The chain is started first once it takes longer in total, even though
+    // each of its steps is faster than the slowest short step
+    {
+        AStackString<> firstCopy;
+        buildWithTimes( 500, 300, 300, firstCopy );
+        TEST_ASSERT( firstCopy.EndsWith( "longA.txt" ) );
+    }
+}
+
+// BFFTokenCache
+//------------------------------------------------------------------------------
+void TestGraph::BFFTokenCache() const
+{
+    FBuildTestOptions options;
+    options.m_ConfigFile = "Tools/FBuild/FBuildTest/Data/TestGraph/TokenCache/fbuild.bff";
+
+    const char * const dbFile = "../tmp/Test/Graph/TokenCache/fbuild.fdb";
+    const char * const tokenCacheFile = "../tmp/Test/Graph/TokenCache/fbuild.fdb.tokens";
+    const char * const outputFile = "../tmp/Test/Graph/TokenCache/textfile.txt";
+    EnsureFileDoesNotExist( dbFile );
+    EnsureFileDoesNotExist( tokenCacheFile );
+    EnsureFileDoesNotExist( outputFile );
+
+    // Parse and save DB, creating token cache
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize() );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+        TEST_ASSERT( FileIO::FileExists( tokenCacheFile ) );
+    }
+
+    // Reparse, using token cache
+    options.m_ForceDBMigration_Debug = true;
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+        TEST_ASSERT( FileIO::FileExists( outputFile ) );
+        TEST_ASSERT( fBuild.SaveDependencyGraph( dbFile ) );
+    }
+
+    // Corrupt token cache is ignored
+    {
+        FileStream fs;
+        TEST_ASSERT( fs.Open( tokenCacheFile, FileStream::WRITE_ONLY ) );
+        TEST_ASSERT( fs.WriteBuffer( "BTC", 3 ) == 3 );
+    }
+    {
+        FBuild fBuild( options );
+        TEST_ASSERT( fBuild.Initialize( dbFile ) );
+        TEST_ASSERT( fBuild.Build( "all" ) );
+    }
+}
+
 //------------------------------------------------------------------------------
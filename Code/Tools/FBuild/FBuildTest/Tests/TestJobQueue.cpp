@@ -0,0 +1,286 @@
+// TestJobQueue.cpp
+//------------------------------------------------------------------------------
+
+// Includes
+//------------------------------------------------------------------------------
+#include "FBuildTest.h"
+
+// FBuildCore
+#include "Tools/FBuild/FBuildCore/FBuild.h"
+#include "Tools/FBuild/FBuildCore/Graph/FileNode.h"
+#include "Tools/FBuild/FBuildCore/Graph/NodeGraph.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/Job.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/JobQueue.h"
+
+// Core
+#include "Core/Containers/Array.h"
+#include "Core/Strings/AStackString.h"
+
+// Defines
+//------------------------------------------------------------------------------
+namespace
+{
+    constexpr uint64_t kToolA = 0xAAAAAAAAAAAAAAAA;
+    constexpr uint64_t kToolB = 0xBBBBBBBBBBBBBBBB;
+    constexpr uint64_t kToolC = 0xCCCCCCCCCCCCCCCC;
+}
+
+// TestJobQueue
+//------------------------------------------------------------------------------
+class TestJobQueue : public FBuildTest
+{
+private:
+    DECLARE_TESTS
+
+    void HeapRemoveRoot() const;
+    void HeapRemoveMiddle() const;
+    void HeapRemoveLast() const;
+    void HeapRemoveEveryIndex() const;
+    void PreferToolchains() const;
+    void MostExpensive() const;
+
+    // Helpers
+    static Job * CreateJob( NodeGraph & ng, uint32_t cost );
+    static void CreateHeap( NodeGraph & ng, Array< Job * > & heap );
+    static void CheckRemove( Array< Job * > & heap, size_t index );
+    static void DeleteJobs( const Array< Job * > & jobs );
+};
+
+// Register Tests
+//------------------------------------------------------------------------------
+REGISTER_TESTS_BEGIN( TestJobQueue )
+    REGISTER_TEST( HeapRemoveRoot )
+    REGISTER_TEST( HeapRemoveMiddle )
+    REGISTER_TEST( HeapRemoveLast )
+    REGISTER_TEST( HeapRemoveEveryIndex )
+    REGISTER_TEST( PreferToolchains )
+    REGISTER_TEST( MostExpensive )
+REGISTER_TESTS_END
+
+// HeapRemoveRoot
+//------------------------------------------------------------------------------
+void TestJobQueue::HeapRemoveRoot() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    Array< Job * > heap;
+    CreateHeap( ng, heap );
+    const Array< Job * > jobs( heap );
+
+    CheckRemove( heap, 0 );
+    DeleteJobs( jobs );
+}
+
+// HeapRemoveMiddle
+//------------------------------------------------------------------------------
+void TestJobQueue::HeapRemoveMiddle() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    Array< Job * > heap;
+    CreateHeap( ng, heap );
+    const Array< Job * > jobs( heap );
+
+    CheckRemove( heap, heap.GetSize() / 2 );
+    DeleteJobs( jobs );
+
+    // Pushed in heap order, so each job stays where it is pushed:
+    //   [0] 100
+    //   [1] 10, [2] 90, [3] 90, [4] 90
+    //   [5..8] 5 (children of [1]), [9] 50 (child of [2])
+    const uint32_t costs[] = { 100, 10, 90, 90, 90, 5, 5, 5, 5, 50 };
+    for ( const uint32_t cost : costs )
+    {
+        JobHeap::Push( heap, CreateJob( ng, cost ) );
+    }
+    const Array< Job * > jobs2( heap );
+
+    // The last job replaces the removed one, and is more expensive than its new
+    // parent, so moves towards the root
+    Job * const last = heap.Top();
+    Job * const removed = heap[ 5 ];
+    TEST_ASSERT( JobHeap::Remove( heap, 5 ) == removed );
+    TEST_ASSERT( heap[ 1 ] == last );
+    TEST_ASSERT( heap[ 5 ] == jobs2[ 1 ] );
+    CheckRemove( heap, 0 );
+    DeleteJobs( jobs2 );
+}
+
+// HeapRemoveLast
+//------------------------------------------------------------------------------
+void TestJobQueue::HeapRemoveLast() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    Array< Job * > heap;
+    CreateHeap( ng, heap );
+    const Array< Job * > jobs( heap );
+
+    CheckRemove( heap, heap.GetSize() - 1 );
+    DeleteJobs( jobs );
+}
+
+// HeapRemoveEveryIndex
+//------------------------------------------------------------------------------
+void TestJobQueue::HeapRemoveEveryIndex() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    Array< Job * > heap;
+    CreateHeap( ng, heap );
+
+    // The job moved into the removed job's place can need to move towards the
+    // root or the leaves, depending on where it is removed from
+    const size_t numJobs = heap.GetSize();
+    for ( size_t i = 0; i < numJobs; ++i )
+    {
+        Array< Job * > copy( heap );
+        CheckRemove( copy, i );
+    }
+    DeleteJobs( heap );
+}
+
+// PreferToolchains
+//------------------------------------------------------------------------------
+void TestJobQueue::PreferToolchains() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    DistributableJobs jobs;
+
+    // The worker has A, no worker has B and another worker has C
+    Job * const a1 = CreateJob( ng, 10 );
+    Job * const a2 = CreateJob( ng, 20 );
+    Job * const b1 = CreateJob( ng, 50 );
+    Job * const c1 = CreateJob( ng, 100 );
+    jobs.Push( a1, kToolA );
+    jobs.Push( b1, kToolB );
+    jobs.Push( c1, kToolC );
+    jobs.Push( a2, kToolA );
+    TEST_ASSERT( jobs.GetSize() == 4 );
+    TEST_ASSERT( jobs.GetNumToolchains() == 3 );
+
+    Array< uint64_t > toolIds;
+    toolIds.Append( kToolA );
+    Array< uint64_t > otherToolIds;
+    otherToolIds.Append( kToolC );
+
+    // Jobs not needing a sync are preferred, most expensive first
+    Job * job = jobs.Pop( toolIds, otherToolIds, false );
+    TEST_ASSERT( job == a2 );
+    FDELETE job;
+    job = jobs.Pop( toolIds, otherToolIds, false );
+    TEST_ASSERT( job == a1 );
+    FDELETE job;
+    TEST_ASSERT( jobs.GetNumToolchains() == 2 ); // Toolchains with no jobs are dropped
+
+    // Then jobs needing a sync no other worker has
+    job = jobs.Pop( toolIds, otherToolIds, false );
+    TEST_ASSERT( job == b1 );
+    FDELETE job;
+
+    // Jobs for toolchains other workers have are left for them
+    TEST_ASSERT( jobs.Pop( toolIds, otherToolIds, false ) == nullptr );
+    TEST_ASSERT( jobs.GetSize() == 1 );
+
+    // Unless syncing is allowed
+    job = jobs.Pop( toolIds, otherToolIds, true );
+    TEST_ASSERT( job == c1 );
+    FDELETE job;
+    TEST_ASSERT( jobs.IsEmpty() );
+    TEST_ASSERT( jobs.GetNumToolchains() == 0 );
+    TEST_ASSERT( jobs.Pop( toolIds, otherToolIds, true ) == nullptr );
+
+    // A toolchain can be used again after its jobs were all taken
+    jobs.Push( CreateJob( ng, 10 ), kToolA );
+    job = jobs.Pop( toolIds, otherToolIds, false );
+    TEST_ASSERT( job && ( job->GetNode()->GetRecursiveCost() == 10 ) );
+    FDELETE job;
+    TEST_ASSERT( jobs.GetNumToolchains() == 0 );
+}
+
+// MostExpensive
+//------------------------------------------------------------------------------
+void TestJobQueue::MostExpensive() const
+{
+    FBuild fb;
+    NodeGraph ng;
+    DistributableJobs jobs;
+
+    // Without toolchain info, jobs are taken in cost order across all toolchains
+    const uint32_t costs[] = { 30, 10, 60, 20, 50, 40 };
+    const uint64_t tools[] = { kToolA, kToolB, kToolC };
+    for ( size_t i = 0; i < ( sizeof( costs ) / sizeof( costs[ 0 ] ) ); ++i )
+    {
+        jobs.Push( CreateJob( ng, costs[ i ] ), tools[ i % 3 ] );
+    }
+
+    uint32_t expectedCost = 60;
+    while ( Job * job = jobs.Pop() )
+    {
+        TEST_ASSERT( job->GetNode()->GetRecursiveCost() == expectedCost );
+        expectedCost -= 10;
+        FDELETE job;
+    }
+    TEST_ASSERT( expectedCost == 0 );
+    TEST_ASSERT( jobs.IsEmpty() );
+}
+
+// CreateJob
+//------------------------------------------------------------------------------
+/*static*/ Job * TestJobQueue::CreateJob( NodeGraph & ng, uint32_t cost )
+{
+    AStackString<> name;
+    name.Format( "file%zu", ng.GetNodeCount() );
+    FileNode * node = ng.CreateFileNode( name );
+    node->m_RecursiveCost = cost;
+    return FNEW( Job( node ) );
+}
+
+// CreateHeap
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::CreateHeap( NodeGraph & ng, Array< Job * > & heap )
+{
+    // Costs in a scrambled order, with duplicates, spanning several levels
+    for ( uint32_t i = 0; i < 64; ++i )
+    {
+        JobHeap::Push( heap, CreateJob( ng, ( i * 37 ) % 50 ) );
+    }
+}
+
+// CheckRemove
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::CheckRemove( Array< Job * > & heap, size_t index )
+{
+    const size_t numJobs = heap.GetSize();
+    Job * const expected = heap[ index ];
+    TEST_ASSERT( JobHeap::Remove( heap, index ) == expected );
+    TEST_ASSERT( heap.GetSize() == ( numJobs - 1 ) );
+    TEST_ASSERT( heap.Find( expected ) == nullptr );
+
+    // Remaining jobs are still consumed most expensive first
+    Array< Job * > removed;
+    while ( heap.IsEmpty() == false )
+    {
+        Job * job = JobHeap::Pop( heap );
+        if ( removed.IsEmpty() == false )
+        {
+            TEST_ASSERT( job->GetNode()->GetRecursiveCost() <= removed.Top()->GetNode()->GetRecursiveCost() );
+        }
+        removed.Append( job );
+    }
+    TEST_ASSERT( removed.GetSize() == ( numJobs - 1 ) );
+    TEST_ASSERT( removed.Find( expected ) == nullptr );
+}
+
+// DeleteJobs
+//------------------------------------------------------------------------------
+/*static*/ void TestJobQueue::DeleteJobs( const Array< Job * > & jobs )
+{
+    for ( Job * job : jobs )
+    {
+        FDELETE job;
+    }
+}
+
+//------------------------------------------------------------------------------
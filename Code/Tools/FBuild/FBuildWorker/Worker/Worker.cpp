@@ -19,6 +19,7 @@
 #include "Tools/FBuild/FBuildCore/Protocol/Protocol.h"
 #include "Tools/FBuild/FBuildCore/Protocol/Server.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/JobQueueRemote.h"
+#include "Tools/FBuild/FBuildCore/WorkerPool/WorkerConnectionPool.h"
 #include "Tools/FBuild/FBuildCore/WorkerPool/WorkerThreadRemote.h"
 
 // Core
@@ -363,7 +364,14 @@ void Worker::UpdateAvailability()
 
     WorkerThreadRemote::SetNumCPUsToUse( numCPUsToUse );
 
-    m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0 );
+    // let the coordinator know how busy we are and which toolchains we have
+    WorkerLoad load;
+    load.m_NumCPUs = (uint16_t)numCPUsToUse;
+    load.m_NumJobsActive = (uint16_t)JobQueueRemote::Get().GetNumJobsActive();
+    load.m_NumJobsQueued = (uint16_t)JobQueueRemote::Get().GetNumJobsQueued();
+    m_ConnectionPool->GetSynchronizedToolIds( load.m_ToolIds );
+
+    m_WorkerBrokerage.SetAvailability( numCPUsToUse > 0, &load );
 }
 
 // UpdateUI
@@ -0,0 +1,6 @@
+#include "string.h"
+
+const char * FunctionA()
+{
+    return "FunctionAString";
+}
@@ -0,0 +1 @@
+const char * FunctionB() { return "Modified"; }
@@ -0,0 +1,9 @@
+// Auto-generated Unity file - do not modify
+
+//#pragma message( "/root/repo/tmp/Test/Object/StaleDynamicDeps/Generated/FileA.cpp" )
+#include "/root/repo/tmp/Test/Object/StaleDynamicDeps/Generated/FileA.cpp"
+
+//#pragma message( "/root/repo/tmp/Test/Object/StaleDynamicDeps/Generated/FileC.cpp" )
+#include "/root/repo/tmp/Test/Object/StaleDynamicDeps/Generated/FileC.cpp"
+
+